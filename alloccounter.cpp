@@ -0,0 +1,88 @@
+#include "alloccounter.h"
+
+#ifdef DRONES_ALLOC_COUNTER
+
+#include <cstdlib>
+#include <new>
+#ifdef Q_OS_WIN
+#include <malloc.h>
+#endif
+
+namespace {
+    thread_local std::size_t nbAllocations=0; ///< allocations done by the current thread
+
+    void *countedAlloc(std::size_t size) {
+        ++nbAllocations;
+        void *p=std::malloc(size ? size : 1);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+
+    /// allocation of an over-aligned type (alignas beyond __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    void *alignedAlloc(std::size_t size,std::align_val_t alignment) noexcept {
+        ++nbAllocations;
+        const std::size_t align=std::size_t(alignment);
+#ifdef Q_OS_WIN
+        return _aligned_malloc(size ? size : 1,align);
+#else
+        // the size of aligned_alloc is a multiple of the alignment
+        return std::aligned_alloc(align,(size+align-1)/align*align);
+#endif
+    }
+
+    void alignedFree(void *p) noexcept {
+#ifdef Q_OS_WIN
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+    void *countedAlignedAlloc(std::size_t size,std::align_val_t alignment) {
+        void *p=alignedAlloc(size,alignment);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+}
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+void *operator new(std::size_t size,const std::nothrow_t&) noexcept {
+    ++nbAllocations;
+    return std::malloc(size ? size : 1);
+}
+void *operator new[](std::size_t size,const std::nothrow_t&) noexcept {
+    ++nbAllocations;
+    return std::malloc(size ? size : 1);
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p,std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p,std::size_t) noexcept { std::free(p); }
+void operator delete(void *p,const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void *p,const std::nothrow_t&) noexcept { std::free(p); }
+
+void *operator new(std::size_t size,std::align_val_t alignment) { return countedAlignedAlloc(size,alignment); }
+void *operator new[](std::size_t size,std::align_val_t alignment) { return countedAlignedAlloc(size,alignment); }
+void *operator new(std::size_t size,std::align_val_t alignment,const std::nothrow_t&) noexcept {
+    return alignedAlloc(size,alignment);
+}
+void *operator new[](std::size_t size,std::align_val_t alignment,const std::nothrow_t&) noexcept {
+    return alignedAlloc(size,alignment);
+}
+void operator delete(void *p,std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void *p,std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void *p,std::size_t,std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void *p,std::size_t,std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void *p,std::align_val_t,const std::nothrow_t&) noexcept { alignedFree(p); }
+void operator delete[](void *p,std::align_val_t,const std::nothrow_t&) noexcept { alignedFree(p); }
+
+bool AllocCounter::enabled() { return true; }
+std::size_t AllocCounter::count() { return nbAllocations; }
+
+#else
+
+bool AllocCounter::enabled() { return false; }
+std::size_t AllocCounter::count() { return 0; }
+
+#endif
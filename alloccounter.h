@@ -0,0 +1,55 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <cstddef>
+#include <QtGlobal>
+
+/**
+ * @brief Opt-in heap allocation counter.
+ * Build with "qmake CONFIG+=alloc_counter" to replace the global operator new
+ * and count the allocations made by each thread. Without that flag every
+ * function below is a no-op and count() always returns 0.
+ */
+namespace AllocCounter {
+    /**
+     * @brief enabled
+     * @return true if the counter was compiled in
+     */
+    bool enabled();
+    /**
+     * @brief count number of heap allocations done by the calling thread
+     * @return the number of allocations since the start of the thread
+     */
+    std::size_t count();
+}
+
+/**
+ * @brief AllocGuard aborts the application (qFatal, in release builds too) if a heap allocation
+ * happens in its scope. Used around the simulation substeps of a tick once the world is in
+ * steady state.
+ */
+class AllocGuard {
+public:
+    /**
+     * @brief AllocGuard constructor
+     * @param p_armed: if false the guard does not check anything (warm-up ticks)
+     */
+    explicit AllocGuard(bool p_armed=true):armed(p_armed),start(AllocCounter::count()) {}
+    ~AllocGuard() {
+        if (armed && AllocCounter::enabled() && AllocCounter::count()!=start) {
+            qFatal("AllocGuard: %zu heap allocations in the simulation tick",AllocCounter::count()-start);
+        }
+    }
+    AllocGuard(const AllocGuard&)=delete;
+    AllocGuard& operator=(const AllocGuard&)=delete;
+private:
+    bool armed;        ///< true if the scope is checked
+    std::size_t start; ///< allocation count when entering the scope
+};
+
+#endif // ALLOCCOUNTER_H
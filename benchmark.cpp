@@ -0,0 +1,607 @@
+#include "benchmark.h"
+#include "alloccounter.h"
+#include "canvas.h"
+#include "collisionavoidance.h"
+#include "commandserver.h"
+#include "drone.h"
+#include "dronescheduler.h"
+#include "fleetrouter.h"
+#include "missiondispatcher.h"
+#include "scenario.h"
+#include "shardhub.h"
+#include "vector2d.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QMap>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace {
+/// minimum time of a measure, repeated until reached
+const qint64 minimumNs = 500000000;
+/// servers of the synthetic world
+const int worldServers = 400;
+/// distance between two servers of the synthetic world
+const float serverSpacing = 300;
+/// servers receiving all the missions of a clustered batch
+const int hotServers = 10;
+/// commands per second written by the client of the command benchmark
+const int commandRate = 100000;
+/// duration of the stream of commands
+const int commandSeconds = 5;
+/// ticks before the measure of the steady ticks (take-offs and first landings)
+const int warmupTicks = 100;
+/// measured ticks of the steady traffic
+const int steadyTicks = 600;
+/// servers of the sharded world, on a grid of shardColumns x shardRows
+const int shardColumns = 16, shardRows = 12;
+/// simulated seconds of a sharded run, measured from the first tick
+const double shardSeconds = 60;
+/// wall time given to a sharded run (start of the workers included)
+const int shardTimeoutMs = 300000;
+
+/**
+ * @brief A synthetic fleet spread over a square of constant density
+ */
+struct Fleet {
+    QVector<Vector2D> positions, velocities, goals;
+    QVector<int> neighbors; ///< CollisionAvoidance::maxNeighbors indices per drone
+
+    explicit Fleet(int drones) {
+        std::mt19937 random(1);
+        const float side = 40.0f * std::sqrt(float(drones)); // about 40 units between neighbours
+        std::uniform_real_distribution<float> coordinate(0, side), speed(-50, 50);
+        std::uniform_int_distribution<int> other(0, drones - 1);
+        for (int i = 0; i < drones; i++) {
+            positions.append(Vector2D(coordinate(random), coordinate(random)));
+            velocities.append(Vector2D(speed(random), speed(random)));
+            goals.append(Vector2D(coordinate(random), coordinate(random)));
+            for (int k = 0; k < CollisionAvoidance::maxNeighbors; k++) {
+                neighbors.append(other(random));
+            }
+        }
+    }
+};
+
+/**
+ * @brief gridWorld servers on a jittered square grid, serverSpacing apart: about 8 connections
+ * per server (see Scenario::connectionDistance)
+ * @param count: number of servers, rounded to a square
+ * @return the world with its routing table
+ */
+Scenario gridWorld(int count) {
+    Scenario world;
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> jitter(-0.2f * serverSpacing, 0.2f * serverSpacing);
+    const int side = std::max(2, int(std::lround(std::sqrt(double(count)))));
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            Server server;
+            server.name = QString("S%1").arg(world.servers.size());
+            server.position = Vector2D(serverSpacing * (x + 1) + jitter(random), serverSpacing * (y + 1) + jitter(random));
+            world.serverIndex.insert(server.name, world.servers.size());
+            world.servers.append(server);
+        }
+    }
+    world.buildConnections();
+    world.buildRoutingTable();
+    return world;
+}
+
+/**
+ * @brief measure repeats a pass over the fleet until minimumNs
+ * @param drones: number of drones of a pass
+ * @param pass: the pass
+ * @return ns per drone
+ */
+template <class F>
+double measure(int drones, F &&pass) {
+    QElapsedTimer timer;
+    timer.start();
+    qint64 passes = 0;
+    do {
+        pass();
+        passes++;
+    } while (timer.nsecsElapsed() < minimumNs);
+    return double(timer.nsecsElapsed()) / (passes * drones);
+}
+
+/**
+ * @brief vectorMath the vector arithmetic of a flying drone per step: the steering of
+ * Drone::preferredVelocity and Drone::move, and the swept test of Drone::addCollision against
+ * CollisionAvoidance::maxNeighbors neighbours. The checksum keeps the results alive.
+ */
+void vectorMath(QTextStream &out, int drones) {
+    Fleet fleet(drones);
+    const float dt = 0.02f, maxSpeed = 50, threshold = 10;
+    float checksum = 0;
+    const double steer = measure(drones, [&]() {
+        for (int i = 0; i < drones; i++) {
+            Vector2D toGoal = fleet.goals[i] - fleet.positions[i];
+            const float distance = toGoal.normalizeLength();
+            fleet.velocities[i] = toGoal * std::min(maxSpeed, distance);
+            fleet.positions[i] += fleet.velocities[i] * dt;
+            const Vector2D &heading = fleet.velocities[i];
+            checksum += heading.x == 0 ? 0 : float(-std::atan2(heading.x, heading.y) * 180.0 / M_PI);
+        }
+    });
+    int collisions = 0;
+    const double sweep = measure(drones, [&]() {
+        const int *neighbor = fleet.neighbors.constData();
+        for (int i = 0; i < drones; i++) {
+            const Vector2D &A = fleet.positions[i], &VA = fleet.velocities[i];
+            for (int k = 0; k < CollisionAvoidance::maxNeighbors; k++, neighbor++) {
+                Vector2D AB = fleet.positions[*neighbor] - A;
+                Vector2D W = fleet.velocities[*neighbor] - VA;
+                float w2 = W.lengthSquared();
+                float t = 0;
+                if (w2 > 0) {
+                    t = std::clamp(-(AB * W) / w2, 0.0f, dt);
+                }
+                Vector2D ABt = AB + t * W;
+                collisions += ABt.lengthSquared() < threshold * threshold;
+            }
+        }
+    });
+    out << "vector drones " << drones << " steer_ns " << steer << " sweep_ns " << sweep
+        << " checksum " << checksum + collisions << Qt::endl;
+}
+
+/**
+ * @brief routing FleetRouter on a batch of drones with random origins and targets:
+ * - search: every drone searches its route (a new target for the whole fleet), per drone
+ * - tick: the loads are counted again and the whole fleet is routed, 1 drone in 20 entering the
+ *   region of its next hop (the others keep their hop), per batch
+ */
+void routing(QTextStream &out, int drones) {
+    const Scenario world = gridWorld(worldServers);
+    const int servers = world.servers.size();
+    FleetRouter router;
+    router.reset(world);
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int> server(0, servers - 1);
+    QVector<Drone*> fleet;
+    QVector<int> current, target;
+    for (int i = 0; i < drones; i++) {
+        fleet.append(new Drone(QString("D%1").arg(i)));
+        current.append(server(random));
+        int t;
+        do {
+            t = server(random);
+        } while (t == current.last());
+        target.append(t);
+    }
+    const double search = measure(drones, [&]() {
+        for (Drone *drone : fleet) {
+            drone->route() = Drone::Route();
+        }
+        router.countLoads(fleet);
+        for (int i = 0; i < drones; i++) {
+            router.route(fleet[i], current[i], target[i]);
+        }
+    });
+    int turn = 0;
+    const double tick = measure(drones, [&]() {
+        router.countLoads(fleet);
+        for (int i = 0; i < drones; i++) {
+            int next = router.route(fleet[i], current[i], target[i]);
+            if ((i + turn) % 20 == 0 && next >= 0) {
+                current[i] = next;
+                if (next == target[i]) {
+                    target[i] = (next + 1 + server(random) % (servers - 1)) % servers;
+                }
+            }
+        }
+        turn++;
+    });
+    qDeleteAll(fleet);
+    out << "router servers " << servers << " drones " << drones << " search_us " << search / 1000
+        << " tick_ms " << tick * drones / 1.0e6 << Qt::endl;
+}
+
+/**
+ * @brief dispatching MissionDispatcher on a batch of missions, half as many as the landed drones
+ * spread over the synthetic world, each drone able to fly a third of the world, per batch:
+ * - spread: the targets are random servers (several missions per server)
+ * - clustered: the targets are hotServers servers, more missions than the drones around them
+ * for each objective, with the assigned missions, the total distance and the longest flight.
+ */
+void dispatching(QTextStream &out, int drones) {
+    const Scenario world = gridWorld(worldServers);
+    const int servers = world.servers.size();
+    const float side = serverSpacing * (std::sqrt(float(servers)) + 1);
+    std::mt19937 random(4);
+    std::uniform_real_distribution<float> coordinate(0, side);
+    std::uniform_int_distribution<int> server(0, servers - 1), hot(0, hotServers - 1);
+    QVector<Vector2D> positions;
+    QVector<float> ranges(drones, side / 3);
+    for (int i = 0; i < drones; i++) {
+        positions.append(Vector2D(coordinate(random), coordinate(random)));
+    }
+    QVector<int> hotServer;
+    for (int h = 0; h < hotServers; h++) {
+        hotServer.append(server(random));
+    }
+    QVector<Vector2D> spread, clustered;
+    for (int m = 0; m < drones / 2; m++) {
+        spread.append(world.servers[server(random)].position);
+        clustered.append(world.servers[hotServer[hot(random)]].position);
+    }
+    MissionDispatcher dispatcher;
+    QVector<int> droneOfMission;
+    for (const auto &objective : {qMakePair(MissionDispatcher::minimizeTotal, QString("total")),
+                                  qMakePair(MissionDispatcher::minimizeMakespan, QString("makespan"))}) {
+        dispatcher.objective = objective.first;
+        for (const auto &batch : {qMakePair(&spread, QString("spread")), qMakePair(&clustered, QString("clustered"))}) {
+            int assigned = 0;
+            const double batchNs = measure(1, [&]() {
+                assigned = dispatcher.assign(positions, ranges, *batch.first, droneOfMission);
+            });
+            out << "dispatch drones " << drones << " missions " << batch.first->size() << " " << batch.second
+                << " objective " << objective.second << " ms " << batchNs / 1.0e6 << " assigned " << assigned
+                << " bids " << dispatcher.bids() << " total " << dispatcher.totalDistance()
+                << " longest " << dispatcher.longestFlight() << Qt::endl;
+        }
+    }
+}
+
+/**
+ * @brief streamCommands writes commandRate lines per second on the command socket for
+ * commandSeconds (client thread): "speed" lines carrying their number as the value, and one
+ * "goto" line in 4
+ * @param name: name of the local socket
+ * @param drones: number of drones of the canvas
+ * @param servers: number of servers
+ * @param sent: receives the time each line is written
+ */
+void streamCommands(const QString &name, int drones, int servers, QVector<qint64> &sent) {
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    while (!socket.waitForConnected(100)) { // the receiver thread listens asynchronously
+        QThread::msleep(10);
+        socket.connectToServer(name);
+    }
+    QByteArray chunk;
+    const qint64 start = CommandServer::clock();
+    int next = 0;
+    while (next < sent.size()) {
+        const qint64 now = CommandServer::clock();
+        const int due = std::min<qint64>(sent.size(), (now - start) * commandRate / 1000000000);
+        chunk.resize(0);
+        for (; next < due; next++) {
+            sent[next] = now;
+            if (next % 4 == 3) {
+                chunk += "goto D" + QByteArray::number(next % drones) + " S" + QByteArray::number(next % servers) + "\n";
+            } else {
+                chunk += "speed D" + QByteArray::number(next % drones) + " " + QByteArray::number(next) + "\n";
+            }
+        }
+        if (!chunk.isEmpty()) {
+            socket.write(chunk);
+            socket.waitForBytesWritten(-1);
+        }
+        QThread::usleep(200);
+    }
+    socket.waitForBytesWritten(-1);
+    socket.disconnectFromServer();
+}
+
+/**
+ * @brief commanding the whole path of the commands, end to end: a client thread streams
+ * commandRate lines per second on the local socket, the receiver thread parses and queues them,
+ * and at each tick the simulation thread takes the batch and applies it to a canvas of drones
+ * (like MainWindow::update), for the tick of the real time (100 ms) and of the time warp (10 ms).
+ * The latency runs from the write of a "speed" line by the client to the end of the tick that
+ * applied it. The allocations are the heap allocations of the simulation thread per command
+ * (CONFIG+=alloc_counter, -1 without).
+ */
+void commanding(QTextStream &out, int drones) {
+    Scenario world = gridWorld(100);
+    const int servers = world.servers.size();
+    for (int i = 0; i < drones; i++) {
+        world.drones.append(DroneSpec{QString("D%1").arg(i), world.servers[i % servers].position,
+                                      world.servers[(i + 1) % servers].name, QString()});
+    }
+    QMap<QString, Drone*> map;
+    Canvas canvas;
+    canvas.setMap(&map);
+    canvas.applyScenario(world);
+    const int total = commandRate * commandSeconds;
+    for (int tickMs : {100, 10}) {
+        CommandServer commands;
+        const QString name = QString("drones-bench-%1").arg(QCoreApplication::applicationPid());
+        commands.listen(name);
+        QVector<qint64> sent(total);
+        QVector<double> latencies;
+        latencies.reserve(total);
+        QVector<DroneCommand> batch;
+        batch.reserve(1 << CommandServer::queueLog2);
+        QVector<Drone*> added, removed;
+        const qint64 start = CommandServer::clock();
+        std::thread client(streamCommands, name, drones, servers, std::ref(sent));
+
+        int received = 0, applied = 0;
+        std::size_t allocations = 0;
+        qint64 last = start;
+        qint64 nextTick = start;
+        const qint64 deadline = nextTick + (commandSeconds + 5) * qint64(1000000000);
+        while (received < total && nextTick < deadline) {
+            nextTick += tickMs * qint64(1000000);
+            const qint64 wait = nextTick - CommandServer::clock();
+            if (wait > 0) {
+                QThread::usleep(wait / 1000);
+            }
+            const std::size_t before = AllocCounter::count();
+            commands.take(batch);
+            const int done = canvas.applyCommands(batch, added, removed);
+            const qint64 end = CommandServer::clock();
+            allocations += AllocCounter::count() - before;
+            commands.applied(batch, done);
+            for (const DroneCommand &command : batch) {
+                if (command.kind == DroneCommand::speed) {
+                    latencies.append((end - sent[int(command.value)]) / 1.0e6);
+                }
+            }
+            if (!batch.isEmpty()) {
+                last = end;
+            }
+            received += batch.size();
+            applied += done;
+        }
+        client.join();
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double q) {
+            return latencies.isEmpty() ? 0.0 : latencies[std::min<int>(latencies.size() - 1, int(q * latencies.size()))];
+        };
+        out << "commands drones " << drones << " tick_ms " << tickMs << " rate " << commandRate
+            << " received " << received << " applied " << applied
+            << " per_s " << (last > start ? received / ((last - start) / 1.0e9) : 0)
+            << " latency_ms p50 " << percentile(0.5) << " p99 " << percentile(0.99)
+            << " max " << (latencies.isEmpty() ? 0 : latencies.last())
+            << " allocs_per_command " << (AllocCounter::enabled() ? double(allocations) / std::max(1, received) : -1.0)
+            << Qt::endl;
+    }
+    qDeleteAll(map);
+}
+
+/**
+ * @brief ticking the simulation tick of MainWindow::simulationStep (100 ms) on a canvas of drones
+ * flying between the servers of the synthetic world. Between two ticks, the drones that landed
+ * take off again to the next server (commands applied outside the measure, like the missions of
+ * MainWindow::advance), so that the traffic stays steady. After warmupTicks, steadyTicks are
+ * timed and their heap allocations counted (CONFIG+=alloc_counter, -1 without): a steady tick
+ * must not allocate.
+ * @return false if a steady tick allocated
+ */
+bool ticking(QTextStream &out, int drones) {
+    Scenario world = gridWorld(100);
+    const int servers = world.servers.size();
+    for (int i = 0; i < drones; i++) {
+        world.drones.append(DroneSpec{QString("D%1").arg(i), world.servers[i % servers].position,
+                                      world.servers[(i + 1) % servers].name, QString()});
+    }
+    QMap<QString, Drone*> map;
+    DroneScheduler scheduler;
+    CollisionAvoidance avoidance;
+    Canvas canvas;
+    canvas.setMap(&map);
+    canvas.setScheduler(&scheduler);
+    canvas.applyScenario(world);
+    const Scenario &running = canvas.getWorld();
+    const double dt = 0.1;
+    auto step = [&]() {
+        scheduler.runUntil(scheduler.now() + dt);
+        const QVector<Drone*> &active = scheduler.activeDrones();
+        canvas.updateDroneTargets(active);
+        avoidance.prepare(map, active, canvas.droneCollisionDistance);
+        int substepsPerTick = 1;
+        for (int i = 0; i < active.size(); i++) {
+            const float searchDistance = canvas.droneCollisionDistance + float(2 * dt * active[i]->type().maxSpeed);
+            substepsPerTick = std::max(substepsPerTick, active[i]->chooseSubsteps(avoidance.nearestDistance(i, searchDistance),
+                                                                                  canvas.droneCollisionDistance, dt));
+        }
+        for (int s = 0; s < substepsPerTick; s++) {
+            if (s > 0) {
+                avoidance.advance(s, substepsPerTick);
+            }
+            avoidance.computeVelocities(dt, s, substepsPerTick);
+            for (int i = active.size() - 1; i >= 0; i--) {
+                Drone *drone = active[i];
+                if (drone->isDueAt(s, substepsPerTick)) {
+                    drone->update(dt / drone->getSubsteps());
+                }
+            }
+            canvas.admitLandings(active);
+        }
+    };
+    // every drone takes off, then each landed drone retargets the next server and takes off again
+    QVector<DroneCommand> launch;
+    launch.reserve(2 * drones);
+    QVector<Drone*> added, removed;
+    for (Drone *drone : map) {
+        DroneCommand start;
+        start.addName(drone->getName());
+        launch.append(start);
+    }
+    canvas.applyCommands(launch, added, removed);
+    std::size_t allocations = 0, worst = 0;
+    int ticksAllocating = 0, flying = 0;
+    qint64 ns = 0;
+    QElapsedTimer timer;
+    for (int tick = 0; tick < warmupTicks + steadyTicks; tick++) {
+        launch.resize(0);
+        for (Drone *drone : scheduler.landedDrones()) {
+            const int next = (running.serverIndex.value(drone->getTargetServerName(), 0) + 1) % servers;
+            DroneCommand retarget;
+            retarget.kind = DroneCommand::retarget;
+            retarget.addName(drone->getName());
+            retarget.addName(running.servers[next].name);
+            DroneCommand start;
+            start.addName(drone->getName());
+            launch.append(retarget);
+            launch.append(start);
+        }
+        scheduler.clearLanded();
+        canvas.applyCommands(launch, added, removed);
+        const std::size_t before = AllocCounter::count();
+        timer.start();
+        step();
+        const qint64 elapsed = timer.nsecsElapsed();
+        const std::size_t count = AllocCounter::count() - before;
+        if (tick >= warmupTicks) {
+            ns += elapsed;
+            allocations += count;
+            worst = std::max(worst, count);
+            ticksAllocating += count > 0;
+            flying += scheduler.activeDrones().size();
+        }
+    }
+    qDeleteAll(map);
+    const bool steady = ticksAllocating == 0;
+    out << "ticks drones " << drones << " active " << flying / steadyTicks << " tick_ms " << ns / (steadyTicks * 1.0e6)
+        << " allocs_per_tick " << (AllocCounter::enabled() ? double(allocations) / steadyTicks : -1.0)
+        << " max " << (AllocCounter::enabled() ? qint64(worst) : -1) << " ticks_allocating " << ticksAllocating
+        << (steady ? "" : " FAILED") << Qt::endl;
+    return steady;
+}
+
+/**
+ * @brief writeShardScenario the sharded world: shardColumns x shardRows servers 100 apart, and
+ * drones spread around them, each one targeting the server symmetric of its own through the
+ * center of the world, so that most drones cross the borders of several shards
+ * @param path: the scenario file
+ * @param drones: number of drones
+ * @return false if the file cannot be written
+ */
+bool writeShardScenario(const QString &path, int drones) {
+    QJsonArray servers, fleet;
+    for (int y = 0; y < shardRows; y++) {
+        for (int x = 0; x < shardColumns; x++) {
+            servers.append(QJsonObject{{"name", QString("S%1").arg(y * shardColumns + x)},
+                                       {"position", QString("%1,%2").arg(100 * x + 50).arg(100 * y + 50)},
+                                       {"color", "#808080"}, {"capacity", 64}});
+        }
+    }
+    std::mt19937 random(5);
+    std::uniform_int_distribution<int> server(0, shardColumns * shardRows - 1), offset(-40, 40);
+    for (int i = 0; i < drones; i++) {
+        const int s = server(random), x = s % shardColumns, y = s / shardColumns;
+        const int target = (shardRows - 1 - y) * shardColumns + shardColumns - 1 - x;
+        fleet.append(QJsonObject{{"name", QString("D%1").arg(i)},
+                                 {"position", QString("%1,%2").arg(100 * x + 50 + offset(random)).arg(100 * y + 50 + offset(random))},
+                                 {"server", QString("S%1").arg(target)}});
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject{{"servers", servers}, {"drones", fleet}}).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+/**
+ * @brief sharding the multi-process simulation (see ShardHub) of the same world by 1, 2, 4 and 8
+ * worker processes, as fast as they can: the drones take off at the start (--shard-launch) and
+ * the run lasts shardSeconds of simulated time from the first tick (the workers have loaded the
+ * scenario). Printed: the wall time, the ticks and drone ticks per second, the handoffs per
+ * second of the last second and the speedup of the ticks over one shard.
+ */
+void sharding(QTextStream &out, int drones) {
+    QTemporaryDir dir;
+    const QString path = dir.filePath("shards.json");
+    if (!dir.isValid() || !writeShardScenario(path, drones)) {
+        out << "shards cannot write the scenario in " << dir.path() << Qt::endl;
+        return;
+    }
+    const QSize canvasSize(100 * shardColumns, 100 * shardRows);
+    double oneShard = 0;
+    for (int count : {1, 2, 4, 8}) {
+        ShardHub hub;
+        hub.setPace(0);
+        if (!hub.start(count, path, canvasSize, {"--shard-launch"})) {
+            continue;
+        }
+        QElapsedTimer wall, run;
+        wall.start();
+        double firstTick = -1;
+        QEventLoop loop;
+        QTimer poll;
+        poll.setInterval(5);
+        QObject::connect(&poll, &QTimer::timeout, [&]() {
+            if (firstTick < 0 && hub.time() > 0) {
+                firstTick = hub.time();
+                run.start();
+            }
+            if ((firstTick >= 0 && hub.time() - firstTick >= shardSeconds) || wall.elapsed() > shardTimeoutMs) {
+                loop.quit();
+            }
+        });
+        poll.start();
+        loop.exec();
+        const double seconds = run.isValid() ? run.elapsed() / 1000.0 : 0;
+        const double ticks = firstTick >= 0 ? (hub.time() - firstTick) / ShardHub::tickStep : 0;
+        const double tickRate = seconds > 0 ? ticks / seconds : 0;
+        if (count == 1) {
+            oneShard = tickRate;
+        }
+        out << "shards " << count << " drones " << hub.drones() << " sim_s " << ticks * ShardHub::tickStep
+            << " wall_s " << seconds << " ticks_per_s " << tickRate << " drone_ticks_per_s " << tickRate * hub.drones()
+            << " handoffs_per_s " << hub.handoffRate() << " speedup " << (oneShard > 0 ? tickRate / oneShard : 0)
+            << Qt::endl;
+        hub.stop();
+    }
+}
+}
+
+QStringList Benchmark::names() {
+    return {"vector", "router", "dispatch", "commands", "ticks", "shards"};
+}
+
+int Benchmark::run(const QString &name, int size) {
+    QTextStream out(stdout);
+    const QVector<int> sizes = size > 0 ? QVector<int>{size} : QVector<int>{1000, 10000, 100000};
+    if (name == "vector") {
+        for (int drones : sizes) {
+            vectorMath(out, drones);
+        }
+    } else if (name == "router") {
+        for (int drones : size > 0 ? sizes : QVector<int>{1000, 5000, 20000}) {
+            routing(out, drones);
+        }
+    } else if (name == "dispatch") {
+        for (int drones : size > 0 ? sizes : QVector<int>{1000, 5000, 20000}) {
+            dispatching(out, drones);
+        }
+    } else if (name == "commands") {
+        for (int drones : size > 0 ? sizes : QVector<int>{1000, 10000}) {
+            commanding(out, drones);
+        }
+    } else if (name == "ticks") {
+        bool steady = true;
+        for (int drones : size > 0 ? sizes : QVector<int>{1000, 10000}) {
+            steady = ticking(out, drones) && steady;
+        }
+        return steady ? 0 : 2;
+    } else if (name == "shards") {
+        for (int drones : size > 0 ? sizes : QVector<int>{2000, 10000}) {
+            sharding(out, drones);
+        }
+    } else {
+        out << "unknown benchmark " << name << ", expected one of: " << names().join(", ") << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Measured runs of the simulation kernels on synthetic fleets, without window
+ * ("drones --bench <name> [--bench-size <drones>]"). Each benchmark prints one line per
+ * configuration on the standard output: the size, then the timings.
+ */
+namespace Benchmark {
+    /**
+     * @brief names
+     * @return the names of the benchmarks
+     */
+    QStringList names();
+    /**
+     * @brief run runs a benchmark and prints its results
+     * @param name: one of names()
+     * @param size: number of drones, 0 for the sizes of the benchmark
+     * @return the exit code of the application, 1 if the benchmark is unknown, 2 if a steady tick
+     * of the "ticks" benchmark allocated
+     */
+    int run(const QString &name, int size);
+}
+
+#endif // BENCHMARK_H
@@ -1,654 +1,1427 @@
-#include "canvas.h"
-#include <QPainter>
-#include "drone.h"
-#include <cmath>
-#include <limits>
-#include <QDebug>
-#include <fstream>
-#include <QFile>
-#include <QString>
-#include <QStringList>
-#include <QColor>
-#include <QFileDialog>
-#include <QMessageBox>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QMap>
-#include <QQueue>
-
-
-/**
- * @brief Calculates the Euclidean distance between two 2D points.
- * @param a The first point as a Vector2D object.
- * @param b The second point as a Vector2D object.
- * @return The Euclidean distance between the two points.
- */
- double Canvas::euclideanDistance(const Vector2D& a, const Vector2D& b) {
-    return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
-}
-
-
-
-/**
- * @brief Constructor for the Canvas class.
- * Initializes the canvas and loads the drone image.
- * @param parent The parent QWidget object.
- */
-Canvas::Canvas(QWidget *parent)
-    : QWidget{parent} {
-    droneImg.load("../../media/drone.png");
-    setMouseTracking(true);
-}
-
-
-/**
- * @brief Loads data from a JSON file and updates the drone and server information.
- * updates the positions and goal locations for the drones.
- * It also assigns servers to drones.
- * @param jsonFilePath The path to the JSON file to be loaded.
- */
-void Canvas::loadJsonData(const QString &jsonFilePath) {
-    QString filePath = jsonFilePath;
-
-    // Open file dialog if no path is provided
-    if (filePath.isEmpty()) {
-        filePath = QFileDialog::getOpenFileName(
-            this,
-            tr("Open JSON File"),
-            "",
-            tr("JSON Files (*.json);;All Files (*)")
-            );
-
-        if (filePath.isEmpty()) {
-            QMessageBox::warning(this, tr("File Error"), tr("No file selected."));
-            return;
-        }
-    }
-
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::critical(this, tr("File Error"), tr("Couldn't open the selected JSON file."));
-        return;
-    }
-
-    QByteArray jsonData = file.readAll();
-    file.close();
-
-    // Parse JSON data
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-    if (doc.isNull() || !doc.isObject()) {
-        QMessageBox::critical(this, tr("JSON Error"), tr("Invalid JSON file format."));
-        return;
-    }
-
-    QJsonObject rootObj = doc.object();
-
-    // Parse servers
-    if (rootObj.contains("servers") && rootObj["servers"].isArray()) {
-        QJsonArray serversArray = rootObj["servers"].toArray();
-        servers.clear();
-
-        for (const QJsonValue &serverValue : serversArray) {
-            QJsonObject serverObj = serverValue.toObject();
-            QString name = serverObj["name"].toString();
-            QStringList positionStr = serverObj["position"].toString().split(",");
-            QColor color(serverObj["color"].toString());
-
-            if (positionStr.size() == 2) {
-                int x = positionStr[0].toInt();
-                int y = positionStr[1].toInt();
-
-                Server server;
-                server.name = name;
-                server.position = Vector2D(x, y);
-                server.color = color;
-
-                servers.append(server);
-
-                qDebug() << "Server loaded:" << name << "Position:" << x << "," << y << "Color:" << color;
-            }
-        }
-    } else {
-        QMessageBox::warning(this, tr("JSON Error"), tr("No 'servers' array found in the JSON file."));
-    }
-
-    // Parse drones and position them
-    if (rootObj.contains("drones") && rootObj["drones"].isArray()) {
-        QJsonArray dronesArray = rootObj["drones"].toArray();
-        drones.clear(); // Clear existing drones
-
-        for (const QJsonValue &droneValue : dronesArray) {
-            QJsonObject droneObj = droneValue.toObject();
-            QString name = droneObj["name"].toString();
-            QString targetServerName = droneObj["server"].toString();
-
-            QStringList positionStr = droneObj["position"].toString().split(",");
-            if (positionStr.size() == 2) {
-                int x = positionStr[0].toInt();
-                int y = positionStr[1].toInt();
-
-                Drone *drone = new Drone(name);
-                //Drone *drone = new Drone(name, this);
-
-
-
-                drone->setInitialPosition(Vector2D(x, y));
-
-                // Find the specified server for the drone
-                Server *targetServer = getServerByName(targetServerName);
-                if (targetServer) {
-                    drone->setGoalPosition(targetServer->position);
-                     drone->setTargetServerName(targetServerName);
-                    qDebug() << "Drone" << name << "assigned to server" << targetServerName;
-                } else {
-                    qDebug() << "Server" << targetServerName << "not found for drone" << name;
-                }
-
-                drones.append(drone); // Add the drone to the list
-            }
-        }
-    }
-
-    // Update the map of drones for MainWindow
-    if (mapDrones) {
-        mapDrones->clear();
-        for (auto &drone : drones) {
-            mapDrones->insert(drone->getName(), drone); // Add each drone to the map
-        }
-    }
-    parseServerConnections(rootObj);
-    update(); // repaint to show the updated positions of drones and Voronoi regions
-}
-
-/**
- * @brief Canvas::paintEvent
- */
-
-/*paintevent
-void Canvas::paintEvent(QPaintEvent *) {
-    QPainter painter(this);
-    QBrush whiteBrush(Qt::SolidPattern);
-    QPen penCol(Qt::DashDotDotLine);
-    penCol.setColor(Qt::lightGray);
-    penCol.setWidth(3);
-    whiteBrush.setColor(Qt::white);
-    painter.fillRect(0,0,width(),height(),whiteBrush);
-
-
-    //Draw the Voronoi diagram
-
-    drawVoronoiDiagram(painter);
-    //draw server connections
-    drawServerConnections(painter);
-
-    if (mapDrones) {
-        Vector2D p;
-        QRect rect(-droneIconSize/2,-droneIconSize/2,droneIconSize,droneIconSize);
-        QRect rectCol(-droneCollisionDistance/2,-droneCollisionDistance/2,droneCollisionDistance,droneCollisionDistance);
-
-        for (auto &drone:*mapDrones) {
-            updateDroneTarget(drone);
-            painter.save();
-            // place and orient the drone
-            painter.translate(drone->getPosition().x,drone->getPosition().y);
-            painter.rotate(drone->getAzimut());
-            painter.drawImage(rect,droneImg);
-            // light leds if flying
-            if (drone->getStatus()!=Drone::landed) {
-                painter.setPen(Qt::NoPen);
-                painter.setBrush(Qt::red);
-                painter.drawEllipse((-185.0/511.0)*droneIconSize,(-185.0/511.0)*droneIconSize,(65.0/511.0)*droneIconSize,(65.0/511.0)*droneIconSize);
-                painter.drawEllipse((115.0/511.0)*droneIconSize,(-185.0/511.0)*droneIconSize,(65.0/511.0)*droneIconSize,(65.0/511.0)*droneIconSize);
-                painter.setBrush(Qt::green);
-                painter.drawEllipse((-185.0/511.0)*droneIconSize,(115.0/511.0)*droneIconSize,(70.0/511.0)*droneIconSize,(70.0/511.0)*droneIconSize);
-                painter.drawEllipse((115.0/511.0)*droneIconSize,(115.0/511.0)*droneIconSize,(70.0/511.0)*droneIconSize,(70.0/511.0)*droneIconSize);
-            }
-            // draw collision detector
-            if (drone->hasCollision()) {
-                painter.setPen(penCol);
-                painter.setBrush(Qt::NoBrush);
-                painter.drawEllipse(rectCol);
-            }
-            painter.restore();
-        }
-    }
-}
-/*
-
-
-
-//----
-/**
- * @brief Handles the mouse press event to select and move drones.
- * @param event The mouse event triggered by a click.
- */
-
-void Canvas::paintEvent(QPaintEvent *) {
-    QPainter painter(this);
-
-    // Set up the background and basic styles
-    QBrush whiteBrush(Qt::SolidPattern);
-    QPen penCol(Qt::DashDotDotLine);
-    penCol.setColor(Qt::lightGray);
-    penCol.setWidth(3);
-    whiteBrush.setColor(Qt::white);
-    painter.fillRect(0, 0, width(), height(), whiteBrush);
-
-    // Draw the Voronoi diagram
-    drawVoronoiDiagram(painter);
-
-    // Draw server connections
-    drawServerConnections(painter);
-
-    // Draw the servers as clickable polygons
-    drawServers(painter);  // function to draw the server polygons
-
-    // Draw drones (if any)
-    if (mapDrones) {
-        Vector2D p;
-        QRect rect(-droneIconSize / 2, -droneIconSize / 2, droneIconSize, droneIconSize);
-        QRect rectCol(-droneCollisionDistance / 2, -droneCollisionDistance / 2, droneCollisionDistance, droneCollisionDistance);
-
-        for (auto &drone : *mapDrones) {
-            updateDroneTarget(drone);
-            painter.save();
-            // Place and orient the drone
-            painter.translate(drone->getPosition().x, drone->getPosition().y);
-            painter.rotate(drone->getAzimut());
-            painter.drawImage(rect, droneImg);
-
-            // Light LEDs if flying
-            if (drone->getStatus() != Drone::landed) {
-                painter.setPen(Qt::NoPen);
-                painter.setBrush(Qt::red);
-                painter.drawEllipse((-185.0 / 511.0) * droneIconSize, (-185.0 / 511.0) * droneIconSize, (65.0 / 511.0) * droneIconSize, (65.0 / 511.0) * droneIconSize);
-                painter.drawEllipse((115.0 / 511.0) * droneIconSize, (-185.0 / 511.0) * droneIconSize, (65.0 / 511.0) * droneIconSize, (65.0 / 511.0) * droneIconSize);
-                painter.setBrush(Qt::green);
-                painter.drawEllipse((-185.0 / 511.0) * droneIconSize, (115.0 / 511.0) * droneIconSize, (70.0 / 511.0) * droneIconSize, (70.0 / 511.0) * droneIconSize);
-                painter.drawEllipse((115.0 / 511.0) * droneIconSize, (115.0 / 511.0) * droneIconSize, (70.0 / 511.0) * droneIconSize, (70.0 / 511.0) * droneIconSize);
-            }
-
-            // Draw collision detector
-            if (drone->hasCollision()) {
-                painter.setPen(penCol);
-                painter.setBrush(Qt::NoBrush);
-                painter.drawEllipse(rectCol);
-            }
-            painter.restore();
-        }
-    }
-}
-
-/**
- * @brief Canvas::drawServers function to
- * draw servers as clickable polygons
- * @param painter
- */
-void Canvas::drawServers(QPainter &painter) {
-    QPen serverPen(Qt::black);  //  color for the server polygons
-    painter.setPen(serverPen);
-    painter.setBrush(Qt::NoBrush);
-
-    for (const Server &server : servers) {
-
-        QPointF serverPos(server.position.x, server.position.y);
-        qreal radius = 30;
-
-        // Draw server as a circle
-        painter.drawEllipse(serverPos, radius, radius);
-    }
-}
-
-
-/* mousePressEvent
-void Canvas::mousePressEvent(QMouseEvent *event) {
-    // search for a drone that is landed
-    auto it = mapDrones->begin();
-    while (it!=mapDrones->end() && (*it)->getStatus()!=Drone::landed) {
-        it++;
-    }
-    // if found, ask for a motion to the mouse position
-    if (it!=mapDrones->end()) {
-        (*it)->setGoalPosition(Vector2D(event->pos().x(),event->pos().y()));
-        (*it)->start();
-    }
-    repaint();
-}
-*/
-//----
-///*
-
-/**
- * @brief Canvas::mousePressEvent Handles mouse press events for activating drones and setting their target servers.
- * this function checks for the mouse press event and does two action which is
- * 1-if a drone is clicked,it activate drone and sets it as the the active drone,
- * 2- if a server is clicked and a drone is active it then set the server which is clicked as the target of the the active drone
- * and updates the drones movement toward the server that is being targetted .
- * @param event
- */
-void Canvas::mousePressEvent(QMouseEvent *event) {
-    QPointF clickPos = event->pos();
-
-    //Check if a drone is clicked
-    for (Drone* drone : *mapDrones) {
-        QRect droneBounds(drone->getPosition().x - 20, drone->getPosition().y - 20, 40, 40);
-        if (droneBounds.contains(clickPos.toPoint())) {
-            if (activeDrone) {
-                qDebug() << "Deactivating drone:" << activeDrone->getName();
-            }
-            activeDrone = drone;
-            qDebug() << "Drone activated:" << activeDrone->getName();
-            return;
-        }
-    }
-
-    //  If a server is clicked and a drone is active
-    if (activeDrone) {
-        for (const Server &server : servers) {
-            QPointF serverPos(server.position.x, server.position.y);
-            qreal radius = 30;
-
-            // Check if the click is within the server's circle
-            if ((clickPos - serverPos).manhattanLength() <= radius) {
-                activeDrone->setTargetServerName(server.name);  // Set the target server for the active drone
-                updateDroneTarget(activeDrone);  // Move the drone
-                activeDrone->start();
-                qDebug() << "Drone" << activeDrone->getName() << "moving to server:" << server.name;
-                activeDrone = nullptr;  // Reset active drone
-                return;
-        }
-    }
-}
-
-}
-//*/
-
-/**
- * @brief Canvas::drawVoronoiDiagram Draws the Voronoi diagram based on  drone positions.
- * @param painter The QPainter object used to draw the Voronoi diagram.
- */
-void Canvas::drawVoronoiDiagram(QPainter &painter) {
-    if (servers.isEmpty()) return;
-
-    int resolution = 1;
-    // Loop through every point in the grid
-    for (int x = 0; x < width(); x += resolution) {
-        for (int y = 0; y < height(); y += resolution) {
-            Vector2D currentPoint(x, y);
-            double minDistance = std::numeric_limits<double>::max();
-            QColor closestColor;
-
-            // Find the closest server
-            for (const auto &server : servers) {
-                double distance = euclideanDistance(currentPoint, server.position);
-                if (distance < minDistance) {
-                    minDistance = distance;
-                    closestColor = server.color;
-                }
-            }
-
-            //  represent the region
-            painter.fillRect(x, y, resolution, resolution, closestColor);
-        }
-    }
-
-    // Draw server positions
-    for (const auto &server : servers) {
-        painter.setBrush(Qt::black);
-        painter.setPen(Qt::black);
-        painter.drawEllipse(QPointF(server.position.x, server.position.y), 10, 10); // Circle at server position
-
-        // Draw the server name near its position
-        painter.setPen(Qt::white);
-        painter.drawText(server.position.x + 15, server.position.y - 15, server.name);
-    }
-}
-
-
-
-/**
- * @brief Canvas::getServerByName this function searches for a server by its name from the list of servers.
- * @param name The name of the server to retrieve.
- * @return A pointer to the Server object if found.
- */
-
-Canvas::Server* Canvas::getServerByName(const QString &name) {
-    for (auto &server : servers) {
-        if (server.name == name) {
-            return &server; // Return  matching server
-        }
-    }
-    return nullptr; // Return nullptr if no match is found
-}
-
-
-
-/**
- * @brief Canvas::parseServerConnections this function parseServer connectionfrom the provided JSON object and
- * processes the server connections specified in the JSON data,
- * @param jsonObject The root JSON object that contains the server connection information
- */
-void Canvas::parseServerConnections(const QJsonObject &jsonObject) {
-    serverConnections.clear();
-    const auto serverList = jsonObject["servers"].toArray();
-    for (int i = 0; i < serverList.size(); ++i) {
-        QJsonObject serverA = serverList[i].toObject();
-        QString serverAName = serverA["name"].toString();
-        QPoint serverAPosition = parsePosition(serverA["position"].toString());
-
-        for (int j = i + 1; j < serverList.size(); ++j) {
-            QJsonObject serverB = serverList[j].toObject();
-            QString serverBName = serverB["name"].toString();
-            QPoint serverBPosition = parsePosition(serverB["position"].toString());
-
-            // Calculate the distance between two servers
-            double distance = std::hypot(serverAPosition.x() - serverBPosition.x(),
-                                         serverAPosition.y() - serverBPosition.y());
-
-
-            if (distance < 500) {
-                serverConnections[serverAName].insert(serverBName);
-                serverConnections[serverBName].insert(serverAName); // Bidirectional connection
-            }
-        }
-    }
-}
-
-
-
-/**
- * @brief Canvas::parsePosition
- * @param position
- * @return
- */
-
-QPoint Canvas::parsePosition(const QString &position) {
-    QStringList coords = position.split(",");
-    if (coords.size() == 2) {
-        return QPoint(coords[0].toInt(), coords[1].toInt());
-    }
-    return QPoint();
-}
-
-
-
-/**
- * @brief Canvas::drawServerConnections draws the server connections on the canvas by looping through each server and the set of connected server then draws conecting line between
- * each pairs of cnnected servers
- * @param painter the QPainter objects is then  used to draw the server connections.
- */
-
-void Canvas::drawServerConnections(QPainter &painter) {
-    for (auto it = serverConnections.begin(); it != serverConnections.end(); ++it) {
-        QString serverNameA = it.key();
-        Server *serverA = getServerByName(serverNameA);
-
-        if (serverA) {
-            for (const QString &serverNameB : it.value()) {
-                if (serverNameA != serverNameB) {
-                    Server *serverB = getServerByName(serverNameB);
-                    if (serverB) {
-                        painter.setPen(QPen(Qt::white, 2));
-                        painter.drawLine(serverA->position.x, serverA->position.y,
-                                         serverB->position.x, serverB->position.y);
-                    }
-                }
-            }
-        }
-    }
-}
-
-
-
-/**
- * @brief Canvas::findPathBasedOnConnections this function Finds the shortest path between two servers based on their connections.
- * used the BFS -breadth first seach to fine shortest path from the start server and goal server basd on the connection btw servers
- * @param start the starting server name
- * @param goal the goal server name
- * @return  A list of server names representing the path from start to goal, or an empty list if no path is found.
- */
-QStringList Canvas::findPathBasedOnConnections(const QString &start, const QString &goal) {
-    if (start == goal) {
-        return {start};
-    }
-    if (!serverConnections.contains(start) || !serverConnections.contains(goal)) {
-        return {};
-    }
-
-    QQueue<QString> queue;
-    QMap<QString, QString> predecessors;
-    QSet<QString> visited;
-
-    queue.enqueue(start);
-    visited.insert(start);
-
-    while (!queue.isEmpty()) {
-        QString current = queue.dequeue();
-        for (const QString &neighbor : serverConnections[current]) {
-            if (!visited.contains(neighbor)) {
-                predecessors[neighbor] = current;
-                if (neighbor == goal) {
-                    QStringList path;
-                    QString step = neighbor;
-                    while (!step.isEmpty()) {
-                        path.prepend(step);
-                        step = predecessors.value(step, "");
-                    }
-                    path.prepend(start);
-                    return path;
-                }
-                visited.insert(neighbor);
-                queue.enqueue(neighbor);
-            }
-        }
-    }
-
-    return {};
-}
-
-
-/**
- * @brief Canvas::updateDroneTarget this function updates the target positioning of a drone based on the current and target servers.
- * @param drone The drone object whose target position is to be updated.
- */
-
-void Canvas::updateDroneTarget(Drone *drone) {
-    QString currentServer = getCurrentServerForDrone(drone);
-    QString targetServer = getTargetServerForDrone(drone);
-
-    if (currentServer.isEmpty() || targetServer.isEmpty()) {
-        return;  // No valid movement if drone isn’t on a server
-    }
-
-    // Get the path from current to target
-    QStringList path = findPathBasedOnConnections(currentServer, targetServer);
-
-    if (path.size() > 1) {
-        for (int i = 1; i < path.size(); i++) {
-            Server *nextServerObj = getServerByName(path[i]);
-            if (nextServerObj) {
-                drone->setGoalPosition(nextServerObj->position);  // Move to each intermediate step
-                 drone->setTargetServerName(nextServerObj->name);
-            }
-        }
-    }
-}
-
-
-/**
- * @brief Canvas::getNextServer this function is to fnd next server in the path between the current server and the target server and
- * returns the next server along the path from the current server to the target server,
- * based on the connections between servers.
- * @param current current server name
- * @param target target server name
- * @return The name of the next server in the path, or it will return an  empty string if there is no valid next server  found.
- */
-QString Canvas::getNextServer(const QString &current, const QString &target) {
-    QStringList path = findPathBasedOnConnections(current, target);
-    qDebug() << "Path from" << current << "to" << target << ":" << path;
-
-    if (path.size() > 1) {
-        qDebug() << "Next step is:" << path[1];
-        return path[1];  // Move to the next step
-    }
-    qDebug() << "No valid path found!";
-    return {};
-}
-
-/**
- * @brief Canvas::getCurrentServerForDrone this function checks the position of the drone for any given drone and finds the server that contains the position
- * @param drone The drone object for which to determine the current server.
- * @return The name of the current server the drone is located in, or return an empty string if it is not  found.
- */
-QString Canvas::getCurrentServerForDrone(Drone *drone) {
-    Vector2D position = drone->getPosition();
-
-    // check if the drone is inside a server polygon
-    for (const auto &server : servers) {
-        if (server.polygon.containsPoint(QPointF(position.x, position.y), Qt::WindingFill)) {
-            return server.name;
-        }
-    }
-
-    // If not inside any polygon, find the nearest server
-    double minDistance = std::numeric_limits<double>::max();
-    QString closestServer;
-
-    for (const auto &server : servers) {
-        double distance = euclideanDistance(position, server.position);
-        if (distance < minDistance) {
-            minDistance = distance;
-            closestServer = server.name;
-        }
-    }
-
-    return closestServer;
-}
-
-/**
- * @brief Canvas::getTargetServerForDrone ths function gets the targer server for a drone
- * @param drone the drone object for which to retrieve the target server name.
- * @return The name of the target server for the drone.
- */
-QString Canvas::getTargetServerForDrone(Drone *drone) {
-    return drone->getTargetServerName();
-}
-
-/**
- * @brief Canvas::getServerPolygon
- * @param serverPos
- * @return
- */
-QPolygonF Canvas::getServerPolygon(const Vector2D &serverPos) {
-    for (const auto &server : servers) {
-        if ((server.position - serverPos).length() < 10.0) {  // Find the matching server
-            return server.polygon;  // Return its Voronoi polygon
-        }
-    }
-    return QPolygonF();  // Return  empty polygon  if not found
-}
-
-
-
-
+#include "canvas.h"
+#include "tilestore.h"
+#include <QPainter>
+#include "drone.h"
+#include "dronescheduler.h"
+#include <cmath>
+#include <limits>
+#include <QDebug>
+#include <fstream>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QColor>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMap>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <algorithm>
+
+
+/**
+ * @brief Calculates the Euclidean distance between two 2D points.
+ * @param a The first point as a Vector2D object.
+ * @param b The second point as a Vector2D object.
+ * @return The Euclidean distance between the two points.
+ */
+ double Canvas::euclideanDistance(const Vector2D& a, const Vector2D& b) {
+    return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+}
+
+
+
+/**
+ * @brief Constructor for the Canvas class.
+ * Initializes the canvas and loads the drone image.
+ * @param parent The parent QWidget object.
+ */
+Canvas::Canvas(QWidget *parent)
+    : QWidget{parent} {
+    droneImg.load("../../media/drone.png");
+    setMouseTracking(true);
+}
+
+
+/**
+ * @brief Loads data from a JSON file and updates the drone and server information.
+ * updates the positions and goal locations for the drones.
+ * It also assigns servers to drones.
+ * The scenario is built synchronously, see ScenarioLoader to load it in the background.
+ * @param jsonFilePath The path to the JSON file to be loaded.
+ */
+void Canvas::loadJsonData(const QString &jsonFilePath) {
+    QString filePath = jsonFilePath;
+
+    // Open file dialog if no path is provided
+    if (filePath.isEmpty()) {
+        filePath = QFileDialog::getOpenFileName(
+            this,
+            tr("Open JSON File"),
+            "",
+            tr("JSON Files (*.json);;All Files (*)")
+            );
+
+        if (filePath.isEmpty()) {
+            QMessageBox::warning(this, tr("File Error"), tr("No file selected."));
+            return;
+        }
+    }
+
+    Scenario scenario;
+    QString error;
+    if (!scenario.load(filePath, size(), error)) {
+        QMessageBox::critical(this, tr("JSON Error"), error);
+        return;
+    }
+    applyScenario(scenario);
+}
+
+/**
+ * @brief Canvas::applyScenario adopts the servers, connections, routing table and Voronoi raster
+ * of a loaded scenario and creates its drones. The swap is done between two ticks, so the
+ * simulation never sees a partially built world.
+ * @param scenario the loaded scenario (its content is moved)
+ */
+void Canvas::applyScenario(Scenario &scenario) {
+    world = std::move(scenario);
+    if (world.background.size() != size()) {
+        world.rasterize(size());
+    }
+    activeDrone = nullptr;
+
+    // the previous drones are owned by the drone list of the main window, they stop simulating now
+    if (mapDrones) {
+        for (Drone *drone : *mapDrones) {
+            drone->setScheduler(nullptr);
+        }
+    }
+    // the previous drones are not simulated anymore: their types can go
+    DroneTypes::reset();
+    defineTypes(world.types);
+    drones.clear();
+    chargingDrones.clear();
+    chargingIndex.fill(-1); // the slots of the previous drones are reused
+    drones.reserve(world.drones.size());
+    for (const DroneSpec &spec : world.drones) {
+        drones.append(createDrone(spec)); // Add the drone to the list
+    }
+
+    // Update the map of drones for MainWindow
+    if (mapDrones) {
+        mapDrones->clear();
+        for (auto &drone : drones) {
+            mapDrones->insert(drone->getName(), drone); // Add each drone to the map
+        }
+    }
+    resetTraffic();
+    heatmap.reset(size(), scheduler ? scheduler->now() : 0);
+    update(); // repaint to show the updated positions of drones and Voronoi regions
+}
+
+/**
+ * @brief Canvas::mergeScenario applies a reloaded file to the running world. Servers are merged
+ * by name (see Scenario::mergeServers) and the traffic is repaired like for a runtime change (see
+ * repairTraffic): the routes, pads and queue places follow the renumbered servers, only the drones
+ * of the changed servers plan again. Drones present in both files keep their state; only their
+ * target server, or their initial position if they are landed, is updated when it changed.
+ * @param scenario the reloaded scenario
+ * @param added drones created by the reload
+ * @param removed drones no longer in the file, removed from the canvas but not deleted
+ * @return the changed servers
+ */
+Scenario::ServerDiff Canvas::mergeScenario(const Scenario &scenario, QVector<Drone*> &added, QVector<Drone*> &removed) {
+    Scenario::ServerDiff diff = world.mergeServers(scenario.servers);
+    if (world.background.size() != size()) {
+        world.rasterize(size());
+    }
+    if (diff.added + diff.removed + diff.moved > 0) {
+        repairTraffic(diff.changed, diff.remap);
+    } else {
+        landing.update(); // the capacities may have changed
+    }
+
+    if (defineTypes(scenario.types)) {
+        planner.reset(world, DroneTypes::count());
+    }
+    QHash<QString,const DroneSpec*> previousSpecs;
+    for (const DroneSpec &spec : world.drones) {
+        previousSpecs.insert(spec.name, &spec);
+    }
+
+    QHash<QString,Drone*> dronesByName;
+    for (Drone *drone : drones) {
+        dronesByName.insert(drone->getName(), drone);
+    }
+
+    QSet<QString> names;
+    for (const DroneSpec &spec : scenario.drones) {
+        names.insert(spec.name);
+        Drone *drone = dronesByName.value(spec.name, nullptr);
+        if (!drone) {
+            drone = createDrone(spec);
+            drones.append(drone);
+            if (mapDrones) mapDrones->insert(spec.name, drone);
+            added.append(drone);
+            continue;
+        }
+        const DroneSpec *previous = previousSpecs.value(spec.name, nullptr);
+        if (previous && previous->position != spec.position) {
+            drone->setInitialPosition(spec.position); // only applied if landed
+        }
+        // the characteristics of a type may have changed even if its name did not
+        drone->setType(typeIdOf(spec));
+        if ((!previous || previous->server != spec.server) && getServerByName(spec.server)) {
+            drone->setTargetServerName(spec.server);
+            drone->setGoalPosition(getServerByName(spec.server)->position);
+            if (drone->getStatus() != Drone::landed) {
+                landing.release(drone); // leaves its holding queue, plans again toward the new server
+            }
+        }
+    }
+    if (!added.isEmpty()) {
+        reserveFleet();
+        for (Drone *drone : added) {
+            const int server = world.serverIndex.value(drone->getTargetServerName(), -1);
+            if (drone->getStatus() == Drone::landed && server >= 0) {
+                landing.occupy(drone, server);
+            }
+        }
+    }
+
+    for (int i = drones.size() - 1; i >= 0; i--) {
+        Drone *drone = drones[i];
+        if (!names.contains(drone->getName())) {
+            detachDrone(drone);
+            drones.remove(i);
+            removed.append(drone);
+        }
+    }
+    world.drones = scenario.drones;
+    world.types = scenario.types;
+    // the goals of the drones in the air follow the moved servers at the next tick (see updateDroneTargets)
+    update();
+    return diff;
+}
+
+/**
+ * @brief Canvas::detachDrone the drone stops simulating and leaves its pad, its queue and the map
+ * of the main window; it stays in drones.
+ * @param drone the drone
+ */
+void Canvas::detachDrone(Drone *drone) {
+    if (activeDrone == drone) activeDrone = nullptr;
+    landing.release(drone);
+    setCharging(drone, false);
+    if (mapDrones) mapDrones->remove(drone->getName());
+    drone->setScheduler(nullptr);
+}
+
+int Canvas::fleetSlots() const {
+    const int fleetSize = mapDrones ? mapDrones->size() : drones.size();
+    return scheduler ? std::max(fleetSize, scheduler->slotCount()) : fleetSize;
+}
+
+void Canvas::reserveFleet() {
+    const int slots = fleetSlots();
+    landing.reserve(slots);
+    chargingDrones.reserve(slots);
+    chargingIndex.resize(slots, -1);
+}
+
+/**
+ * @brief Canvas::setCharging the last drone of the list takes the place of a removed one
+ * @param drone the drone
+ * @param charging true if it landed at a charging stop
+ */
+void Canvas::setCharging(Drone *drone, bool charging) {
+    const int slot = drone->getSchedulerSlot();
+    if (slot < 0) {
+        return;
+    }
+    if (slot >= chargingIndex.size()) {
+        chargingIndex.resize(slot + 1, -1); // only if the fleet was not reserved
+    }
+    const int index = chargingIndex[slot];
+    if (charging && index < 0) {
+        chargingIndex[slot] = chargingDrones.size();
+        chargingDrones.append(drone);
+    } else if (!charging && index >= 0) {
+        Drone *last = chargingDrones.last();
+        chargingDrones[index] = last;
+        chargingIndex[last->getSchedulerSlot()] = index;
+        chargingDrones.removeLast();
+        chargingIndex[slot] = -1;
+    }
+}
+
+bool Canvas::isCharging(const Drone *drone) const {
+    const int slot = drone->getSchedulerSlot();
+    return slot >= 0 && slot < chargingIndex.size() && chargingIndex[slot] >= 0;
+}
+
+/**
+ * @brief Canvas::applyCommands applies the commands in their order, like the mouse does for a
+ * single drone: a started or retargeted drone leaves its pad or its holding queue and follows the
+ * routes toward its target server. The removed drones leave drones in one pass at the end.
+ * The names of the commands are only looked up: a drone keeps the name of the server of the
+ * world (shared), so a command allocates nothing but the drone it adds.
+ * @param commands the commands
+ * @param added drones created by the commands
+ * @param removed drones removed from the canvas (to be deleted by the caller)
+ * @return the number of commands that had an effect
+ */
+int Canvas::applyCommands(const QVector<DroneCommand> &commands, QVector<Drone*> &added, QVector<Drone*> &removed) {
+    if (!mapDrones) {
+        return 0;
+    }
+    int done = 0;
+    const int removedBefore = removed.size();
+    for (const DroneCommand &command : commands) {
+        Drone *drone = mapDrones->value(command.key(0), nullptr);
+        if (command.kind == DroneCommand::add) {
+            const Server *server = getServerByName(command.key(1));
+            if (drone || !server) {
+                continue;
+            }
+            drone = createDrone(DroneSpec{command.name(0).toString(), command.position, server->name, command.type().toString()});
+            drones.append(drone);
+            mapDrones->insert(drone->getName(), drone);
+            added.append(drone);
+            done++;
+            continue;
+        }
+        if (!drone) {
+            continue;
+        }
+        switch (command.kind) {
+        case DroneCommand::retarget: {
+            const Server *server = getServerByName(command.key(1));
+            if (!server) {
+                continue;
+            }
+            drone->setTargetServerName(server->name);
+            if (drone->getStatus() != Drone::landed) {
+                landing.release(drone); // leaves its holding queue
+                updateDroneTarget(drone);
+            }
+            break;
+        }
+        case DroneCommand::start:
+            if (drone->getStatus() != Drone::landed) {
+                continue;
+            }
+            landing.release(drone); // leaves its pad
+            setCharging(drone, false);
+            updateDroneTarget(drone);
+            drone->start();
+            break;
+        case DroneCommand::stop:
+            if (drone->getStatus() == Drone::landed || drone->getStatus() == Drone::landing) {
+                continue;
+            }
+            landing.release(drone);
+            drone->stop();
+            break;
+        case DroneCommand::speed:
+            drone->setSpeed(command.value);
+            break;
+        case DroneCommand::remove:
+            detachDrone(drone);
+            added.removeOne(drone); // created by this batch: never shown
+            removed.append(drone);
+            break;
+        case DroneCommand::tour: // a mission, started by the caller (see MissionScheduler)
+        default:
+            continue;
+        }
+        done++;
+    }
+    if (!added.isEmpty()) {
+        reserveFleet();
+    }
+    if (removed.size() > removedBefore) {
+        QSet<Drone*> gone(removed.begin() + removedBefore, removed.end());
+        drones.erase(std::remove_if(drones.begin(), drones.end(), [&gone](Drone *drone) {
+            return gone.contains(drone);
+        }), drones.end());
+    }
+    return done;
+}
+
+/**
+ * @brief Canvas::adoptDrone restores a drone handed off by another shard like a snapshot does,
+ * a flying drone asks its route again from this shard's router.
+ * @param name name of the drone
+ * @param target its target server
+ * @param state its state
+ * @return the drone, nullptr if a drone already has this name
+ */
+Drone *Canvas::adoptDrone(const QString &name, const QString &target, const Drone::State &state) {
+    if (!mapDrones || mapDrones->contains(name)) {
+        return nullptr;
+    }
+    Drone *drone = new Drone(name);
+    drone->setScheduler(scheduler);
+    drone->restoreState(state);
+    drone->setTargetServerName(target);
+    if (drone->getStatus() != Drone::landed) {
+        updateDroneTarget(drone);
+    }
+    drones.append(drone);
+    mapDrones->insert(name, drone);
+    reserveFleet();
+    return drone;
+}
+
+/**
+ * @brief Canvas::releaseDrones detaches the drones, then removes them from drones in one pass
+ * @param gone the drones
+ */
+void Canvas::releaseDrones(const QVector<Drone*> &gone) {
+    if (gone.isEmpty()) {
+        return;
+    }
+    for (Drone *drone : gone) {
+        detachDrone(drone);
+    }
+    QSet<Drone*> set(gone.begin(), gone.end());
+    drones.erase(std::remove_if(drones.begin(), drones.end(), [&set](Drone *drone) {
+        return set.contains(drone);
+    }), drones.end());
+}
+
+/**
+ * @brief Canvas::resetTraffic rebuilds the router, the planner and the pads of the servers, gives
+ * a pad to each landed drone at its target server (or at its charging stop) and makes the
+ * holding drones ask again when they reach the landing zone.
+ */
+void Canvas::resetTraffic() {
+    // the edges of the router and the planner are indexed like the servers too
+    router.reset(world);
+    planner.reset(world, DroneTypes::count());
+    if (mapDrones) {
+        for (Drone *drone : *mapDrones) {
+            drone->route() = Drone::Route();
+        }
+    }
+    landing.reset(world, fleetSlots(), scheduler ? scheduler->now() : 0);
+    reserveFleet();
+    if (!mapDrones) {
+        return;
+    }
+    for (Drone *drone : *mapDrones) {
+        int server = world.serverIndex.value(drone->getTargetServerName(), -1);
+        if (isCharging(drone)) {
+            server = serverIndexAt(drone->getPosition());
+        }
+        if (drone->getStatus() == Drone::landed && server >= 0) {
+            landing.occupy(drone, server);
+        } else if (drone->isHolding()) {
+            drone->resumeLanding();
+        }
+    }
+}
+
+/**
+ * @brief Canvas::admitLandings asks the landing control for the drones that reached their landing
+ * zone. Drones without a known target server land around their goal as before.
+ * @param fleet the drones to check
+ */
+void Canvas::admitLandings(const QVector<Drone*> &fleet) {
+    const double now = scheduler ? scheduler->now() : 0;
+    // backward loop: a drone that lands leaves the list and is replaced by the last one
+    for (int i = fleet.size() - 1; i >= 0; i--) {
+        Drone *drone = fleet[i];
+        if (!drone->hasArrived()) {
+            continue;
+        }
+        Drone::Route &route = drone->route();
+        int server = world.serverIndex.value(drone->getTargetServerName(), -1);
+        // a drone on its way lands at its charging stop
+        const bool charging = route.stop >= 0 && route.stop != server;
+        if (charging) {
+            server = route.stop;
+        }
+        if (server < 0 || server >= landing.stationCount()) {
+            drone->land(drone->findLandingSpot(drone->getGoalPosition(), Drone::landingRadius));
+            continue;
+        }
+        Vector2D spot;
+        int rerouteServer = -1;
+        switch (landing.request(drone, server, now, spot, rerouteServer)) {
+            case LandingControl::land:
+                drone->land(spot);
+                if (charging) {
+                    setCharging(drone, true);
+                }
+                break;
+            case LandingControl::hold:
+                drone->hold();
+                break;
+            case LandingControl::reroute:
+                if (charging) {
+                    // charges at the other server, where its pad is reserved: the stop is kept until
+                    // it lands there (see updateDroneTarget)
+                    route.stop = rerouteServer;
+                    route.stopFrom = server;
+                } else {
+                    drone->setTargetServerName(world.servers[rerouteServer].name);
+                }
+                drone->setGoalPosition(world.servers[rerouteServer].position);
+                drone->resumeLanding();
+                break;
+        }
+    }
+    resumeCharged();
+}
+
+/**
+ * @brief Canvas::resumeCharged the drones landed at a charging stop take off toward their target
+ * as soon as they are fully charged (the plans assume a full charge). A drone started or moved
+ * meanwhile leaves the list.
+ */
+void Canvas::resumeCharged() {
+    // backward loop: the last drone takes the place of a removed one
+    for (int i = chargingDrones.size() - 1; i >= 0; i--) {
+        Drone *drone = chargingDrones[i];
+        if (drone->getStatus() == Drone::landed && !drone->isFullyCharged()) {
+            continue;
+        }
+        setCharging(drone, false);
+        if (drone->getStatus() != Drone::landed) {
+            continue;
+        }
+        landing.release(drone);
+        drone->route().stopFrom = -1; // plans again with the full range
+        updateDroneTarget(drone);
+        drone->start();
+    }
+}
+
+/**
+ * @brief Canvas::dispatchMissions gathers the landed drones with the distance they can still
+ * fly, assigns them to the missions and sends each assigned drone to its server like a click
+ * on the drone then on the server. Unknown servers are ignored.
+ * @param targetServers name of the target server of each mission
+ * @return the number of assigned missions
+ */
+int Canvas::dispatchMissions(const QStringList &targetServers, MissionDispatcher::Objective objective) {
+    if (!mapDrones) {
+        return 0;
+    }
+    QVector<Drone*> available;
+    QVector<Vector2D> positions;
+    QVector<float> ranges;
+    for (Drone *drone : *mapDrones) {
+        if (drone->getStatus() == Drone::landed) {
+            available.append(drone);
+            positions.append(drone->getPosition());
+            ranges.append(drone->rangeLeft());
+        }
+    }
+    QVector<int> servers;
+    QVector<Vector2D> targets;
+    for (const QString &name : targetServers) {
+        int server = world.serverIndex.value(name.trimmed(), -1);
+        if (server >= 0) {
+            servers.append(server);
+            targets.append(world.servers[server].position);
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<int> droneOfMission;
+    dispatcher.objective = objective;
+    int assigned = dispatcher.assign(positions, ranges, targets, droneOfMission);
+    qint64 elapsed = timer.nsecsElapsed();
+
+    for (int m = 0; m < droneOfMission.size(); m++) {
+        if (droneOfMission[m] < 0) {
+            continue;
+        }
+        Drone *drone = available[droneOfMission[m]];
+        landing.release(drone);  // leaves its pad
+        drone->setTargetServerName(world.servers[servers[m]].name);
+        updateDroneTarget(drone);
+        drone->start();
+    }
+    qDebug() << "Dispatched" << assigned << "of" << targets.size() << "missions to" << available.size()
+             << "drones in" << elapsed / 1.0e6 << "ms, total distance" << dispatcher.totalDistance()
+             << "longest flight" << dispatcher.longestFlight();
+    return assigned;
+}
+
+/**
+ * @brief Canvas::setServerOnline the routing table is repaired incrementally for each removed or
+ * restored connection (see Scenario::setOnline), then only the affected drones are rerouted.
+ * The drones flying to a server taken offline go to the closest online server instead; the ones
+ * that planned to charge there plan again (see repairTraffic).
+ * @param name name of the server
+ * @param online new state
+ * @return true if the state changed
+ */
+bool Canvas::setServerOnline(const QString &name, bool online) {
+    int index = world.serverIndex.value(name, -1);
+    QElapsedTimer timer;
+    timer.start();
+    if (index < 0 || !world.setOnline(index, online)) {
+        return false;
+    }
+    int rerouted = repairTraffic({index});
+    const int substitute = world.nearestServer(world.servers[index].position);
+    if (!online && mapDrones && substitute >= 0 && substitute != index) {
+        for (Drone *drone : *mapDrones) {
+            const Drone::droneStatus status = drone->getStatus();
+            if (drone->getTargetServerName() != name || status == Drone::landed || status == Drone::landing) {
+                continue;
+            }
+            landing.release(drone);
+            drone->setTargetServerName(world.servers[substitute].name);
+            updateDroneTarget(drone);
+            rerouted++;
+        }
+    }
+    qDebug() << "Server" << name << (online ? "online" : "offline") << ", repaired in"
+             << timer.nsecsElapsed() / 1.0e6 << "ms," << rerouted << "drones rerouted";
+    update();
+    return true;
+}
+
+bool Canvas::moveServer(const QString &name, const Vector2D &position) {
+    int index = world.serverIndex.value(name, -1);
+    QElapsedTimer timer;
+    timer.start();
+    if (index < 0 || !world.moveServer(index, position)) {
+        return false;
+    }
+    int rerouted = repairTraffic({index});
+    qDebug() << "Server" << name << "moved, repaired in" << timer.nsecsElapsed() / 1.0e6 << "ms,"
+             << rerouted << "drones rerouted";
+    update();
+    return true;
+}
+
+bool Canvas::addServer(const Server &server) {
+    QElapsedTimer timer;
+    timer.start();
+    int index = world.addServer(server);
+    if (index < 0) {
+        return false;
+    }
+    int rerouted = repairTraffic({index});
+    qDebug() << "Server" << server.name << "added, repaired in" << timer.nsecsElapsed() / 1.0e6 << "ms,"
+             << rerouted << "drones rerouted";
+    update();
+    return true;
+}
+
+bool Canvas::setConnection(const QString &a, const QString &b, bool connected) {
+    int indexA = world.serverIndex.value(a, -1);
+    int indexB = world.serverIndex.value(b, -1);
+    if (indexA < 0 || indexB < 0) {
+        return false;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    bool changed = connected ? world.addConnection(indexA, indexB) : world.removeConnection(indexA, indexB);
+    if (!changed) {
+        return false;
+    }
+    int rerouted = repairTraffic({indexA, indexB});
+    qDebug() << "Connection" << a << b << (connected ? "added" : "removed") << ", repaired in"
+             << timer.nsecsElapsed() / 1.0e6 << "ms," << rerouted << "drones rerouted";
+    update();
+    return true;
+}
+
+/**
+ * @brief Canvas::repairTraffic only the drones whose hop used a removed connection lose their
+ * route; the drones going to or charging at a changed or removed server choose their stop again.
+ * The other drones keep their hop and choose the next one with the repaired tables when they
+ * enter the next region. When servers were removed, the servers of the routes are renumbered
+ * first, like the pads and the queues.
+ * @param changed changed servers
+ * @param remap new index of each previous server, empty if unchanged
+ * @return the number of rerouted drones
+ */
+int Canvas::repairTraffic(const QVector<int> &changed, const QVector<int> &remap) {
+    QVector<Drone*> fleet;
+    if (mapDrones) {
+        fleet.reserve(mapDrones->size());
+        for (Drone *drone : *mapDrones) {
+            fleet.append(drone);
+        }
+    }
+    if (!remap.isEmpty()) {
+        for (Drone *drone : fleet) {
+            Drone::Route &route = drone->route();
+            for (int *server : {&route.from, &route.target, &route.stop, &route.stopFrom, &route.destination}) {
+                *server = *server >= 0 ? remap.value(*server, -1) : -1;
+            }
+        }
+    }
+    int rerouted = router.update(fleet, remap);
+    // the plans are searched again on demand, with the new edges
+    planner.reset(world, DroneTypes::count());
+    landing.update(remap);
+    QVector<bool> touched(world.servers.size(), false);
+    for (int server : changed) {
+        touched[server] = true;
+    }
+    for (Drone *drone : fleet) {
+        Drone::Route &route = drone->route();
+        const bool lost = route.stop < 0 || route.destination < 0; // renumbered to a removed server
+        if (route.stopFrom >= 0 && (lost || touched[route.stop] || touched[route.destination])) {
+            route.stopFrom = -1;
+            route.edge = -1;
+            rerouted++;
+        }
+    }
+    return rerouted;
+}
+
+/**
+ * @brief Canvas::defineTypes registers the drone types of a scenario in the type table. The
+ * drones of a type changed in place end their current phase with the previous characteristics,
+ * then schedule their next transition with the new ones.
+ * @param types the types
+ * @return true if a type changed in place
+ */
+bool Canvas::defineTypes(const QVector<DroneType> &types) {
+    QVector<Drone*> changed;
+    bool redefined = false;
+    for (const DroneType &type : types) {
+        const int id = DroneTypes::redefinedId(type);
+        redefined = redefined || id >= 0;
+        if (id >= 0 && mapDrones) {
+            for (Drone *drone : *mapDrones) {
+                if (drone->getTypeId() == id) {
+                    drone->settle();
+                    changed.append(drone);
+                }
+            }
+        }
+    }
+    for (const DroneType &type : types) {
+        DroneTypes::define(type);
+    }
+    for (Drone *drone : changed) {
+        drone->setType(drone->getTypeId());
+    }
+    return redefined;
+}
+
+/**
+ * @brief Canvas::typeIdOf the type of a drone of the scenario
+ * @param spec description of the drone
+ * @return the ID of its type, the standard type if it is not given or unknown
+ */
+int Canvas::typeIdOf(const DroneSpec &spec) const {
+    if (spec.type.isEmpty()) {
+        return DroneTypes::standard;
+    }
+    int id = DroneTypes::idOf(spec.type);
+    if (id < 0) {
+        qDebug() << "Drone type" << spec.type << "not found for drone" << spec.name;
+        return DroneTypes::standard;
+    }
+    return id;
+}
+
+/**
+ * @brief Canvas::createDrone creates a drone at its initial position, heading to its server.
+ * @param spec description of the drone
+ * @return the new drone
+ */
+Drone *Canvas::createDrone(const DroneSpec &spec) {
+    Drone *drone = new Drone(spec.name);
+    drone->setType(typeIdOf(spec));
+    drone->setScheduler(scheduler);
+    drone->setInitialPosition(spec.position);
+
+    // Find the specified server for the drone
+    Server *targetServer = getServerByName(spec.server);
+    if (targetServer) {
+        drone->setGoalPosition(targetServer->position);
+        drone->setTargetServerName(spec.server);
+    }
+    return drone;
+}
+
+/**
+ * @brief Canvas::resizeEvent updates the cached Voronoi raster to the new size of the canvas
+ */
+void Canvas::resizeEvent(QResizeEvent *) {
+    if (world.background.size() != size()) {
+        world.rasterize(size());
+    }
+}
+
+/**
+ * @brief Canvas::paintEvent
+ */
+
+/*paintevent
+void Canvas::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    QBrush whiteBrush(Qt::SolidPattern);
+    QPen penCol(Qt::DashDotDotLine);
+    penCol.setColor(Qt::lightGray);
+    penCol.setWidth(3);
+    whiteBrush.setColor(Qt::white);
+    painter.fillRect(0,0,width(),height(),whiteBrush);
+
+
+    //Draw the Voronoi diagram
+
+    drawVoronoiDiagram(painter);
+    //draw server connections
+    drawServerConnections(painter);
+
+    if (mapDrones) {
+        Vector2D p;
+        QRect rect(-droneIconSize/2,-droneIconSize/2,droneIconSize,droneIconSize);
+        QRect rectCol(-droneCollisionDistance/2,-droneCollisionDistance/2,droneCollisionDistance,droneCollisionDistance);
+
+        for (auto &drone:*mapDrones) {
+            updateDroneTarget(drone);
+            painter.save();
+            // place and orient the drone
+            painter.translate(drone->getPosition().x,drone->getPosition().y);
+            painter.rotate(drone->getAzimut());
+            painter.drawImage(rect,droneImg);
+            // light leds if flying
+            if (drone->getStatus()!=Drone::landed) {
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(Qt::red);
+                painter.drawEllipse((-185.0/511.0)*droneIconSize,(-185.0/511.0)*droneIconSize,(65.0/511.0)*droneIconSize,(65.0/511.0)*droneIconSize);
+                painter.drawEllipse((115.0/511.0)*droneIconSize,(-185.0/511.0)*droneIconSize,(65.0/511.0)*droneIconSize,(65.0/511.0)*droneIconSize);
+                painter.setBrush(Qt::green);
+                painter.drawEllipse((-185.0/511.0)*droneIconSize,(115.0/511.0)*droneIconSize,(70.0/511.0)*droneIconSize,(70.0/511.0)*droneIconSize);
+                painter.drawEllipse((115.0/511.0)*droneIconSize,(115.0/511.0)*droneIconSize,(70.0/511.0)*droneIconSize,(70.0/511.0)*droneIconSize);
+            }
+            // draw collision detector
+            if (drone->hasCollision()) {
+                painter.setPen(penCol);
+                painter.setBrush(Qt::NoBrush);
+                painter.drawEllipse(rectCol);
+            }
+            painter.restore();
+        }
+    }
+}
+/*
+
+
+
+//----
+/**
+ * @brief Handles the mouse press event to select and move drones.
+ * @param event The mouse event triggered by a click.
+ */
+
+void Canvas::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+
+    // Set up the background and basic styles
+    QBrush whiteBrush(Qt::SolidPattern);
+    whiteBrush.setColor(Qt::white);
+    painter.fillRect(0, 0, width(), height(), whiteBrush);
+
+    // Draw the Voronoi diagram
+    drawVoronoiDiagram(painter);
+
+    // Draw the traffic density of the local drones over the regions (its image is cached)
+    if (heatmapVisible && !replay.isOpen() && !shardSamples && scheduler) {
+        painter.save();
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        const QImage &image = heatmap.image(scheduler->now());
+        painter.drawImage(QRectF(0, 0, image.width() * TrafficHeatmap::cellSize, image.height() * TrafficHeatmap::cellSize), image);
+        painter.restore();
+    }
+
+    // Draw server connections
+    drawServerConnections(painter);
+
+    // Draw the servers as clickable polygons
+    drawServers(painter);  // function to draw the server polygons
+
+    // Draw the recorded drones when replaying a trace, or the drones of the shards
+    if (replay.isOpen() || shardSamples) {
+        for (const TraceSample &sample : replay.isOpen() ? replay.samples() : *shardSamples) {
+            drawDrone(painter, sample.position, sample.azimut, sample.status != Drone::landed, false);
+        }
+        return;
+    }
+
+    // Draw drones (if any)
+    if (mapDrones) {
+        for (auto &drone : *mapDrones) {
+            drawDrone(painter, drone->getPosition(), drone->getAzimut(), drone->getStatus() != Drone::landed, drone->hasCollision());
+        }
+    }
+}
+
+/**
+ * @brief Canvas::recordTraffic the grid follows the size of the canvas; only the cells of the
+ * active drones are updated, the blur and the colors wait for the next paint
+ */
+void Canvas::recordTraffic(const QVector<Drone*> &active, double now, double dt) {
+    if (heatmap.canvasSize() != size()) {
+        heatmap.reset(size(), now);
+    }
+    heatmap.record(active, now, dt);
+}
+
+/**
+ * @brief Canvas::drawDrone places and orients the picture of a drone
+ * @param painter
+ * @param position position of the drone
+ * @param azimut heading of the drone
+ * @param flying lights the LEDs
+ * @param collision draws the collision detector
+ */
+void Canvas::drawDrone(QPainter &painter, const Vector2D &position, double azimut, bool flying, bool collision) {
+    QRect rect(-droneIconSize / 2, -droneIconSize / 2, droneIconSize, droneIconSize);
+    QRect rectCol(-droneCollisionDistance / 2, -droneCollisionDistance / 2, droneCollisionDistance, droneCollisionDistance);
+    QPen penCol(Qt::DashDotDotLine);
+    penCol.setColor(Qt::lightGray);
+    penCol.setWidth(3);
+
+    painter.save();
+    // Place and orient the drone
+    painter.translate(position.x, position.y);
+    painter.rotate(azimut);
+    painter.drawImage(rect, droneImg);
+
+    // Light LEDs if flying
+    if (flying) {
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::red);
+        painter.drawEllipse((-185.0 / 511.0) * droneIconSize, (-185.0 / 511.0) * droneIconSize, (65.0 / 511.0) * droneIconSize, (65.0 / 511.0) * droneIconSize);
+        painter.drawEllipse((115.0 / 511.0) * droneIconSize, (-185.0 / 511.0) * droneIconSize, (65.0 / 511.0) * droneIconSize, (65.0 / 511.0) * droneIconSize);
+        painter.setBrush(Qt::green);
+        painter.drawEllipse((-185.0 / 511.0) * droneIconSize, (115.0 / 511.0) * droneIconSize, (70.0 / 511.0) * droneIconSize, (70.0 / 511.0) * droneIconSize);
+        painter.drawEllipse((115.0 / 511.0) * droneIconSize, (115.0 / 511.0) * droneIconSize, (70.0 / 511.0) * droneIconSize, (70.0 / 511.0) * droneIconSize);
+    }
+
+    // Draw collision detector
+    if (collision) {
+        painter.setPen(penCol);
+        painter.setBrush(Qt::NoBrush);
+        painter.drawEllipse(rectCol);
+    }
+    painter.restore();
+}
+
+/**
+ * @brief Canvas::drawServers function to
+ * draw servers as clickable polygons
+ * @param painter
+ */
+void Canvas::drawServers(QPainter &painter) {
+    QPen serverPen(Qt::black);  //  color for the server polygons
+    painter.setPen(serverPen);
+    painter.setBrush(Qt::NoBrush);
+
+    for (const Server &server : world.servers) {
+
+        QPointF serverPos(server.position.x, server.position.y);
+        qreal radius = 30;
+
+        // Draw server as a circle
+        painter.drawEllipse(serverPos, radius, radius);
+    }
+}
+
+
+/* mousePressEvent
+void Canvas::mousePressEvent(QMouseEvent *event) {
+    // search for a drone that is landed
+    auto it = mapDrones->begin();
+    while (it!=mapDrones->end() && (*it)->getStatus()!=Drone::landed) {
+        it++;
+    }
+    // if found, ask for a motion to the mouse position
+    if (it!=mapDrones->end()) {
+        (*it)->setGoalPosition(Vector2D(event->pos().x(),event->pos().y()));
+        (*it)->start();
+    }
+    repaint();
+}
+*/
+//----
+///*
+
+/**
+ * @brief Canvas::mousePressEvent Handles mouse press events for activating drones and setting their target servers.
+ * this function checks for the mouse press event and does two action which is
+ * 1-if a drone is clicked,it activate drone and sets it as the the active drone,
+ * 2- if a server is clicked and a drone is active it then set the server which is clicked as the target of the the active drone
+ * and updates the drones movement toward the server that is being targetted .
+ * @param event
+ */
+void Canvas::mousePressEvent(QMouseEvent *event) {
+    if (replay.isOpen() || shardSamples) {
+        return; // the recorded drones and the drones of the shards cannot be controlled
+    }
+    QPointF clickPos = event->pos();
+
+    //Check if a drone is clicked
+    for (Drone* drone : *mapDrones) {
+        QRect droneBounds(drone->getPosition().x - 20, drone->getPosition().y - 20, 40, 40);
+        if (droneBounds.contains(clickPos.toPoint())) {
+            if (activeDrone) {
+                qDebug() << "Deactivating drone:" << activeDrone->getName();
+            }
+            activeDrone = drone;
+            qDebug() << "Drone activated:" << activeDrone->getName();
+            return;
+        }
+    }
+
+    //  If a server is clicked and a drone is active
+    if (activeDrone) {
+        for (const Server &server : world.servers) {
+            QPointF serverPos(server.position.x, server.position.y);
+            qreal radius = 30;
+
+            // Check if the click is within the server's circle
+            if ((clickPos - serverPos).manhattanLength() <= radius) {
+                landing.release(activeDrone);  // leaves its pad or its holding queue
+                activeDrone->setTargetServerName(server.name);  // Set the target server for the active drone
+                updateDroneTarget(activeDrone);  // Move the drone
+                activeDrone->start();
+                qDebug() << "Drone" << activeDrone->getName() << "moving to server:" << server.name;
+                activeDrone = nullptr;  // Reset active drone
+                return;
+        }
+    }
+}
+
+}
+//*/
+
+/**
+ * @brief Canvas::drawVoronoiDiagram Draws the Voronoi diagram based on  drone positions.
+ * @param painter The QPainter object used to draw the Voronoi diagram.
+ */
+void Canvas::drawVoronoiDiagram(QPainter &painter) {
+    if (world.servers.isEmpty()) return;
+
+    // the regions are rasterized once per scenario and size (see Scenario::rasterize)
+    painter.drawImage(0, 0, world.background);
+
+    // Draw server positions
+    for (const auto &server : world.servers) {
+        painter.setBrush(server.online ? Qt::black : Qt::gray); // offline servers in gray
+        painter.setPen(Qt::black);
+        painter.drawEllipse(QPointF(server.position.x, server.position.y), 10, 10); // Circle at server position
+
+        // Draw the server name near its position
+        painter.setPen(Qt::white);
+        painter.drawText(server.position.x + 15, server.position.y - 15, server.name);
+    }
+}
+
+
+
+/**
+ * @brief Canvas::getServerByName this function searches for a server by its name from the list of servers.
+ * @param name The name of the server to retrieve.
+ * @return A pointer to the Server object if found.
+ */
+
+Canvas::Server* Canvas::getServerByName(const QString &name) {
+    int index = world.serverIndex.value(name, -1);
+    return (index < 0) ? nullptr : &world.servers[index]; // Return nullptr if no match is found
+}
+
+
+
+/**
+ * @brief Canvas::drawServerConnections draws the server connections on the canvas by looping through each server and the set of connected server then draws conecting line between
+ * each pairs of cnnected servers
+ * @param painter the QPainter objects is then  used to draw the server connections.
+ */
+
+void Canvas::drawServerConnections(QPainter &painter) {
+    for (auto it = world.serverConnections.begin(); it != world.serverConnections.end(); ++it) {
+        QString serverNameA = it.key();
+        Server *serverA = getServerByName(serverNameA);
+
+        if (serverA) {
+            for (const QString &serverNameB : it.value()) {
+                if (serverNameA != serverNameB) {
+                    Server *serverB = getServerByName(serverNameB);
+                    if (serverB) {
+                        painter.setPen(QPen(Qt::white, 2));
+                        painter.drawLine(serverA->position.x, serverA->position.y,
+                                         serverB->position.x, serverB->position.y);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief Canvas::findPathBasedOnConnections this function Finds the shortest path between two servers based on their connections.
+ * used the BFS -breadth first seach to fine shortest path from the start server and goal server basd on the connection btw servers
+ * @param start the starting server name
+ * @param goal the goal server name
+ * @return  A list of server names representing the path from start to goal, or an empty list if no path is found.
+ */
+QStringList Canvas::findPathBasedOnConnections(const QString &start, const QString &goal) {
+    if (start == goal) {
+        return {start};
+    }
+    const int n = world.servers.size();
+    int current = world.serverIndex.value(start, -1);
+    int target = world.serverIndex.value(goal, -1);
+    if (current < 0 || target < 0 || world.nextHop[current * n + target] < 0) {
+        return {};
+    }
+
+    QStringList path;
+    path.append(start);
+    while (current != target) {
+        current = world.nextHop[current * n + target];
+        path.append(world.servers[current].name);
+    }
+    return path;
+}
+
+
+/**
+ * @brief Canvas::updateDroneTarget this function updates the target positioning of a drone based on the current and target servers.
+ * @param drone The drone object whose target position is to be updated.
+ */
+
+void Canvas::updateDroneTarget(Drone *drone) {
+    updateDroneTarget(drone, serverIndexAt(drone->getPosition()));
+}
+
+/**
+ * @brief Canvas::updateDroneTarget moves a drone toward its target server if it can be reached
+ * @param drone The drone object whose target position is to be updated.
+ * @param currentServer index of the server region containing the drone
+ */
+void Canvas::updateDroneTarget(Drone *drone, int currentServer) {
+    int targetServer = world.serverIndex.value(getTargetServerForDrone(drone), -1);
+
+    if (currentServer < 0 || targetServer < 0) {
+        return;  // No valid movement if drone isn’t on a server
+    }
+    // next landing, planned again in each new region with the range left (cached plans)
+    Drone::Route &route = drone->route();
+    if (route.stopFrom != currentServer || route.destination != targetServer) {
+        // a pad or a place waiting at the stop pins it (a charging drone rerouted by admitLandings)
+        const int reserved = landing.stationOf(drone);
+        if (route.destination != targetServer || reserved < 0 || reserved != route.stop) {
+            route.stop = planner.nextStop(currentServer, targetServer, drone->rangeLeft(), drone->getTypeId());
+            if (route.stop < 0) {
+                route.stop = targetServer; // out of reach even with charges: flies as far as it can
+            }
+            if (reserved >= 0 && reserved != route.stop) {
+                landing.release(drone); // the pad promised at the former stop goes to another drone
+            }
+        }
+        route.stopFrom = currentServer;
+        route.destination = targetServer;
+    }
+    const int leg = route.stop;
+    if (currentServer == leg) {
+        // last leg (also after a reroute to the current region), or charges here first
+        drone->setGoalPosition(world.servers[leg].position);
+        return;
+    }
+
+    // next hop on the least congested path, the drone only lands at the end of the leg
+    int next = router.route(drone, currentServer, leg);
+    if (next == leg) {
+        drone->setGoalPosition(world.servers[leg].position);
+    } else if (next >= 0) {
+        drone->setWaypoint(world.servers[next].position);
+    }
+}
+
+/**
+ * @brief Canvas::updateDroneTargets gathers the positions of the drones, finds their server
+ * regions in one pass over the region raster (see Scenario::locate) and updates their targets.
+ * @param fleet the drones to update
+ */
+void Canvas::updateDroneTargets(const QVector<Drone*> &fleet) {
+    const int n = fleet.size();
+    dronePositions.resize(n);
+    for (int i = 0; i < n; i++) {
+        dronePositions[i] = fleet[i]->getPosition();
+    }
+    if (world.tiles) {
+        // the drones out of the canvas read their region in the tiles around them
+        world.tiles->prefetch(dronePositions, world.background.size());
+    }
+    world.locate(dronePositions, droneRegions);
+    router.countLoads(fleet);
+    for (int i = 0; i < n; i++) {
+        updateDroneTarget(fleet[i], droneRegions[i]);
+    }
+}
+
+
+/**
+ * @brief Canvas::getNextServer this function is to fnd next server in the path between the current server and the target server and
+ * returns the next server along the path from the current server to the target server,
+ * based on the connections between servers.
+ * @param current current server name
+ * @param target target server name
+ * @return The name of the next server in the path, or it will return an  empty string if there is no valid next server  found.
+ */
+QString Canvas::getNextServer(const QString &current, const QString &target) {
+    QStringList path = findPathBasedOnConnections(current, target);
+    qDebug() << "Path from" << current << "to" << target << ":" << path;
+
+    if (path.size() > 1) {
+        qDebug() << "Next step is:" << path[1];
+        return path[1];  // Move to the next step
+    }
+    qDebug() << "No valid path found!";
+    return {};
+}
+
+/**
+ * @brief Canvas::getCurrentServerForDrone this function checks the position of the drone for any given drone and finds the server that contains the position
+ * @param drone The drone object for which to determine the current server.
+ * @return The name of the current server the drone is located in, or return an empty string if it is not  found.
+ */
+const QString &Canvas::getCurrentServerForDrone(Drone *drone) {
+    static const QString noServer;
+    int index = serverIndexAt(drone->getPosition());
+    return (index < 0) ? noServer : world.servers[index].name;
+}
+
+/**
+ * @brief Canvas::serverIndexAt returns the server whose Voronoi region contains the position.
+ * @param position the position to locate
+ * @return The index of the server, or -1 if there is no server.
+ */
+int Canvas::serverIndexAt(const Vector2D &position) const {
+    return world.regionAt(position);
+}
+
+/**
+ * @brief Canvas::getTargetServerForDrone ths function gets the targer server for a drone
+ * @param drone the drone object for which to retrieve the target server name.
+ * @return The name of the target server for the drone.
+ */
+const QString &Canvas::getTargetServerForDrone(Drone *drone) {
+    return drone->getTargetServerName();
+}
+
+/**
+ * @brief Canvas::getServerPolygon
+ * @param serverPos
+ * @return
+ */
+QPolygonF Canvas::getServerPolygon(const Vector2D &serverPos) {
+    for (const auto &server : world.servers) {
+        if ((server.position - serverPos).length() < 10.0) {  // Find the matching server
+            return server.polygon;  // Return its Voronoi polygon
+        }
+    }
+    return QPolygonF();  // Return  empty polygon  if not found
+}
+
+/**
+ * @brief Canvas::startReplay maps a trace and shows its first frame, the live drones are
+ * hidden until stopReplay.
+ * @param path path of the trace
+ * @return true if the trace is shown
+ */
+bool Canvas::startReplay(const QString &path) {
+    if (!replay.open(path)) {
+        return false;
+    }
+    qDebug() << "replay" << path << replay.droneNames().size() << "drones from" << replay.startTime() << "to" << replay.endTime();
+    update();
+    return true;
+}
+
+/**
+ * @brief Canvas::stopReplay closes the trace.
+ */
+void Canvas::stopReplay() {
+    replay.close();
+    update();
+}
+
+/**
+ * @brief Canvas::seekReplay decodes the trace at a time and repaints.
+ * @param t time to show
+ * @return time of the shown frame
+ */
+double Canvas::seekReplay(double t) {
+    double shown = replay.seek(t);
+    update();
+    return shown;
+}
+
+/**
+ * @brief Canvas::captureSnapshot the tables of the world and the raster are shared with the
+ * snapshot (copied on write by the next change), only the drones and the pads are copied.
+ * @param snapshot the copy
+ */
+void Canvas::captureSnapshot(WorldSnapshot &snapshot) const {
+    QVector<Drone*> fleet = drones;
+    if (mapDrones) {
+        fleet.clear();
+        for (Drone *drone : *mapDrones) {
+            fleet.append(drone);
+        }
+    }
+    const int n = world.servers.size();
+    snapshot.time = scheduler ? scheduler->now() : 0;
+    snapshot.names.clear();
+    snapshot.servers.resize(n);
+    for (int i = 0; i < n; i++) {
+        const Server &server = world.servers[i];
+        snapshot.servers[i] = WorldSnapshot::ServerRecord{server.position, server.color.rgb(), server.capacity, server.online, quint32(snapshot.names.size())};
+        snapshot.names.append(server.name);
+    }
+    snapshot.types.resize(DroneTypes::count());
+    for (int id = 0; id < DroneTypes::count(); id++) {
+        const DroneType &type = DroneTypes::at(id);
+        snapshot.types[id] = WorldSnapshot::TypeRecord{quint32(snapshot.names.size()), 0, type.maxSpeed, type.maxPower, type.takeoffSpeed,
+                                                       type.hoveringHeight, type.damping, type.chargingSpeed, type.powerConsumption};
+        snapshot.names.append(type.name);
+    }
+    snapshot.edgeStart.resize(n + 1);
+    snapshot.edgeTo.clear();
+    for (int i = 0; i < n; i++) {
+        snapshot.edgeStart[i] = snapshot.edgeTo.size();
+        snapshot.edgeTo.append(world.adjacency.value(i));
+    }
+    snapshot.edgeStart[n] = snapshot.edgeTo.size();
+    snapshot.nextHop = world.nextHop;
+    snapshot.hopCount = world.hopCount;
+    snapshot.hopParent = world.hopParent;
+    snapshot.background = world.background;
+    snapshot.regionIds = world.regionIds;
+
+    QHash<const Drone*,int> droneIndex;
+    droneIndex.reserve(fleet.size());
+    snapshot.drones.resize(fleet.size());
+    for (int d = 0; d < fleet.size(); d++) {
+        Drone *drone = fleet[d];
+        droneIndex.insert(drone, d);
+        snapshot.drones[d] = WorldSnapshot::DroneRecord{drone->saveState(), world.serverIndex.value(drone->getTargetServerName(), -1), quint32(snapshot.names.size())};
+        snapshot.names.append(drone->getName());
+    }
+    snapshot.charging.clear();
+    for (Drone *drone : chargingDrones) {
+        snapshot.charging.append(droneIndex.value(drone));
+    }
+    landing.saveState(droneIndex, snapshot.pads, snapshot.queues, snapshot.landingCounters);
+}
+
+/**
+ * @brief Canvas::restoreSnapshot rebuilds the world from the saved tables (no connection,
+ * routing or raster computation unless the canvas size changed), then recreates the drones in
+ * their saved state and gives back their pads.
+ * @param snapshot the snapshot
+ */
+void Canvas::restoreSnapshot(const WorldSnapshot &snapshot) {
+    if (mapDrones) {
+        for (Drone *drone : *mapDrones) {
+            drone->setScheduler(nullptr);
+        }
+    }
+    if (scheduler) {
+        scheduler->setTime(snapshot.time);
+    }
+    activeDrone = nullptr;
+
+    world = Scenario();
+    const int n = snapshot.servers.size();
+    world.servers.resize(n);
+    for (int i = 0; i < n; i++) {
+        const WorldSnapshot::ServerRecord &record = snapshot.servers[i];
+        Server &server = world.servers[i];
+        server.name = snapshot.names[record.name];
+        server.position = record.position;
+        server.color = QColor::fromRgb(record.rgb);
+        server.capacity = record.capacity;
+        server.online = record.online;
+        world.serverIndex.insert(server.name, i);
+    }
+    world.adjacency.resize(n);
+    for (int a = 0; a < n; a++) {
+        for (int e = snapshot.edgeStart[a]; e < snapshot.edgeStart[a + 1]; e++) {
+            int b = snapshot.edgeTo[e];
+            world.adjacency[a].append(b);
+            world.serverConnections[world.servers[a].name].insert(world.servers[b].name);
+        }
+    }
+    world.nextHop = snapshot.nextHop;
+    world.hopCount = snapshot.hopCount;
+    world.hopParent = snapshot.hopParent;
+    world.background = snapshot.background;
+    world.regionIds = snapshot.regionIds;
+    if (world.background.size() != size()) {
+        world.rasterize(size());
+    }
+
+    // the IDs of the types defined at runtime may differ in this session
+    DroneTypes::reset();
+    QVector<int> typeIds(snapshot.types.size());
+    for (int id = 0; id < snapshot.types.size(); id++) {
+        const WorldSnapshot::TypeRecord &record = snapshot.types[id];
+        DroneType type{snapshot.names[record.name], record.maxSpeed, record.maxPower, record.takeoffSpeed, record.hoveringHeight,
+                       record.damping, record.chargingSpeed, record.powerConsumption};
+        typeIds[id] = id < DroneTypes::builtinCount ? id : DroneTypes::define(type);
+        if (id >= DroneTypes::builtinCount) {
+            world.types.append(type);
+        }
+    }
+
+    drones.clear();
+    drones.reserve(snapshot.drones.size());
+    world.drones.reserve(snapshot.drones.size());
+    for (const WorldSnapshot::DroneRecord &record : snapshot.drones) {
+        Drone *drone = new Drone(snapshot.names[record.name]);
+        drone->setScheduler(scheduler);
+        Drone::State state = record.state;
+        state.typeId = typeIds[state.typeId];
+        drone->restoreState(state);
+        QString target = record.target >= 0 ? world.servers[record.target].name : QString();
+        drone->setTargetServerName(target);
+        drones.append(drone);
+        world.drones.append(DroneSpec{drone->getName(), drone->getPosition(), target, drone->type().name});
+    }
+    if (mapDrones) {
+        mapDrones->clear();
+        for (Drone *drone : drones) {
+            mapDrones->insert(drone->getName(), drone);
+        }
+    }
+    heatmap.reset(size(), snapshot.time);
+
+    router.reset(world);
+    planner.reset(world, DroneTypes::count());
+    landing.reset(world, fleetSlots(), snapshot.time);
+    landing.restoreState(drones, snapshot.pads, snapshot.queues, snapshot.landingCounters);
+    chargingDrones.clear();
+    chargingIndex.fill(-1);
+    reserveFleet();
+    for (int d : snapshot.charging) {
+        setCharging(drones[d], true);
+    }
+    update();
+}
@@ -1,179 +1,434 @@
-/**
- * @brief Drone_demo project
- * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
- * @date dec. 2024
- **/
-#ifndef CANVAS_H
-#define CANVAS_H
-
-#include <QWidget>
-#include <drone.h>
-#include <QMouseEvent>
-#include <QPaintEvent>
-#include <QVector>
-#include <QColor>
-#include <QMap>
-#include <QSet>
-#include <QString>
-#include "vector2d.h"
-class QPainter;
-class Canvas : public QWidget {
-
-    Q_OBJECT
-public:
-    const int droneIconSize=64; ///< size of the drone picture in the vanvas
-    const double droneCollisionDistance=droneIconSize*1.5; ///< distance to detect collision with other drone
-    /**
-     * @brief Canvas constructor
-     * @param parent
-     */
-    explicit Canvas(QWidget *parent = nullptr);
-    /**
-     * @brief setMap set the list of drones (identified by their name) to the canvas
-     * @param map the map of couple "name of the drone"/"drone pointer"
-     */
-    inline void setMap(QMap<QString,Drone*> *map) { mapDrones=map; }
-    /**
-     * @brief paintEvent
-     */
-    void paintEvent(QPaintEvent*) override;
-    /**
-     * @brief mousePressEvent
-     * @param event
-     */
-    void mousePressEvent(QMouseEvent *event) override;
-
-    /**
-     * @brief loadJsonData loads server and drone information from a JSON file
-     * @param jsonFilePath the path to the JSON file
-     */
-     void loadJsonData(const QString &jsonFilePath = ""); // Function to load JSON data
-
-    /**
-      * @brief initializeServerConnections
-      */
-     void initializeServerConnections();  // Method to initialize server connectivity
-
-     /**
-    /**      * @brief getNextServerComputes the next server for a drone based on current and target servers.
-    /**      * @param current Current server name.
-    /**      * @param target the Target server name
-    /**      * @return next server name in oath
-    /**      */
-
-     QString getNextServer(const QString &current, const QString &target);  // Logic for moving drones
-     /**
-      * @brief parseServerConnections from a json object
-      * @param jsonObject
-      */
-     void parseServerConnections(const QJsonObject &jsonObject);  // Declare function to parse connections
-     /**
-      * @brief computeVoronoiPolygons for servers
-      */
-     void computeVoronoiPolygons();
-     /**
-      * @brief check if polygon sare an edge
-      * @return return tre if they share an edge otherwise false
-      */
-     bool polygonsShareEdge(const QPolygonF &poly1, const QPolygonF &poly2);
-
-     /**
-     * @brief Finds a path between two servers using connectivity data.
-     * @param start Starting server name.
-     * @param goalis to Target server name.
-     * @return List of server names representing the path.
-     */
-     QStringList findPathBasedOnConnections(const QString &start, const QString &goal);
-     /**
-     * @brief Updates the target server for a given drone.
-     */
-     void updateDroneTarget(Drone *drone);
-     /**
-     * @brief Finds the current server for a drone.
-     * @return Name of the current server.
-     */
-     QString getCurrentServerForDrone(Drone *drone);  // Helper to find the current server of a drone
-     /**
-     * @brief Finds the target server for a drone.
-     * @return Name of the target server.
-     */
-     QString getTargetServerForDrone(Drone *drone);   // Helper to get target server for a drone
-
-     /**
-     * @brief Gets the name of the target server.
-     */
-     QString getTargetServerName() const;
-
-    QPolygonF getServerPolygon(const Vector2D &serverPos);
-
-
-  public:
-     /**
-     * @brief Represents a server with name, position, color, and polygon.
-     */
-     struct Server {
-        QString name;
-        Vector2D position;
-        QColor color;
-        QPolygonF polygon;
-
-
-    };
-    QVector<Server> servers;// List of servers
-signals:
-
-private:
-    /** Draw the Voronoi diagram on the canvas */
-    void drawVoronoiDiagram(QPainter& painter);
-    /**
-     * @brief drawServerConnections
-     * @param painter
-     */
-    void drawServerConnections(QPainter& painter);
-    /**
-     * @brief getServerByName
-     * @param name Server name
-     * @return Pointer to the server or nullptr if not found.
-     */
-    Server* getServerByName(const QString &name);
-    /**
-     * @brief drawServers Draws the server polygons
-     * @param painter QPainter object used to  draw on the canvas
-     */
-    void drawServers(QPainter &painter);
-
-    QVector<Drone*> drones;//list of drones
-    //QVector<Server> servers;  // List of servers
-    QMap<QString,Drone*> *mapDrones=nullptr; //pointer on the map of the drones
-    QMap<QString, QSet<QString>> serverConnections;// Adjacency list for server connections
-    QImage droneImg; ///< picture representing the drone in the canvas
-
-    /**
-     * @brief euclideanDistance
-     * @param a
-     * @param b
-     * @return Distance between the points.
-     */
-    static double euclideanDistance(const Vector2D &a, const Vector2D &b);  // Static helper for distance
-    /**
-     * @brief parsePosition
-     * @param position String representation of position.
-     * @return  representing the parsed position.
-     */
-    QPoint parsePosition(const QString &position);  // Helper to parse position strings
-    /**
-     * @brief selectedDrone Pointer to the currentselected drone.
-     */
-    Drone* selectedDrone = nullptr;
-    /**
-     * @brief activeDrone pointer to the curren active drone.
-     */
-    Drone* activeDrone = nullptr;  // Track the currently selected drone
-
-
-
-
-
-};
-
-#endif // CANVAS_H
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <QWidget>
+#include <drone.h>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QVector>
+#include <QColor>
+#include <QMap>
+#include <QSet>
+#include <QHash>
+#include <QString>
+#include "vector2d.h"
+#include "scenario.h"
+#include "landingcontrol.h"
+#include "fleetrouter.h"
+#include "missiondispatcher.h"
+#include "energyplanner.h"
+#include "tracereader.h"
+#include "worldsnapshot.h"
+#include "commandserver.h"
+#include "trafficheatmap.h"
+class QPainter;
+class DroneScheduler;
+class Canvas : public QWidget {
+
+    Q_OBJECT
+public:
+    const int droneIconSize=64; ///< size of the drone picture in the vanvas
+    const double droneCollisionDistance=droneIconSize*1.5; ///< distance to detect collision with other drone
+    /**
+     * @brief Canvas constructor
+     * @param parent
+     */
+    explicit Canvas(QWidget *parent = nullptr);
+    /**
+     * @brief setMap set the list of drones (identified by their name) to the canvas
+     * @param map the map of couple "name of the drone"/"drone pointer"
+     */
+    inline void setMap(QMap<QString,Drone*> *map) { mapDrones=map; }
+    /**
+     * @brief setScheduler set the scheduler given to the drones created by the canvas
+     * @param s the scheduler
+     */
+    inline void setScheduler(DroneScheduler *s) { scheduler=s; }
+    /**
+     * @brief paintEvent
+     */
+    void paintEvent(QPaintEvent*) override;
+    /**
+     * @brief mousePressEvent
+     * @param event
+     */
+    void mousePressEvent(QMouseEvent *event) override;
+    /**
+     * @brief resizeEvent rasterizes the Voronoi diagram at the new size
+     */
+    void resizeEvent(QResizeEvent *event) override;
+
+    /**
+     * @brief loadJsonData loads server and drone information from a JSON file
+     * @param jsonFilePath the path to the JSON file
+     */
+     void loadJsonData(const QString &jsonFilePath = ""); // Function to load JSON data
+
+    /**
+     * @brief applyScenario replaces the current world by a loaded scenario.
+     * Must be called between two ticks; the drones are created here (GUI thread).
+     * @param scenario the scenario, its content is moved to the canvas
+     */
+     void applyScenario(Scenario &scenario);
+
+    /**
+      * @brief initializeServerConnections
+      */
+     void initializeServerConnections();  // Method to initialize server connectivity
+
+     /**
+    /**      * @brief getNextServerComputes the next server for a drone based on current and target servers.
+    /**      * @param current Current server name.
+    /**      * @param target the Target server name
+    /**      * @return next server name in oath
+    /**      */
+
+     QString getNextServer(const QString &current, const QString &target);  // Logic for moving drones
+     /**
+      * @brief computeVoronoiPolygons for servers
+      */
+     void computeVoronoiPolygons();
+     /**
+      * @brief check if polygon sare an edge
+      * @return return tre if they share an edge otherwise false
+      */
+     bool polygonsShareEdge(const QPolygonF &poly1, const QPolygonF &poly2);
+
+     /**
+     * @brief Finds a path between two servers using connectivity data.
+     * @param start Starting server name.
+     * @param goalis to Target server name.
+     * @return List of server names representing the path.
+     */
+     QStringList findPathBasedOnConnections(const QString &start, const QString &goal);
+     /**
+     * @brief Updates the target server for a given drone.
+     */
+     void updateDroneTarget(Drone *drone);
+     /**
+     * @brief Updates the target of a fleet of drones, after locating them in one batched pass.
+     * @param fleet the drones to update
+     */
+     void updateDroneTargets(const QVector<Drone*> &fleet);
+     /**
+     * @brief Finds the current server for a drone.
+     * @return Name of the current server.
+     */
+     const QString &getCurrentServerForDrone(Drone *drone);  // Helper to find the current server of a drone
+     /**
+     * @brief Finds the index of the server region containing a position.
+     * @param position the position to test
+     * @return index in servers or -1 if there is no server.
+     */
+     int serverIndexAt(const Vector2D &position) const;
+     /**
+     * @brief Finds the target server for a drone.
+     * @return Name of the target server.
+     */
+     const QString &getTargetServerForDrone(Drone *drone);   // Helper to get target server for a drone
+
+     /**
+     * @brief Gets the name of the target server.
+     */
+     QString getTargetServerName() const;
+
+    QPolygonF getServerPolygon(const Vector2D &serverPos);
+
+
+    /**
+     * @brief mergeScenario applies a reloaded scenario in place: only the servers and drones
+     * that differ (by name) are updated, the other drones keep flying.
+     * Must be called between two ticks.
+     * @param scenario the reloaded scenario (only its servers and drones are used)
+     * @param added drones created by the reload
+     * @param removed drones removed from the canvas (to be deleted by the caller)
+     * @return the changes made to the servers
+     */
+     Scenario::ServerDiff mergeScenario(const Scenario &scenario, QVector<Drone*> &added, QVector<Drone*> &removed);
+    /**
+     * @brief applyCommands applies a batch of drone commands (between two ticks)
+     * @param commands the commands, in their order of reception
+     * @param added drones created by the commands
+     * @param removed drones removed from the canvas (to be deleted by the caller)
+     * @return the number of commands that had an effect (the others name an unknown drone or
+     * server, or do not apply to the state of the drone)
+     */
+     int applyCommands(const QVector<DroneCommand> &commands, QVector<Drone*> &added, QVector<Drone*> &removed);
+    /**
+     * @brief adoptDrone creates a drone handed off by another shard (between two ticks)
+     * @param name: name of the drone
+     * @param target: name of its target server
+     * @param state: its state in the other shard
+     * @return the new drone, nullptr if the name is already used
+     */
+     Drone *adoptDrone(const QString &name, const QString &target, const Drone::State &state);
+    /**
+     * @brief releaseDrones removes the drones handed off to another shard (between two ticks)
+     * @param gone: the drones, to be deleted by the caller
+     */
+     void releaseDrones(const QVector<Drone*> &gone);
+    /**
+     * @brief getWorld
+     * @return the servers, connections and routing table of the running world
+     */
+     inline const Scenario &getWorld() const { return world; }
+     /**
+      * @brief admitLandings gives a landing decision to the drones that reached their landing zone:
+      * land on a pad, hold around the server or reroute to another server; the drones charged
+      * at a stop take off again
+      * @param fleet the drones to check (a drone that lands leaves the active list)
+      */
+     void admitLandings(const QVector<Drone*> &fleet);
+     /**
+      * @brief getLanding
+      * @return the landing pads and queues of the servers
+      */
+     inline const LandingControl &getLanding() const { return landing; }
+     /**
+      * @brief getPlanner
+      * @return the charging stops planner
+      */
+     inline const EnergyPlanner &getPlanner() const { return planner; }
+     /**
+      * @brief dispatchMissions assigns a batch of missions to the landed drones, minimizing the
+      * total flight distance or the longest flight, and starts the assigned drones
+      * @param targetServers name of the target server of each mission
+      * @param objective quantity minimized by the assignment
+      * @return the number of assigned missions
+      */
+     int dispatchMissions(const QStringList &targetServers, MissionDispatcher::Objective objective = MissionDispatcher::minimizeTotal);
+     /**
+      * @brief setServerOnline takes a server down or back up at runtime (between two ticks)
+      * @param name: name of the server
+      * @param online: new state
+      * @return false if the server is unknown or already in this state
+      */
+     bool setServerOnline(const QString &name, bool online);
+     /**
+      * @brief moveServer moves a server at runtime, its connections follow the distance rule
+      * @param name: name of the server
+      * @param position: new position
+      * @return false if the server is unknown or did not move
+      */
+     bool moveServer(const QString &name, const Vector2D &position);
+     /**
+      * @brief addServer adds a server at runtime, connected to the servers in range
+      * @param server: the new server
+      * @return false if the name is already used
+      */
+     bool addServer(const Server &server);
+     /**
+      * @brief setConnection adds or removes a connection at runtime
+      * @param a: name of a server
+      * @param b: name of another server
+      * @param connected: true to add the connection, false to remove it
+      * @return false if a server is unknown or nothing changed
+      */
+     bool setConnection(const QString &a, const QString &b, bool connected);
+     /**
+      * @brief captureSnapshot copies the running world and the state of the drones (between two
+      * ticks); the copy can then be written in the background
+      * @param snapshot: filled with the world
+      */
+     void captureSnapshot(WorldSnapshot &snapshot) const;
+     /**
+      * @brief restoreSnapshot replaces the world and the drones by a snapshot and sets the clock
+      * of the scheduler to its time (between two ticks)
+      * @param snapshot: the snapshot
+      */
+     void restoreSnapshot(const WorldSnapshot &snapshot);
+     /**
+      * @brief startReplay shows a recorded trace instead of the drones (see TraceReader)
+      * @param path: path of the trace
+      * @return false if the trace cannot be read
+      */
+     bool startReplay(const QString &path);
+     /**
+      * @brief stopReplay goes back to the live drones
+      */
+     void stopReplay();
+     /**
+      * @brief seekReplay shows the fleet of the trace at a time
+      * @param t: simulation time
+      * @return the time of the shown frame
+      */
+     double seekReplay(double t);
+     /**
+      * @brief isReplaying
+      * @return true if a trace is shown
+      */
+     inline bool isReplaying() const { return replay.isOpen(); }
+     /**
+      * @brief getReplay
+      * @return the shown trace
+      */
+     inline const TraceReader &getReplay() const { return replay; }
+     /**
+      * @brief showShards shows the drones of a multi-process simulation instead of the local ones
+      * @param samples: the drones, owned by the caller (see ShardHub), nullptr to show the local drones
+      */
+     inline void showShards(const QVector<TraceSample> *samples) { shardSamples = samples; update(); }
+     /**
+      * @brief recordTraffic adds the moving drones of a tick to the traffic heatmap
+      * @param active: the hovering and flying drones
+      * @param now: simulation time at the end of the tick
+      * @param dt: duration of the tick
+      */
+     void recordTraffic(const QVector<Drone*> &active, double now, double dt);
+     /**
+      * @brief setHeatmapVisible shows the traffic heatmap over the Voronoi regions
+      * @param visible: true to show it
+      */
+     inline void setHeatmapVisible(bool visible) { heatmapVisible = visible; update(); }
+
+  public:
+     using Server = ::Server;
+signals:
+
+private:
+    /** Draw the Voronoi diagram on the canvas */
+    void drawVoronoiDiagram(QPainter& painter);
+    /**
+     * @brief drawServerConnections
+     * @param painter
+     */
+    void drawServerConnections(QPainter& painter);
+    /**
+     * @brief getServerByName
+     * @param name Server name
+     * @return Pointer to the server or nullptr if not found.
+     */
+    Server* getServerByName(const QString &name);
+    /**
+     * @brief drawServers Draws the server polygons
+     * @param painter QPainter object used to  draw on the canvas
+     */
+    void drawServers(QPainter &painter);
+    /**
+     * @brief drawDrone draws the picture of a drone, its LEDs when it flies and its collision circle
+     * @param painter QPainter object used to draw on the canvas
+     * @param position position of the drone
+     * @param azimut heading of the drone
+     * @param flying true if the drone is not landed
+     * @param collision true if a collision is detected
+     */
+    void drawDrone(QPainter &painter, const Vector2D &position, double azimut, bool flying, bool collision);
+
+    /**
+     * @brief createDrone creates a drone from its description
+     * @param spec description of the drone
+     * @return the new drone
+     */
+    Drone *createDrone(const DroneSpec &spec);
+    /**
+     * @brief defineTypes registers the drone types of a scenario
+     * @param types the types
+     * @return true if a type changed in place (its plans are out of date)
+     */
+    bool defineTypes(const QVector<DroneType> &types);
+    /**
+     * @brief typeIdOf finds the type of a drone
+     * @param spec description of the drone
+     * @return the ID of the type
+     */
+    int typeIdOf(const DroneSpec &spec) const;
+    /**
+     * @brief detachDrone removes a drone from the simulation, the pads and the map of drones
+     * @param drone the drone
+     */
+    void detachDrone(Drone *drone);
+    /**
+     * @brief fleetSlots
+     * @return the size of the tables indexed by the scheduler slots of the drones
+     */
+    int fleetSlots() const;
+    /**
+     * @brief reserveFleet makes room for the drones of all the scheduler slots in the pads and the
+     * charging list, so that a tick never allocates
+     */
+    void reserveFleet();
+    /**
+     * @brief setCharging adds or removes a drone in chargingDrones, in O(1)
+     * @param drone the drone, attached to the scheduler
+     * @param charging true if it landed at a charging stop
+     */
+    void setCharging(Drone *drone, bool charging);
+    /**
+     * @brief isCharging
+     * @param drone the drone
+     * @return true if the drone is in chargingDrones
+     */
+    bool isCharging(const Drone *drone) const;
+    /**
+     * @brief resetTraffic rebuilds the router, the planner and the landing pads for a new world:
+     * the landed drones get a pad and the holding drones ask again
+     */
+    void resetTraffic();
+    /**
+     * @brief resumeCharged restarts the drones fully charged at a stop toward their target
+     */
+    void resumeCharged();
+    /**
+     * @brief repairTraffic follows a runtime change of the servers: the router keeps the hops
+     * still connected, the plans are dropped and the drones whose hop was removed, or whose stop
+     * or target changed, are routed again
+     * @param changed servers changed (moved, offline, new, end of a connection)
+     * @param remap new index of each previous server, -1 if removed (see Scenario::mergeServers),
+     * empty if the servers kept their index
+     * @return the number of rerouted drones
+     */
+    int repairTraffic(const QVector<int> &changed, const QVector<int> &remap = QVector<int>());
+
+    QVector<Drone*> drones;//list of drones
+    QMap<QString,Drone*> *mapDrones=nullptr; //pointer on the map of the drones
+    DroneScheduler *scheduler=nullptr; ///< scheduler of the drones
+    Scenario world; ///< servers, connections, routing table and Voronoi raster of the running world
+    LandingControl landing; ///< landing pads and holding queues of the servers
+    FleetRouter router; ///< congestion aware next hops of the drones
+    MissionDispatcher dispatcher; ///< assignment of the mission batches
+    EnergyPlanner planner; ///< charging stops of the drones
+    QVector<Drone*> chargingDrones; ///< drones landed at a charging stop
+    QVector<int> chargingIndex; ///< index of the drone of each scheduler slot in chargingDrones, -1 if none
+    TraceReader replay; ///< trace shown instead of the drones
+    const QVector<TraceSample> *shardSamples=nullptr; ///< drones of the shards shown instead of the local ones
+    TrafficHeatmap heatmap; ///< decaying density of the moving drones
+    bool heatmapVisible=false;
+    /**
+     * @brief updateDroneTarget moves a drone toward the next server of its route to its next
+     * landing (the target server or a charging stop)
+     * @param drone the drone
+     * @param currentServer index of the server region containing the drone
+     */
+    void updateDroneTarget(Drone *drone, int currentServer);
+    QVector<Vector2D> dronePositions; ///< positions of the drones gathered for locate()
+    QVector<int> droneRegions;        ///< server region of each drone of the fleet
+    QImage droneImg; ///< picture representing the drone in the canvas
+
+    /**
+     * @brief euclideanDistance
+     * @param a
+     * @param b
+     * @return Distance between the points.
+     */
+    static double euclideanDistance(const Vector2D &a, const Vector2D &b);  // Static helper for distance
+    /**
+     * @brief selectedDrone Pointer to the currentselected drone.
+     */
+    Drone* selectedDrone = nullptr;
+    /**
+     * @brief activeDrone pointer to the curren active drone.
+     */
+    Drone* activeDrone = nullptr;  // Track the currently selected drone
+
+
+
+
+
+};
+
+#endif // CANVAS_H
@@ -0,0 +1,319 @@
+#include "collisionavoidance.h"
+#include "drone.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+const float epsilon = 1e-5f;
+}
+
+/**
+ * @brief CollisionAvoidance::prepare gathers the drones in the air (the active ones first),
+ * then the ghosts, and indexes their positions in the grid.
+ * @param drones all the drones
+ * @param active the drones to steer
+ * @param collisionRadius collision distance
+ */
+void CollisionAvoidance::prepare(const QMap<QString,Drone*> &drones, const QVector<Drone*> &active, float collisionRadius) {
+    radius = collisionRadius;
+    nActive = active.size();
+    airborne.clear();
+    positions.clear();
+    velocities.clear();
+    for (Drone *drone : active) {
+        airborne.append(drone);
+    }
+    // drones taking off or landing do not move but must be avoided
+    for (Drone *drone : drones) {
+        Drone::droneStatus status = drone->getStatus();
+        if (status == Drone::takeoff || status == Drone::landing) {
+            airborne.append(drone);
+        }
+    }
+    fastestSpeed = 0;
+    for (Drone *drone : airborne) {
+        positions.append(drone->getPosition());
+        velocities.append(drone->getVelocity());
+        fastestSpeed = std::max(fastestSpeed, float(drone->type().maxSpeed));
+    }
+    nAirborne = airborne.size();
+    if (!ghostPositions.isEmpty()) {
+        positions.append(ghostPositions);
+        velocities.append(ghostVelocities);
+        fastestSpeed = std::max(fastestSpeed, ghostSpeed);
+    }
+    newVelocities.resize(nActive);
+    neighborLists.resize(nActive * maxNeighbors);
+    neighborCounts.resize(nActive);
+    grid.build(positions, radius);
+}
+
+/**
+ * @brief CollisionAvoidance::advance only the drones due in the previous substep moved: their
+ * position and velocity are copied and they change cell in the grid if needed, a drone that
+ * landed leaves the grid. The others, the drones taking off or landing and the ghosts do not
+ * change during the tick.
+ * @param substep index of the next substep
+ * @param substepsPerTick number of substeps of the tick
+ */
+void CollisionAvoidance::advance(int substep, int substepsPerTick) {
+    for (int i = 0; i < nActive; i++) {
+        Drone *drone = airborne[i];
+        if (!drone->isDueAt(substep - 1, substepsPerTick)) {
+            continue;
+        }
+        if (drone->getStatus() < Drone::hovering) {
+            grid.remove(i);
+            continue;
+        }
+        positions[i] = drone->getPosition();
+        velocities[i] = drone->getVelocity();
+        grid.move(i);
+    }
+}
+
+void CollisionAvoidance::setGhosts(const QVector<Vector2D> &ghostAt, const QVector<Vector2D> &ghostVelocity, float maxSpeed) {
+    ghostPositions = ghostAt;
+    ghostVelocities = ghostVelocity;
+    ghostSpeed = maxSpeed;
+}
+
+float CollisionAvoidance::nearestDistance(int index, float maxDistance) const {
+    int neighbor;
+    float distanceSquared;
+    if (grid.kNearest(index, maxDistance, 1, &neighbor, &distanceSquared) == 0) {
+        return maxDistance;
+    }
+    return std::sqrt(distanceSquared);
+}
+
+/**
+ * @brief CollisionAvoidance::computeVelocities solves one ORCA linear program per active drone
+ * due in this substep, with its maxNeighbors nearest neighbours. All the velocities are
+ * computed from the previous ones before any drone is changed, so the result does not depend
+ * on the order of the drones.
+ * A drone that is not due is in the middle of a longer step and has already moved to its end:
+ * the drones are first brought back to the start of the substep along their velocity, and the
+ * constraints and the collision sweeps use this snapshot, with the new velocity of the drones
+ * due now and the velocity of the current step of the others.
+ * @param dt duration of the tick
+ * @param substep index of the substep
+ * @param substepsPerTick number of substeps of the tick
+ */
+void CollisionAvoidance::computeVelocities(double dt, int substep, int substepsPerTick) {
+    if (nActive == 0) {
+        return;
+    }
+    const double substepTime = dt / substepsPerTick;
+    snapshot.resize(positions.size()); // element copy: keeps the buffer, no sharing
+    std::copy(positions.cbegin(), positions.cend(), snapshot.begin());
+    for (int i = 0; i < nActive; i++) {
+        const int stride = substepsPerTick / airborne[i]->getSubsteps();
+        const int ahead = (stride - substep % stride) % stride; // substeps to the end of its step
+        snapshot[i] = snapshot[i] - velocities[i] * float(ahead * substepTime);
+    }
+    float distancesSquared[maxNeighbors];
+    Line lines[maxNeighbors];
+    for (int i = 0; i < nActive; i++) {
+        Drone *drone = airborne[i];
+        if (!drone->isDueAt(substep, substepsPerTick) || drone->getStatus() < Drone::hovering) {
+            continue;
+        }
+        const double step = dt / drone->getSubsteps();
+        const float maxSpeed = float(drone->type().maxSpeed);
+        // a drone farther than this cannot be reached during timeHorizon
+        const float neighborDistance = radius + float(timeHorizon) * (maxSpeed + fastestSpeed);
+        int *neighbors = neighborLists.data() + i * maxNeighbors;
+        int count = grid.kNearest(i, neighborDistance, maxNeighbors, neighbors, distancesSquared);
+        neighborCounts[i] = count;
+        for (int n = 0; n < count; n++) {
+            int j = neighbors[n];
+            // an active neighbour or a ghost (active in its shard) takes half of the avoidance,
+            // the others do not react
+            lines[n] = orcaLine(snapshot[j] - snapshot[i], velocities[i] - velocities[j],
+                                velocities[i], radius, step, j < nActive || j >= nAirborne ? 0.5f : 1.0f);
+        }
+        Vector2D preferred = drone->preferredVelocity();
+        Vector2D result;
+        int lineFail = linearProgram2(lines, count, maxSpeed, preferred, false, result);
+        if (lineFail < count) {
+            // infeasible: the velocity that least violates the constraints
+            linearProgram3(lines, count, lineFail, maxSpeed, result);
+        }
+        newVelocities[i] = result;
+    }
+    for (int i = 0; i < nActive; i++) {
+        if (airborne[i]->isDueAt(substep, substepsPerTick) && airborne[i]->getStatus() >= Drone::hovering) {
+            airborne[i]->setVelocity(newVelocities[i]);
+        }
+    }
+    // collisions swept over the step, every drone moving linearly from the snapshot
+    for (int i = 0; i < nActive; i++) {
+        Drone *drone = airborne[i];
+        if (!drone->isDueAt(substep, substepsPerTick) || drone->getStatus() < Drone::hovering) {
+            continue;
+        }
+        const double step = dt / drone->getSubsteps();
+        const int *neighbors = neighborLists.constData() + i * maxNeighbors;
+        drone->initCollision();
+        for (int n = 0; n < neighborCounts[i]; n++) {
+            const int j = neighbors[n];
+            const bool moving = j < nActive && airborne[j]->isDueAt(substep, substepsPerTick);
+            drone->addCollision(snapshot[j], moving ? newVelocities[j] : velocities[j], radius, step);
+        }
+    }
+}
+
+/**
+ * @brief CollisionAvoidance::orcaLine builds the ORCA half-plane of a neighbour: u is the
+ * smallest change of the relative velocity that leaves the velocity obstacle (a cone truncated
+ * at timeHorizon), the drone takes share of it.
+ */
+CollisionAvoidance::Line CollisionAvoidance::orcaLine(const Vector2D &relativePosition, const Vector2D &relativeVelocity, const Vector2D &velocity, float radius, double dt, float share) const {
+    const float invTimeHorizon = float(1.0 / timeHorizon);
+    const float distSq = relativePosition.lengthSquared();
+    const float radiusSq = radius * radius;
+    Line line;
+    Vector2D u;
+    if (distSq > radiusSq) {
+        // no collision yet: vector from the cutoff center to the relative velocity
+        Vector2D w = relativeVelocity - invTimeHorizon * relativePosition;
+        const float wLengthSq = w.lengthSquared();
+        const float dotProduct = w * relativePosition;
+        if (dotProduct < 0 && dotProduct * dotProduct > radiusSq * wLengthSq) {
+            // project on the cutoff circle
+            const float wLength = std::sqrt(wLengthSq);
+            Vector2D unitW = w / wLength;
+            line.direction.set(unitW.y, -unitW.x);
+            u = (radius * invTimeHorizon - wLength) * unitW;
+        } else {
+            // project on the legs of the cone
+            const float leg = std::sqrt(distSq - radiusSq);
+            if ((relativePosition ^ w) > 0) {
+                line.direction = Vector2D(relativePosition.x * leg - relativePosition.y * radius,
+                                          relativePosition.x * radius + relativePosition.y * leg) / distSq;
+            } else {
+                line.direction = -Vector2D(relativePosition.x * leg + relativePosition.y * radius,
+                                           -relativePosition.x * radius + relativePosition.y * leg) / distSq;
+            }
+            u = (relativeVelocity * line.direction) * line.direction - relativeVelocity;
+        }
+    } else {
+        // already colliding: separate during the step
+        const float invTimeStep = float(1.0 / dt);
+        Vector2D w = relativeVelocity - invTimeStep * relativePosition;
+        const float wLength = w.length();
+        Vector2D unitW = wLength > 0 ? w / wLength : Vector2D(0, 1);
+        line.direction.set(unitW.y, -unitW.x);
+        u = (radius * invTimeStep - wLength) * unitW;
+    }
+    line.point = velocity + share * u;
+    return line;
+}
+
+/**
+ * @brief CollisionAvoidance::linearProgram1 optimizes on the line lineNo, inside the speed
+ * circle and the half-planes of the previous lines
+ * @return false if the problem is infeasible
+ */
+bool CollisionAvoidance::linearProgram1(const Line *lines, int lineNo, float radius, const Vector2D &optVelocity, bool directionOpt, Vector2D &result) {
+    const Line &line = lines[lineNo];
+    const float dotProduct = line.point * line.direction;
+    const float discriminant = dotProduct * dotProduct + radius * radius - line.point.lengthSquared();
+    if (discriminant < 0) {
+        // the speed circle does not reach the line
+        return false;
+    }
+    const float sqrtDiscriminant = std::sqrt(discriminant);
+    float tLeft = -dotProduct - sqrtDiscriminant;
+    float tRight = -dotProduct + sqrtDiscriminant;
+    for (int i = 0; i < lineNo; i++) {
+        const float denominator = line.direction ^ lines[i].direction;
+        const float numerator = lines[i].direction ^ (line.point - lines[i].point);
+        if (std::fabs(denominator) <= epsilon) {
+            // parallel lines
+            if (numerator < 0) {
+                return false;
+            }
+            continue;
+        }
+        const float t = numerator / denominator;
+        if (denominator >= 0) {
+            tRight = std::min(tRight, t);
+        } else {
+            tLeft = std::max(tLeft, t);
+        }
+        if (tLeft > tRight) {
+            return false;
+        }
+    }
+    if (directionOpt) {
+        result = line.point + ((optVelocity * line.direction > 0) ? tRight : tLeft) * line.direction;
+    } else {
+        const float t = std::clamp(line.direction * (optVelocity - line.point), tLeft, tRight);
+        result = line.point + t * line.direction;
+    }
+    return true;
+}
+
+/**
+ * @brief CollisionAvoidance::linearProgram2 the velocity closest to optVelocity (or the furthest
+ * in its direction if directionOpt) in the speed circle and all the half-planes
+ * @return count on success, else the index of the line where it failed
+ */
+int CollisionAvoidance::linearProgram2(const Line *lines, int count, float radius, const Vector2D &optVelocity, bool directionOpt, Vector2D &result) {
+    if (directionOpt) {
+        result = optVelocity * radius;
+    } else if (optVelocity.lengthSquared() > radius * radius) {
+        result = optVelocity * (radius / optVelocity.length());
+    } else {
+        result = optVelocity;
+    }
+    for (int i = 0; i < count; i++) {
+        if ((lines[i].direction ^ (lines[i].point - result)) > 0) {
+            // result violates the constraint i
+            Vector2D previous = result;
+            if (!linearProgram1(lines, i, radius, optVelocity, directionOpt, result)) {
+                result = previous;
+                return i;
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief CollisionAvoidance::linearProgram3 when the half-planes have no common velocity,
+ * minimizes the maximum penetration in the violated half-planes
+ */
+void CollisionAvoidance::linearProgram3(const Line *lines, int count, int beginLine, float radius, Vector2D &result) {
+    Line projLines[maxNeighbors];
+    float distance = 0;
+    for (int i = beginLine; i < count; i++) {
+        if ((lines[i].direction ^ (lines[i].point - result)) > distance) {
+            int projCount = 0;
+            for (int j = 0; j < i; j++) {
+                Line line;
+                const float determinant = lines[i].direction ^ lines[j].direction;
+                if (std::fabs(determinant) <= epsilon) {
+                    if (lines[i].direction * lines[j].direction > 0) {
+                        // same direction
+                        continue;
+                    }
+                    line.point = 0.5f * (lines[i].point + lines[j].point);
+                } else {
+                    line.point = lines[i].point + ((lines[j].direction ^ (lines[i].point - lines[j].point)) / determinant) * lines[i].direction;
+                }
+                line.direction = lines[j].direction - lines[i].direction;
+                line.direction.normalize();
+                projLines[projCount++] = line;
+            }
+            Vector2D previous = result;
+            if (linearProgram2(projLines, projCount, radius, Vector2D(-lines[i].direction.y, lines[i].direction.x), true, result) < projCount) {
+                // can only fail by rounding errors, keep the previous result
+                result = previous;
+            }
+            distance = lines[i].direction ^ (lines[i].point - result);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef COLLISIONAVOIDANCE_H
+#define COLLISIONAVOIDANCE_H
+
+#include <QVector>
+#include <QMap>
+#include <QString>
+#include "vector2d.h"
+#include "spatialgrid.h"
+
+class Drone;
+
+/**
+ * @brief CollisionAvoidance computes collision free velocities for the flying drones with
+ * optimal reciprocal collision avoidance (ORCA): each neighbour forbids a half-plane of
+ * velocities and the velocity closest to the preferred one is found by a small 2D linear
+ * program. Only the maxNeighbors nearest drones (found in a SpatialGrid) are considered,
+ * so the cost per drone is bounded whatever the density of the swarm.
+ */
+class CollisionAvoidance {
+public:
+    static constexpr int maxNeighbors = 8; ///< number of neighbours considered by a drone
+    double timeHorizon = 2.0;              ///< anticipation time of the collisions (s)
+
+    /**
+     * @brief prepare gathers the drones in the air and indexes them, to call at the start of a
+     * tick before computeVelocities() and nearestDistance()
+     * @param drones: all the drones, the ones in the air are obstacles
+     * @param active: the drones to steer (hovering or flying)
+     * @param radius: distance between two drones under which they collide
+     */
+    void prepare(const QMap<QString,Drone*> &drones, const QVector<Drone*> &active, float radius);
+    /**
+     * @brief advance updates the drones stepped in the previous substep, to call before
+     * computeVelocities() for the next substeps of the tick
+     * @param substep: index of the next substep (> 0)
+     * @param substepsPerTick: number of substeps of the tick
+     */
+    void advance(int substep, int substepsPerTick);
+    /**
+     * @brief setGhosts gives the drones simulated by another process near the border of this one
+     * (see ShardHub): they are avoided like the drones taking off or landing, kept until the next call
+     * @param positions: position of the ghosts
+     * @param velocities: velocity of the ghosts
+     * @param maxSpeed: max speed of the fastest ghost
+     */
+    void setGhosts(const QVector<Vector2D> &positions, const QVector<Vector2D> &velocities, float maxSpeed);
+    /**
+     * @brief nearestDistance distance between an active drone and its nearest neighbour
+     * @param index: index of the drone in the active list given to prepare()
+     * @param maxDistance: search distance
+     * @return the distance, maxDistance if there is no closer drone
+     */
+    float nearestDistance(int index, float maxDistance) const;
+    /**
+     * @brief computeVelocities sets the velocity of the active drones that are stepped in this
+     * substep and marks their collisions (swept over their step). A drone landed since
+     * prepare() is skipped.
+     * @param dt: duration of the tick, a drone steps dt/drone->getSubsteps()
+     * @param substep: index of the substep in the tick
+     * @param substepsPerTick: number of substeps of the tick
+     */
+    void computeVelocities(double dt, int substep = 0, int substepsPerTick = 1);
+
+    /**
+     * @brief A half-plane of permitted velocities: the left side of the directed line
+     */
+    struct Line {
+        Vector2D point;     ///< a point of the line
+        Vector2D direction; ///< unit direction of the line
+    };
+
+private:
+    /**
+     * @brief orcaLine the half-plane of velocities that avoid a neighbour during timeHorizon
+     * @param relativePosition: position of the neighbour relative to the drone
+     * @param relativeVelocity: velocity of the drone relative to the neighbour
+     * @param velocity: current velocity of the drone
+     * @param radius: collision distance
+     * @param dt: duration of the step (used if the drones already collide)
+     * @param share: part of the avoidance taken by the drone (1/2 if the neighbour avoids too)
+     */
+    Line orcaLine(const Vector2D &relativePosition, const Vector2D &relativeVelocity, const Vector2D &velocity, float radius, double dt, float share) const;
+    static bool linearProgram1(const Line *lines, int lineNo, float radius, const Vector2D &optVelocity, bool directionOpt, Vector2D &result);
+    static int linearProgram2(const Line *lines, int count, float radius, const Vector2D &optVelocity, bool directionOpt, Vector2D &result);
+    static void linearProgram3(const Line *lines, int count, int beginLine, float radius, Vector2D &result);
+
+    SpatialGrid grid;               ///< neighbour search
+    float radius = 0;               ///< collision distance
+    int nActive = 0;                ///< number of active drones at the beginning of airborne
+    int nAirborne = 0;              ///< number of local drones, the ghosts follow in positions
+    float fastestSpeed = 0;         ///< max speed of the fastest drone in the air
+    QVector<Drone*> airborne;       ///< active drones first, then the ones taking off or landing
+    QVector<Vector2D> positions;    ///< position of the airborne drones
+    QVector<Vector2D> velocities;   ///< velocity of the airborne drones at the previous step
+    QVector<Vector2D> newVelocities; ///< velocity computed for the active drones
+    QVector<Vector2D> snapshot;     ///< positions at the start of the substep (see computeVelocities)
+    QVector<int> neighborLists;     ///< maxNeighbors neighbours per active drone due in the substep
+    QVector<int> neighborCounts;    ///< number of neighbours of each active drone
+    QVector<Vector2D> ghostPositions;  ///< drones of the other shards near the border
+    QVector<Vector2D> ghostVelocities;
+    float ghostSpeed = 0;           ///< max speed of the fastest ghost
+};
+
+#endif // COLLISIONAVOIDANCE_H
@@ -0,0 +1,285 @@
+#include "commandserver.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QStringDecoder>
+#include <QTimer>
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+/// the verb, the drone and the servers of the longest tour
+const int maxWords = DroneCommand::maxNames + 1;
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * @brief split cuts a line at the spaces, without copy
+ * @param line the line
+ * @param words receives views on the words
+ * @return the number of words, -1 if there are more than maxWords
+ */
+int split(QByteArrayView line, QByteArrayView (&words)[maxWords]) {
+    int count = 0;
+    qsizetype i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && isSpace(line[i])) {
+            i++;
+        }
+        const qsizetype begin = i;
+        while (i < line.size() && !isSpace(line[i])) {
+            i++;
+        }
+        if (i == begin) {
+            break;
+        }
+        if (count == maxWords) {
+            return -1;
+        }
+        words[count++] = line.sliced(begin, i - begin);
+    }
+    return count;
+}
+}
+
+bool DroneCommand::addName(QStringView name) {
+    const int begin = nameCount > 0 ? nameEnd[nameCount - 1] : 0;
+    if (nameCount == maxNames || name.size() > textLength - begin) {
+        return false;
+    }
+    std::copy(name.begin(), name.end(), text + begin);
+    nameEnd[nameCount++] = quint8(begin + name.size());
+    return true;
+}
+
+/**
+ * @brief DroneCommand::addUtf8 a UTF-8 byte gives at most one UTF-16 unit, so the room is known
+ * before decoding.
+ * @param name the name in UTF-8
+ * @return false if there is no room left
+ */
+bool DroneCommand::addUtf8(QByteArrayView name) {
+    const int begin = nameCount > 0 ? nameEnd[nameCount - 1] : 0;
+    if (nameCount == maxNames || name.size() > textLength - begin) {
+        return false;
+    }
+    QStringDecoder decoder(QStringDecoder::Utf8);
+    const QChar *end = decoder.appendToBuffer(text + begin, name);
+    nameEnd[nameCount++] = quint8(end - text);
+    return true;
+}
+
+/**
+ * @brief DroneCommand::parse the names cannot contain spaces, the numbers use a dot. The line is
+ * cut and decoded in place: a command line never allocates.
+ * @param line the text of the command
+ * @return true if the command is complete and its names fit in the command
+ */
+bool DroneCommand::parse(QByteArrayView line) {
+    QByteArrayView words[maxWords];
+    const int count = split(line, words);
+    if (count < 2) {
+        return false;
+    }
+    const QByteArrayView verb = words[0];
+    nameCount = 0;
+    bool ok = addUtf8(words[1]);
+    if (verb == "goto" && count == 3) {
+        kind = retarget;
+        ok = ok && addUtf8(words[2]);
+    } else if (verb == "start" && count == 2) {
+        kind = start;
+    } else if (verb == "stop" && count == 2) {
+        kind = stop;
+    } else if (verb == "speed" && count == 3) {
+        kind = speed;
+        bool okValue;
+        value = words[2].toDouble(&okValue);
+        ok = ok && okValue;
+    } else if (verb == "add" && (count == 5 || count == 6)) {
+        kind = add;
+        bool okX, okY;
+        position = Vector2D(words[2].toDouble(&okX), words[3].toDouble(&okY));
+        ok = ok && okX && okY && addUtf8(words[4]) && (count == 5 || addUtf8(words[5]));
+    } else if (verb == "remove" && count == 2) {
+        kind = remove;
+    } else if (verb == "tour" && count >= 3) {
+        kind = tour;
+        for (int i = 2; i < count; i++) {
+            ok = ok && addUtf8(words[i]);
+        }
+    } else {
+        return false;
+    }
+    return ok;
+}
+
+CommandServer::CommandServer()
+    : queue(queueLog2) {
+    receiver = new CommandReceiver(*this);
+    receiver->moveToThread(&thread);
+    QObject::connect(&thread, &QThread::finished, receiver, &QObject::deleteLater);
+}
+
+CommandServer::~CommandServer() {
+    if (!thread.isRunning()) {
+        delete receiver;
+        return;
+    }
+    thread.quit();
+    thread.wait(); // the receiver is deleted at the end of the thread
+}
+
+void CommandServer::listen(const QString &name) {
+    if (!thread.isRunning()) {
+        thread.start();
+    }
+    QMetaObject::invokeMethod(receiver, "listen", Qt::QueuedConnection, Q_ARG(QString, name));
+}
+
+qint64 CommandServer::clock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CommandServer::submit(DroneCommand &&command) {
+    if (command.received == 0) {
+        command.received = clock();
+    }
+    return queue.push(std::move(command));
+}
+
+int CommandServer::take(QVector<DroneCommand> &batch) {
+    batch.resize(0); // keeps the capacity
+    DroneCommand command;
+    while (queue.pop(command)) {
+        batch.append(std::move(command));
+    }
+    return batch.size();
+}
+
+/**
+ * @brief CommandServer::applied the latency of a command is the time from its reception by the
+ * receiver to its application at a tick boundary; the counters are kept per second of wall time.
+ * @param batch the commands
+ * @param done number of commands that had an effect
+ */
+void CommandServer::applied(const QVector<DroneCommand> &batch, int done) {
+    const qint64 now = clock();
+    if (now - windowStart >= 1000000000) {
+        current.meanLatency = current.applied + current.rejected > 0 ? latencySum / (current.applied + current.rejected) : 0;
+        lastStats = current;
+        current = Stats();
+        latencySum = 0;
+        windowStart = now;
+    }
+    for (const DroneCommand &command : batch) {
+        double latency = (now - command.received) / 1.0e6;
+        latencySum += latency;
+        current.maxLatency = std::max(current.maxLatency, latency);
+    }
+    current.applied += done;
+    current.rejected += batch.size() - done;
+}
+
+CommandReceiver::CommandReceiver(CommandServer &server)
+    : commands(server) {
+}
+
+void CommandReceiver::listen(const QString &name) {
+    if (!server) {
+        server = new QLocalServer(this);
+        connect(server, &QLocalServer::newConnection, this, &CommandReceiver::accept);
+        retryTimer = new QTimer(this);
+        retryTimer->setInterval(retryInterval);
+        connect(retryTimer, &QTimer::timeout, this, &CommandReceiver::retry);
+    }
+    server->close();
+    QLocalServer::removeServer(name); // left by a crashed run
+    if (server->listen(name)) {
+        qDebug() << "Commands on" << server->fullServerName();
+    } else {
+        qDebug() << "Commands cannot listen on" << name << ":" << server->errorString();
+    }
+}
+
+void CommandReceiver::accept() {
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        Client *client = new Client;
+        client->socket = socket;
+        socket->setReadBufferSize(readBufferSize); // the rest waits in the kernel buffers
+        clients.append(client);
+        connect(socket, &QLocalSocket::readyRead, this, [this, client]() {
+            if (!readCommands(*client) && !retryTimer->isActive()) {
+                retryTimer->start();
+            }
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, client]() {
+            clients.removeOne(client);
+            client->socket->deleteLater();
+            delete client;
+        });
+    }
+}
+
+/**
+ * @brief CommandReceiver::readCommands the lines left in the socket when the queue is full stay
+ * in the socket buffers, so the client blocks (or gets EAGAIN) until the simulation catches up.
+ * The lines are read in a fixed buffer and parsed in place; a line longer than the buffer is
+ * skipped up to its end.
+ * @param client the client
+ * @return false if a command is waiting for room in the queue
+ */
+bool CommandReceiver::readCommands(Client &client) {
+    if (client.hasPending) {
+        if (!commands.submit(std::move(client.pending))) {
+            return false;
+        }
+        client.hasPending = false;
+    }
+    while (client.socket->canReadLine()) {
+        qint64 length = client.socket->readLine(line, lineLength);
+        if (length <= 0) {
+            break;
+        }
+        if (line[length - 1] != '\n') {
+            while (length > 0 && line[length - 1] != '\n') {
+                length = client.socket->readLine(line, lineLength);
+            }
+            qDebug() << "Commands: line longer than" << lineLength << "bytes";
+            continue;
+        }
+        const QByteArrayView text(line, length);
+        DroneCommand command;
+        if (text.trimmed().isEmpty()) {
+            continue;
+        }
+        if (!command.parse(text)) {
+            qDebug() << "Commands: invalid line" << text.trimmed().toByteArray();
+            continue;
+        }
+        command.received = CommandServer::clock();
+        if (!commands.submit(std::move(command))) {
+            client.pending = std::move(command);
+            client.hasPending = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief CommandReceiver::retry reads again the clients that were stopped by a full queue
+ */
+void CommandReceiver::retry() {
+    bool waiting = false;
+    for (Client *client : clients) {
+        if (client->hasPending || client->socket->canReadLine()) {
+            waiting |= !readCommands(*client);
+        }
+    }
+    if (!waiting) {
+        retryTimer->stop();
+    }
+}
@@ -0,0 +1,216 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef COMMANDSERVER_H
+#define COMMANDSERVER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QStringView>
+#include <QByteArrayView>
+#include <QVector>
+#include "vector2d.h"
+#include "mpscqueue.h"
+#include <type_traits>
+
+class QLocalServer;
+class QLocalSocket;
+class QTimer;
+
+/**
+ * @brief A command received for a drone, applied at the next tick (see Canvas::applyCommands).
+ * A command is plain data: the names are stored in place, so a command is parsed, queued and
+ * applied without any heap allocation. They are read with name() or, for the lookups in the
+ * QString keyed maps, with key().
+ * On the local socket a command is a text line, a client writes as many lines as it wants:
+ * - "goto drone server": new target server (a flying drone turns at once)
+ * - "start drone": takes off toward its target server
+ * - "stop drone": lands where it is
+ * - "speed drone value": speed setpoint (limited by the type)
+ * - "add drone x y server [type]": new landed drone
+ * - "remove drone"
+ * - "tour drone server...": mission visiting the servers, charging and waiting between two legs
+ *   (see Missions::tour)
+ */
+struct DroneCommand {
+    enum Kind : quint8 { retarget, start, stop, speed, add, remove, tour };
+    static constexpr int maxNames = 16;    ///< the drone and up to 15 servers of a tour
+    static constexpr int textLength = 120; ///< UTF-16 units for all the names
+
+    Kind kind = start;
+    quint8 nameCount = 0;          ///< names stored in text
+    quint8 nameEnd[maxNames] = {}; ///< end of each name in text
+    /// the names one after the other: the drone, then the target server (retarget, add) and the
+    /// type (add, optional), or the servers to visit (tour)
+    QChar text[textLength];
+    Vector2D position;   ///< initial position (add)
+    double value = 0;    ///< speed setpoint (speed)
+    qint64 received = 0; ///< time of reception (CommandServer::clock)
+
+    /**
+     * @brief name
+     * @param i: index of the name, in [0, nameCount)
+     * @return a view on the name in the command
+     */
+    inline QStringView name(int i) const {
+        const int begin = i > 0 ? nameEnd[i - 1] : 0;
+        return QStringView(text + begin, nameEnd[i] - begin);
+    }
+    /**
+     * @brief key a QString on the name in the command, without copy: only for lookups, it must
+     * not be stored nor outlive the command
+     * @param i: index of the name
+     */
+    inline QString key(int i) const {
+        const QStringView view = name(i);
+        return QString::fromRawData(view.data(), view.size());
+    }
+    /**
+     * @brief type
+     * @return the type of the drone (add), empty for the standard type
+     */
+    inline QStringView type() const {
+        return kind == add && nameCount == 3 ? name(2) : QStringView();
+    }
+    /**
+     * @brief addName appends a name
+     * @param name: the name
+     * @return false if there is no room left
+     */
+    bool addName(QStringView name);
+    /**
+     * @brief parse reads a command line
+     * @param line: the text of the command
+     * @return false if the line is not a valid command
+     */
+    bool parse(QByteArrayView line);
+
+private:
+    /**
+     * @brief addUtf8 appends a name read from the socket
+     * @param name: the name in UTF-8
+     * @return false if there is no room left
+     */
+    bool addUtf8(QByteArrayView name);
+};
+static_assert(std::is_trivially_copyable<DroneCommand>::value, "commands are queued as plain data");
+
+class CommandReceiver;
+
+/**
+ * @brief CommandServer receives the commands of the clients of a QLocalServer in a thread and
+ * queues them for the simulation, which applies them between two ticks. Any thread can submit
+ * commands too. When the queue is full the receiver stops reading the sockets, so the clients
+ * are slowed down instead of losing commands.
+ */
+class CommandServer {
+public:
+    static constexpr int queueLog2 = 16; ///< room for 2^16 commands between two ticks
+
+    /**
+     * @brief Commands applied during the last complete second
+     */
+    struct Stats {
+        int applied = 0;
+        int rejected = 0;         ///< unknown drone or server, invalid line
+        double meanLatency = 0;   ///< ms from reception to application
+        double maxLatency = 0;    ///< ms
+    };
+
+    CommandServer();
+    /**
+     * @brief CommandServer destructor, stops the receiver thread
+     */
+    ~CommandServer();
+    /**
+     * @brief listen starts the receiver thread and the socket server
+     * @param name: name of the local socket
+     */
+    void listen(const QString &name);
+    /**
+     * @brief submit queues a command (any thread)
+     * @param command: the command, its reception time is set here if not set yet
+     * @return false if the queue is full
+     */
+    bool submit(DroneCommand &&command);
+    /**
+     * @brief take moves the queued commands to a batch (simulation thread)
+     * @param batch: receives the commands, cleared first
+     * @return the number of commands
+     */
+    int take(QVector<DroneCommand> &batch);
+    /**
+     * @brief applied counts the commands of a batch applied now (simulation thread)
+     * @param batch: the commands
+     * @param done: number of commands that had an effect
+     */
+    void applied(const QVector<DroneCommand> &batch, int done);
+    /**
+     * @brief stats
+     * @return the counters of the last complete second
+     */
+    inline const Stats &stats() const { return lastStats; }
+    /**
+     * @brief clock
+     * @return a monotonic time in ns
+     */
+    static qint64 clock();
+
+private:
+    MpscQueue<DroneCommand> queue;
+    QThread thread;
+    CommandReceiver *receiver = nullptr;
+    Stats current, lastStats;
+    double latencySum = 0;
+    qint64 windowStart = 0;
+};
+
+/**
+ * @brief CommandReceiver lives in the receiver thread: it accepts the clients and parses their
+ * lines into the queue.
+ */
+class CommandReceiver : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int retryInterval = 5; ///< ms before reading again when the queue is full
+    static constexpr qint64 readBufferSize = 1 << 20; ///< bytes read ahead from a client
+    static constexpr int lineLength = 512; ///< longest command line, longer ones are rejected
+
+    explicit CommandReceiver(CommandServer &server);
+
+public slots:
+    /**
+     * @brief listen creates the server in the receiver thread
+     * @param name: name of the local socket
+     */
+    void listen(const QString &name);
+
+private:
+    /**
+     * @brief A connected client, with the command that did not fit in the queue
+     */
+    struct Client {
+        QLocalSocket *socket;
+        DroneCommand pending;
+        bool hasPending = false;
+    };
+
+    void accept();
+    /**
+     * @brief readCommands queues the lines of a client until the queue is full
+     * @return false if the client waits for room in the queue
+     */
+    bool readCommands(Client &client);
+    void retry();
+
+    CommandServer &commands;
+    QLocalServer *server = nullptr;
+    QTimer *retryTimer = nullptr;
+    QVector<Client*> clients;
+    char line[lineLength];           ///< the line being parsed (reused)
+};
+
+#endif // COMMANDSERVER_H
@@ -1,320 +1,621 @@
-#include "drone.h"
-#include <QPainter>
-#include <QStyle>
-#include <QDebug>
-#include "canvas.h"
-
-Drone::Drone(const QString &n,QWidget *parent)
-    : QWidget{parent},name(n)
-
-{
-
-    status=landed;
-    speed=0;
-    power=maxPower/2.0;
-    V.set(0,0);
-    ForceCollision.set(0,0);
-    position=Vector2D(50,50);
-    goalPosition=Vector2D(550,600);
-    showCollision=false;
-    azimut=0;
-
-    speedPB=new QProgressBar(this);
-    speedPB->setValue(speed);
-    speedPB->setMaximum(maxSpeed);
-    speedPB->setMinimum(0);
-    speedPB->setFormat(name+" speed %p%");
-    speedPB->setAlignment(Qt::AlignCenter);
-    //speedPB->setStyleSheet("QProgressBar::chunk{background-color:red");
-
-    powerPB=new QProgressBar(this);
-    powerPB->setValue(power);
-    powerPB->setMaximum(maxPower);
-    powerPB->setMinimum(0);
-    powerPB->setFormat("power %p%");
-    powerPB->setAlignment(Qt::AlignCenter);
-    //powerPB->setStyleSheet("QProgressBar::chunk{background-color:yellow");
-
-    setBaseSize(barSpace+compasSize,2*compasSize);
-    setMinimumHeight(2*compasSize);
-    setSizePolicy(QSizePolicy::Expanding,QSizePolicy::Fixed);
-
-    compasImg.load("../../media/compas.png");
-    stopImg.load("../../media/stop.png");
-    takeoffImg.load("../../media/takeoff.png");
-    landingImg.load("../../media/landing.png");
-}
-
-Drone::~Drone() {
-    delete speedPB;
-    delete powerPB;
-}
-
-void Drone::paintEvent(QPaintEvent *) {
-    QPainter painter(this);
-    QBrush whiteBrush(Qt::SolidPattern);
-    whiteBrush.setColor(Qt::white);
-    QRect rect(0,0,compasSize,compasSize);
-
-     painter.translate(position.x, position.y);
-
-
-    switch (status) {
-        case landed: painter.drawImage(rect,stopImg); break;
-        case takeoff: painter.drawImage(rect,takeoffImg); break;
-        case landing: painter.drawImage(rect,landingImg); break;
-        default : {
-            painter.drawImage(rect,compasImg);
-            // draw the compass needle
-            QPointF *points = new QPointF[3];
-            points[0] = QPointF(-compasSize/5.0,0);
-            points[1] = QPointF(compasSize/5.0,0);
-            points[2] = QPointF(0,compasSize/2.2);
-            painter.save();
-            painter.translate(compasSize/2.0,compasSize/2.0);
-            painter.rotate(azimut);
-            painter.setBrush(Qt::white);
-            painter.setPen(Qt::black);
-            painter.drawPolygon(points,3);
-            painter.setBrush(Qt::red);
-            painter.rotate(180);
-            painter.drawPolygon(points,3);
-            painter.restore();
-
-
-        }
-            //update();
-    }
-}
-
-void Drone::resizeEvent(QResizeEvent *) {
-    QRect rect(compasSize+5,0,width()-compasSize-5,compasSize/2);
-    speedPB->setGeometry(rect);
-    rect.setRect(compasSize+5,compasSize/2,width()-compasSize-5,compasSize/2);
-    powerPB->setGeometry(rect);
-}
-/*drone update
-void Drone::update(double dt) {
-    if (status==landed) {
-        power+=dt*chargingSpeed;
-        if (power>maxPower) {
-            power=maxPower;
-        }
-        powerPB->setValue(power);
-        repaint();
-        return;
-    }
-
-    if (status==takeoff) {
-        height+=dt*takeoffSpeed;
-        if (height>=hoveringHeight) {
-            height=hoveringHeight;
-            status=hovering;
-        }
-        power-=dt*powerConsumption;
-        if (power<20+powerConsumption/takeoffSpeed) {
-            status=landing;
-            speed=0;
-        }
-        powerPB->setValue(power);
-        repaint();
-        return;
-    }
-
-    if (status==landing) {
-        height-=dt*takeoffSpeed;
-        if (height<=0) {
-            height=0;
-            status=landed;
-            showCollision=false;
-        }
-        power-=dt*powerConsumption;
-        powerPB->setValue(power);
-        repaint();
-        return;
-    }
-
-    if (status>=hovering) {
-        Vector2D toGoal=goalPosition-position;
-        double distance = toGoal.length();
-
-        double damp= 1-dt*(1-damping);
-        V = damp*V+((maxPower*dt/distance)*toGoal)+dt*ForceCollision;
-        position += dt*V;
-        speed=V.length();
-        Vector2D Vn = (1.0/speed)*V;
-        if (Vn.y==0) {
-            if (Vn.x>0) {
-                azimut = -90;
-            } else {
-                azimut = 90.0;
-            }
-        } else if (Vn.y>0) {
-            azimut = 180.0-180.0*atan(Vn.x/Vn.y)/M_PI;
-        } else {
-            azimut = -180.0*atan(Vn.x/Vn.y)/M_PI;
-        }
-        if (toGoal.length()<1.0 && speed<10) {
-            V.set(0,0);
-            speed=0;
-            status=landing;
-        }
-        speedPB->setValue(speed);
-        power-=dt*powerConsumption;
-        if (power<20+powerConsumption/takeoffSpeed) {
-            speed=0;
-            V.set(0,0);
-            status=landing;
-        }
-        powerPB->setValue(power);
-    }
-    repaint();
-}
-*/
-
-void Drone::update(double dt) {
-    if (status == landed) {
-        power += dt * chargingSpeed;
-        if (power > maxPower) {
-            power = maxPower;
-        }
-        powerPB->setValue(power);
-        return;
-    }
-
-    if (status == takeoff) {
-        height += dt * takeoffSpeed;
-        if (height >= hoveringHeight) {
-            height = hoveringHeight;
-            status = hovering;
-        }
-        power -= dt * powerConsumption;
-        if (power < 20 + powerConsumption / takeoffSpeed) {
-            status = landing;
-            speed = 0;
-        }
-        powerPB->setValue(power);
-        repaint();
-        return;
-    }
-
-    if (status == landing) {
-        height -= dt * takeoffSpeed;
-        if (height <= 0) {
-            height = 0;
-            status = landed;
-            showCollision = false;
-        }
-        power -= dt * powerConsumption;
-        powerPB->setValue(power);
-        repaint();
-        return;
-    }
-
-    if (status >= hovering) {
-        Vector2D toGoal = goalPosition - position;
-        double distance = toGoal.length();
-        //double hoverRadius = 70.0;
-        double landingRadius = 90.0;
-
-        if (distance > landingRadius) {
-            toGoal.normalize();
-            position += (toGoal * dt * maxSpeed);
-        } else {
-            // Find an available landing spot around the server
-            position = findLandingSpot(goalPosition, landingRadius);
-            status = landed;
-        }
-
-
-
-        // Update heading (azimuth) so the drone rotates correctly
-        if (toGoal.x == 0) {
-            azimut = (toGoal.y > 0) ? 180 : 0;
-        } else {
-            azimut = -atan2(toGoal.x, toGoal.y) * 180.0 / M_PI;
-        }
-
-        speed = (goalPosition - position).length();
-        speedPB->setValue(speed);
-        power -= dt * powerConsumption;
-
-        if (power < 20 + powerConsumption / takeoffSpeed) {
-            status = landing;
-        }
-    }
-
-    repaint();
-}
-
-
-void Drone::initCollision() {
-    ForceCollision.set(0,0);
-    showCollision=false;
-}
-
-
-void Drone::addCollision(const Vector2D& B,float threshold) {
-    Vector2D AB=B-position;
-    double l=AB.length();
-    if (l<threshold) {
-        ForceCollision+=(-coefCollision/threshold)*AB;
-        showCollision=true;
-    }
-}
-
-
-/**
- * @brief Drone::getTargetServerName returns the name of the server to which the drone is currently targeting..
- * @return The name of the target server
- */
-
-QString Drone::getTargetServerName() const {
-    return targetServerName;
-}
-
-/**
- * @brief Drone::setTargetServerName sets the name of the server to which the drone will move.
- * @param serverName The name of the target server to set.
- */
-void Drone::setTargetServerName(const QString &serverName) {
-    targetServerName = serverName;
-}
-
-/**
- * @brief Drone::findLandingSpot
- *  This function ensures that drones do not land on the same
- *  spot by checking previous use landing spots.
- * @param serverPos The position of the server.
- * @param radiusradius The radius in which the drone can land
- * @return land spot for the drone
- */
-Vector2D Drone::findLandingSpot(const Vector2D &serverPos, double radius) {
-    static std::vector<Vector2D> usedLandingSpots;  // Store occupied landing spots
-
-    for (int i = 0; i < 10; i++) {
-        double angle = (rand() % 360) * (M_PI / 180.0);
-        double r = (rand() % int(radius - 50)) + 50;  // Ensure spacing
-        Vector2D landingSpot = serverPos + Vector2D(r * cos(angle), r * sin(angle));
-
-        bool occupied = false;
-        for (const auto &spot : usedLandingSpots) {
-            if ((landingSpot - spot).length() < 40.0) {  // Keep 40px spacing
-                occupied = true;
-                break;
-            }
-        }
-
-        if (!occupied) {
-            usedLandingSpots.push_back(landingSpot);
-            return landingSpot;
-        }
-    }
-
-    return serverPos;  // Default to center if no space found
-}
-
-
-
-
-
+#include "drone.h"
+#include <QPainter>
+#include <QStyle>
+#include <QDebug>
+#include "canvas.h"
+#include "dronescheduler.h"
+#include <limits>
+#include <algorithm>
+
+Drone::Drone(const QString &n,QWidget *parent)
+    : QWidget{parent},name(n)
+
+{
+
+    status=landed;
+    speed=0;
+    power=type().maxPower/2.0;
+    height=0;
+    phaseStart=0;
+    V.set(0,0);
+    position=Vector2D(50,50);
+    goalPosition=Vector2D(550,600);
+    showCollision=false;
+    azimut=0;
+
+    speedPB=new QProgressBar(this);
+    speedPB->setValue(speed);
+    speedPB->setMaximum(type().maxSpeed);
+    speedPB->setMinimum(0);
+    speedPB->setFormat(name+" speed %p%");
+    speedPB->setAlignment(Qt::AlignCenter);
+    //speedPB->setStyleSheet("QProgressBar::chunk{background-color:red");
+
+    powerPB=new QProgressBar(this);
+    powerPB->setValue(power);
+    powerPB->setMaximum(type().maxPower);
+    powerPB->setMinimum(0);
+    powerPB->setFormat("power %p%");
+    powerPB->setAlignment(Qt::AlignCenter);
+    //powerPB->setStyleSheet("QProgressBar::chunk{background-color:yellow");
+
+    setBaseSize(barSpace+compasSize,2*compasSize);
+    setMinimumHeight(2*compasSize);
+    setSizePolicy(QSizePolicy::Expanding,QSizePolicy::Fixed);
+
+    compasImg.load("../../media/compas.png");
+    stopImg.load("../../media/stop.png");
+    takeoffImg.load("../../media/takeoff.png");
+    landingImg.load("../../media/landing.png");
+}
+
+Drone::~Drone() {
+    setScheduler(nullptr);
+    delete speedPB;
+    delete powerPB;
+}
+
+void Drone::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    QBrush whiteBrush(Qt::SolidPattern);
+    whiteBrush.setColor(Qt::white);
+    QRect rect(0,0,compasSize,compasSize);
+
+     painter.translate(position.x, position.y);
+
+
+    switch (status) {
+        case landed: painter.drawImage(rect,stopImg); break;
+        case takeoff: painter.drawImage(rect,takeoffImg); break;
+        case landing: painter.drawImage(rect,landingImg); break;
+        default : {
+            painter.drawImage(rect,compasImg);
+            // draw the compass needle
+            const QPointF points[3] = { QPointF(-compasSize/5.0,0),
+                                        QPointF(compasSize/5.0,0),
+                                        QPointF(0,compasSize/2.2) };
+            painter.save();
+            painter.translate(compasSize/2.0,compasSize/2.0);
+            painter.rotate(azimut);
+            painter.setBrush(Qt::white);
+            painter.setPen(Qt::black);
+            painter.drawPolygon(points,3);
+            painter.setBrush(Qt::red);
+            painter.rotate(180);
+            painter.drawPolygon(points,3);
+            painter.restore();
+
+
+        }
+            //update();
+    }
+}
+
+void Drone::resizeEvent(QResizeEvent *) {
+    QRect rect(compasSize+5,0,width()-compasSize-5,compasSize/2);
+    speedPB->setGeometry(rect);
+    rect.setRect(compasSize+5,compasSize/2,width()-compasSize-5,compasSize/2);
+    powerPB->setGeometry(rect);
+}
+/*drone update
+void Drone::update(double dt) {
+    if (status==landed) {
+        power+=dt*chargingSpeed;
+        if (power>maxPower) {
+            power=maxPower;
+        }
+        powerPB->setValue(power);
+        repaint();
+        return;
+    }
+
+    if (status==takeoff) {
+        height+=dt*takeoffSpeed;
+        if (height>=hoveringHeight) {
+            height=hoveringHeight;
+            status=hovering;
+        }
+        power-=dt*powerConsumption;
+        if (power<20+powerConsumption/takeoffSpeed) {
+            status=landing;
+            speed=0;
+        }
+        powerPB->setValue(power);
+        repaint();
+        return;
+    }
+
+    if (status==landing) {
+        height-=dt*takeoffSpeed;
+        if (height<=0) {
+            height=0;
+            status=landed;
+            showCollision=false;
+        }
+        power-=dt*powerConsumption;
+        powerPB->setValue(power);
+        repaint();
+        return;
+    }
+
+    if (status>=hovering) {
+        Vector2D toGoal=goalPosition-position;
+        double distance = toGoal.length();
+
+        double damp= 1-dt*(1-damping);
+        V = damp*V+((maxPower*dt/distance)*toGoal)+dt*ForceCollision;
+        position += dt*V;
+        speed=V.length();
+        Vector2D Vn = (1.0/speed)*V;
+        if (Vn.y==0) {
+            if (Vn.x>0) {
+                azimut = -90;
+            } else {
+                azimut = 90.0;
+            }
+        } else if (Vn.y>0) {
+            azimut = 180.0-180.0*atan(Vn.x/Vn.y)/M_PI;
+        } else {
+            azimut = -180.0*atan(Vn.x/Vn.y)/M_PI;
+        }
+        if (toGoal.length()<1.0 && speed<10) {
+            V.set(0,0);
+            speed=0;
+            status=landing;
+        }
+        speedPB->setValue(speed);
+        power-=dt*powerConsumption;
+        if (power<20+powerConsumption/takeoffSpeed) {
+            speed=0;
+            V.set(0,0);
+            status=landing;
+        }
+        powerPB->setValue(power);
+    }
+    repaint();
+}
+*/
+
+/**
+ * @brief Drone::setType the power and height of the current phase are settled with the previous
+ * type, then the next transition is scheduled with the new one. A type changed in place has
+ * already been settled by its owner (see Canvas::defineTypes): only its revision tells it.
+ * @param id ID of the type
+ */
+void Drone::setType(int id) {
+    if (id == typeId && DroneTypes::revision(id) == typeRevision) {
+        return;
+    }
+    settle();
+    typeId = id;
+    typeRevision = DroneTypes::revision(id);
+    speedPB->setMaximum(type().maxSpeed);
+    powerPB->setMaximum(type().maxPower);
+    if (scheduler) {
+        scheduleNextTransition();
+    }
+}
+
+/**
+ * @brief Drone::preferredVelocity straight to the goal at full speed
+ * @return the preferred velocity
+ */
+Vector2D Drone::preferredVelocity() const {
+    if (status < hovering) {
+        return Vector2D();
+    }
+    Vector2D toGoal = goalPosition - position;
+    float distance = toGoal.normalizeLength();
+    return DroneTypes::visit(typeId, [&](const auto &type) {
+        if (!holding) {
+            return toGoal * float(type.maxSpeed);
+        }
+        // holding pattern: circle around the goal, radial correction toward holdingRadius
+        float maxSpeed = float(type.maxSpeed);
+        float radial = std::clamp(float(distance - holdingRadius), -maxSpeed, maxSpeed);
+        Vector2D v = Vector2D(toGoal.y, -toGoal.x) * (0.6f * maxSpeed) + toGoal * radial;
+        float l = v.length();
+        return l > maxSpeed ? v * (maxSpeed / l) : v;
+    });
+}
+
+/**
+ * @brief Drone::chooseSubsteps an isolated drone cruising far from its goal takes a single step,
+ * a drone in a cluster or close to its landing zone takes up to maxSubsteps small steps.
+ * @param nearest distance to the nearest drone in the air
+ * @param collisionDistance collision distance
+ * @param dt duration of the tick
+ * @return the number of steps
+ */
+int Drone::chooseSubsteps(double nearest, double collisionDistance, double dt) {
+    double clearance = nearest - collisionDistance;
+    if (finalGoal) {
+        clearance = std::min(clearance, (goalPosition - position).length() - landingRadius);
+    }
+    double travel = DroneTypes::visit(typeId, [dt](const auto &type) { return dt * type.maxSpeed; });
+    substeps = 1;
+    while (substeps < maxSubsteps && travel > 0.5 * clearance * substeps) {
+        substeps *= 2;
+    }
+    return substeps;
+}
+
+void Drone::update(double dt) {
+    // landed, takeoff and landing are analytic phases handled by onScheduledEvent()
+    if (status >= hovering) {
+        DroneTypes::visit(typeId, [this, dt](const auto &type) { move(dt, type); });
+    }
+}
+
+/**
+ * @brief Drone::move moves the drone with its velocity, or lands it if the landing zone is
+ * reached during the step. Type is a compile time profile for the built-in types.
+ * @param dt duration of the step
+ * @param type characteristics of the drone
+ */
+template <class Type>
+void Drone::move(double dt, const Type &type) {
+    Vector2D toGoal = goalPosition - position;
+    double distance = toGoal.length();
+    //double hoverRadius = 70.0;
+
+    if (holding || !finalGoal || distance - dt * type.maxSpeed > landingRadius) {
+        // V is given by the collision avoidance (see CollisionAvoidance)
+        position += V * float(dt);
+    } else {
+        // the landing zone is reached during this step: wait for the decision of the
+        // landing control (see Canvas::admitLandings)
+        V.set(0, 0);
+        arrived = true;
+    }
+
+    // Update heading (azimuth) so the drone rotates correctly
+    Vector2D heading = (V.lengthSquared() > 0) ? V : toGoal;
+    if (heading.x == 0) {
+        azimut = (heading.y > 0) ? 180 : 0;
+    } else {
+        azimut = -atan2(heading.x, heading.y) * 180.0 / M_PI;
+    }
+
+    speed = (goalPosition - position).length();
+    // the power drain and the low battery transition are scheduled (see scheduleNextTransition)
+}
+
+/**
+ * @brief Drone::land the landing control gave a pad to the drone
+ * @param spot position of the pad
+ */
+void Drone::land(const Vector2D &spot) {
+    arrived = false;
+    holding = false;
+    V.set(0, 0);
+    position = spot;
+    setStatus(landed);
+}
+
+void Drone::hold() {
+    arrived = false;
+    holding = true;
+}
+
+void Drone::start() {
+    arrived = false;
+    holding = false;
+    settle();
+    height = 0;
+    setStatus(takeoff);
+    repaint();
+}
+
+void Drone::stop() {
+    setStatus(landing);
+}
+
+/**
+ * @brief Drone::saveState the power and height are evaluated at the current time, so that the
+ * phase restarts from the snapshot when it is restored.
+ * @return the state
+ */
+Drone::State Drone::saveState() const {
+    State state{};
+    state.typeId = typeId;
+    state.status = status;
+    state.position = position;
+    state.goalPosition = goalPosition;
+    state.direction = direction;
+    state.V = V;
+    state.speed = speed;
+    state.speedSetpoint = speedSetpoint;
+    state.power = powerAt(now());
+    state.height = heightAt(now());
+    state.azimut = azimut;
+    state.route = currentRoute;
+    state.arrived = arrived;
+    state.holding = holding;
+    state.finalGoal = finalGoal;
+    state.showCollision = showCollision;
+    return state;
+}
+
+/**
+ * @brief Drone::restoreState copies the saved state, starts a phase at the current time and
+ * lets setStatus activate the drone and schedule its transition.
+ * @param state the saved state
+ */
+void Drone::restoreState(const State &state) {
+    typeId = std::clamp(int(state.typeId), 0, DroneTypes::count() - 1);
+    typeRevision = DroneTypes::revision(typeId);
+    status = droneStatus(std::clamp(int(state.status), int(landed), int(flying)));
+    position = state.position;
+    goalPosition = state.goalPosition;
+    direction = state.direction;
+    V = state.V;
+    speed = state.speed;
+    speedSetpoint = state.speedSetpoint;
+    power = state.power;
+    height = state.height;
+    azimut = state.azimut;
+    currentRoute = state.route;
+    arrived = state.arrived;
+    holding = state.holding;
+    finalGoal = state.finalGoal;
+    showCollision = state.showCollision;
+    phaseStart = now();
+    speedPB->setMaximum(type().maxSpeed);
+    powerPB->setMaximum(type().maxPower);
+    setStatus(status);
+}
+
+/**
+ * @brief Drone::setScheduler attaches the drone to a scheduler and schedules its next transition.
+ * @param s the scheduler, nullptr to detach the drone
+ */
+void Drone::setScheduler(DroneScheduler *s) {
+    if (scheduler) {
+        settle();
+        scheduler->detach(schedulerSlot);
+        schedulerSlot = -1;
+    }
+    scheduler = s;
+    if (scheduler) {
+        schedulerSlot = scheduler->attach(this);
+        phaseStart = scheduler->now();
+        setStatus(status);
+    }
+}
+
+double Drone::now() const {
+    return scheduler ? scheduler->now() : phaseStart;
+}
+
+/**
+ * @brief Drone::powerAt the power charges linearly when landed and is consumed linearly otherwise
+ * @param t simulation time
+ * @return the power at time t
+ */
+double Drone::powerAt(double t) const {
+    const DroneType &type = this->type();
+    double dt = t - phaseStart;
+    if (status == landed) {
+        return std::min(type.maxPower, power + dt * type.chargingSpeed);
+    }
+    return power - dt * type.powerConsumption;
+}
+
+/**
+ * @brief Drone::heightAt the height changes linearly during takeoff and landing
+ * @param t simulation time
+ * @return the height at time t
+ */
+double Drone::heightAt(double t) const {
+    const DroneType &type = this->type();
+    double dt = t - phaseStart;
+    switch (status) {
+        case takeoff: return std::min(type.hoveringHeight, height + dt * type.takeoffSpeed);
+        case landing: return std::max(0.0, height - dt * type.takeoffSpeed);
+        default: return height;
+    }
+}
+
+void Drone::settle() {
+    double t = now();
+    power = powerAt(t);
+    height = heightAt(t);
+    phaseStart = t;
+}
+
+/**
+ * @brief Drone::setStatus starts a new phase: the drone is stepped only when hovering or flying
+ * and its next analytic transition is scheduled.
+ * @param s the new status
+ */
+void Drone::setStatus(droneStatus s) {
+    settle();
+    const droneStatus previous = status;
+    status = s;
+    if (status < hovering) {
+        V.set(0, 0);
+    }
+    if (scheduler) {
+        scheduler->setActive(schedulerSlot, status >= hovering);
+        scheduleNextTransition();
+        if (status == landed && previous != landed) {
+            // a landing, not a drone attached or restored on the ground
+            scheduler->noteLanded(schedulerSlot);
+        }
+    }
+}
+
+/**
+ * @brief Drone::scheduleNextTransition computes the end of the current phase from the linear
+ * evolution of power and height: fully charged when landed, hovering height reached during
+ * takeoff, ground reached during landing, and low battery for any airborne state but landing.
+ */
+void Drone::scheduleNextTransition() {
+    const DroneType &type = this->type();
+    double t = std::numeric_limits<double>::infinity();
+    switch (status) {
+        case landed:
+            if (power < type.maxPower) t = phaseStart + (type.maxPower - power) / type.chargingSpeed;
+            break;
+        case takeoff:
+            t = phaseStart + (type.hoveringHeight - height) / type.takeoffSpeed;
+            break;
+        case landing:
+            t = phaseStart + height / type.takeoffSpeed;
+            break;
+        default:
+            break;
+    }
+    if (status != landed && status != landing) {
+        t = std::min(t, phaseStart + std::max(0.0, power - lowPowerLevel()) / type.powerConsumption);
+    }
+    if (t < std::numeric_limits<double>::infinity()) {
+        scheduler->schedule(schedulerSlot, t);
+    } else {
+        scheduler->cancel(schedulerSlot);
+    }
+}
+
+/**
+ * @brief Drone::onScheduledEvent applies the transition that is due at the scheduler time.
+ */
+void Drone::onScheduledEvent() {
+    const double eps = 1e-9;
+    settle();
+    switch (status) {
+        case landed: // fully charged
+            break;
+        case takeoff:
+            if (power <= lowPowerLevel() + eps) {
+                speed = 0;
+                setStatus(landing);
+            } else if (height >= type().hoveringHeight - eps) {
+                height = type().hoveringHeight;
+                setStatus(hovering);
+            } else {
+                scheduleNextTransition();
+            }
+            break;
+        case landing:
+            if (height <= eps) {
+                height = 0;
+                showCollision = false;
+                setStatus(landed);
+            } else {
+                scheduleNextTransition();
+            }
+            break;
+        default: // battery low while hovering or flying
+            if (power <= lowPowerLevel() + eps) {
+                setStatus(landing);
+            } else {
+                scheduleNextTransition();
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Drone::refreshDisplay copies the simulated state to the progress bars
+ * and repaints the compass. Widgets are only touched here so that the
+ * simulation substeps stay free of painting and heap allocations.
+ */
+void Drone::refreshDisplay() {
+    speedPB->setValue(speed);
+    powerPB->setValue(powerAt(now()));
+    repaint();
+}
+
+
+void Drone::initCollision() {
+    showCollision=false;
+}
+
+
+/**
+ * @brief Drone::addCollision continuous collision detection between two drones moving linearly
+ * during dt. The time of closest approach t* of the relative motion is clamped to [0,dt]; the
+ * drones collide if their distance at t* is under threshold, so fast drones cannot tunnel
+ * through each other between two steps.
+ * @param B position of the other drone at the start of the step (the position of this one)
+ * @param VB velocity of the other drone during the step
+ * @param threshold distance of collision detection
+ * @param dt duration of the step
+ */
+void Drone::addCollision(const Vector2D& B,const Vector2D& VB,float threshold,double dt) {
+    Vector2D AB=B-position;
+    Vector2D W=VB-V; // relative velocity
+    float w2=W.lengthSquared();
+    float t=0;
+    if (w2>0) {
+        t=-(AB*W)/w2;
+        if (t<0) t=0;
+        else if (t>dt) t=float(dt);
+    }
+    Vector2D ABt=AB+t*W; // relative position at the closest approach
+    if (ABt.lengthSquared()<threshold*threshold) {
+        showCollision=true;
+    }
+}
+
+
+/**
+ * @brief Drone::getTargetServerName returns the name of the server to which the drone is currently targeting..
+ * @return The name of the target server
+ */
+
+const QString &Drone::getTargetServerName() const {
+    return targetServerName;
+}
+
+/**
+ * @brief Drone::setTargetServerName sets the name of the server to which the drone will move.
+ * @param serverName The name of the target server to set.
+ */
+void Drone::setTargetServerName(const QString &serverName) {
+    targetServerName = serverName;
+}
+
+/**
+ * @brief Drone::findLandingSpot
+ *  This function ensures that drones do not land on the same
+ *  spot by checking previous use landing spots.
+ * @param serverPos The position of the server.
+ * @param radiusradius The radius in which the drone can land
+ * @return land spot for the drone
+ */
+Vector2D Drone::findLandingSpot(const Vector2D &serverPos, double radius) {
+    // Occupied landing spots, kept in a fixed ring so that landing never allocates
+    static const int maxLandingSpots = 256;
+    static Vector2D usedLandingSpots[maxLandingSpots];
+    static int nbLandingSpots = 0, nextLandingSpot = 0;
+
+    for (int i = 0; i < 10; i++) {
+        double angle = (rand() % 360) * (M_PI / 180.0);
+        double r = (rand() % int(radius - 50)) + 50;  // Ensure spacing
+        Vector2D landingSpot = serverPos + Vector2D(r * cos(angle), r * sin(angle));
+
+        bool occupied = false;
+        for (int j = 0; j < nbLandingSpots; j++) {
+            if ((landingSpot - usedLandingSpots[j]).length() < 40.0) {  // Keep 40px spacing
+                occupied = true;
+                break;
+            }
+        }
+
+        if (!occupied) {
+            usedLandingSpots[nextLandingSpot] = landingSpot;
+            nextLandingSpot = (nextLandingSpot + 1) % maxLandingSpots;
+            if (nbLandingSpots < maxLandingSpots) nbLandingSpots++;
+            return landingSpot;
+        }
+    }
+
+    return serverPos;  // Default to center if no space found
+}
+
+
+
+
+
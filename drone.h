@@ -1,142 +1,363 @@
-/**
- * @brief Drone_demo project
- * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
- * @date dec. 2024
- **/
-#ifndef DRONE_H
-#define DRONE_H
-
-#include <QWidget>
-#include <QProgressBar>
-#include <vector2d.h>
-#include <QImage>
-class Canvas;
-
-class Drone : public QWidget {
-    Q_OBJECT
-public:
-    const double maxSpeed=50; ///< max speed in pixels per second
-    const double maxPower=200; ///< max power of drone motors
-    const double takeoffSpeed=2.5; ///< unit/s
-    const double hoveringHeight=5; ///< units
-    const double coefCollision=1000; ///< coefficient for collision avoidment
-    const double damping=0.2;        ///< damping for motion simulation
-    const double chargingSpeed=10;   ///< speed of charging (power/s)
-    const double powerConsumption=5; ///< speed of consumption (power/s)
-    enum droneStatus { landed,takeoff,landing,hovering,turning,flying};
-    /**
-     * @brief Drone constructor
-     * @param p_name name of the drone
-     * @param parent parent widget
-     */
-    explicit Drone(const QString &p_name,QWidget *parent = nullptr);
-    //explicit Drone(const QString &p_name, Canvas *canvas, QWidget *parent = nullptr);
-    /**
-     * Drone destructor
-     */
-    ~Drone();
-    /**
-     * @brief Make the drone takeoff to move to a target position
-     */
-    inline void start() { status=takeoff; height=0; repaint(); }
-    /**
-     * @brief Ask for landing
-     */
-    inline void stop() { status=landing; }
-    /**
-     * @brief set the speed of fly of the drone
-     * @param s: speed
-     */
-    inline void setSpeed(double s) { speedSetpoint=(s>maxSpeed?maxSpeed:s); }
-    /**
-     * @brief setInitialPosition set the initial position of the drone (takeoff place)
-     * @param pos: the position
-     */
-    inline void setInitialPosition(const Vector2D& pos) { if (status==landed) position=pos; }
-    /**
-     * @brief setGoalPosition set the goal position of the drone (landing place)
-     * @param pos: the position
-     */
-    inline void setGoalPosition(const Vector2D& pos) { goalPosition=pos; }
-    /**
-     * @brief getPosition get the current position of the drone
-     * @return the position
-     */
-    inline Vector2D getPosition() { return position; }
-    /**
-     * @brief getStatus get the current status of the drone
-     * @return the status
-     */
-    inline droneStatus getStatus() { return status; }
-    /**
-     * @brief getName get the name of the drone
-     * @return the name
-     */
-    inline QString getName() { return name; }
-    /**
-    /** * @brief getAzimut get the direction of motion of the drone (angle in degree relatively to the y direction)
-    /** * @return the angle in degree
-    */
-    inline double getAzimut() { return azimut; }
-    /**
-     * @brief get the Power rank between 0 and 100
-     * @return the rank
-     */
-    inline double getPower() { return 100.0*power/maxPower; }
-    void paintEvent(QPaintEvent*) override;
-    void resizeEvent(QResizeEvent *event) override;
-
-    void update(double dt);
-    /**
-     * @brief Prepare data for collision detections
-     */
-    void initCollision();
-    /**
-     * @brief Add a collision force
-     * @param A: position of the other drone to test
-     * @param threshold: distance of collision detection
-     */
-    void addCollision(const Vector2D& A,float threshold);
-    /**
-     * @brief Get if a collision has occurred
-     * @return true if collision
-     */
-    bool hasCollision() { return showCollision; }
-    /**
- * @brief Gets and sets the name of the target server.
- */
-    void setTargetServerName(const QString &serverName);
-    QString getTargetServerName() const;
-    /**
-     * @brief findLandingSpot
-     */
-   Vector2D findLandingSpot(const Vector2D &serverPos, double radius);
-
-
-
-signals:
-
-private:
-    const int compasSize = 48; ///< size of the compas image (compasSize x compasSize)
-    const int barSpace = 150; ///< minimum size of the ProgressBar
-    droneStatus status;       ///< status of the drone
-    double height;            ///< current height of the drone
-    QString name;             ///< name of the drone
-    QProgressBar *speedPB;    ///< progress bar widget for the speed
-    QProgressBar *powerPB;    ///< progress bar widget for the power
-    Vector2D position;        ///< current position of the drone
-    Vector2D goalPosition;    ///< goal position for the drone
-    Vector2D direction;       ///< current direction
-    Vector2D V;               ///< current speed vector
-    Vector2D ForceCollision;  ///< force generated by the collision detection
-    double speed;             ///< current speed
-    double speedSetpoint;     ///< speed to reach if possible
-    double power;             ///< current power
-    double azimut;            ///< rotation angle of the drone
-    QImage compasImg,stopImg,takeoffImg,landingImg;
-    bool showCollision;       ///< true if a collision is detected
-    QString targetServerName;  // Stores the name of the target server
-    //Canvas *canvas;
-};
-
-#endif // DRONE_H
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef DRONE_H
+#define DRONE_H
+
+#include <QWidget>
+#include <QProgressBar>
+#include <vector2d.h>
+#include "dronetype.h"
+#include <QImage>
+#include <algorithm>
+class Canvas;
+class DroneScheduler;
+
+class Drone : public QWidget {
+    Q_OBJECT
+public:
+    static constexpr double landingRadius=90; ///< distance to the goal where the drone lands
+    static constexpr int maxSubsteps=16; ///< maximum number of steps of a drone in a tick
+    static constexpr double holdingRadius=150; ///< radius of the holding pattern around a full server
+    enum droneStatus { landed,takeoff,landing,hovering,turning,flying};
+    /**
+     * @brief Hop followed by the drone on the server connections (see FleetRouter)
+     */
+    struct Route {
+        int from=-1;        ///< server region where the hop was chosen
+        int target=-1;      ///< server of the next landing
+        int edge=-1;        ///< connection flown, -1 if none
+        int stop=-1;        ///< next landing: the final server or a charging stop (see EnergyPlanner)
+        int stopFrom=-1;    ///< server region where the stop was chosen
+        int destination=-1; ///< final server when the stop was chosen
+    };
+    /**
+     * @brief Simulated state of a drone, plain data copied as is in the snapshots (see WorldSnapshot)
+     */
+    struct State {
+        qint32 typeId;          ///< ID of the type in DroneTypes
+        qint32 status;          ///< droneStatus
+        Vector2D position;
+        Vector2D goalPosition;
+        Vector2D direction;
+        Vector2D V;
+        double speed;
+        double speedSetpoint;
+        double power;           ///< power at the time of the snapshot
+        double height;          ///< height at the time of the snapshot
+        double azimut;
+        Route route;
+        quint8 arrived;
+        quint8 holding;
+        quint8 finalGoal;
+        quint8 showCollision;
+    };
+    /**
+     * @brief Drone constructor
+     * @param p_name name of the drone
+     * @param parent parent widget
+     */
+    explicit Drone(const QString &p_name,QWidget *parent = nullptr);
+    //explicit Drone(const QString &p_name, Canvas *canvas, QWidget *parent = nullptr);
+    /**
+     * Drone destructor
+     */
+    ~Drone();
+    /**
+     * @brief Make the drone takeoff to move to a target position
+     */
+    void start();
+    /**
+     * @brief Ask for landing
+     */
+    void stop();
+    /**
+     * @brief setScheduler set the scheduler that gives the simulation time and triggers the
+     * state transitions of the drone (nullptr to detach the drone)
+     * @param s: the scheduler
+     */
+    void setScheduler(DroneScheduler *s);
+    /**
+     * @brief setType changes the type of the drone (the current phase continues with the new type),
+     * or takes into account its type changed in place (see DroneTypes::revision)
+     * @param id: ID of the type in DroneTypes
+     */
+    void setType(int id);
+    /**
+     * @brief settle evaluates power and height at the current time and starts a new phase
+     * (before the characteristics of the type change in place, see Canvas::defineTypes)
+     */
+    void settle();
+    /**
+     * @brief type
+     * @return the type of the drone
+     */
+    inline const DroneType &type() const { return DroneTypes::at(typeId); }
+    /**
+     * @brief getTypeId
+     * @return the ID of the type of the drone
+     */
+    inline int getTypeId() const { return typeId; }
+    /**
+     * @brief getSchedulerSlot
+     * @return the slot of the drone in its scheduler, -1 if it is not attached
+     */
+    inline int getSchedulerSlot() const { return schedulerSlot; }
+    /**
+     * @brief set the speed of fly of the drone
+     * @param s: speed
+     */
+    inline void setSpeed(double s) { speedSetpoint=std::min(s,type().maxSpeed); }
+    /**
+     * @brief setInitialPosition set the initial position of the drone (takeoff place)
+     * @param pos: the position
+     */
+    inline void setInitialPosition(const Vector2D& pos) { if (status==landed) position=pos; }
+    /**
+     * @brief setGoalPosition set the goal position of the drone (landing place)
+     * @param pos: the position
+     */
+    inline void setGoalPosition(const Vector2D& pos) { goalPosition=pos; finalGoal=true; }
+    /**
+     * @brief setWaypoint set an intermediate goal (a server on the way): the drone does not
+     * land there
+     * @param pos: the position
+     */
+    inline void setWaypoint(const Vector2D& pos) { goalPosition=pos; finalGoal=false; }
+    /**
+     * @brief route the hop followed by the drone
+     * @return the route, changed by the router
+     */
+    inline Route &route() { return currentRoute; }
+    /**
+     * @brief getGoalPosition get the goal position of the drone
+     * @return the position
+     */
+    inline const Vector2D &getGoalPosition() const { return goalPosition; }
+    /**
+     * @brief getPosition get the current position of the drone
+     * @return the position
+     */
+    inline Vector2D getPosition() { return position; }
+    /**
+     * @brief getStatus get the current status of the drone
+     * @return the status
+     */
+    inline droneStatus getStatus() { return status; }
+    /**
+     * @brief getName get the name of the drone
+     * @return the name
+     */
+    inline const QString &getName() const { return name; }
+    /**
+    /** * @brief getAzimut get the direction of motion of the drone (angle in degree relatively to the y direction)
+    /** * @return the angle in degree
+    */
+    inline double getAzimut() { return azimut; }
+    /**
+     * @brief get the Power rank between 0 and 100
+     * @return the rank
+     */
+    inline double getPower() { return 100.0*powerAt(now())/type().maxPower; }
+    /**
+     * @brief rangeLeft distance the drone can fly at full speed before its low power level
+     * @return the distance in pixels
+     */
+    inline double rangeLeft() const { return std::max(0.0,(powerAt(now())-lowPowerLevel())/type().powerConsumption*type().maxSpeed); }
+    /**
+     * @brief isFullyCharged
+     * @return true if the drone is landed with its max power
+     */
+    inline bool isFullyCharged() const { return status==landed && powerAt(now())>=type().maxPower; }
+    void paintEvent(QPaintEvent*) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+    /**
+     * @brief hasArrived
+     * @return true if the drone reached the landing zone of its goal and waits for a landing decision
+     */
+    inline bool hasArrived() const { return arrived; }
+    /**
+     * @brief isHolding
+     * @return true if the drone circles around its goal waiting for a free landing pad
+     */
+    inline bool isHolding() const { return holding; }
+    /**
+     * @brief land puts the drone on a landing pad
+     * @param spot: position of the pad
+     */
+    void land(const Vector2D &spot);
+    /**
+     * @brief hold makes the drone circle around its goal at holdingRadius
+     */
+    void hold();
+    /**
+     * @brief resumeLanding flies again to the landing zone of the goal (a pad is promised)
+     */
+    inline void resumeLanding() { holding=false; arrived=false; }
+    /**
+     * @brief saveState
+     * @return the state of the drone at the current simulation time
+     */
+    State saveState() const;
+    /**
+     * @brief restoreState puts the drone back in a saved state at the current simulation time
+     * and schedules its next transition (the drone must be attached to the scheduler)
+     * @param state: the saved state
+     */
+    void restoreState(const State &state);
+    /**
+     * @brief update moves a hovering or flying drone with its velocity (see setVelocity);
+     * the other states are driven by the scheduler
+     * @param dt: duration of the step in seconds
+     */
+    void update(double dt);
+    /**
+     * @brief refresh the progress bars and the compass from the current state
+     * (called once per tick, not in the simulation substeps)
+     */
+    void refreshDisplay();
+    /**
+     * @brief Prepare data for collision detections
+     */
+    void initCollision();
+    /**
+     * @brief Mark a collision if the two drones come closer than threshold during the step
+     * (swept circles: both drones move linearly during dt)
+     * @param A: position of the other drone at the start of the step of this one
+     * @param VA: velocity of the other drone
+     * @param threshold: distance of collision detection
+     * @param dt: duration of the step
+     */
+    void addCollision(const Vector2D& A,const Vector2D& VA,float threshold,double dt);
+    /**
+     * @brief getVelocity get the velocity of the drone during the last step
+     * @return the velocity vector
+     */
+    inline const Vector2D &getVelocity() const { return V; }
+    /**
+     * @brief setVelocity set the velocity of the next step (given by the collision avoidance)
+     * @param v: the velocity
+     */
+    inline void setVelocity(const Vector2D &v) { V=v; }
+    /**
+     * @brief preferredVelocity the velocity to reach the goal at full speed
+     * @return the velocity, null if the drone is not hovering or flying
+     */
+    Vector2D preferredVelocity() const;
+    /**
+     * @brief chooseSubsteps sets the number of steps of the drone in the next tick (local time
+     * stepping): a power of 2 such that a step moves less than half of the free space around the
+     * drone (to its nearest neighbour and to its landing zone)
+     * @param nearest: distance to the nearest drone in the air
+     * @param collisionDistance: distance of collision between two drones
+     * @param dt: duration of the tick
+     * @return the number of steps
+     */
+    int chooseSubsteps(double nearest, double collisionDistance, double dt);
+    /**
+     * @brief getSubsteps
+     * @return the number of steps of the drone in the current tick
+     */
+    inline int getSubsteps() const { return substeps; }
+    /**
+     * @brief isDueAt the drone is stepped in substep if its own step ends there
+     * @param substep: index of the substep in the tick
+     * @param substepsPerTick: number of substeps of the tick (a multiple of getSubsteps())
+     * @return true if the drone must be stepped
+     */
+    inline bool isDueAt(int substep, int substepsPerTick) const { return substep%(substepsPerTick/substeps)==0; }
+    /**
+     * @brief Get if a collision has occurred
+     * @return true if collision
+     */
+    bool hasCollision() { return showCollision; }
+    /**
+ * @brief Gets and sets the name of the target server.
+ */
+    void setTargetServerName(const QString &serverName);
+    const QString &getTargetServerName() const;
+    /**
+     * @brief findLandingSpot
+     */
+   Vector2D findLandingSpot(const Vector2D &serverPos, double radius);
+
+
+
+signals:
+
+private:
+    friend class DroneScheduler;
+    /**
+     * @brief setStatus changes the status at the current time and schedules the next transition
+     * @param s: new status
+     */
+    void setStatus(droneStatus s);
+    /**
+     * @brief scheduleNextTransition computes when the current state ends
+     * (fully charged, takeoff complete, landed or battery low)
+     */
+    void scheduleNextTransition();
+    /**
+     * @brief onScheduledEvent applies the transition due now (called by the scheduler)
+     */
+    void onScheduledEvent();
+    /**
+     * @brief now
+     * @return the simulation time
+     */
+    double now() const;
+    /**
+     * @brief powerAt power of the drone at time t (linear in the current phase)
+     */
+    double powerAt(double t) const;
+    /**
+     * @brief heightAt height of the drone at time t (linear in the current phase)
+     */
+    double heightAt(double t) const;
+    /**
+     * @brief lowPowerLevel
+     * @return the power under which the drone must land
+     */
+    inline double lowPowerLevel() const { return type().lowPowerLevel(); }
+
+    /**
+     * @brief move the hot path of update(), specialized for each built-in type
+     */
+    template <class Type>
+    void move(double dt, const Type &type);
+
+    static constexpr int compasSize = 48; ///< size of the compas image (compasSize x compasSize)
+    static constexpr int barSpace = 150; ///< minimum size of the ProgressBar
+    int typeId = DroneTypes::standard; ///< ID of the type of the drone
+    quint32 typeRevision = 0; ///< revision of the type when the current phase was scheduled
+    droneStatus status;       ///< status of the drone
+    double height;            ///< height of the drone at phaseStart
+    QString name;             ///< name of the drone
+    QProgressBar *speedPB;    ///< progress bar widget for the speed
+    QProgressBar *powerPB;    ///< progress bar widget for the power
+    Vector2D position;        ///< current position of the drone
+    Vector2D goalPosition;    ///< goal position for the drone
+    Vector2D direction;       ///< current direction
+    Vector2D V;               ///< current speed vector (null if not moving)
+    double speed;             ///< current speed
+    double speedSetpoint;     ///< speed to reach if possible
+    double power;             ///< power at phaseStart
+    double phaseStart;        ///< simulation time of the last status change (or settle)
+    DroneScheduler *scheduler=nullptr; ///< simulation clock and transitions
+    int schedulerSlot=-1;     ///< slot of the drone in the scheduler
+    int substeps=1;           ///< number of steps in the current tick
+    bool arrived=false;       ///< in the landing zone, waiting for a landing decision
+    bool holding=false;       ///< circling around the goal, waiting for a landing pad
+    bool finalGoal=true;      ///< false if goalPosition is a waypoint
+    Route currentRoute;       ///< hop on the server connections
+    double azimut;            ///< rotation angle of the drone
+    QImage compasImg,stopImg,takeoffImg,landingImg;
+    bool showCollision;       ///< true if a collision is detected
+    QString targetServerName;  // Stores the name of the target server
+    //Canvas *canvas;
+};
+
+#endif // DRONE_H
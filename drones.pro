@@ -1,33 +1,90 @@
-QT       += core gui
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-CONFIG += c++17
-
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-    canvas.cpp \
-    drone.cpp \
-    main.cpp \
-    mainwindow.cpp \
-    vector2d.cpp
-HEADERS += \
-    canvas.h \
-    drone.h \
-    mainwindow.h \
-    vector2d.h
-
-FORMS += \
-    mainwindow.ui
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
-
-DISTFILES += \
-    media/compas.png \
-    media/stop.png
+QT       += core gui network
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+# C++20 for the mission coroutines (see missionscheduler.h)
+CONFIG += c++2a
+gcc:!clang: QMAKE_CXXFLAGS += -fcoroutines
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+# Opt-in heap allocation counter, aborts if a steady simulation tick allocates (see --bench ticks):
+# qmake CONFIG+=alloc_counter
+alloc_counter: DEFINES += DRONES_ALLOC_COUNTER
+
+# shared memory state export (shm_open), mapped tile store (mmap)
+unix:!macx: LIBS += -lrt
+
+SOURCES += \
+    alloccounter.cpp \
+    benchmark.cpp \
+    canvas.cpp \
+    collisionavoidance.cpp \
+    commandserver.cpp \
+    drone.cpp \
+    dronescheduler.cpp \
+    dronetype.cpp \
+    energyplanner.cpp \
+    fleetrouter.cpp \
+    landingcontrol.cpp \
+    main.cpp \
+    mainwindow.cpp \
+    missiondispatcher.cpp \
+    missionscheduler.cpp \
+    scenario.cpp \
+    scenarioloader.cpp \
+    shardhub.cpp \
+    shardplan.cpp \
+    spatialgrid.cpp \
+    stateexporter.cpp \
+    telemetrypublisher.cpp \
+    tilestore.cpp \
+    tracereader.cpp \
+    tracerecorder.cpp \
+    trafficheatmap.cpp \
+    worldsnapshot.cpp
+HEADERS += \
+    alloccounter.h \
+    benchmark.h \
+    canvas.h \
+    collisionavoidance.h \
+    commandserver.h \
+    drone.h \
+    dronescheduler.h \
+    dronetype.h \
+    energyplanner.h \
+    fleetrouter.h \
+    landingcontrol.h \
+    mainwindow.h \
+    missiondispatcher.h \
+    missionscheduler.h \
+    mpscqueue.h \
+    scenario.h \
+    scenarioloader.h \
+    shardhub.h \
+    shardplan.h \
+    sharedstate.h \
+    spatialgrid.h \
+    spscring.h \
+    stateexporter.h \
+    telemetrypublisher.h \
+    tilestore.h \
+    tracereader.h \
+    tracerecorder.h \
+    trafficheatmap.h \
+    vector2d.h \
+    worldsnapshot.h
+
+FORMS += \
+    mainwindow.ui
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+DISTFILES += \
+    media/compas.png \
+    media/stop.png
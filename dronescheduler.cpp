@@ -0,0 +1,144 @@
+#include "dronescheduler.h"
+#include "drone.h"
+#include <algorithm>
+
+DroneScheduler::DroneScheduler() {
+    events.reserve(256);
+}
+
+/**
+ * @brief DroneScheduler::attach gives a slot to a drone, reusing the free ones.
+ * @param drone the drone
+ * @return the slot
+ */
+int DroneScheduler::attach(Drone *drone) {
+    int slot;
+    if (!freeSlots.isEmpty()) {
+        slot = freeSlots.takeLast();
+        drones[slot] = drone;
+    } else {
+        slot = drones.size();
+        drones.append(drone);
+        generations.append(0);
+        activeIndex.append(-1);
+        landedIndex.append(-1);
+    }
+    // room for the pending events and the active list, so that the ticks never allocate
+    if (events.capacity() < 2 * drones.size()) {
+        events.reserve(2 * drones.size());
+    }
+    if (active.capacity() < drones.size()) {
+        active.reserve(drones.size());
+        landed.reserve(drones.size());
+    }
+    return slot;
+}
+
+/**
+ * @brief DroneScheduler::detach frees the slot of a drone in O(1): like in the active list, the
+ * last landed drone takes the place of the detached one.
+ * @param slot slot of the drone
+ */
+void DroneScheduler::detach(int slot) {
+    setActive(slot, false);
+    cancel(slot);
+    const int index = landedIndex[slot];
+    if (index >= 0) {
+        Drone *last = landed.last();
+        landed[index] = last;
+        landedIndex[last->schedulerSlot] = index;
+        landed.removeLast();
+        landedIndex[slot] = -1;
+    }
+    drones[slot] = nullptr;
+    freeSlots.append(slot);
+}
+
+void DroneScheduler::noteLanded(int slot) {
+    if (landedIndex[slot] < 0) {
+        landedIndex[slot] = landed.size();
+        landed.append(drones[slot]);
+    }
+}
+
+void DroneScheduler::clearLanded() {
+    for (Drone *drone : landed) {
+        landedIndex[drone->schedulerSlot] = -1;
+    }
+    landed.resize(0);
+}
+
+/**
+ * @brief DroneScheduler::schedule pushes the next transition of a drone in the heap.
+ * The previous event of the drone stays in the heap but is ignored (generation changed).
+ * @param slot slot of the drone
+ * @param time simulation time of the transition
+ */
+void DroneScheduler::schedule(int slot, double time) {
+    cancel(slot);
+    if (events.size() >= events.capacity()) {
+        // drop the canceled events before growing the heap
+        events.erase(std::remove_if(events.begin(), events.end(), [this](const Event &e) {
+            return generations[e.slot] != e.generation;
+        }), events.end());
+        std::make_heap(events.begin(), events.end(), later);
+    }
+    events.append(Event{time, slot, generations[slot]});
+    std::push_heap(events.begin(), events.end(), later);
+}
+
+void DroneScheduler::cancel(int slot) {
+    generations[slot]++;
+}
+
+/**
+ * @brief DroneScheduler::setActive adds or removes a drone from the list of drones to step,
+ * in O(1) (the last drone of the list takes the place of the removed one).
+ * @param slot slot of the drone
+ * @param isActive true if the drone must be stepped
+ */
+void DroneScheduler::setActive(int slot, bool isActive) {
+    int index = activeIndex[slot];
+    if (isActive && index < 0) {
+        activeIndex[slot] = active.size();
+        active.append(drones[slot]);
+    } else if (!isActive && index >= 0) {
+        Drone *last = active.last();
+        active[index] = last;
+        activeIndex[last->schedulerSlot] = index;
+        active.removeLast();
+        activeIndex[slot] = -1;
+    }
+}
+
+/**
+ * @brief DroneScheduler::runUntil pops the events due before time in chronological order,
+ * sets the clock to the time of each event and lets the drone apply its transition.
+ * @param time new simulation time
+ */
+void DroneScheduler::runUntil(double time) {
+    while (!events.isEmpty() && events.first().time <= time) {
+        std::pop_heap(events.begin(), events.end(), later);
+        Event event = events.takeLast();
+        if (generations[event.slot] != event.generation) {
+            continue; // canceled
+        }
+        generations[event.slot]++;
+        clock = std::max(clock, event.time);
+        drones[event.slot]->onScheduledEvent();
+    }
+    clock = std::max(clock, time);
+}
+
+/**
+ * @brief DroneScheduler::setTime drops the canceled events, whose times refer to the previous
+ * clock, then sets the clock.
+ * @param time new simulation time
+ */
+void DroneScheduler::setTime(double time) {
+    events.erase(std::remove_if(events.begin(), events.end(), [this](const Event &e) {
+        return generations[e.slot] != e.generation;
+    }), events.end());
+    std::make_heap(events.begin(), events.end(), later);
+    clock = time;
+}
@@ -0,0 +1,119 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef DRONESCHEDULER_H
+#define DRONESCHEDULER_H
+
+#include <QVector>
+
+class Drone;
+
+/**
+ * @brief DroneScheduler keeps the simulation clock, a priority queue of the state transitions
+ * that are due at a known time (takeoff complete, landed, fully charged, battery low) and the
+ * list of the active drones (the ones that must be stepped).
+ * Each drone has at most one pending event: scheduling a new one cancels the previous one.
+ */
+class DroneScheduler {
+public:
+    DroneScheduler();
+    /**
+     * @brief now
+     * @return the simulation time in seconds
+     */
+    inline double now() const { return clock; }
+    /**
+     * @brief attach registers a drone
+     * @param drone: the drone
+     * @return the slot of the drone in the scheduler
+     */
+    int attach(Drone *drone);
+    /**
+     * @brief detach unregisters a drone, its pending event is canceled
+     * @param slot: slot returned by attach()
+     */
+    void detach(int slot);
+    /**
+     * @brief slotCount
+     * @return number of slots, used or free: the slots of the attached drones are below it
+     */
+    inline int slotCount() const { return drones.size(); }
+    /**
+     * @brief schedule sets the time of the next transition of a drone
+     * @param slot: slot of the drone
+     * @param time: simulation time of the transition
+     */
+    void schedule(int slot, double time);
+    /**
+     * @brief cancel removes the pending transition of a drone
+     * @param slot: slot of the drone
+     */
+    void cancel(int slot);
+    /**
+     * @brief setActive adds or removes a drone in the list of drones to step
+     * @param slot: slot of the drone
+     * @param active: true if the drone must be stepped
+     */
+    void setActive(int slot, bool active);
+    /**
+     * @brief activeDrones
+     * @return the drones that must be stepped (the order changes when a drone leaves)
+     */
+    inline const QVector<Drone*> &activeDrones() const { return active; }
+    /**
+     * @brief runUntil advances the clock and triggers the transitions that are due
+     * @param time: new simulation time
+     */
+    void runUntil(double time);
+    /**
+     * @brief setTime moves the clock to resume a saved world; the events of the detached
+     * drones are dropped (the drones must be attached afterwards)
+     * @param time: new simulation time
+     */
+    void setTime(double time);
+    /**
+     * @brief noteLanded records a drone that just landed (see landedDrones)
+     * @param slot: slot of the drone
+     */
+    void noteLanded(int slot);
+    /**
+     * @brief landedDrones
+     * @return the drones landed since the last clearLanded(), for the missions waiting for them
+     * (the order changes when a drone leaves)
+     */
+    inline const QVector<Drone*> &landedDrones() const { return landed; }
+    /**
+     * @brief clearLanded empties landedDrones()
+     */
+    void clearLanded();
+    /**
+     * @brief pendingEvents
+     * @return number of events in the queue (including canceled ones not yet popped)
+     */
+    inline int pendingEvents() const { return events.size(); }
+
+private:
+    /**
+     * @brief A transition of the drone of slot due at time
+     */
+    struct Event {
+        double time;
+        int slot;
+        unsigned generation; ///< the event is canceled if the slot generation changed
+    };
+    static bool later(const Event &a, const Event &b) { return a.time > b.time; }
+
+    double clock = 0;                ///< simulation time
+    QVector<Event> events;           ///< binary heap of events (earliest first)
+    QVector<Drone*> drones;          ///< drone of each slot (nullptr for a free slot)
+    QVector<unsigned> generations;   ///< generation of each slot
+    QVector<int> activeIndex;        ///< index of each slot in active, -1 if not active
+    QVector<int> freeSlots;          ///< slots to reuse
+    QVector<Drone*> active;          ///< drones to step
+    QVector<Drone*> landed;          ///< drones landed since clearLanded()
+    QVector<int> landedIndex;        ///< index of each slot in landed, -1 if not landed
+};
+
+#endif // DRONESCHEDULER_H
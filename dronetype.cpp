@@ -0,0 +1,83 @@
+#include "dronetype.h"
+#include <QDebug>
+
+namespace {
+bool sameCharacteristics(const DroneType &a, const DroneType &b) {
+    return a.maxSpeed == b.maxSpeed && a.maxPower == b.maxPower && a.takeoffSpeed == b.takeoffSpeed
+        && a.hoveringHeight == b.hoveringHeight && a.damping == b.damping
+        && a.chargingSpeed == b.chargingSpeed && a.powerConsumption == b.powerConsumption;
+}
+}
+
+QVector<DroneType> &DroneTypes::table() {
+    static QVector<DroneType> types = {
+        DroneType::fromProfile<StandardProfile>("standard"),
+        DroneType::fromProfile<HeavyProfile>("heavy"),
+        DroneType::fromProfile<RacerProfile>("racer")
+    };
+    return types;
+}
+
+QHash<QString,int> &DroneTypes::names() {
+    static QHash<QString,int> ids = { {"standard", standard}, {"heavy", heavy}, {"racer", racer} };
+    return ids;
+}
+
+QVector<quint32> &DroneTypes::revisions() {
+    static QVector<quint32> stamps(builtinCount, 0);
+    return stamps;
+}
+
+quint32 DroneTypes::nextRevision = 1;
+
+int DroneTypes::define(const DroneType &type) {
+    QVector<DroneType> &types = table();
+    int id = names().value(type.name, -1);
+    if (id >= 0 && id < builtinCount && types[id].name == type.name) {
+        if (!sameCharacteristics(types[id], type)) {
+            qDebug() << "Drone type" << type.name << "has the name of a built-in type, its characteristics are ignored";
+        }
+        return id;
+    }
+    // same characteristics as a built-in type: share its ID and its specialized kernels
+    for (int builtin = 0; builtin < builtinCount; builtin++) {
+        if (sameCharacteristics(types[builtin], type)) {
+            names().insert(type.name, builtin);
+            return builtin;
+        }
+    }
+    if (id >= builtinCount) {
+        if (!sameCharacteristics(types[id], type)) {
+            types[id] = type;
+            revisions()[id] = nextRevision++;
+        }
+        return id;
+    }
+    id = types.size();
+    types.append(type);
+    revisions().append(nextRevision++);
+    names().insert(type.name, id);
+    return id;
+}
+
+int DroneTypes::redefinedId(const DroneType &type) {
+    const int id = names().value(type.name, -1);
+    return id >= builtinCount && !sameCharacteristics(table()[id], type) ? id : -1;
+}
+
+void DroneTypes::reset() {
+    table().resize(builtinCount);
+    revisions().resize(builtinCount);
+    QHash<QString,int> &ids = names();
+    for (auto it = ids.begin(); it != ids.end();) {
+        if (it.value() >= builtinCount || table()[it.value()].name != it.key()) {
+            it = ids.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int DroneTypes::idOf(const QString &name) {
+    return names().value(name, -1);
+}
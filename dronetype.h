@@ -0,0 +1,141 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef DRONETYPE_H
+#define DRONETYPE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+/**
+ * @brief Physical characteristics shared by all the drones of a type.
+ */
+struct DroneType {
+    QString name;               ///< name of the type (used in the scenario files)
+    double maxSpeed;            ///< max speed in pixels per second
+    double maxPower;            ///< max power of drone motors
+    double takeoffSpeed;        ///< unit/s
+    double hoveringHeight;      ///< units
+    double damping;             ///< damping for motion simulation
+    double chargingSpeed;       ///< speed of charging (power/s)
+    double powerConsumption;    ///< speed of consumption (power/s)
+
+    /**
+     * @brief lowPowerLevel
+     * @return the power under which a flying drone must land
+     */
+    inline double lowPowerLevel() const { return 20+powerConsumption/takeoffSpeed; }
+    /**
+     * @brief fullRange distance flown at full speed from full power to the low power level
+     * @return the distance in pixels
+     */
+    inline double fullRange() const { return (maxPower-lowPowerLevel())/powerConsumption*maxSpeed; }
+
+    /**
+     * @brief fromProfile builds a type from a compile time profile
+     * @param name: name of the type
+     * @return the type
+     */
+    template <class Profile>
+    static DroneType fromProfile(const QString &name) {
+        return DroneType{name, Profile::maxSpeed, Profile::maxPower, Profile::takeoffSpeed, Profile::hoveringHeight,
+                         Profile::damping, Profile::chargingSpeed, Profile::powerConsumption};
+    }
+};
+
+/**
+ * @brief Compile time profiles of the common types: the kernels instantiated with a profile
+ * see its characteristics as constants (same member names as DroneType).
+ */
+struct StandardProfile {
+    static constexpr double maxSpeed=50, maxPower=200, takeoffSpeed=2.5, hoveringHeight=5,
+                            damping=0.2, chargingSpeed=10, powerConsumption=5;
+};
+struct HeavyProfile {
+    static constexpr double maxSpeed=30, maxPower=400, takeoffSpeed=1.5, hoveringHeight=8,
+                            damping=0.3, chargingSpeed=15, powerConsumption=8;
+};
+struct RacerProfile {
+    static constexpr double maxSpeed=90, maxPower=120, takeoffSpeed=4, hoveringHeight=4,
+                            damping=0.1, chargingSpeed=8, powerConsumption=6;
+};
+
+/**
+ * @brief DroneTypes is the table of the drone types, each drone only keeps the ID of its type.
+ * The built-in types (IDs below builtinCount) have a compile time profile; the types read in
+ * the scenario files are added after them and forgotten when another scenario is applied.
+ * The table is only changed in the GUI thread.
+ */
+class DroneTypes {
+public:
+    enum BuiltinId { standard=0, heavy, racer, builtinCount };
+    /**
+     * @brief define adds a type or updates the type with the same name.
+     * A type with the characteristics of a built-in one gets its ID; a built-in type and its
+     * name are never changed, a different definition with its name is ignored.
+     * @param type: the type
+     * @return the ID of the type
+     */
+    static int define(const DroneType &type);
+    /**
+     * @brief redefinedId
+     * @param type: a type to define
+     * @return the ID of the type that define() would change in place (same name, other
+     * characteristics), -1 if none
+     */
+    static int redefinedId(const DroneType &type);
+    /**
+     * @brief reset forgets the types defined by the scenarios, only the built-in ones are left
+     */
+    static void reset();
+    /**
+     * @brief revision
+     * @param id: ID of a type
+     * @return a stamp that changes each time the type is defined (never reused, even after reset())
+     */
+    static inline quint32 revision(int id) { return revisions()[id]; }
+    /**
+     * @brief idOf
+     * @param name: name of a type
+     * @return the ID of the type, -1 if unknown
+     */
+    static int idOf(const QString &name);
+    /**
+     * @brief at
+     * @param id: ID of a type
+     * @return the type
+     */
+    static inline const DroneType &at(int id) { return table()[id]; }
+    /**
+     * @brief count
+     * @return the number of types (the IDs are below)
+     */
+    static inline int count() { return table().size(); }
+    /**
+     * @brief visit calls f with the compile time profile of a built-in type, or the DroneType
+     * of the table otherwise, so that f is specialized for the common types
+     * @param id: ID of the type
+     * @param f: generic callable, f(const auto &type)
+     * @return the result of f
+     */
+    template <class F>
+    static auto visit(int id, F &&f) {
+        switch (id) {
+            case standard: return f(StandardProfile());
+            case heavy: return f(HeavyProfile());
+            case racer: return f(RacerProfile());
+            default: return f(at(id));
+        }
+    }
+
+private:
+    static QVector<DroneType> &table();
+    static QHash<QString,int> &names();
+    static QVector<quint32> &revisions();
+    static quint32 nextRevision;
+};
+
+#endif // DRONETYPE_H
@@ -0,0 +1,151 @@
+#include "energyplanner.h"
+#include "scenario.h"
+#include "dronetype.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief EnergyPlanner::reset stores the connections as a compact list of directed edges and
+ * sizes the cache and the search buffers, the plans never allocate afterwards.
+ * @param w the servers
+ * @param types number of drone types
+ */
+void EnergyPlanner::reset(const Scenario &w, int types) {
+    world = &w;
+    serverCount = w.servers.size();
+    typeCount = types;
+    const int n = serverCount;
+    edgeStart.resize(n + 1);
+    edgeTo.clear();
+    edgeLength.clear();
+    for (int a = 0; a < n; a++) {
+        edgeStart[a] = edgeTo.size();
+        for (int b : w.adjacency[a]) {
+            edgeTo.append(b);
+            edgeLength.append((w.servers[b].position - w.servers[a].position).length());
+        }
+    }
+    edgeStart[n] = edgeTo.size();
+
+    rowOf.fill(-1, typeCount * (powerBuckets + 1) * n);
+    rows.resize(std::min(maxCachedRows, rowOf.size()) * n);
+    usedRows = 0;
+    scratch.resize(n);
+    const int states = n * (powerBuckets + 1);
+    times.resize(states);
+    previous.resize(states);
+    heap.clear();
+    // each state is pushed once by a charge and once per edge reaching it at most
+    heap.reserve(states + edgeTo.size() * (powerBuckets + 1) + 1);
+    hits = misses = 0;
+}
+
+/**
+ * @brief EnergyPlanner::nextStop looks the plan up in the cache, the row of an origin, a type
+ * and a range level is searched once for all the destinations. When the cache is full it is
+ * emptied.
+ * @param origin region of the drone
+ * @param target final server
+ * @param range distance the drone can still fly
+ * @param typeId type of the drone
+ * @return the next landing, -1 if unreachable
+ */
+int EnergyPlanner::nextStop(int origin, int target, double range, int typeId) {
+    if (origin < 0 || target < 0 || origin >= serverCount || target >= serverCount || origin == target) {
+        return target;
+    }
+    const DroneType &type = DroneTypes::at(typeId);
+    // rounded down: the plan of a level is feasible for all the ranges of the level
+    int level = std::clamp(int(std::floor(range / type.fullRange() * powerBuckets)), 0, powerBuckets);
+    if (typeId >= typeCount) {
+        misses++;
+        plan(origin, level, type, scratch.data());
+        return scratch[target];
+    }
+    int &row = rowOf[(typeId * (powerBuckets + 1) + level) * serverCount + origin];
+    if (row < 0) {
+        if (usedRows * serverCount == rows.size()) {
+            std::fill(rowOf.begin(), rowOf.end(), -1);
+            usedRows = 0;
+        }
+        row = usedRows++;
+        misses++;
+        plan(origin, level, type, rows.data() + row * serverCount);
+    } else {
+        hits++;
+    }
+    return rows[row * serverCount + target];
+}
+
+/**
+ * @brief EnergyPlanner::plan Dijkstra on the states (server, level) ordered by time. From a
+ * state the drone either flies a connection if its range is enough (the level of the arrival
+ * is rounded down), or charges to its max power (landing and takeoff included). The first
+ * charge on the path back from a destination is the next stop.
+ * @param origin origin server
+ * @param level range level at the origin
+ * @param type characteristics of the drone
+ * @param row next stop to each destination, -1 if unreachable
+ */
+void EnergyPlanner::plan(int origin, int level, const DroneType &type, int *row) {
+    const int levels = powerBuckets + 1;
+    const double fullRange = type.fullRange();
+    const double chargeOverhead = 2 * type.hoveringHeight / type.takeoffSpeed;
+    const double chargeRate = type.chargingSpeed / type.powerConsumption * type.maxSpeed; // range per second
+    std::fill(times.begin(), times.end(), std::numeric_limits<double>::infinity());
+
+    auto relax = [this](int state, int from, double time) {
+        if (time < times[state]) {
+            times[state] = time;
+            previous[state] = from;
+            heap.append(Candidate{time, state});
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    };
+    heap.clear();
+    relax(origin * levels + level, -1, 0);
+    while (!heap.isEmpty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Candidate c = heap.last();
+        heap.removeLast();
+        if (c.time > times[c.state]) {
+            continue; // already settled with a lower time
+        }
+        const int server = c.state / levels;
+        const int l = c.state % levels;
+        const double range = l * fullRange / powerBuckets;
+        if (l < powerBuckets) {
+            relax(server * levels + powerBuckets, c.state, c.time + chargeOverhead + (fullRange - range) / chargeRate);
+        }
+        for (int e = edgeStart[server]; e < edgeStart[server + 1]; e++) {
+            double left = range - edgeLength[e] * (1 + margin);
+            if (left >= 0) {
+                int arrival = int(std::floor(left / fullRange * powerBuckets));
+                relax(edgeTo[e] * levels + arrival, c.state, c.time + edgeLength[e] / type.maxSpeed);
+            }
+        }
+    }
+
+    for (int target = 0; target < serverCount; target++) {
+        int best = -1;
+        for (int l = 0; l < levels; l++) {
+            int state = target * levels + l;
+            if (times[state] < std::numeric_limits<double>::infinity() && (best < 0 || times[state] < times[best])) {
+                best = state;
+            }
+        }
+        if (best < 0) {
+            row[target] = -1;
+            continue;
+        }
+        // walk back to the origin, a transition inside a server is a charge
+        int stop = target;
+        for (int state = best; previous[state] >= 0; state = previous[state]) {
+            if (previous[state] / levels == state / levels) {
+                stop = state / levels;
+            }
+        }
+        row[target] = stop;
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef ENERGYPLANNER_H
+#define ENERGYPLANNER_H
+
+#include <QVector>
+
+struct DroneType;
+class Scenario;
+
+/**
+ * @brief EnergyPlanner chooses where a drone lands next on its way to a server: the server
+ * itself when its range is enough, or a charging stop. The plan is the fastest path over the
+ * server connections (flight time plus charging time) where the range never goes below zero,
+ * searched with a Dijkstra over the states (server, range level); a drone charges to its max
+ * power at a stop.
+ * The ranges are rounded down to powerBuckets levels, so the plans of an origin, a type and a
+ * level are cached together for all the destinations.
+ */
+class EnergyPlanner {
+public:
+    static constexpr int powerBuckets = 16;     ///< range levels of the plans
+    static constexpr int maxCachedRows = 4096; ///< plans kept, one row per origin, type and level
+    double margin = 0.15; ///< extra range kept on each flight (congestion detours, drone away from the server)
+
+    /**
+     * @brief reset builds the edges from the connections of the servers and empties the cache
+     * @param world: the servers (kept until the next reset)
+     * @param typeCount: number of drone types, the plans of the other types are not cached
+     */
+    void reset(const Scenario &world, int typeCount);
+    /**
+     * @brief nextStop
+     * @param origin: index of the server region containing the drone
+     * @param target: index of the final server
+     * @param range: distance the drone can still fly (see Drone::rangeLeft)
+     * @param typeId: type of the drone
+     * @return the index of the next server where the drone must land (target or a charging
+     * stop, origin if it must charge first), -1 if the target cannot be reached
+     */
+    int nextStop(int origin, int target, double range, int typeId);
+    /**
+     * @brief cacheHits
+     * @return number of plans found in the cache since the reset
+     */
+    inline int cacheHits() const { return hits; }
+    /**
+     * @brief cacheMisses
+     * @return number of searches since the reset
+     */
+    inline int cacheMisses() const { return misses; }
+
+private:
+    /**
+     * @brief plan searches the fastest feasible paths from a server with a range level
+     * @param row: filled with the next stop to each destination
+     */
+    void plan(int origin, int level, const DroneType &type, int *row);
+    /**
+     * @brief An entry of the Dijkstra heap
+     */
+    struct Candidate {
+        double time;
+        int state;
+    };
+    static bool later(const Candidate &a, const Candidate &b) { return a.time > b.time; }
+
+    const Scenario *world = nullptr;
+    int serverCount = 0;
+    int typeCount = 0;
+    QVector<int> edgeStart;     ///< first edge of each server (edgeStart[n] = number of edges)
+    QVector<int> edgeTo;        ///< destination server of each edge
+    QVector<float> edgeLength;  ///< length of each edge
+    QVector<int> rowOf;         ///< cached row of each (type, level, origin), -1 if not planned
+    QVector<int> rows;          ///< cached next stops, serverCount per row
+    int usedRows = 0;           ///< rows in use
+    QVector<int> scratch;       ///< next stops of a type out of the cache
+    QVector<double> times;      ///< search buffer: time to reach each state
+    QVector<int> previous;      ///< search buffer: state before each state, -1 for the origin
+    QVector<Candidate> heap;    ///< search buffer: states to visit
+    int hits = 0;
+    int misses = 0;
+};
+
+#endif // ENERGYPLANNER_H
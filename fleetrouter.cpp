@@ -0,0 +1,179 @@
+#include "fleetrouter.h"
+#include "scenario.h"
+#include "drone.h"
+#include <algorithm>
+#include <limits>
+
+/**
+ * @brief FleetRouter::reset stores the connections as a compact list of directed edges
+ * and sizes the search buffers, the routes never allocate afterwards.
+ * @param w the servers
+ */
+void FleetRouter::reset(const Scenario &w) {
+    world = &w;
+    const int n = w.servers.size();
+    edgeStart.resize(n + 1);
+    edgeFrom.clear();
+    edgeTo.clear();
+    edgeLength.clear();
+    for (int a = 0; a < n; a++) {
+        edgeStart[a] = edgeTo.size();
+        for (int b : w.adjacency[a]) {
+            edgeFrom.append(a);
+            edgeTo.append(b);
+            edgeLength.append((w.servers[b].position - w.servers[a].position).length());
+        }
+    }
+    edgeStart[n] = edgeTo.size();
+    loads.fill(0, edgeTo.size());
+    distances.resize(n);
+    previous.resize(n);
+    heap.clear();
+    heap.reserve(edgeTo.size() + 1);
+}
+
+/**
+ * @brief FleetRouter::countLoads the loads are recounted at each step from the drones in the
+ * air, so the landed or removed drones never have to release their edge.
+ * @param fleet the flying drones
+ */
+void FleetRouter::countLoads(const QVector<Drone*> &fleet) {
+    std::fill(loads.begin(), loads.end(), 0);
+    for (Drone *drone : fleet) {
+        int edge = drone->route().edge;
+        if (edge >= 0 && edge < loads.size()) {
+            loads[edge]++;
+        }
+    }
+}
+
+/**
+ * @brief FleetRouter::route keeps the hop of a drone while it stays in the same region with the
+ * same target, otherwise moves its load to the first edge of the cheapest path.
+ * @param drone the drone
+ * @param current index of the region of the drone
+ * @param target index of the server of the next landing
+ * @return the next server, -1 if unreachable
+ */
+int FleetRouter::route(Drone *drone, int current, int target) {
+    Drone::Route &r = drone->route();
+    if (r.from == current && r.target == target && r.edge >= 0 && r.edge < edgeTo.size()) {
+        return edgeTo[r.edge];
+    }
+    if (r.edge >= 0 && r.edge < loads.size() && loads[r.edge] > 0) {
+        loads[r.edge]--;
+    }
+    r.from = current;
+    r.target = target;
+    r.edge = cheapestFirstEdge(current, target);
+    if (r.edge < 0) {
+        return -1;
+    }
+    loads[r.edge]++;
+    return edgeTo[r.edge];
+}
+
+int FleetRouter::load(int from, int to) const {
+    int e = findEdge(from, to);
+    return e < 0 ? 0 : loads[e];
+}
+
+int FleetRouter::findEdge(int from, int to) const {
+    for (int e = edgeStart[from]; e < edgeStart[from + 1]; e++) {
+        if (edgeTo[e] == to) {
+            return e;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief FleetRouter::update the edges are renumbered by the rebuild: the hop of each drone is
+ * kept by its ends (renumbered like the servers), only the drones whose connection disappeared
+ * lose their route.
+ * @param fleet all the drones
+ * @param remap new index of each previous server, empty if unchanged
+ * @return the number of rerouted drones
+ */
+int FleetRouter::update(const QVector<Drone*> &fleet, const QVector<int> &remap) {
+    QVector<int> from(fleet.size()), to(fleet.size());
+    int rerouted = 0;
+    for (int i = 0; i < fleet.size(); i++) {
+        int edge = fleet[i]->route().edge;
+        bool valid = edge >= 0 && edge < edgeTo.size();
+        from[i] = valid ? edgeFrom[edge] : -1;
+        to[i] = valid ? edgeTo[edge] : -1;
+        if (valid && !remap.isEmpty()) {
+            from[i] = remap.value(from[i], -1);
+            to[i] = remap.value(to[i], -1);
+            if (from[i] < 0 || to[i] < 0) {
+                // an end of the connection was removed
+                fleet[i]->route() = Drone::Route();
+                from[i] = -1;
+                rerouted++;
+            }
+        }
+    }
+    reset(*world);
+    for (int i = 0; i < fleet.size(); i++) {
+        if (from[i] < 0) {
+            continue;
+        }
+        Drone::Route &r = fleet[i]->route();
+        r.edge = findEdge(from[i], to[i]);
+        if (r.edge < 0) {
+            r = Drone::Route();
+            rerouted++;
+        }
+    }
+    return rerouted;
+}
+
+/**
+ * @brief FleetRouter::cheapestFirstEdge Dijkstra with a binary heap (lazy deletion), stopped
+ * when the target is settled; the path is walked back to its first edge.
+ * @param current origin
+ * @param target destination
+ * @return the first edge of the path, -1 if the target cannot be reached
+ */
+int FleetRouter::cheapestFirstEdge(int current, int target) {
+    const int n = distances.size();
+    if (current == target || world->nextHop[current * n + target] < 0) {
+        return -1;
+    }
+    std::fill(distances.begin(), distances.end(), std::numeric_limits<float>::max());
+    distances[current] = 0;
+    previous[current] = -1;
+    heap.clear();
+    heap.append(Candidate{0, current});
+    while (!heap.isEmpty()) {
+        std::pop_heap(heap.begin(), heap.end(), farther);
+        Candidate c = heap.last();
+        heap.removeLast();
+        if (c.distance > distances[c.server]) {
+            continue; // already settled with a lower cost
+        }
+        if (c.server == target) {
+            break;
+        }
+        for (int e = edgeStart[c.server]; e < edgeStart[c.server + 1]; e++) {
+            int next = edgeTo[e];
+            float d = c.distance + cost(e);
+            if (d < distances[next]) {
+                distances[next] = d;
+                previous[next] = e;
+                heap.append(Candidate{d, next});
+                std::push_heap(heap.begin(), heap.end(), farther);
+            }
+        }
+    }
+    // walk back from the target to the edge leaving current
+    int server = target;
+    for (;;) {
+        int e = previous[server];
+        if (edgeFrom[e] == current) {
+            return e;
+        }
+        server = edgeFrom[e];
+    }
+}
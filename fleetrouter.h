@@ -0,0 +1,100 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef FLEETROUTER_H
+#define FLEETROUTER_H
+
+#include <QVector>
+
+class Drone;
+class Scenario;
+
+/**
+ * @brief FleetRouter routes the drones hop by hop over the server connections. It counts the
+ * drones flying each connection (the load of the directed edge) and chooses the next hop with
+ * a Dijkstra search where the cost of an edge grows with its load, so that the drones sharing
+ * an origin and a destination spread over the parallel routes.
+ * A route is only searched when a drone enters a new server region or changes of target.
+ */
+class FleetRouter {
+public:
+    double laneCapacity = 4; ///< drones on an edge that double its cost
+
+    /**
+     * @brief reset builds the edges from the connections of the servers
+     * @param world: the servers (kept until the next reset)
+     */
+    void reset(const Scenario &world);
+    /**
+     * @brief update rebuilds the edges after a runtime change of the connections; the drones
+     * keep their hop if its connection still exists, the others lose their route and are routed
+     * again at their next update
+     * @param fleet: all the drones
+     * @param remap: new index of each previous server, -1 if removed (see Scenario::mergeServers),
+     * empty if the servers kept their index
+     * @return the number of drones whose hop was removed
+     */
+    int update(const QVector<Drone*> &fleet, const QVector<int> &remap = QVector<int>());
+    /**
+     * @brief countLoads recounts the load of each edge from the routes of the flying drones
+     * @param fleet: the flying drones
+     */
+    void countLoads(const QVector<Drone*> &fleet);
+    /**
+     * @brief route chooses the next hop of a drone, keeps its current hop if it is still in the
+     * region where it was chosen
+     * @param drone: the drone
+     * @param current: index of the server region containing the drone
+     * @param target: index of the server of the next landing (final server or charging stop)
+     * @return the index of the next server, -1 if the target cannot be reached
+     */
+    int route(Drone *drone, int current, int target);
+    /**
+     * @brief load
+     * @param from: index of a server
+     * @param to: index of a connected server
+     * @return the number of drones flying from from to to
+     */
+    int load(int from, int to) const;
+    /**
+     * @brief findEdge
+     * @param from: index of a server
+     * @param to: index of another server
+     * @return the edge from from to to, -1 if they are not connected
+     */
+    int findEdge(int from, int to) const;
+
+private:
+    /**
+     * @brief cheapestFirstEdge Dijkstra search from current to target with the congestion costs
+     * @return the first edge of the cheapest path, -1 if unreachable
+     */
+    int cheapestFirstEdge(int current, int target);
+    /**
+     * @brief cost of an edge with its current load
+     */
+    inline float cost(int edge) const { return edgeLength[edge] * float(1.0 + loads[edge] / laneCapacity); }
+
+    /**
+     * @brief An entry of the Dijkstra heap
+     */
+    struct Candidate {
+        float distance;
+        int server;
+    };
+    static bool farther(const Candidate &a, const Candidate &b) { return a.distance > b.distance; }
+
+    const Scenario *world = nullptr;
+    QVector<int> edgeStart;     ///< first edge of each server (edgeStart[n] = number of edges)
+    QVector<int> edgeFrom;      ///< origin server of each edge
+    QVector<int> edgeTo;        ///< destination server of each edge
+    QVector<float> edgeLength;  ///< length of each edge
+    QVector<int> loads;         ///< drones flying each edge
+    QVector<float> distances;   ///< search buffer: cost from the origin
+    QVector<int> previous;      ///< search buffer: edge reaching each server
+    QVector<Candidate> heap;    ///< search buffer: servers to visit
+};
+
+#endif // FLEETROUTER_H
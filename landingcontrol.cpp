@@ -0,0 +1,415 @@
+#include "landingcontrol.h"
+#include "scenario.h"
+#include "drone.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+/**
+ * @brief LandingControl::reset places capacity pads around each server, on rings of 8 pads
+ * inside the landing zone.
+ * @param w the servers
+ * @param fleetSize number of drones
+ * @param now simulation time
+ */
+void LandingControl::reset(const Scenario &w, int fleetSize, double now) {
+    world = &w;
+    queueCapacity = fleetSize;
+    stations.clear();
+    slotStation.fill(-1, queueCapacity);
+    update();
+    landingCount = 0;
+    startTime = now;
+    worstWait = 0;
+}
+
+/**
+ * @brief LandingControl::update renumbers the stations like the servers, adds the stations of the
+ * new servers, moves the pads with their server, follows the capacities and closes the stations
+ * of the offline servers. When a station is closed or opened again, the drones of its queue leave
+ * their holding pattern and ask again (rerouted if a pad is available elsewhere); a closed station
+ * also loses the pads promised to the drones on their way. Only the drones of the removed and
+ * renumbered stations are visited.
+ * @param remap new index of each previous server, empty if unchanged
+ */
+void LandingControl::update(const QVector<int> &remap) {
+    if (!remap.isEmpty()) {
+        int kept = 0;
+        for (int to : remap) {
+            kept += to >= 0;
+        }
+        QVector<Station> renumbered(kept);
+        for (int s = 0; s < stations.size(); s++) {
+            Station &station = stations[s];
+            const int to = remap.value(s, -1);
+            // the drones of a removed server lose their pad, the holding ones ask again
+            for (const Pad &pad : station.pads) {
+                if (pad.drone && to != s) {
+                    setStation(pad.drone, to);
+                }
+            }
+            for (const Waiting &waiting : station.queue) {
+                if (to != s) {
+                    setStation(waiting.drone, to);
+                }
+                if (to < 0) {
+                    waiting.drone->resumeLanding();
+                }
+            }
+            if (to >= 0) {
+                renumbered[to] = std::move(station);
+            }
+        }
+        stations = std::move(renumbered);
+    }
+    for (int s = 0; s < world->servers.size(); s++) {
+        const Server &server = world->servers[s];
+        if (s == stations.size()) {
+            stations.append(Station());
+            stations[s].pads.resize(std::max(1, server.capacity));
+            stations[s].queue.reserve(queueCapacity);
+        }
+        Station &station = stations[s];
+        if (station.pads.size() != std::max(1, server.capacity)) {
+            resizePads(station, std::max(1, server.capacity));
+        }
+        placePads(station, server.position);
+        if (station.open != server.online) {
+            station.open = server.online;
+            for (const Waiting &waiting : station.queue) {
+                setStation(waiting.drone, -1);
+                waiting.drone->resumeLanding();
+            }
+            station.queue.clear();
+            // the pads promised to the drones on their way are taken back, they land elsewhere
+            for (Pad &pad : station.pads) {
+                if (pad.drone && !pad.landed) {
+                    setStation(pad.drone, -1);
+                    pad.drone = nullptr;
+                }
+            }
+        }
+    }
+}
+
+void LandingControl::reserve(int fleetSize) {
+    if (fleetSize <= queueCapacity) {
+        return;
+    }
+    queueCapacity = std::max(fleetSize, 2 * queueCapacity); // grows rarely
+    for (Station &station : stations) {
+        station.queue.reserve(queueCapacity);
+    }
+    slotStation.resize(queueCapacity, -1);
+}
+
+/**
+ * @brief LandingControl::resizePads the drones on the pads beyond a reduced capacity move to the
+ * free pads of the station; without a free pad a landed drone loses its pad and a drone on its
+ * way asks again on arrival. The pads added to a station are promised to its queue.
+ * @param station the station
+ * @param capacity new number of pads
+ */
+void LandingControl::resizePads(Station &station, int capacity) {
+    const int previous = station.pads.size();
+    for (int p = capacity; p < previous; p++) {
+        Pad &pad = station.pads[p];
+        if (!pad.drone) {
+            continue;
+        }
+        int q = 0;
+        while (q < capacity && station.pads[q].drone) {
+            q++;
+        }
+        if (q < capacity) {
+            station.pads[q].drone = pad.drone;
+            station.pads[q].landed = pad.landed;
+            station.pads[q].requested = pad.requested;
+        } else {
+            setStation(pad.drone, -1);
+        }
+    }
+    station.pads.resize(capacity);
+    for (int p = previous; p < capacity; p++) {
+        promiseToQueue(station, station.pads[p]);
+    }
+}
+
+void LandingControl::placePads(Station &station, const Vector2D &center) {
+    for (int k = 0; k < station.pads.size(); k++) {
+        int ring = k / 8;
+        double radius = 45.0 + 30.0 * ring;
+        double angle = 2 * M_PI * (k % 8) / 8.0 + ring * M_PI / 8.0;
+        station.pads[k].position = center + Vector2D(radius * cos(angle), radius * sin(angle));
+    }
+}
+
+void LandingControl::occupy(Drone *drone, int server) {
+    int p = freePad(stations[server]);
+    if (p >= 0) {
+        stations[server].pads[p].drone = drone;
+        stations[server].pads[p].landed = true;
+        setStation(drone, server);
+    }
+}
+
+/**
+ * @brief LandingControl::request lands the drone on the pad it was promised, or on a free pad if
+ * nobody is waiting. Otherwise a pad is reserved at the nearest server with an available one and
+ * the drone is rerouted there, or the drone joins the queue of the server.
+ * @param drone the drone
+ * @param server index of the server
+ * @param now simulation time
+ * @param spot position of the pad
+ * @param rerouteServer index of the new server
+ * @return the decision
+ */
+LandingControl::Decision LandingControl::request(Drone *drone, int server, double now, Vector2D &spot, int &rerouteServer) {
+    Station &station = stations[server];
+    for (Pad &pad : station.pads) {
+        if (pad.drone == drone) {
+            // pad given when it was freed (see release)
+            pad.landed = true;
+            worstWait = std::max(worstWait, now - pad.requested);
+            landingCount++;
+            spot = pad.position;
+            return land;
+        }
+    }
+    for (const Waiting &waiting : station.queue) {
+        if (waiting.drone == drone) {
+            return hold;
+        }
+    }
+    int p = freePad(station);
+    if (p >= 0 && station.queue.isEmpty() && station.open) {
+        Pad &pad = station.pads[p];
+        pad.drone = drone;
+        pad.landed = true;
+        pad.requested = now;
+        landingCount++;
+        spot = pad.position;
+        setStation(drone, server);
+        return land;
+    }
+    rerouteServer = nearestAvailable(server);
+    if (rerouteServer >= 0) {
+        // the pad is reserved so that the rerouted drones do not all converge on the same one
+        Pad &pad = stations[rerouteServer].pads[freePad(stations[rerouteServer])];
+        pad.drone = drone;
+        pad.landed = false;
+        pad.requested = now;
+        setStation(drone, rerouteServer);
+        return reroute;
+    }
+    station.queue.append(Waiting{drone, now});
+    setStation(drone, server);
+    return hold;
+}
+
+/**
+ * @brief LandingControl::release frees the pad of the drone and promises it to the first drone
+ * of the queue, which leaves its holding pattern to land. The station of the drone is found in
+ * slot of the drone: a drone without pad nor place (most takeoffs and new targets) costs a read.
+ * @param drone the drone
+ */
+void LandingControl::release(Drone *drone) {
+    const int s = stationOf(drone);
+    if (s < 0) {
+        return;
+    }
+    Station &station = stations[s];
+    setStation(drone, -1);
+    for (int i = 0; i < station.queue.size(); i++) {
+        if (station.queue[i].drone == drone) {
+            station.queue.remove(i);
+            return;
+        }
+    }
+    for (Pad &pad : station.pads) {
+        if (pad.drone != drone) {
+            continue;
+        }
+        pad.drone = nullptr;
+        pad.landed = false;
+        promiseToQueue(station, pad);
+        return;
+    }
+}
+
+void LandingControl::promiseToQueue(Station &station, Pad &pad) {
+    // drones that landed elsewhere meanwhile (low battery) lose their place
+    while (station.open && !station.queue.isEmpty()) {
+        Waiting next = station.queue.first();
+        station.queue.removeFirst();
+        if (next.drone->getStatus() >= Drone::hovering) {
+            pad.drone = next.drone; // same station: its index entry stays
+            pad.landed = false;
+            pad.requested = next.since;
+            next.drone->resumeLanding();
+            return;
+        }
+        setStation(next.drone, -1);
+    }
+}
+
+int LandingControl::landedAt(const Drone *drone) const {
+    const int s = stationOf(drone);
+    if (s < 0) {
+        return -1;
+    }
+    for (const Pad &pad : stations[s].pads) {
+        if (pad.drone == drone) {
+            return pad.landed ? s : -1;
+        }
+    }
+    return -1; // in the queue
+}
+
+void LandingControl::saveState(const QHash<const Drone*,int> &droneIndex, QVector<PadState> &pads, QVector<QueueState> &queues, Counters &counters) const {
+    pads.clear();
+    queues.clear();
+    for (int s = 0; s < stations.size(); s++) {
+        const Station &station = stations[s];
+        for (int p = 0; p < station.pads.size(); p++) {
+            const Pad &pad = station.pads[p];
+            int drone = pad.drone ? droneIndex.value(pad.drone, -1) : -1;
+            if (drone >= 0) {
+                pads.append(PadState{s, p, drone, pad.landed, pad.requested});
+            }
+        }
+        for (const Waiting &waiting : station.queue) {
+            int drone = droneIndex.value(waiting.drone, -1);
+            if (drone >= 0) {
+                queues.append(QueueState{s, drone, waiting.since});
+            }
+        }
+    }
+    counters = Counters{landingCount, 0, startTime, worstWait};
+}
+
+/**
+ * @brief LandingControl::restoreState the entries that do not match the stations or the fleet
+ * (corrupted snapshot) are skipped. A landed drone whose pad is beyond a reduced capacity takes
+ * a free pad of the same station; a closed station gets back neither its queue nor the pads
+ * promised to drones on their way. The queues keep their order.
+ */
+QSet<const Drone*> LandingControl::restoreState(const QVector<Drone*> &fleet, const QVector<PadState> &pads, const QVector<QueueState> &queues, const Counters &counters) {
+    QSet<const Drone*> placed;
+    for (const PadState &state : pads) {
+        if (state.server < 0 || state.server >= stations.size() || state.drone < 0 || state.drone >= fleet.size()
+                || !fleet[state.drone] || state.pad < 0) {
+            continue;
+        }
+        Station &station = stations[state.server];
+        if (!state.landed && !station.open) {
+            continue;
+        }
+        int p = state.pad < station.pads.size() && !station.pads[state.pad].drone ? state.pad : -1;
+        if (p < 0 && state.landed) {
+            p = freePad(station);
+        }
+        if (p < 0) {
+            continue;
+        }
+        Pad &pad = station.pads[p];
+        pad.drone = fleet[state.drone];
+        pad.landed = state.landed;
+        pad.requested = state.requested;
+        setStation(pad.drone, state.server);
+        placed.insert(pad.drone);
+    }
+    for (const QueueState &state : queues) {
+        if (state.server >= 0 && state.server < stations.size() && stations[state.server].open
+                && state.drone >= 0 && state.drone < fleet.size() && fleet[state.drone]) {
+            stations[state.server].queue.append(Waiting{fleet[state.drone], state.since});
+            setStation(fleet[state.drone], state.server);
+            placed.insert(fleet[state.drone]);
+        }
+    }
+    landingCount = counters.landings;
+    startTime = counters.startTime;
+    worstWait = counters.worstWait;
+    return placed;
+}
+
+int LandingControl::stationOf(const Drone *drone) const {
+    const int slot = drone->getSchedulerSlot();
+    return slot >= 0 && slot < slotStation.size() ? slotStation[slot] : -1;
+}
+
+void LandingControl::setStation(const Drone *drone, int station) {
+    const int slot = drone->getSchedulerSlot();
+    if (slot < 0) {
+        return;
+    }
+    if (slot >= slotStation.size()) {
+        slotStation.resize(slot + 1, -1); // only if the fleet was not reserved
+    }
+    slotStation[slot] = station;
+}
+
+double LandingControl::landingsPerMinute(double now) const {
+    double minutes = (now - startTime) / 60.0;
+    return minutes > 0 ? landingCount / minutes : 0;
+}
+
+double LandingControl::maxWait(double now) const {
+    double wait = worstWait;
+    for (const Station &station : stations) {
+        for (const Waiting &waiting : station.queue) {
+            wait = std::max(wait, now - waiting.since);
+        }
+        for (const Pad &pad : station.pads) {
+            if (pad.drone && !pad.landed) {
+                wait = std::max(wait, now - pad.requested);
+            }
+        }
+    }
+    return wait;
+}
+
+int LandingControl::queued() const {
+    int count = 0;
+    for (const Station &station : stations) {
+        count += station.queue.size();
+    }
+    return count;
+}
+
+int LandingControl::Station::available() const {
+    if (!open) {
+        return 0;
+    }
+    int free = 0;
+    for (const Pad &pad : pads) {
+        if (!pad.drone) free++;
+    }
+    return free - queue.size();
+}
+
+int LandingControl::freePad(const Station &station) {
+    for (int p = 0; p < station.pads.size(); p++) {
+        if (!station.pads[p].drone) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+int LandingControl::nearestAvailable(int server) const {
+    const int n = stations.size();
+    int best = -1;
+    float bestDistance = std::numeric_limits<float>::max();
+    for (int s = 0; s < n; s++) {
+        if (s == server || stations[s].available() <= 0 || world->nextHop[server * n + s] < 0) {
+            continue;
+        }
+        float d = (world->servers[s].position - world->servers[server].position).lengthSquared();
+        if (d < bestDistance) {
+            bestDistance = d;
+            best = s;
+        }
+    }
+    return best;
+}
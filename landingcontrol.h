@@ -0,0 +1,231 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef LANDINGCONTROL_H
+#define LANDINGCONTROL_H
+
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include "vector2d.h"
+
+class Drone;
+class Scenario;
+
+/**
+ * @brief LandingControl gives the landing pads of the servers to the arriving drones.
+ * Each server has capacity pads; a drone arriving at a full server is rerouted to the nearest
+ * reachable server with a free pad, or waits in a holding pattern in the FIFO queue of the
+ * server until a pad is freed by a takeoff.
+ */
+class LandingControl {
+public:
+    /**
+     * @brief Answer to a landing request
+     */
+    enum Decision { land, hold, reroute };
+    /**
+     * @brief Saved occupant of a pad (see saveState)
+     */
+    struct PadState {
+        qint32 server;    ///< index of the server
+        qint32 pad;       ///< index of the pad in the station
+        qint32 drone;     ///< index of the drone in the fleet
+        qint32 landed;    ///< 0 if the pad is promised to a drone on its way
+        double requested; ///< time of the landing request
+    };
+    /**
+     * @brief Saved place in a holding queue
+     */
+    struct QueueState {
+        qint32 server;    ///< index of the server
+        qint32 drone;     ///< index of the drone in the fleet
+        double since;     ///< time of the landing request
+    };
+    /**
+     * @brief Saved statistics
+     */
+    struct Counters {
+        qint32 landings;
+        qint32 reserved;
+        double startTime;
+        double worstWait;
+    };
+
+    /**
+     * @brief reset frees all the pads and empties the queues
+     * @param world: the servers (kept until the next reset)
+     * @param fleetSize: number of scheduler slots of the drones (the queues and the station of
+     * each drone never allocate afterwards)
+     * @param now: simulation time, start of the statistics
+     */
+    void reset(const Scenario &world, int fleetSize, double now);
+    /**
+     * @brief update follows a runtime change of the servers: a station is added for each new
+     * server, the pads follow a moved server or a new capacity and an offline server is closed
+     * (its holding drones ask again and are rerouted)
+     * @param remap: new index of each previous server, -1 if removed (see Scenario::mergeServers),
+     * empty if the servers kept their index
+     */
+    void update(const QVector<int> &remap = QVector<int>());
+    /**
+     * @brief reserve makes room in the queues for a larger fleet (drones added at runtime)
+     * @param fleetSize: number of scheduler slots of the drones
+     */
+    void reserve(int fleetSize);
+    /**
+     * @brief occupy gives a pad to a drone already landed at a server (after a reset)
+     * @param drone: the drone
+     * @param server: index of the server
+     */
+    void occupy(Drone *drone, int server);
+    /**
+     * @brief request asks for a landing at a server
+     * @param drone: the drone in the landing zone of the server
+     * @param server: index of the server
+     * @param now: simulation time
+     * @param spot: position of the pad if the decision is land
+     * @param rerouteServer: index of the new target server if the decision is reroute
+     * @return the decision
+     */
+    Decision request(Drone *drone, int server, double now, Vector2D &spot, int &rerouteServer);
+    /**
+     * @brief release frees the pad or the place in the queue of a drone (takeoff, new target,
+     * removed drone); the pad is given to the first drone of the queue. Only the station of the
+     * drone is visited.
+     * @param drone: the drone
+     */
+    void release(Drone *drone);
+
+    /**
+     * @brief saveState lists the occupied pads and the holding queues in order
+     * @param droneIndex: index of each drone in the fleet
+     * @param pads: filled with the occupied pads
+     * @param queues: filled with the queues, server by server
+     * @param counters: filled with the statistics
+     */
+    void saveState(const QHash<const Drone*,int> &droneIndex, QVector<PadState> &pads, QVector<QueueState> &queues, Counters &counters) const;
+    /**
+     * @brief restoreState gives back the pads and the places in the queues after a reset
+     * @param fleet: the drones, indexed like in saveState (nullptr for a drone that left)
+     * @param pads: the occupied pads
+     * @param queues: the holding queues
+     * @param counters: the statistics
+     * @return the drones that got back a pad or a place in a queue
+     */
+    QSet<const Drone*> restoreState(const QVector<Drone*> &fleet, const QVector<PadState> &pads, const QVector<QueueState> &queues, const Counters &counters);
+
+    /**
+     * @brief landedAt
+     * @param drone: the drone
+     * @return index of the server where the drone is landed on a pad, -1 if none
+     */
+    int landedAt(const Drone *drone) const;
+    /**
+     * @brief stationOf
+     * @param drone: the drone
+     * @return index of the server where the drone has a pad (landed or promised) or a place in
+     * the queue, -1 if none
+     */
+    int stationOf(const Drone *drone) const;
+    /**
+     * @brief stationCount
+     * @return number of servers with landing pads
+     */
+    inline int stationCount() const { return stations.size(); }
+    /**
+     * @brief landings
+     * @return number of landings since the reset
+     */
+    inline int landings() const { return landingCount; }
+    /**
+     * @brief landingsPerMinute fleet throughput since the reset
+     * @param now: simulation time
+     */
+    double landingsPerMinute(double now) const;
+    /**
+     * @brief maxWait worst wait between the landing request at a server and the landing,
+     * including the drones still waiting
+     * @param now: simulation time
+     */
+    double maxWait(double now) const;
+    /**
+     * @brief queued
+     * @return number of drones in the holding patterns
+     */
+    int queued() const;
+
+private:
+    /**
+     * @brief A landing pad, reserved when drone is set and not landed yet
+     */
+    struct Pad {
+        Vector2D position;
+        Drone *drone = nullptr;
+        bool landed = false;
+        double requested = 0; ///< time of the landing request of the drone
+    };
+    /**
+     * @brief A drone in a holding pattern
+     */
+    struct Waiting {
+        Drone *drone;
+        double since;
+    };
+    /**
+     * @brief Pads and queue of a server
+     */
+    struct Station {
+        QVector<Pad> pads;
+        QVector<Waiting> queue;
+        bool open = true; ///< false if the server is offline: no new landing
+        /**
+         * @brief available
+         * @return number of free pads not promised to the queue
+         */
+        int available() const;
+    };
+    /**
+     * @brief freePad index of a free pad of a station, -1 if full
+     */
+    static int freePad(const Station &station);
+    /**
+     * @brief placePads puts the pads of a station on rings of 8 around its server
+     */
+    static void placePads(Station &station, const Vector2D &center);
+    /**
+     * @brief resizePads follows a new capacity of a server
+     * @param station: the station
+     * @param capacity: new number of pads
+     */
+    void resizePads(Station &station, int capacity);
+    /**
+     * @brief promiseToQueue gives a free pad to the first drone of the queue still in the air
+     * @param station: the station
+     * @param pad: the free pad
+     */
+    void promiseToQueue(Station &station, Pad &pad);
+    /**
+     * @brief nearestAvailable the closest server reachable from server with an available pad
+     * @return its index, -1 if none
+     */
+    int nearestAvailable(int server) const;
+    /**
+     * @brief setStation records the station of a drone, indexed by its scheduler slot
+     * @param drone: the drone
+     * @param station: index of the server, -1 for none
+     */
+    void setStation(const Drone *drone, int station);
+
+    const Scenario *world = nullptr; ///< servers and routing table
+    QVector<Station> stations;       ///< pads and queue of each server
+    QVector<int> slotStation;        ///< station of the drone of each scheduler slot (see stationOf)
+    int queueCapacity = 0;           ///< room reserved in each queue
+    int landingCount = 0;            ///< landings since the reset
+    double startTime = 0;            ///< time of the reset
+    double worstWait = 0;            ///< worst wait of the landed drones
+};
+
+#endif // LANDINGCONTROL_H
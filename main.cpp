@@ -1,11 +1,91 @@
-#include "mainwindow.h"
-
-#include <QApplication>
-
-int main(int argc, char *argv[])
-{
-    QApplication a(argc, argv);
-    MainWindow w;
-    w.show();
-    return a.exec();
-}
+#include "benchmark.h"
+#include "mainwindow.h"
+#include "sharedstate.h"
+#include "tilestore.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <cmath>
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Drone fleet simulation");
+    parser.addHelpOption();
+    QCommandLineOption headlessOption("headless", "Run the simulation without window (see drones_viewer).");
+    QCommandLineOption scenarioOption("scenario", "Load the scenario <file> at start.", "file");
+    QCommandLineOption shmOption("shm", "Export the state in the shared memory segment <name> (\"none\" to disable).",
+                                 "name", SharedState::defaultName);
+    QCommandLineOption warpOption("warp", "Run <factor> simulated seconds per wall second (0: as fast as possible).",
+                                  "factor", "1");
+    QCommandLineOption shardsOption("shards", "Simulate the scenario in <count> worker processes (regions of servers).", "count");
+    QCommandLineOption workerOption("shard-worker", "Run the shard <index> for a hub (started by --shards).", "index");
+    QCommandLineOption shardCountOption("shard-count", "Number of shards of the hub.", "count", "1");
+    QCommandLineOption hubOption("shard-hub", "Local socket <name> of the hub.", "name");
+    QCommandLineOption launchOption("shard-launch", "Take off all the drones of the shard at start (see --bench shards).");
+    QCommandLineOption canvasOption("canvas", "Size <width>x<height> of the world of the hub.", "size");
+    QCommandLineOption tilesOption("tiles", "Keep the regions of the whole world in the tile store <file> (built if needed).", "file");
+    QCommandLineOption tileBudgetOption("tile-budget", "Memory for the mapped tiles, in MB.", "MB", "64");
+    QCommandLineOption tileCellOption("tile-cell", "World units per cell of a new tile store.", "units",
+                                      QString::number(TileStore::defaultCellSize));
+    parser.addOption(headlessOption);
+    parser.addOption(warpOption);
+    parser.addOption(scenarioOption);
+    parser.addOption(shmOption);
+    parser.addOption(shardsOption);
+    parser.addOption(workerOption);
+    parser.addOption(shardCountOption);
+    parser.addOption(hubOption);
+    parser.addOption(launchOption);
+    parser.addOption(canvasOption);
+    parser.addOption(tilesOption);
+    parser.addOption(tileBudgetOption);
+    QCommandLineOption benchOption("bench", "Run the benchmark <name> (" + Benchmark::names().join(", ") + ") and quit.", "name");
+    QCommandLineOption benchSizeOption("bench-size", "Number of drones of the benchmark (default: several sizes).", "drones", "0");
+    parser.addOption(tileCellOption);
+    parser.addOption(benchOption);
+    parser.addOption(benchSizeOption);
+    parser.process(a);
+
+    if (parser.isSet(benchOption)) {
+        return Benchmark::run(parser.value(benchOption), parser.value(benchSizeOption).toInt());
+    }
+    bool warpOk;
+    const double warp = parser.value(warpOption).toDouble(&warpOk);
+    if (!warpOk || warp < 0 || !std::isfinite(warp)) {
+        qCritical().noquote() << "Invalid --warp" << parser.value(warpOption) << ": expected a factor >= 0";
+        return 1;
+    }
+
+    MainWindow w;
+    if (parser.isSet(workerOption)) {
+        // a worker only talks to its hub
+        const QStringList size = parser.value(canvasOption).split('x');
+        w.joinShard(parser.value(hubOption), parser.value(workerOption).toInt(), parser.value(shardCountOption).toInt(),
+                    QSize(size.value(0).toInt(), size.value(1).toInt()), parser.isSet(launchOption));
+    } else {
+        w.listen();
+    }
+    if (parser.value(shmOption) != "none") {
+        w.exportState(parser.value(shmOption));
+    }
+    if (parser.isSet(tilesOption)) {
+        w.useTileStore(parser.value(tilesOption), qint64(parser.value(tileBudgetOption).toDouble() * (1 << 20)),
+                       parser.value(tileCellOption).toFloat());
+    }
+    if (parser.isSet(scenarioOption)) {
+        w.loadScenario(parser.value(scenarioOption));
+    }
+    w.setTimeWarp(warp);
+    if (parser.isSet(shardsOption)) {
+        w.startShards(parser.value(shardsOption).toInt());
+    }
+    if (parser.isSet(headlessOption)) {
+        w.setHeadless(true);
+    } else {
+        w.show();
+    }
+    return a.exec();
+}
@@ -1,102 +1,795 @@
-#include "mainwindow.h"
-#include "ui_mainwindow.h"
-#include <QListWidgetItem>
-#include <QPushButton>
-
-MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent)
-    , ui(new Ui::MainWindow)
-{
-    ui->setupUi(this);
-
-    /* preset initial positions of the drones */
-    const QVector<Vector2D> tabPos={{60,80},{400,700},{50,250},{800,800},{700,50}};
-
-    int n=0;
-    for (auto &pos:tabPos) {
-        QListWidgetItem *LWitems=new QListWidgetItem(ui->listDronesInfo);
-        ui->listDronesInfo->addItem(LWitems);
-        QString name="Drone"+QString::number(++n);
-        //mapDrones[name]=new Drone(name);
-        mapDrones[name] = new Drone(name, ui->widget);
-
-        mapDrones[name]->setInitialPosition(pos);
-        ui->listDronesInfo->setItemWidget(LWitems,mapDrones[name]);
-    }
-
-    ui->widget->setMap(&mapDrones);
-    // Connect the "Load" button to loadJsonData
-    connect(ui->actionLoad, &QAction::triggered, [this]() {
-        ui->widget->loadJsonData(); // Call the Canvas method to load JSON
-         refreshDronesUI();
-    });
-
-
-    timer = new QTimer(this);
-    timer->setInterval(100);
-    connect(timer,SIGNAL(timeout()),this,SLOT(update()));
-    timer->start();
-
-    elapsedTimer.start();
-}
-
-
-MainWindow::~MainWindow() {
-    delete ui;
-    delete timer;
-}
-
-void MainWindow::on_actionQuit_triggered()
-{
-    QApplication::quit();
-}
-
-void MainWindow::update() {
-    static int last=elapsedTimer.elapsed();
-    static int steps=10;
-    int current=elapsedTimer.elapsed();
-    double dt=(current-last)/(1000.0*steps);
-    for (int step=0; step<steps; step++) {
-        // update positions of drones
-        for (auto &drone:mapDrones) {
-            ui->widget->updateDroneTarget(drone);// Update the drone's target based on server connections
-
-            // detect collisions between drone and other flying drones
-            if (drone->getStatus()!=Drone::landed) {
-                drone->initCollision();
-                for (auto &obs:mapDrones) {
-                    if (obs->getStatus()!=Drone::landed && obs->getName()!=drone->getName()) {
-                        Vector2D B=obs->getPosition();
-                        drone->addCollision(B,ui->widget->droneCollisionDistance);
-                    }
-                }
-            }
-            drone->update(dt);
-        }
-    }
-    int d = elapsedTimer.elapsed()-current;
-    ui->statusbar->showMessage("duree:"+QString::number(d)+" steps="+QString::number(steps));
-    if (d>90) {
-        steps/=2;
-    } else {
-
-        if (steps<10) steps++;
-    }
-    last=current;
-    ui->widget->repaint();
-}
-
-void MainWindow::refreshDronesUI() {
-    // Clear the current drone list in the UI
-    ui->listDronesInfo->clear();
-
-    // Rebuild the drone list with updated drones from the map
-    for (auto &drone : mapDrones) {
-        QListWidgetItem *LWitem = new QListWidgetItem(ui->listDronesInfo);
-        ui->listDronesInfo->addItem(LWitem);
-        ui->listDronesInfo->setItemWidget(LWitem, drone);
-    }
-
-    // Update the canvas to reflect changes
-    ui->widget->update();
-}
+#include "mainwindow.h"
+#include "ui_mainwindow.h"
+#include <QListWidgetItem>
+#include <QPushButton>
+#include <QProgressBar>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QInputDialog>
+#include <QSlider>
+#include <QSet>
+#include <QComboBox>
+#include <QDebug>
+#include "alloccounter.h"
+#include "tilestore.h"
+#include <algorithm>
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent)
+    , ui(new Ui::MainWindow)
+{
+    ui->setupUi(this);
+
+    /* preset initial positions of the drones */
+    const QVector<Vector2D> tabPos={{60,80},{400,700},{50,250},{800,800},{700,50}};
+
+    int n=0;
+    for (auto &pos:tabPos) {
+        QListWidgetItem *LWitems=new QListWidgetItem(ui->listDronesInfo);
+        ui->listDronesInfo->addItem(LWitems);
+        QString name="Drone"+QString::number(++n);
+        //mapDrones[name]=new Drone(name);
+        mapDrones[name] = new Drone(name, ui->widget);
+        mapDrones[name]->setScheduler(&scheduler);
+
+        mapDrones[name]->setInitialPosition(pos);
+        ui->listDronesInfo->setItemWidget(LWitems,mapDrones[name]);
+    }
+
+    ui->widget->setMap(&mapDrones);
+    ui->widget->setScheduler(&scheduler);
+
+    // scenarios are loaded in the background and swapped in at the next tick
+    loader = new ScenarioLoader(this);
+    loadPB = new QProgressBar(this);
+    loadPB->setRange(0,100);
+    loadPB->setFormat(tr("loading %p%"));
+    loadPB->setMaximumWidth(200);
+    cancelLoadBt = new QPushButton(tr("Cancel"),this);
+    ui->statusbar->addPermanentWidget(loadPB);
+    ui->statusbar->addPermanentWidget(cancelLoadBt);
+    loadPB->hide();
+    cancelLoadBt->hide();
+    connect(loader,&ScenarioLoader::progress,loadPB,&QProgressBar::setValue);
+    connect(loader,&ScenarioLoader::loaded,this,&MainWindow::scenarioLoaded);
+    connect(loader,&ScenarioLoader::failed,this,&MainWindow::scenarioFailed);
+    connect(cancelLoadBt,&QPushButton::clicked,this,&MainWindow::cancelLoading);
+
+    // snapshots are copied between two ticks and written in the background
+    snapshotWriter = new SnapshotWriter(this);
+    connect(snapshotWriter,&SnapshotWriter::saved,[](const QString &path) {
+        qDebug() << "Snapshot saved:" << path;
+    });
+    connect(snapshotWriter,&SnapshotWriter::failed,[this](const QString &message) {
+        QMessageBox::warning(this, tr("Save snapshot"), message);
+    });
+
+    // scrubbing of the replayed trace
+    replaySlider = new QSlider(Qt::Horizontal,this);
+    replaySlider->setMaximumWidth(300);
+    ui->statusbar->addPermanentWidget(replaySlider);
+    replaySlider->hide();
+    connect(replaySlider,&QSlider::valueChanged,[this](int value) {
+        const TraceReader &replay=ui->widget->getReplay();
+        double t=ui->widget->seekReplay(replay.startTime()+value/1000.0);
+        ui->statusbar->showMessage("replay t="+QString::number(t,'f',1)+"s / "+QString::number(replay.endTime(),'f',1)+"s");
+    });
+
+    // time warp: the simulation runs ahead of the wall clock, the display is throttled
+    warpCB = new QComboBox(this);
+    warpCB->addItem(tr("x1"),1.0);
+    warpCB->addItem(tr("x10"),10.0);
+    warpCB->addItem(tr("x100"),100.0);
+    warpCB->addItem(tr("max"),0.0);
+    ui->statusbar->addPermanentWidget(warpCB);
+    connect(warpCB,QOverload<int>::of(&QComboBox::currentIndexChanged),[this](int index) {
+        setTimeWarp(warpCB->itemData(index).toDouble());
+    });
+
+    // Connect the "Load" button to the background loader
+    connect(ui->actionLoad, &QAction::triggered, [this]() {
+        QString filePath = QFileDialog::getOpenFileName(this, tr("Open JSON File"), "",
+                                                        tr("JSON Files (*.json);;All Files (*)"));
+        if (filePath.isEmpty()) {
+            QMessageBox::warning(this, tr("File Error"), tr("No file selected."));
+            return;
+        }
+        loadScenario(filePath);
+    });
+    // Reload the same file and apply only the differences to the running world
+    connect(ui->actionReload, &QAction::triggered, [this]() {
+        if (scenarioPath.isEmpty()) {
+            QMessageBox::warning(this, tr("File Error"), tr("No scenario to reload."));
+            return;
+        }
+        loadPB->setValue(0);
+        loadPB->show();
+        cancelLoadBt->show();
+        loader->load(scenarioPath, QSize(), false);
+    });
+    // Take a server down or back up without reloading the scenario
+    connect(ui->actionToggleServer, &QAction::triggered, [this]() {
+        bool ok;
+        QString name = QInputDialog::getText(this, tr("Toggle server"), tr("Server name:"),
+                                             QLineEdit::Normal, "", &ok).trimmed();
+        if (!ok || name.isEmpty()) {
+            return;
+        }
+        const Scenario &world = ui->widget->getWorld();
+        int index = world.serverIndex.value(name, -1);
+        if (index < 0) {
+            QMessageBox::warning(this, tr("Toggle server"), tr("Unknown server %1.").arg(name));
+            return;
+        }
+        if (ui->widget->setServerOnline(name, !world.servers[index].online)) {
+            exporter.reset();
+        }
+    });
+    // Save the running world to resume it later
+    connect(ui->actionSaveSnapshot, &QAction::triggered, [this]() {
+        QString filePath = QFileDialog::getSaveFileName(this, tr("Save snapshot"), "",
+                                                        tr("World snapshots (*.dsnap);;All Files (*)"));
+        if (filePath.isEmpty()) {
+            return;
+        }
+        QElapsedTimer copyTimer;
+        copyTimer.start();
+        std::unique_ptr<WorldSnapshot> snapshot(new WorldSnapshot);
+        ui->widget->captureSnapshot(*snapshot);
+        qDebug() << "Snapshot of" << snapshot->drones.size() << "drones copied in" << copyTimer.elapsed() << "ms";
+        snapshotWriter->save(std::move(snapshot), filePath);
+    });
+    // Resume a saved world instead of the running one
+    connect(ui->actionRestoreSnapshot, &QAction::triggered, [this]() {
+        QString filePath = QFileDialog::getOpenFileName(this, tr("Restore snapshot"), "",
+                                                        tr("World snapshots (*.dsnap);;All Files (*)"));
+        if (filePath.isEmpty()) {
+            return;
+        }
+        QElapsedTimer restoreTimer;
+        restoreTimer.start();
+        WorldSnapshot snapshot;
+        QString error;
+        if (!snapshot.read(filePath, error)) {
+            QMessageBox::warning(this, tr("Restore snapshot"), error);
+            return;
+        }
+        qint64 read = restoreTimer.elapsed();
+        if (recorder.isRecording()) {
+            recorder.stop();
+            ui->actionRecord->setChecked(false);
+        }
+        missions.clear();
+        ui->widget->restoreSnapshot(snapshot);
+        refreshDronesUI();
+        fleetChanged();
+        steadyTicks=0;
+        droneSteps=uniformDroneSteps=0;
+        // the clock jumped to the time of the snapshot: the rate is measured again from there
+        rateStart=scheduler.now();
+        rateTimer.restart();
+        qDebug() << "Snapshot of" << snapshot.drones.size() << "drones read in" << read << "ms, restored in" << restoreTimer.elapsed() << "ms";
+    });
+    // Record the fleet at each tick until unchecked or the scenario changes
+    connect(ui->actionRecord, &QAction::triggered, [this](bool checked) {
+        if (!checked) {
+            recorder.stop();
+            return;
+        }
+        QString filePath = QFileDialog::getSaveFileName(this, tr("Record trace"), "",
+                                                        tr("Drone traces (*.dtrace);;All Files (*)"));
+        QStringList servers;
+        for (const Server &server : ui->widget->getWorld().servers) {
+            servers.append(server.name);
+        }
+        if (filePath.isEmpty() || !recorder.start(filePath, fleet(), servers, scheduler.now())) {
+            ui->actionRecord->setChecked(false);
+        }
+    });
+    // Show a recorded trace, scrubbed with the slider of the status bar
+    connect(ui->actionReplay, &QAction::triggered, [this](bool checked) {
+        if (!checked) {
+            ui->widget->stopReplay();
+            replaySlider->hide();
+            return;
+        }
+        QString filePath = QFileDialog::getOpenFileName(this, tr("Replay trace"), "",
+                                                        tr("Drone traces (*.dtrace);;All Files (*)"));
+        if (filePath.isEmpty() || !ui->widget->startReplay(filePath)) {
+            ui->actionReplay->setChecked(false);
+            return;
+        }
+        const TraceReader &replay=ui->widget->getReplay();
+        replaySlider->setRange(0,int((replay.endTime()-replay.startTime())*1000));
+        replaySlider->setValue(0);
+        replaySlider->show();
+    });
+    // Show where the drones flew recently
+    connect(ui->actionHeatmap, &QAction::toggled, ui->widget, &Canvas::setHeatmapVisible);
+    // Send the landed drones to a batch of servers
+    connect(ui->actionDispatch, &QAction::triggered, [this]() {
+        bool ok;
+        QString text = QInputDialog::getText(this, tr("Dispatch missions"),
+                                             tr("Target servers (separated by commas):"),
+                                             QLineEdit::Normal, "", &ok);
+        if (!ok || text.isEmpty()) {
+            return;
+        }
+        QStringList targets = text.split(',', Qt::SkipEmptyParts);
+        const QStringList objectives = {tr("Shortest total distance"), tr("Shortest longest flight")};
+        QString objective = QInputDialog::getItem(this, tr("Dispatch missions"), tr("Minimize:"),
+                                                  objectives, 0, false, &ok);
+        if (!ok) {
+            return;
+        }
+        int assigned = ui->widget->dispatchMissions(targets, objective == objectives[0] ? MissionDispatcher::minimizeTotal
+                                                                                        : MissionDispatcher::minimizeMakespan);
+        QMessageBox::information(this, tr("Dispatch missions"),
+                                 tr("%1 of %2 missions assigned.").arg(assigned).arg(targets.size()));
+    });
+
+
+    fleetChanged();
+    missions.setWorld(&ui->widget->getWorld());
+    missions.setLanding(&ui->widget->getLanding());
+
+    timer = new QTimer(this);
+    timer->setInterval(100);
+    connect(timer,SIGNAL(timeout()),this,SLOT(update()));
+    timer->start();
+
+    elapsedTimer.start();
+    rateTimer.start();
+}
+
+
+MainWindow::~MainWindow() {
+    // the drones are deleted with the widgets, after the scheduler
+    for (auto &drone:mapDrones) {
+        drone->setScheduler(nullptr);
+    }
+    delete ui;
+    delete timer;
+}
+
+void MainWindow::on_actionQuit_triggered()
+{
+    QApplication::quit();
+}
+
+void MainWindow::update() {
+    static int last=elapsedTimer.elapsed();
+    // swap in the scenario loaded in the background at the tick boundary
+    if (pendingScenario) {
+        if (pendingIsComplete) {
+            missions.clear();
+            ui->widget->applyScenario(*pendingScenario);
+            refreshDronesUI();
+        } else {
+            QVector<Drone*> added,removed;
+            Scenario::ServerDiff diff=ui->widget->mergeScenario(*pendingScenario,added,removed);
+            missions.drop(removed);
+            removeDronesUI(removed);
+            addDronesUI(added);
+            qDebug() << "Reloaded: servers +" << diff.added << "-" << diff.removed << "moved" << diff.moved
+                     << "recolored" << diff.recolored << ", drones +" << added.size() << "-" << removed.size();
+        }
+        pendingScenario.reset();
+        fleetChanged();
+        if (recorder.isRecording()) {
+            recorder.stop(); // the trace keeps the fleet it started with
+            ui->actionRecord->setChecked(false);
+        }
+        steadyTicks=0;
+        droneSteps=uniformDroneSteps=0;
+        if (shardWorker) {
+            enterShard();
+        } else if (shardHub) {
+            // the workers cannot merge a reload, they start again on the file
+            shardHub->start(shardCount,scenarioPath,ui->widget->size());
+        }
+    }
+    if (shardWorker) {
+        return; // the ticks are sent by the hub (see shardTick)
+    }
+    if (shardHub) {
+        // the workers simulate, this window only shows their drones
+        if (headless || !shardHub->isRunning() || (displayTimer.isValid() && displayTimer.elapsed()<displayInterval)) {
+            return;
+        }
+        displayTimer.start();
+        shardHub->requestSamples();
+        ui->statusbar->showMessage("shards:"+QString::number(shardHub->shardCount())
+                                   +" t="+QString::number(shardHub->time(),'f',1)+"s"
+                                   +" ticks/s:"+QString::number(shardHub->tickRate(),'f',1)
+                                   +" drones:"+QString::number(shardHub->drones())
+                                   +" drone-ticks/s:"+QString::number(shardHub->droneRate(),'f',0)
+                                   +" handoffs/s:"+QString::number(shardHub->handoffRate(),'f',1));
+        ui->widget->repaint();
+        return;
+    }
+    int current=elapsedTimer.elapsed();
+    if (ui->widget->isReplaying()) {
+        last=current; // the simulation is paused while a trace is shown
+        return;
+    }
+    // wall time since the last update
+    double dt=(current-last)/1000.0;
+    last=current;
+    if (timeWarp==1) {
+        advance(dt);
+    } else {
+        // fixed ticks in batches, for a slice of wall time; the display is throttled below
+        warpBudget=timeWarp>0 ? std::min(warpBudget+dt*timeWarp,timeWarp*maxWarpLag) : 0;
+        QElapsedTimer batchTimer;
+        batchTimer.start();
+        while ((timeWarp<=0 || warpBudget>=warpStep) && batchTimer.elapsed()<warpSlice) {
+            advance(warpStep);
+            warpBudget-=warpStep;
+        }
+    }
+    telemetry.publish(scheduler.now(),ui->widget->getWorld());
+    exporter.publish(scheduler.now(),currentFleet,ui->widget->getWorld(),ui->widget->size());
+    // simulated seconds per wall second, over about one second
+    if (rateTimer.elapsed()>=1000) {
+        achievedRate=(scheduler.now()-rateStart)*1000.0/rateTimer.restart();
+        rateStart=scheduler.now();
+    }
+    if (headless || (timeWarp!=1 && displayTimer.isValid() && displayTimer.elapsed()<displayInterval)) {
+        return;
+    }
+    displayTimer.start();
+    for (auto &drone:mapDrones) {
+        drone->refreshDisplay();
+    }
+    int d = elapsedTimer.elapsed()-current;
+    const LandingControl &landing=ui->widget->getLanding();
+    const EnergyPlanner &planner=ui->widget->getPlanner();
+    int plans=planner.cacheHits()+planner.cacheMisses();
+    // drone-steps saved by the local time stepping since the scenario was loaded
+    double saved = uniformDroneSteps>0 ? 100.0*(uniformDroneSteps-droneSteps)/uniformDroneSteps : 0;
+    QString tiles;
+    if (const TileStore *store=ui->widget->getWorld().tiles.get()) {
+        tiles=" tiles:"+QString::number(store->stats().resident)+"/"+QString::number(store->stats().capacity)
+             +" paged:"+QString::number(store->stats().mapped);
+    }
+    ui->statusbar->showMessage("duree:"+QString::number(d)+" sim/wall:"+QString::number(achievedRate,'f',1)
+                               +" drone-steps:"+QString::number(droneSteps)
+                               +"/"+QString::number(uniformDroneSteps)+" saved:"+QString::number(saved,'f',1)+"%"
+                               +" landings/min:"+QString::number(landing.landingsPerMinute(scheduler.now()),'f',1)
+                               +" holding:"+QString::number(landing.queued())
+                               +" max wait:"+QString::number(landing.maxWait(scheduler.now()),'f',1)+"s"
+                               +" plans cached:"+QString::number(plans>0 ? 100.0*planner.cacheHits()/plans : 0,'f',1)+"%"
+                               +" missions:"+QString::number(missions.count())
+                               +" cmds/s:"+QString::number(commands.stats().applied)
+                               +" cmd latency:"+QString::number(commands.stats().meanLatency,'f',1)
+                               +"/"+QString::number(commands.stats().maxLatency,'f',1)+"ms"+tiles);
+    ui->widget->repaint();
+}
+
+/**
+ * @brief MainWindow::advance runs one tick: the missions and the received commands at the tick
+ * boundary, the simulation step, then the trace
+ * @param dt: duration of the tick in seconds
+ */
+void MainWindow::advance(double dt) {
+    // the missions waiting for the landings of the last tick or for this time go on
+    missionCommands.resize(0);
+    missions.run(scheduler.now(),scheduler.landedDrones(),missionCommands);
+    scheduler.clearLanded();
+    if (!missionCommands.isEmpty()) {
+        QVector<Drone*> added,removed; // the missions only move their drones
+        ui->widget->applyCommands(missionCommands,added,removed);
+    }
+    // the commands received since the last tick are applied at the tick boundary
+    int done=0;
+    if (commands.take(commandBatch)>0) {
+        QVector<Drone*> added,removed;
+        done=ui->widget->applyCommands(commandBatch,added,removed);
+        done+=startTours(commandBatch);
+        if (!added.isEmpty() || !removed.isEmpty()) {
+            missions.drop(removed);
+            removeDronesUI(removed);
+            addDronesUI(added);
+            fleetChanged();
+            if (recorder.isRecording()) {
+                recorder.stop(); // the trace keeps the fleet it started with
+                ui->actionRecord->setChecked(false);
+            }
+            steadyTicks=0;
+        }
+    }
+    commands.applied(commandBatch,done);
+    // the collisions are swept over the whole step of each drone (see Drone::addCollision)
+    {
+        // once warmed up, the step must not allocate (checked with CONFIG+=alloc_counter)
+        AllocGuard guard(steadyTicks++>1);
+        simulationStep(dt);
+    }
+    ui->widget->recordTraffic(scheduler.activeDrones(),scheduler.now(),dt);
+    recorder.record(scheduler.now(),ui->widget->getWorld().serverIndex);
+}
+
+/**
+ * @brief MainWindow::scenarioLoaded keeps the loaded scenario until the next tick
+ * @param generation the load, ignored if another load was started or canceled since
+ */
+void MainWindow::scenarioLoaded(quint64 generation) {
+    bool complete=true;
+    std::unique_ptr<Scenario> scenario=loader->takeResult(generation,complete);
+    if (!scenario) {
+        return;
+    }
+    pendingIsComplete = complete;
+    pendingScenario = std::move(scenario);
+    loadPB->hide();
+    cancelLoadBt->hide();
+}
+
+/**
+ * @brief MainWindow::scenarioFailed reports a load error, the current world is kept
+ * @param message the error message
+ * @param generation the load, ignored if another load was started or canceled since
+ */
+void MainWindow::scenarioFailed(const QString &message, quint64 generation) {
+    if (generation != loader->currentGeneration()) {
+        return;
+    }
+    loadPB->hide();
+    cancelLoadBt->hide();
+    if (headless) {
+        qDebug() << "Scenario error:" << message;
+        return;
+    }
+    QMessageBox::critical(this, tr("JSON Error"), message);
+}
+
+/**
+ * @brief MainWindow::cancelLoading stops the background load
+ */
+void MainWindow::cancelLoading() {
+    loader->cancel();
+    loadPB->hide();
+    cancelLoadBt->hide();
+    ui->statusbar->showMessage(tr("Loading canceled"),2000);
+}
+
+QVector<Drone*> MainWindow::fleet() const {
+    QVector<Drone*> drones;
+    drones.reserve(mapDrones.size());
+    for (Drone *drone : mapDrones) {
+        drones.append(drone);
+    }
+    return drones;
+}
+
+void MainWindow::fleetChanged() {
+    currentFleet = fleet();
+    telemetry.setFleet(currentFleet, ui->widget->getWorld());
+    exporter.reset();
+}
+
+/**
+ * @brief MainWindow::startTours starts the tour missions of a batch of commands
+ * @param batch the commands
+ * @return the number of started missions
+ */
+int MainWindow::startTours(const QVector<DroneCommand> &batch) {
+    int started=0;
+    const Scenario &world=ui->widget->getWorld();
+    for (const DroneCommand &command : batch) {
+        if (command.kind!=DroneCommand::tour) {
+            continue;
+        }
+        Drone *drone=mapDrones.value(command.key(0),nullptr);
+        if (!drone) {
+            continue;
+        }
+        // the mission keeps its servers: the names of the world are shared
+        QStringList servers;
+        for (int i=1; i<command.nameCount; i++) {
+            const int index=world.serverIndex.value(command.key(i),-1);
+            if (index<0) {
+                break;
+            }
+            servers.append(world.servers[index].name);
+        }
+        if (servers.size()!=command.nameCount-1) {
+            continue;
+        }
+        missions.start(drone,Missions::tour(servers,tourCharge,tourDwell));
+        started++;
+    }
+    return started;
+}
+
+void MainWindow::loadScenario(const QString &filePath) {
+    scenarioPath = filePath;
+    loadPB->setValue(0);
+    loadPB->show();
+    cancelLoadBt->show();
+    loader->load(filePath, ui->widget->size());
+}
+
+bool MainWindow::exportState(const QString &name) {
+    if (!exporter.open(name)) {
+        return false;
+    }
+    qDebug() << "State exported in" << name;
+    return true;
+}
+
+void MainWindow::setTimeWarp(double factor) {
+    timeWarp = factor;
+    warpBudget = 0;
+    // as fast as possible: the ticks go on as soon as the events are processed
+    timer->setInterval(timeWarp == 1 ? 100 : timeWarp > 0 ? 10 : 0);
+    if (shardHub) {
+        shardHub->setPace(factor);
+    }
+    int index = warpCB->findData(factor);
+    if (index >= 0 && index != warpCB->currentIndex()) {
+        warpCB->setCurrentIndex(index);
+    }
+}
+
+void MainWindow::useTileStore(const QString &path, qint64 budgetBytes, float cellSize) {
+    loader->setTileStore(path, budgetBytes, cellSize);
+}
+
+void MainWindow::listen() {
+    // dashboards and loggers subscribe to the drone states on a local socket
+    telemetry.listen("drones-telemetry");
+    // scripts and fleet managers command the drones on another local socket
+    commands.listen("drones-commands");
+}
+
+void MainWindow::startShards(int count) {
+    shardCount = std::clamp(count, 1, Shard::maxShards);
+    if (!shardHub) {
+        shardHub = new ShardHub(this);
+        shardHub->setPace(timeWarp);
+        ui->widget->showShards(&shardHub->samples());
+    }
+}
+
+void MainWindow::joinShard(const QString &hubName, int shard, int count, const QSize &canvasSize, bool launch) {
+    shardHubName = hubName;
+    shardIndex = shard;
+    shardLaunch = launch;
+    shardCount = std::clamp(count, 1, Shard::maxShards);
+    if (canvasSize.isValid()) {
+        ui->widget->setFixedSize(canvasSize); // the same Voronoi raster as the hub and the other shards
+    }
+    shardWorker = new ShardWorker(this);
+    connect(shardWorker, &ShardWorker::tick, this, &MainWindow::shardTick);
+    connect(shardWorker, &ShardWorker::hubLost, []() { QApplication::quit(); });
+}
+
+void MainWindow::setHeadless(bool on) {
+    headless = on;
+    if (headless) {
+        hide();
+    }
+}
+
+/**
+ * @brief MainWindow::simulationStep advances the simulation of one tick with local time
+ * stepping: each active drone takes its own number of steps (a power of 2, see
+ * Drone::chooseSubsteps), all the drones are synchronized at the end of the tick.
+ * @param dt: duration of the tick in seconds
+ */
+void MainWindow::simulationStep(double dt) {
+    // trigger the transitions due in this tick (takeoff complete, landed, charged, battery low)
+    scheduler.runUntil(scheduler.now()+dt);
+    // only hovering and flying drones are stepped, the others evolve analytically
+    const QVector<Drone*> &active=scheduler.activeDrones();
+    // Update the drones' targets based on server connections (whole fleet located at once)
+    ui->widget->updateDroneTargets(active);
+    const float collisionDistance=ui->widget->droneCollisionDistance;
+    avoidance.prepare(mapDrones,active,collisionDistance);
+    // step of each drone from its free space
+    int substepsPerTick=1;
+    for (int i=0; i<active.size(); i++) {
+        // beyond this distance the neighbours do not reduce the step
+        float searchDistance=collisionDistance+float(2*dt*active[i]->type().maxSpeed);
+        int n=active[i]->chooseSubsteps(avoidance.nearestDistance(i,searchDistance),collisionDistance,dt);
+        substepsPerTick=std::max(substepsPerTick,n);
+        droneSteps+=n;
+    }
+    // baseline: every drone stepped as finely as the most constrained one
+    uniformDroneSteps+=qint64(substepsPerTick)*active.size();
+    for (int s=0; s<substepsPerTick; s++) {
+        if (s>0) {
+            // only the drones stepped in the previous substep moved
+            avoidance.advance(s,substepsPerTick);
+        }
+        // collision free velocities from the nearest neighbours (marks the collisions too)
+        avoidance.computeVelocities(dt,s,substepsPerTick);
+        // backward loop: a drone that lands leaves the list and is replaced by the last one
+        for (int i=active.size()-1; i>=0; i--) {
+            Drone *drone=active[i];
+            if (drone->isDueAt(s,substepsPerTick)) {
+                drone->update(dt/drone->getSubsteps());
+            }
+        }
+        // landing pads, holding patterns and reroutes of the drones that reached their landing zone
+        ui->widget->admitLandings(active);
+    }
+}
+
+/**
+ * @brief MainWindow::enterShard splits the servers like every other process (see ShardPlan),
+ * removes the drones of the other shards and tells the hub that this shard is ready
+ */
+void MainWindow::enterShard() {
+    const Scenario &world=ui->widget->getWorld();
+    shardPlan.build(world,shardCount);
+    QVector<Drone*> others;
+    for (Drone *drone : currentFleet) {
+        // without server everything is simulated by shard 0
+        if (std::max(0,shardPlan.shardAt(world,drone->getPosition()))!=shardIndex) {
+            others.append(drone);
+        }
+    }
+    ui->widget->releaseDrones(others);
+    removeDronesUI(others);
+    fleetChanged();
+    if (shardLaunch) {
+        // a start command for each drone, like a client would send
+        QVector<DroneCommand> launch(currentFleet.size());
+        for (int i=0; i<currentFleet.size(); i++) {
+            launch[i].kind=DroneCommand::start;
+            launch[i].addName(currentFleet[i]->getName());
+        }
+        QVector<Drone*> added,removed;
+        ui->widget->applyCommands(launch,added,removed);
+    }
+    shardGhosts.fill(QVector<ShardGhost>(),shardCount);
+    shardHandoffs.fill(QVector<ShardHandoff>(),shardCount);
+    qDebug() << "Shard" << shardIndex << ":" << currentFleet.size() << "drones, load" << shardPlan.shardLoad(shardIndex);
+    if (!shardWorker->connectTo(shardHubName,shardIndex,shardCount)) {
+        QTimer::singleShot(0,[]() { QApplication::quit(); });
+    }
+}
+
+/**
+ * @brief MainWindow::shardTick runs a tick of the hub in a worker. The drones handed off at the
+ * last tick join first and the ghosts (drones of the other shards near the borders, one tick old)
+ * are avoided during the step. Then a drone handoffMargin inside the regions of another shard is
+ * handed off (closer to the border it stays here, so a drone flying along a border is not handed
+ * back and forth), and a flying drone is sent as a ghost to each other shard whose regions may
+ * be within its avoidance reach (see ShardPlan::shardsWithin). A handed off drone is also a ghost
+ * of this shard: it only comes back as a ghost from its new shard after the next tick.
+ * @param dt duration of the tick
+ * @param wantSamples true to send the drones to the hub
+ */
+void MainWindow::shardTick(double dt, bool wantSamples) {
+    QVector<Drone*> added;
+    for (const ShardHandoff &handoff : shardWorker->handoffs()) {
+        if (Drone *drone=ui->widget->adoptDrone(handoff.name,handoff.target,handoff.state)) {
+            added.append(drone);
+        }
+    }
+    if (!added.isEmpty()) {
+        addDronesUI(added);
+        fleetChanged();
+        steadyTicks=0;
+    }
+    const QVector<ShardGhost> &ghosts=shardWorker->ghosts();
+    ghostPositions.resize(ghosts.size());
+    ghostVelocities.resize(ghosts.size());
+    float ghostSpeed=0;
+    for (int i=0; i<ghosts.size(); i++) {
+        ghostPositions[i]=Vector2D(ghosts[i].x,ghosts[i].y);
+        ghostVelocities[i]=Vector2D(ghosts[i].vx,ghosts[i].vy);
+        ghostSpeed=std::max(ghostSpeed,ghosts[i].maxSpeed);
+    }
+    avoidance.setGhosts(ghostPositions,ghostVelocities,ghostSpeed);
+    if (ghosts.size()>ghostPeak) {
+        ghostPeak=ghosts.size(); // the avoidance grows its arrays once
+        steadyTicks=0;
+    }
+    advance(dt);
+
+    const Scenario &world=ui->widget->getWorld();
+    const float collisionDistance=ui->widget->droneCollisionDistance;
+    for (int s=0; s<shardCount; s++) {
+        shardGhosts[s].resize(0);
+        shardHandoffs[s].resize(0);
+    }
+    QVector<Drone*> leaving;
+    const quint64 self=quint64(1)<<shardIndex;
+    for (Drone *drone : currentFleet) {
+        const Vector2D position=drone->getPosition();
+        const int region=world.regionAt(position);
+        const int shard=shardPlan.shardOf(region);
+        quint64 owner=self;
+        if (shard>=0 && shard!=shardIndex && !(shardPlan.shardsWithin(world,region,position,handoffMargin) & self)) {
+            shardHandoffs[shard].append(ShardHandoff{drone->getName(),drone->getTargetServerName(),drone->saveState()});
+            leaving.append(drone);
+            owner=quint64(1)<<shard;
+        }
+        if (drone->getStatus()==Drone::landed) {
+            continue;
+        }
+        // a drone of another shard closer than this may have to avoid this one
+        const float maxSpeed=float(drone->type().maxSpeed);
+        const float reach=collisionDistance+float(avoidance.timeHorizon)*2*maxSpeed;
+        const Vector2D &velocity=drone->getVelocity();
+        quint64 shards=shardPlan.shardsWithin(world,region,position,reach) & ~owner;
+        if (owner!=self) {
+            shards|=self;
+        }
+        for (int other=0; shards; other++, shards>>=1) {
+            if (shards & 1) {
+                shardGhosts[other].append(ShardGhost{position.x,position.y,velocity.x,velocity.y,maxSpeed});
+            }
+        }
+    }
+    if (!leaving.isEmpty()) {
+        ui->widget->releaseDrones(leaving);
+        missions.drop(leaving);
+        removeDronesUI(leaving);
+        fleetChanged();
+        steadyTicks=0;
+    }
+    if (wantSamples) {
+        shardSamples.resize(currentFleet.size());
+        for (int i=0; i<currentFleet.size(); i++) {
+            Drone *drone=currentFleet[i];
+            shardSamples[i]=ShardSample{drone->getPosition().x,drone->getPosition().y,float(drone->getAzimut()),quint8(drone->getStatus())};
+        }
+    }
+    shardWorker->report(currentFleet.size(),shardGhosts,shardHandoffs,wantSamples ? &shardSamples : nullptr);
+}
+
+void MainWindow::refreshDronesUI() {
+    // Clear the current drone list in the UI
+    ui->listDronesInfo->clear();
+
+    // Rebuild the drone list with updated drones from the map
+    for (auto &drone : mapDrones) {
+        QListWidgetItem *LWitem = new QListWidgetItem(ui->listDronesInfo);
+        ui->listDronesInfo->addItem(LWitem);
+        ui->listDronesInfo->setItemWidget(LWitem, drone);
+    }
+
+    // Update the canvas to reflect changes
+    ui->widget->update();
+}
+
+/**
+ * @brief MainWindow::addDronesUI appends the drones created by a reload to the drone list
+ * @param added the new drones
+ */
+void MainWindow::addDronesUI(const QVector<Drone*> &added) {
+    for (Drone *drone : added) {
+        QListWidgetItem *LWitem = new QListWidgetItem(ui->listDronesInfo);
+        ui->listDronesInfo->addItem(LWitem);
+        ui->listDronesInfo->setItemWidget(LWitem, drone);
+    }
+}
+
+/**
+ * @brief MainWindow::removeDronesUI removes the items of the drones removed by a reload or a command;
+ * the list owns the drone widgets and deletes them.
+ * @param removed the removed drones
+ */
+void MainWindow::removeDronesUI(const QVector<Drone*> &removed) {
+    if (removed.isEmpty()) {
+        return;
+    }
+    // one pass over the list for a whole batch of removed drones
+    QSet<QWidget*> gone(removed.begin(), removed.end());
+    for (int row = ui->listDronesInfo->count() - 1; row >= 0; row--) {
+        QListWidgetItem *item = ui->listDronesInfo->item(row);
+        if (gone.contains(ui->listDronesInfo->itemWidget(item))) {
+            ui->listDronesInfo->removeItemWidget(item);
+            delete ui->listDronesInfo->takeItem(row);
+        }
+    }
+    for (Drone *drone : removed) {
+        drone->deleteLater();
+    }
+}
@@ -1,41 +1,195 @@
-/**
- * @brief Drone_demo project
- * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
- * @date dec. 2024
- **/
-#ifndef MAINWINDOW_H
-#define MAINWINDOW_H
-
-#include <QMainWindow>
-#include <drone.h>
-#include <QListWidget>
-#include <QMap>
-#include <QTimer>
-#include <QElapsedTimer>
-
-QT_BEGIN_NAMESPACE
-namespace Ui {
-class MainWindow;
-}
-QT_END_NAMESPACE
-
-class MainWindow : public QMainWindow
-{
-    Q_OBJECT
-
-public:
-    MainWindow(QWidget *parent = nullptr);
-    ~MainWindow();
-
-private slots:
-    void on_actionQuit_triggered();
-    void update();
-
-private:
-    Ui::MainWindow *ui;
-    QMap<QString,Drone*> mapDrones;
-    QTimer *timer;
-    QElapsedTimer elapsedTimer;
-     void refreshDronesUI();
-};
-#endif // MAINWINDOW_H
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#include <QMainWindow>
+#include <drone.h>
+#include <QListWidget>
+#include <QMap>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <memory>
+#include "scenarioloader.h"
+#include "dronescheduler.h"
+#include "collisionavoidance.h"
+#include "tracerecorder.h"
+#include "worldsnapshot.h"
+#include "telemetrypublisher.h"
+#include "stateexporter.h"
+#include "commandserver.h"
+#include "missionscheduler.h"
+#include "shardplan.h"
+#include "shardhub.h"
+
+QT_BEGIN_NAMESPACE
+namespace Ui {
+class MainWindow;
+}
+QT_END_NAMESPACE
+class QProgressBar;
+class QPushButton;
+class QSlider;
+class QComboBox;
+
+class MainWindow : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    MainWindow(QWidget *parent = nullptr);
+    ~MainWindow();
+    /**
+     * @brief loadScenario loads a scenario file in the background, it replaces the running world
+     * at the next tick
+     * @param filePath: path of the JSON file
+     */
+    void loadScenario(const QString &filePath);
+    /**
+     * @brief exportState publishes the state after each tick in a shared memory segment
+     * for the viewers (see StateExporter)
+     * @param name: name of the segment
+     * @return false if the segment cannot be created
+     */
+    bool exportState(const QString &name);
+    /**
+     * @brief setHeadless runs the simulation without display: the window and the drone
+     * widgets are not refreshed, the state is only seen through the exports
+     * @param on: true to run headless
+     */
+    void setHeadless(bool on);
+    /**
+     * @brief setTimeWarp runs the simulation faster than the wall clock: fixed ticks of warpStep
+     * are run in batches of warpSlice ms and the display is refreshed every displayInterval ms
+     * @param factor: simulated seconds per wall second (1 for real time, 0 for as fast as possible)
+     */
+    void setTimeWarp(double factor);
+    /**
+     * @brief useTileStore keeps the regions of the whole world in a tile store on disk, for the
+     * drones out of the canvas (see TileStore); applies to the next complete load
+     * @param path: path of the store, built at the first load of a scenario
+     * @param budgetBytes: memory allowed for the mapped tiles
+     * @param cellSize: world units per cell
+     */
+    void useTileStore(const QString &path, qint64 budgetBytes, float cellSize);
+    /**
+     * @brief listen opens the telemetry and command sockets (not in a shard worker, the hub owns them)
+     */
+    void listen();
+    /**
+     * @brief startShards runs the scenarios in count worker processes (see ShardHub), this window
+     * only shows their drones; the workers are started each time a scenario is loaded
+     * @param count: number of shards
+     */
+    void startShards(int count);
+    /**
+     * @brief joinShard makes this process the worker of a shard: once the scenario is loaded it keeps
+     * the drones of its shard and runs the ticks sent by the hub
+     * @param hubName: name of the local socket of the hub
+     * @param shard: index of the shard
+     * @param count: number of shards
+     * @param canvasSize: size of the world of the hub
+     * @param launch: true to take off all the drones of the shard once it is entered (benchmark)
+     */
+    void joinShard(const QString &hubName, int shard, int count, const QSize &canvasSize, bool launch=false);
+
+private slots:
+    void on_actionQuit_triggered();
+    void update();
+    void scenarioLoaded(quint64 generation);
+    void scenarioFailed(const QString &message, quint64 generation);
+    void cancelLoading();
+
+private:
+    Ui::MainWindow *ui;
+    QMap<QString,Drone*> mapDrones;
+    QTimer *timer;
+    QElapsedTimer elapsedTimer;
+    int steadyTicks=0; ///< number of ticks since the last scenario change
+    DroneScheduler scheduler; ///< simulation clock, drone transitions and active drones
+    CollisionAvoidance avoidance; ///< velocities of the flying drones
+    qint64 droneSteps=0;        ///< drone steps since the scenario was loaded
+    qint64 uniformDroneSteps=0; ///< drone steps with the same step for all the drones
+    ScenarioLoader *loader; ///< builds the scenarios in the background
+    std::unique_ptr<Scenario> pendingScenario; ///< loaded scenario waiting for the next tick
+    bool pendingIsComplete=true; ///< false if pendingScenario must be merged in the running world
+    QString scenarioPath; ///< file of the current scenario (for reload)
+    QProgressBar *loadPB;   ///< progress of the background load
+    QPushButton *cancelLoadBt; ///< cancel the background load
+    TraceRecorder recorder; ///< trace of the fleet, written after each tick
+    QSlider *replaySlider;  ///< time of the replayed trace, in ms since its start
+    SnapshotWriter *snapshotWriter; ///< writes the snapshots in the background
+    TelemetryPublisher telemetry; ///< state of the drones streamed on a local socket
+    StateExporter exporter; ///< state of the drones and servers in shared memory
+    QVector<Drone*> currentFleet; ///< drones of mapDrones, updated by fleetChanged()
+    bool headless=false; ///< true when nothing is displayed
+    CommandServer commands; ///< drone commands received on a local socket
+    QVector<DroneCommand> commandBatch; ///< commands applied at this tick (reused)
+    MissionScheduler missions; ///< coroutine missions of the drones
+    QVector<DroneCommand> missionCommands; ///< commands of the missions applied at this tick (reused)
+    static constexpr double tourCharge=80; ///< battery level (%) before each leg of a tour
+    static constexpr double tourDwell=5;   ///< seconds at each intermediate server of a tour
+    static constexpr double warpStep=0.1;   ///< simulated seconds of a tick in time warp
+    static constexpr int warpSlice=50;       ///< ms of ticks between two event processings
+    static constexpr int displayInterval=100; ///< ms between two refreshes of the display in time warp
+    static constexpr double maxWarpLag=1.0;  ///< wall seconds of late ticks kept when the warp cannot be met
+    static constexpr float handoffMargin=40; ///< distance a drone goes into the regions of another shard before its handoff
+    double timeWarp=1;      ///< simulated seconds per wall second, 0 for as fast as possible
+    double warpBudget=0;    ///< simulated seconds to run to catch up with the warp
+    QComboBox *warpCB;      ///< choice of the time warp
+    QElapsedTimer displayTimer; ///< time since the last refresh of the display
+    QElapsedTimer rateTimer;    ///< time since the start of the rate measure
+    double rateStart=0;     ///< simulation time at the start of the rate measure
+    double achievedRate=0;  ///< simulated seconds per wall second measured
+    ShardHub *shardHub=nullptr;       ///< worker processes, when this window shows a sharded simulation
+    ShardWorker *shardWorker=nullptr; ///< link to the hub, when this process simulates a shard
+    QString shardHubName;   ///< local socket of the hub
+    int shardIndex=-1;      ///< shard simulated by this process
+    int shardCount=0;       ///< number of shards
+    bool shardLaunch=false; ///< the drones of the shard take off when it is entered
+    ShardPlan shardPlan;    ///< servers of each shard
+    QVector<QVector<ShardGhost>> shardGhosts;     ///< ghosts for each shard at this tick (reused)
+    QVector<QVector<ShardHandoff>> shardHandoffs; ///< handoffs to each shard at this tick (reused)
+    QVector<ShardSample> shardSamples;            ///< drones of this shard shown by the hub (reused)
+    QVector<Vector2D> ghostPositions, ghostVelocities; ///< ghosts given to the avoidance (reused)
+    int ghostPeak=0;        ///< most ghosts received in a tick
+     void refreshDronesUI();
+     void addDronesUI(const QVector<Drone*> &added);
+     void removeDronesUI(const QVector<Drone*> &removed);
+     /**
+      * @brief advance runs one tick (commands and missions, step, trace)
+      * @param dt: duration of the tick in seconds
+      */
+     void advance(double dt);
+     void simulationStep(double dt);
+     /**
+      * @brief fleet
+      * @return the drones of mapDrones, in the order of their names
+      */
+     QVector<Drone*> fleet() const;
+     /**
+      * @brief fleetChanged gives the new fleet to the telemetry and the export after a scenario change
+      */
+     void fleetChanged();
+     /**
+      * @brief startTours starts the tour missions of a batch of commands (see Missions::tour)
+      * @param batch: the commands
+      * @return the number of started missions
+      */
+     int startTours(const QVector<DroneCommand> &batch);
+     /**
+      * @brief enterShard keeps the drones of this shard and connects to the hub (after the scenario is applied)
+      */
+     void enterShard();
+     /**
+      * @brief shardTick runs a tick of the hub: adopts the handed off drones, avoids the ghosts,
+      * advances, then reports the drones that left the shard and the ones near its borders
+      * @param dt: duration of the tick
+      * @param wantSamples: true to send the drones to the hub
+      */
+     void shardTick(double dt, bool wantSamples);
+};
+#endif // MAINWINDOW_H
@@ -0,0 +1,475 @@
+#include "missiondispatcher.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+/// ratio of the bid increments of two successive auction phases
+const double epsilonFactor = 5;
+}
+
+/**
+ * @brief MissionDispatcher::assign groups the missions by target and solves the assignment on
+ * the candidates of the groups. While a maximum matching leaves missions unassigned, the groups
+ * that could give them a drone and do not see all the drones in range double their candidates.
+ * With the makespan objective, the longest flight is the smallest candidate distance for which
+ * as many missions can be assigned (binary search, one maximum matching per step); the total
+ * distance is minimized among the assignments under it.
+ * @param drones position of the available drones
+ * @param ranges distance each drone can still fly
+ * @param targets target of each mission
+ * @param droneOfMission drone of each mission
+ * @return the number of assigned missions
+ */
+int MissionDispatcher::assign(const QVector<Vector2D> &drones, const QVector<float> &ranges, const QVector<Vector2D> &targets, QVector<int> &droneOfMission) {
+    const int nMissions = targets.size();
+    droneOfMission.fill(-1, nMissions);
+    total = 0;
+    longest = 0;
+    bidCount = 0;
+    if (drones.isEmpty() || nMissions == 0) {
+        return 0;
+    }
+    // cells of about one drone each
+    Vector2D low = drones.first(), high = drones.first();
+    for (const Vector2D &p : drones) {
+        low.set(std::min(low.x, p.x), std::min(low.y, p.y));
+        high.set(std::max(high.x, p.x), std::max(high.y, p.y));
+    }
+    const float width = std::max(1.0f, high.x - low.x), height = std::max(1.0f, high.y - low.y);
+    grid.build(drones, std::sqrt(width * height / drones.size()) + 1);
+
+    groupMissions(targets);
+    const int nGroups = groupTarget.size();
+    groupSize.resize(nGroups);
+    for (int g = 0; g < nGroups; g++) {
+        groupSize[g] = std::min(int(drones.size()), candidatesPerMission + missionStart[g + 1] - missionStart[g] - 1);
+    }
+    const float unlimited = std::numeric_limits<float>::infinity();
+    for (;;) {
+        buildCandidates(drones, ranges);
+        maxAssigned(unlimited);
+        // the last search of maxAssigned reached the groups from the ones missing drones through
+        // the drones of their candidates and the groups holding them: another mission could be
+        // served only if one of these groups takes a drone beyond its candidates
+        bool grown = false;
+        for (int g = 0; g < nGroups; g++) {
+            if (groupLayer[g] >= 0 && !groupComplete[g]) {
+                groupSize[g] = std::min(int(drones.size()), 2 * groupSize[g]);
+                grown = true;
+            }
+        }
+        if (!grown) {
+            break;
+        }
+    }
+    int assigned = solve(unlimited, droneOfMission);
+
+    if (objective == minimizeMakespan && assigned > 0) {
+        float upper = 0;
+        for (int m = 0; m < nMissions; m++) {
+            if (droneOfMission[m] >= 0) {
+                upper = std::max(upper, (drones[droneOfMission[m]] - targets[m]).length());
+            }
+        }
+        QVector<float> limits;
+        for (float c : candidateCost) {
+            if (c < upper) {
+                limits.append(c);
+            }
+        }
+        std::sort(limits.begin(), limits.end());
+        limits.erase(std::unique(limits.begin(), limits.end()), limits.end());
+        // the limits below the first that assigns as many missions; upper does
+        int first = 0, last = limits.size();
+        while (first < last) {
+            int middle = (first + last) / 2;
+            if (maxAssigned(limits[middle]) == assigned) {
+                last = middle;
+            } else {
+                first = middle + 1;
+            }
+        }
+        if (first < limits.size()) {
+            solve(limits[first], droneOfMission);
+        }
+    }
+
+    for (int m = 0; m < nMissions; m++) {
+        int d = droneOfMission[m];
+        if (d >= 0) {
+            float distance = (drones[d] - targets[m]).length();
+            total += distance;
+            longest = std::max(longest, double(distance));
+        }
+    }
+    return assigned;
+}
+
+/**
+ * @brief MissionDispatcher::groupMissions sorts the missions by target position: the missions
+ * with the same target are consecutive and form a group.
+ */
+void MissionDispatcher::groupMissions(const QVector<Vector2D> &targets) {
+    const int nMissions = targets.size();
+    missionsByGroup.resize(nMissions);
+    for (int m = 0; m < nMissions; m++) {
+        missionsByGroup[m] = m;
+    }
+    std::sort(missionsByGroup.begin(), missionsByGroup.end(), [&targets](int a, int b) {
+        return targets[a].x < targets[b].x || (targets[a].x == targets[b].x && targets[a].y < targets[b].y);
+    });
+    groupTarget.clear();
+    missionStart.clear();
+    groupOf.resize(nMissions);
+    for (int i = 0; i < nMissions; i++) {
+        int m = missionsByGroup[i];
+        if (i == 0 || targets[m].x != groupTarget.last().x || targets[m].y != groupTarget.last().y) {
+            missionStart.append(i);
+            groupTarget.append(targets[m]);
+        }
+        groupOf[m] = groupTarget.size() - 1;
+    }
+    missionStart.append(nMissions);
+}
+
+/**
+ * @brief MissionDispatcher::buildCandidates keeps for each group its groupSize nearest drones,
+ * then drops the ones that cannot reach it. A group that found fewer drones than it asked for
+ * sees all the drones in range. The candidates are also listed by drone for the reverse auction.
+ */
+void MissionDispatcher::buildCandidates(const QVector<Vector2D> &drones, const QVector<float> &ranges) {
+    float maxRange = 0;
+    for (float r : ranges) {
+        maxRange = std::max(maxRange, r);
+    }
+    const int nGroups = groupTarget.size();
+    const int largest = *std::max_element(groupSize.begin(), groupSize.end());
+    QVector<int> neighbors(largest);
+    QVector<float> distancesSquared(largest);
+    candidateStart.resize(nGroups + 1);
+    groupComplete.resize(nGroups);
+    candidateDrone.clear();
+    candidateCost.clear();
+    candidateGroup.clear();
+    for (int g = 0; g < nGroups; g++) {
+        candidateStart[g] = candidateDrone.size();
+        int count = grid.kNearestTo(groupTarget[g], maxRange, groupSize[g], neighbors.data(), distancesSquared.data());
+        groupComplete[g] = count < groupSize[g] || groupSize[g] == drones.size();
+        for (int i = 0; i < count; i++) {
+            float distance = std::sqrt(distancesSquared[i]);
+            if (distance <= ranges[neighbors[i]]) {
+                candidateDrone.append(neighbors[i]);
+                candidateCost.append(distance);
+                candidateGroup.append(g);
+            }
+        }
+    }
+    candidateStart[nGroups] = candidateDrone.size();
+
+    // counting sort of the candidates by drone
+    droneStart.fill(0, drones.size() + 1);
+    for (int d : candidateDrone) {
+        droneStart[d + 1]++;
+    }
+    for (int d = 0; d < drones.size(); d++) {
+        droneStart[d + 1] += droneStart[d];
+    }
+    droneCandidates.resize(candidateDrone.size());
+    QVector<int> fill = droneStart;
+    for (int c = 0; c < candidateDrone.size(); c++) {
+        droneCandidates[fill[candidateDrone[c]]++] = c;
+    }
+}
+
+/**
+ * @brief MissionDispatcher::solve leaving a mission unassigned costs more than any set of
+ * flights, so the assignment first serves as many missions as possible. The auction phases
+ * divide the bid increment by epsilonFactor down to less than 1/missions pixel, keeping the
+ * prices: the drones contested by more missions than they can serve reach the drop cost in a
+ * few large bids instead of many small ones. Each phase is a forward auction followed by a
+ * reverse auction that lowers the price of the drones left free to zero (with the increment of
+ * the phase, so the next one starts from consistent prices): after the last phase the
+ * assignment is within missions * epsilon < 1 pixel of the optimal total distance.
+ */
+int MissionDispatcher::solve(float limit, QVector<int> &droneOfMission) {
+    const int nMissions = groupOf.size();
+    float maxCost = 0;
+    for (float c : candidateCost) {
+        if (c <= limit) {
+            maxCost = std::max(maxCost, c);
+        }
+    }
+    dropCost = double(nMissions) * maxCost + 1;
+    prices.fill(0, droneStart.size() - 1);
+    profits.resize(nMissions);
+    cacheBound.resize(groupTarget.size());
+    cache.resize(groupTarget.size() * cachedOptions);
+    const double finalEpsilon = 1.0 / (nMissions + 1);
+    double epsilon = std::max(finalEpsilon, dropCost / epsilonFactor);
+    for (;;) {
+        forward(epsilon, limit);
+        reverse(epsilon, limit);
+        if (epsilon <= finalEpsilon) {
+            break;
+        }
+        epsilon = std::max(finalEpsilon, epsilon / epsilonFactor);
+    }
+
+    droneOfMission = droneOf;
+    int assigned = 0;
+    for (int d : droneOf) {
+        assigned += d >= 0;
+    }
+    return assigned;
+}
+
+/**
+ * @brief MissionDispatcher::maxAssigned each phase finds by a breadth first search the layers of
+ * the groups from the ones missing drones, through a drone to the group holding it, up to a free
+ * drone; then takes the drones along vertex disjoint shortest paths.
+ */
+int MissionDispatcher::maxAssigned(float limit) {
+    const int nGroups = groupTarget.size();
+    droneCandidate.fill(-1, droneStart.size() - 1);
+    groupLoad.fill(0, nGroups);
+    int assigned = 0;
+    for (;;) {
+        groupLayer.fill(-1, nGroups);
+        pending.clear();
+        for (int g = 0; g < nGroups; g++) {
+            if (groupLoad[g] < missionStart[g + 1] - missionStart[g]) {
+                groupLayer[g] = 0;
+                pending.append(g);
+            }
+        }
+        bool found = false;
+        for (int i = 0; i < pending.size(); i++) {
+            const int g = pending[i];
+            for (int c = candidateStart[g]; c < candidateStart[g + 1] && candidateCost[c] <= limit; c++) {
+                const int holder = droneCandidate[candidateDrone[c]];
+                if (holder < 0) {
+                    found = true;
+                } else if (groupLayer[candidateGroup[holder]] < 0) {
+                    groupLayer[candidateGroup[holder]] = groupLayer[g] + 1;
+                    pending.append(candidateGroup[holder]);
+                }
+            }
+        }
+        if (!found) {
+            return assigned;
+        }
+        groupNext = candidateStart;
+        for (int g = 0; g < nGroups; g++) {
+            while (groupLayer[g] == 0 && groupLoad[g] < missionStart[g + 1] - missionStart[g] && augment(g, limit)) {
+                groupLoad[g]++;
+                assigned++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief MissionDispatcher::augment takes a free drone, or the drone of a group of the next layer
+ * that takes another one in turn; the candidates tried without success are not tried again in
+ * the phase.
+ */
+bool MissionDispatcher::augment(int g, float limit) {
+    for (int &c = groupNext[g]; c < candidateStart[g + 1] && candidateCost[c] <= limit; c++) {
+        const int d = candidateDrone[c];
+        const int holder = droneCandidate[d];
+        if (holder == c) {
+            continue;
+        }
+        if (holder < 0 || (groupLayer[candidateGroup[holder]] == groupLayer[g] + 1 && augment(candidateGroup[holder], limit))) {
+            droneCandidate[d] = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief MissionDispatcher::keepBest keeps the cachedOptions best of the scanned options (the
+ * first ones of the cache, in no order) and the best value of the others.
+ */
+int MissionDispatcher::keepBest(Option *cache, double &bound) {
+    const int kept = std::min(int(options.size()), cachedOptions);
+    bound = -std::numeric_limits<double>::infinity();
+    if (options.size() > kept) {
+        std::nth_element(options.begin(), options.begin() + kept, options.end(),
+                         [](const Option &a, const Option &b) { return a.value > b.value; });
+        bound = options[kept].value;
+    }
+    std::copy(options.begin(), options.begin() + kept, cache);
+    return kept;
+}
+
+/**
+ * @brief MissionDispatcher::forward each unassigned mission bids for its best drone (value =
+ * -cost - price), raising its price by the difference with the second best plus epsilon; the
+ * previous owner of the drone bids again. Leaving the mission unassigned is an option of
+ * value -dropCost that is never outbid, so a price war on a drone ends when the contenders
+ * prefer to drop. The phase starts from no assignment and the prices of the previous one.
+ * The prices only rise during a phase: the values of the candidates of a group only fall, so
+ * the best candidates of its last scan are still the best while the second of them is above
+ * the values the others had then; the many missions of a group bid without scanning them all.
+ * Likewise, once a mission of a group is dropped, the missions of the group bidding after it
+ * are dropped.
+ */
+void MissionDispatcher::forward(double epsilon, float limit) {
+    const int nMissions = groupOf.size();
+    const int nGroups = groupTarget.size();
+    missionOfDrone.fill(-1, prices.size());
+    droneOf.fill(-1, nMissions);
+    groupDropped.fill(false, nGroups);
+    cacheCount.fill(0, nGroups);
+    pending.clear();
+    for (int m = nMissions - 1; m >= 0; m--) {
+        pending.append(m);
+    }
+    while (!pending.isEmpty()) {
+        int m = pending.last();
+        pending.removeLast();
+        const int g = groupOf[m];
+        if (groupDropped[g]) {
+            profits[m] = -dropCost;
+            continue;
+        }
+        Option *cached = cache.data() + g * cachedOptions;
+        if (cacheCount[g] == 0) {
+            options.clear();
+            for (int c = candidateStart[g]; c < candidateStart[g + 1] && candidateCost[c] <= limit; c++) {
+                options.append({-candidateCost[c] - prices[candidateDrone[c]], c, m});
+            }
+            cacheCount[g] = keepBest(cached, cacheBound[g]);
+        }
+        int best = -1;
+        float bestCost = 0;
+        double bestValue = -dropCost, secondValue = -dropCost;
+        for (int i = 0; i < cacheCount[g]; i++) {
+            const int c = cached[i].candidate;
+            const int d = candidateDrone[c];
+            double value = -candidateCost[c] - prices[d];
+            if (value > bestValue) {
+                secondValue = bestValue;
+                bestValue = value;
+                best = d;
+                bestCost = candidateCost[c];
+            } else if (value > secondValue) {
+                secondValue = value;
+            }
+        }
+        if (secondValue < cacheBound[g]) {
+            // a candidate out of the cache may be better: scan again
+            cacheCount[g] = 0;
+            pending.append(m);
+            continue;
+        }
+        if (best < 0) {
+            // the mission is dropped, and the next missions of the group while the prices rise
+            profits[m] = -dropCost;
+            groupDropped[g] = true;
+            continue;
+        }
+        bidCount++;
+        prices[best] += bestValue - secondValue + epsilon;
+        int previous = missionOfDrone[best];
+        if (previous >= 0) {
+            droneOf[previous] = -1;
+            pending.append(previous);
+        }
+        missionOfDrone[best] = m;
+        droneOf[m] = best;
+        profits[m] = -bestCost - prices[best];
+    }
+}
+
+/**
+ * @brief MissionDispatcher::reverse each free drone with a positive price offers itself to its
+ * best mission (value = -cost - profit of the mission), lowering its price to the second best
+ * value minus epsilon (not below zero); the mission leaves its previous drone, which offers
+ * itself in turn if its price is positive. A drone without a mission worth epsilon gets a zero
+ * price. The profits of the missions only increase, so it ends. The missions of a group have
+ * the same cost for a drone: its best ones are those of lowest profit, kept by the group like
+ * its best candidates in forward.
+ */
+void MissionDispatcher::reverse(double epsilon, float limit) {
+    const int nGroups = groupTarget.size();
+    cacheCount.fill(0, nGroups);
+    pending.clear();
+    for (int d = 0; d < prices.size(); d++) {
+        if (missionOfDrone[d] < 0 && prices[d] > 0) {
+            pending.append(d);
+        }
+    }
+    const double none = -std::numeric_limits<double>::infinity();
+    while (!pending.isEmpty()) {
+        int d = pending.last();
+        pending.removeLast();
+        int best = -1;
+        float bestCost = 0;
+        double bestValue = none, secondValue = none;
+        for (int i = droneStart[d]; i < droneStart[d + 1]; i++) {
+            const int c = droneCandidates[i];
+            if (candidateCost[c] > limit) {
+                continue;
+            }
+            // the two missions of lowest profit of the group
+            const int g = candidateGroup[c];
+            Option *cached = cache.data() + g * cachedOptions;
+            int lowest = -1;
+            double lowValue, nextValue;
+            for (;;) {
+                if (cacheCount[g] == 0) {
+                    options.clear();
+                    for (int j = missionStart[g]; j < missionStart[g + 1]; j++) {
+                        int m = missionsByGroup[j];
+                        options.append({-profits[m], c, m});
+                    }
+                    cacheCount[g] = keepBest(cached, cacheBound[g]);
+                }
+                lowValue = nextValue = none;
+                for (int k = 0; k < cacheCount[g]; k++) {
+                    double value = -profits[cached[k].mission];
+                    if (value > lowValue) {
+                        nextValue = lowValue;
+                        lowValue = value;
+                        lowest = cached[k].mission;
+                    } else if (value > nextValue) {
+                        nextValue = value;
+                    }
+                }
+                if (nextValue >= cacheBound[g]) {
+                    break;
+                }
+                cacheCount[g] = 0; // a mission out of the cache may have a lower profit
+            }
+            const double value = -candidateCost[c] + lowValue;
+            if (value > bestValue) {
+                secondValue = std::max(bestValue, -candidateCost[c] + nextValue);
+                bestValue = value;
+                best = lowest;
+                bestCost = candidateCost[c];
+            } else if (value > secondValue) {
+                secondValue = value;
+            }
+        }
+        if (best < 0 || bestValue < epsilon) {
+            prices[d] = 0;
+            continue;
+        }
+        bidCount++;
+        prices[d] = std::max(0.0, secondValue - epsilon);
+        int previous = droneOf[best];
+        if (previous >= 0) {
+            missionOfDrone[previous] = -1;
+            if (prices[previous] > 0) {
+                pending.append(previous);
+            }
+        }
+        droneOf[best] = d;
+        missionOfDrone[d] = best;
+        profits[best] = -bestCost - prices[d];
+    }
+}
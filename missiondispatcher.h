@@ -0,0 +1,162 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef MISSIONDISPATCHER_H
+#define MISSIONDISPATCHER_H
+
+#include <QVector>
+#include "vector2d.h"
+#include "spatialgrid.h"
+
+/**
+ * @brief MissionDispatcher assigns a batch of missions (target positions) to the available
+ * drones. The missions sharing a target form a group whose candidates are its nearest drones
+ * able to reach it (found in a SpatialGrid): candidatesPerMission more than the missions of the
+ * group, more while missions are left unassigned and a group that could free a drone for them
+ * does not see every drone in range.
+ * The assignment serves as many missions as the drones in range allow (a mission is left
+ * unassigned only when no reassignment of the drones able to reach it can serve it), then
+ * minimizes the objective over the candidates: the total flight distance (within 1 pixel of the
+ * optimum), or the longest flight (exact) and then the total distance. It is solved by an
+ * auction with epsilon scaling, the longest flight by a binary search on maximum matchings.
+ */
+class MissionDispatcher {
+public:
+    static constexpr int candidatesPerMission = 16; ///< drones considered by a mission beyond the others of its group
+
+    /**
+     * @brief Quantity minimized by the assignment
+     */
+    enum Objective {
+        minimizeTotal,   ///< sum of the flight distances
+        minimizeMakespan ///< longest flight distance, then the sum
+    };
+    Objective objective = minimizeTotal; ///< quantity minimized by assign
+
+    /**
+     * @brief assign solves the assignment
+     * @param drones: position of the available drones
+     * @param ranges: distance each drone can still fly
+     * @param targets: target position of each mission
+     * @param droneOfMission: filled with the index of the drone of each mission, -1 if unassigned
+     * @return the number of assigned missions
+     */
+    int assign(const QVector<Vector2D> &drones, const QVector<float> &ranges, const QVector<Vector2D> &targets, QVector<int> &droneOfMission);
+    /**
+     * @brief totalDistance
+     * @return the total flight distance of the last assignment
+     */
+    inline double totalDistance() const { return total; }
+    /**
+     * @brief longestFlight
+     * @return the longest flight distance of the last assignment
+     */
+    inline double longestFlight() const { return longest; }
+    /**
+     * @brief bids
+     * @return the number of bids of the last assignment (all phases and solves)
+     */
+    inline qint64 bids() const { return bidCount; }
+
+private:
+    static constexpr int cachedOptions = 32; ///< best options kept by a group between its bids
+
+    /**
+     * @brief An option of a group: a candidate drone (forward) or a mission (reverse), with its
+     * value at the scan
+     */
+    struct Option {
+        double value;
+        int candidate;
+        int mission;
+    };
+
+    /**
+     * @brief groupMissions gathers the missions by target
+     * @param targets: target of each mission
+     */
+    void groupMissions(const QVector<Vector2D> &targets);
+    /**
+     * @brief buildCandidates lists the groupSize[g] nearest drones able to reach each group
+     * @param drones: position of the drones
+     * @param ranges: distance each drone can still fly
+     */
+    void buildCandidates(const QVector<Vector2D> &drones, const QVector<float> &ranges);
+    /**
+     * @brief solve runs the auction on the candidates not longer than limit
+     * @param limit: longest flight allowed
+     * @param droneOfMission: filled with the assignment
+     * @return the number of assigned missions
+     */
+    int solve(float limit, QVector<int> &droneOfMission);
+    /**
+     * @brief forward runs a forward auction phase: the missions bid for the drones
+     * @param epsilon: minimal bid increment
+     * @param limit: longest flight allowed
+     */
+    void forward(double epsilon, float limit);
+    /**
+     * @brief reverse runs reverse auction iterations until the free drones have a zero price:
+     * with more drones than missions the result is then within epsilon per mission of the optimum
+     * @param epsilon: minimal bid decrement
+     * @param limit: longest flight allowed
+     */
+    void reverse(double epsilon, float limit);
+    /**
+     * @brief maxAssigned counts the missions that can be assigned with the candidates not longer
+     * than limit (Hopcroft-Karp, a group taking as many drones as it has missions)
+     * @param limit: longest flight allowed
+     * @return the largest number of assigned missions
+     */
+    int maxAssigned(float limit);
+    /**
+     * @brief augment looks for an augmenting path from a group in the layers of maxAssigned
+     * @param g: the group
+     * @param limit: longest flight allowed
+     * @return true if the group took one more drone
+     */
+    bool augment(int g, float limit);
+    /**
+     * @brief keepBest copies the best scanned options to the cache of a group
+     * @param cache: the cachedOptions entries of the group
+     * @param bound: set to the best value of the options not kept
+     * @return the number of options kept
+     */
+    int keepBest(Option *cache, double &bound);
+
+    SpatialGrid grid;              ///< index of the drones
+    QVector<Vector2D> groupTarget; ///< target of each group
+    QVector<int> groupOf;          ///< group of each mission
+    QVector<int> missionStart;     ///< first mission of each group in missionsByGroup (one more entry at the end)
+    QVector<int> missionsByGroup;  ///< missions sorted by group
+    QVector<int> groupSize;        ///< number of candidates wanted by each group
+    QVector<bool> groupComplete;   ///< the group sees every drone in range
+    QVector<bool> groupDropped;    ///< a mission of the group was dropped in the current forward phase
+    QVector<int> candidateStart;   ///< first candidate of each group (one more entry at the end)
+    QVector<int> candidateDrone;   ///< drone of each candidate
+    QVector<float> candidateCost;  ///< distance of each candidate
+    QVector<int> candidateGroup;   ///< group of each candidate
+    QVector<int> droneStart;       ///< first candidate of each drone in droneCandidates (one more entry at the end)
+    QVector<int> droneCandidates;  ///< candidates sorted by drone
+    QVector<double> prices;        ///< price of each drone (double: the bids add small increments to large prices)
+    QVector<int> missionOfDrone;   ///< mission owning each drone, -1 if free
+    QVector<int> droneOf;          ///< drone of each mission, -1 if unassigned
+    QVector<double> profits;       ///< value of the assignment of each mission (-cost - price, -dropCost if unassigned)
+    QVector<int> pending;          ///< missions still bidding, or drones still lowering their price
+    QVector<Option> options;       ///< options of the last scan
+    QVector<Option> cache;         ///< best options of each group at its last scan (cachedOptions per group)
+    QVector<int> cacheCount;       ///< number of cached options of each group, 0 to scan
+    QVector<double> cacheBound;    ///< best value of the options out of the cache of each group at its scan
+    QVector<int> droneCandidate;   ///< candidate holding each drone in maxAssigned, -1 if free
+    QVector<int> groupLoad;        ///< drones held by each group in maxAssigned
+    QVector<int> groupLayer;       ///< distance of each group from the groups missing drones in maxAssigned
+    QVector<int> groupNext;        ///< next candidate tried by each group in augment
+    double dropCost = 0;           ///< cost of leaving a mission unassigned
+    double total = 0;              ///< total distance of the last assignment
+    double longest = 0;            ///< longest flight of the last assignment
+    qint64 bidCount = 0;           ///< bids of the last assignment
+};
+
+#endif // MISSIONDISPATCHER_H
@@ -0,0 +1,263 @@
+#include "missionscheduler.h"
+#include "drone.h"
+#include "landingcontrol.h"
+#include "scenario.h"
+#include <QDebug>
+#include <algorithm>
+#include <new>
+
+namespace {
+    /**
+     * @brief Blocks and free lists of MissionFramePool
+     */
+    struct FramePool {
+        void *freeFrames[MissionFramePool::classCount] = {}; ///< first free frame of each class, the next one is stored in the frame
+        QVector<char*> blocks;
+        char *cursor = nullptr;  ///< free bytes of the last block
+        char *end = nullptr;
+        int inUse = 0;
+
+        ~FramePool() {
+            for (char *block : blocks) {
+                ::operator delete(block);
+            }
+        }
+    };
+
+    FramePool &framePool() {
+        static FramePool pool;
+        return pool;
+    }
+}
+
+void *MissionFramePool::allocate(size_t size) {
+    FramePool &pool = framePool();
+    const int c = int((size + granularity - 1) / granularity) - 1;
+    pool.inUse++;
+    if (c >= classCount) {
+        return ::operator new(size);
+    }
+    if (void *frame = pool.freeFrames[c]) {
+        pool.freeFrames[c] = *static_cast<void**>(frame);
+        return frame;
+    }
+    const size_t bytes = (c + 1) * granularity;
+    if (pool.cursor == nullptr || size_t(pool.end - pool.cursor) < bytes) {
+        char *block = static_cast<char*>(::operator new(blockSize));
+        pool.blocks.append(block);
+        pool.cursor = block;
+        pool.end = block + blockSize; // the rest of the previous block is left
+    }
+    void *frame = pool.cursor;
+    pool.cursor += bytes;
+    return frame;
+}
+
+void MissionFramePool::release(void *frame, size_t size) {
+    FramePool &pool = framePool();
+    const int c = int((size + granularity - 1) / granularity) - 1;
+    pool.inUse--;
+    if (c >= classCount) {
+        ::operator delete(frame);
+        return;
+    }
+    *static_cast<void**>(frame) = pool.freeFrames[c];
+    pool.freeFrames[c] = frame;
+}
+
+int MissionFramePool::framesInUse() {
+    return framePool().inUse;
+}
+
+size_t MissionFramePool::reservedBytes() {
+    return framePool().blocks.size() * blockSize;
+}
+
+/**
+ * @brief Missions::FlyTo::await_suspend sends the drone to the server (it takes off if landed)
+ * and waits for its landing.
+ * @param h the mission
+ * @return false if the server is unknown (the mission goes on)
+ */
+bool Missions::FlyTo::await_suspend(Mission::Handle h) {
+    promise = &h.promise();
+    MissionScheduler &scheduler = *promise->scheduler;
+    if (!scheduler.getWorld() || !scheduler.getWorld()->serverIndex.contains(server)) {
+        promise->arrived = false;
+        return false;
+    }
+    DroneCommand command;
+    command.kind = DroneCommand::retarget;
+    if (!command.addName(promise->drone->getName()) || !command.addName(server)) {
+        promise->arrived = false; // names too long for a command
+        return false;
+    }
+    scheduler.issue(std::move(command));
+    command = DroneCommand();
+    command.kind = DroneCommand::start; // ignored if flying
+    command.addName(promise->drone->getName());
+    scheduler.issue(std::move(command));
+    scheduler.waitLanding(*promise, server);
+    return true;
+}
+
+/**
+ * @brief Missions::Charged::await_suspend the time to reach the level is known from the charging
+ * speed of the type (see Drone::scheduleNextTransition).
+ * @param h the mission
+ * @return false if the level is reached or the drone does not charge
+ */
+bool Missions::Charged::await_suspend(Mission::Handle h) {
+    Mission::promise_type &promise = h.promise();
+    drone = promise.drone;
+    const double power = drone->getPower();
+    if (power >= percent || drone->getStatus() != Drone::landed) {
+        return false;
+    }
+    const DroneType &type = drone->type();
+    const double target = std::min(percent, 100.0);
+    promise.scheduler->wakeAt(promise, promise.scheduler->now() + (target - power) / 100.0 * type.maxPower / type.chargingSpeed);
+    return true;
+}
+
+bool Missions::Charged::await_resume() const noexcept {
+    return drone->getPower() >= std::min(percent, 100.0) - 1e-6;
+}
+
+void Missions::Sleep::await_suspend(Mission::Handle h) {
+    Mission::promise_type &promise = h.promise();
+    promise.scheduler->wakeAt(promise, promise.scheduler->now() + seconds);
+}
+
+Mission Missions::tour(QStringList servers, double charge, double dwell) {
+    for (int i = 0; i < servers.size(); i++) {
+        if (!co_await flyTo(servers[i])) {
+            co_return; // sent elsewhere: the drone is not ours anymore
+        }
+        if (i + 1 < servers.size()) {
+            if (!co_await charged(charge)) {
+                co_return; // took off before the level: not ours anymore
+            }
+            co_await sleep(std::chrono::duration<double>(dwell));
+        }
+    }
+}
+
+MissionScheduler::~MissionScheduler() {
+    clear();
+}
+
+void MissionScheduler::start(Drone *drone, Mission mission) {
+    Mission::Handle handle = mission.release();
+    handle.promise().scheduler = this;
+    handle.promise().drone = drone;
+    if (Mission::Handle previous = running.value(drone)) {
+        previous.destroy();
+    }
+    running.insert(drone, handle);
+    started.append(drone);
+}
+
+void MissionScheduler::drop(const QVector<Drone*> &removed) {
+    for (Drone *drone : removed) {
+        if (Mission::Handle handle = running.take(drone)) {
+            handle.destroy(); // its timers are ignored
+        }
+    }
+}
+
+void MissionScheduler::clear() {
+    for (Mission::Handle handle : running) {
+        handle.destroy();
+    }
+    running.clear();
+    started.clear();
+    timers.clear();
+    issued.clear();
+}
+
+void MissionScheduler::issue(DroneCommand &&command) {
+    issued.append(std::move(command));
+}
+
+void MissionScheduler::waitLanding(Mission::promise_type &promise, const QString &name) {
+    promise.wait = ++waits;
+    promise.landing = true;
+    promise.landingName = name;
+}
+
+void MissionScheduler::wakeAt(Mission::promise_type &promise, double time) {
+    promise.wait = ++waits;
+    promise.landing = false;
+    timers.append(Timer{time, promise.drone, promise.wait});
+    std::push_heap(timers.begin(), timers.end(), later);
+}
+
+void MissionScheduler::resume(Drone *drone, Mission::Handle handle) {
+    handle.resume();
+    if (handle.done()) {
+        running.remove(drone);
+        handle.destroy();
+    }
+}
+
+/**
+ * @brief MissionScheduler::run a drone landed on a pad of the expected server arrived; the server
+ * is found by name, its index may change with a reload. A drone that lands elsewhere with another
+ * target was taken by someone else, the mission is told; a drone that lands elsewhere with the
+ * same target (charging stop, low battery) goes on.
+ * @param now simulation time
+ * @param landed drones landed since the last run
+ * @param commands receives the commands of the missions
+ * @return the number of resumed missions
+ */
+int MissionScheduler::run(double now, const QVector<Drone*> &landed, QVector<DroneCommand> &commands) {
+    clock = now;
+    int resumed = 0;
+    if (!running.isEmpty()) {
+        for (Drone *drone : landed) {
+            Mission::Handle handle = running.value(drone);
+            if (!handle || !handle.promise().landing) {
+                continue;
+            }
+            Mission::promise_type &promise = handle.promise();
+            const int expected = world ? world->serverIndex.value(promise.landingName, -1) : -1;
+            if (expected >= 0 && landing && landing->landedAt(drone) == expected) {
+                promise.arrived = true;
+            } else if (drone->getTargetServerName() != promise.landingName) {
+                promise.arrived = false;
+            } else {
+                continue;
+            }
+            promise.landing = false;
+            resume(drone, handle);
+            resumed++;
+        }
+    }
+    while (!timers.isEmpty() && timers.first().time <= now) {
+        const Timer timer = timers.first();
+        std::pop_heap(timers.begin(), timers.end(), later);
+        timers.removeLast();
+        Mission::Handle handle = running.value(timer.drone);
+        if (handle && handle.promise().wait == timer.wait) {
+            handle.promise().wait = 0;
+            resume(timer.drone, handle);
+            resumed++;
+        }
+    }
+    // the new missions last, the landings of the last tick are not theirs
+    for (Drone *drone : started) {
+        Mission::Handle handle = running.value(drone);
+        if (handle && !handle.promise().begun) { // a drone may be listed twice
+            handle.promise().begun = true;
+            resume(drone, handle);
+            resumed++;
+        }
+    }
+    started.resize(0);
+    for (DroneCommand &command : issued) {
+        commands.append(std::move(command));
+    }
+    issued.resize(0);
+    return resumed;
+}
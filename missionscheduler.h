@@ -0,0 +1,278 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef MISSIONSCHEDULER_H
+#define MISSIONSCHEDULER_H
+
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include "commandserver.h"
+
+class Drone;
+class Scenario;
+class LandingControl;
+class MissionScheduler;
+
+/**
+ * @brief MissionFramePool gives the memory of the mission coroutines: frames are rounded up to
+ * size classes of 64 bytes, cut from large blocks and recycled in a free list per class, so that
+ * starting and ending missions does not go through the heap (GUI thread only).
+ */
+class MissionFramePool {
+public:
+    static constexpr size_t granularity = 64;       ///< size step of the classes
+    static constexpr int classCount = 16;           ///< frames up to 1 KiB, larger ones use the heap
+    static constexpr size_t blockSize = 256 << 10;  ///< bytes allocated at once
+
+    /**
+     * @brief allocate gives the memory of a frame
+     * @param size: size of the frame
+     * @return the memory
+     */
+    static void *allocate(size_t size);
+    /**
+     * @brief release gives back the memory of a frame
+     * @param frame: memory returned by allocate()
+     * @param size: size of the frame
+     */
+    static void release(void *frame, size_t size);
+    /**
+     * @brief framesInUse
+     * @return the number of allocated frames
+     */
+    static int framesInUse();
+    /**
+     * @brief reservedBytes
+     * @return the bytes of the blocks
+     */
+    static size_t reservedBytes();
+};
+
+/**
+ * @brief Mission is a coroutine driving a drone, written with the awaitables of the Missions
+ * namespace:
+ * @code
+ * Mission delivery(QString from, QString to) {
+ *     co_await Missions::flyTo(from);
+ *     co_await Missions::charged(80);
+ *     co_await Missions::sleep(5s);
+ *     co_await Missions::flyTo(to);
+ * }
+ * @endcode
+ * A mission starts suspended; MissionScheduler::start gives it its drone and resumes it at the
+ * next tick boundary. A suspended mission costs its frame only: it is resumed by the scheduler
+ * when its drone lands or its wake-up time is reached, never polled.
+ */
+class Mission {
+public:
+    struct promise_type {
+        MissionScheduler *scheduler = nullptr;
+        Drone *drone = nullptr;
+        quint64 wait = 0;           ///< ID of the pending wait (timers of older waits are ignored)
+        bool landing = false;       ///< true while the mission waits for the landing of the drone
+        QString landingName;        ///< name of the server where the drone must land
+        bool arrived = false;       ///< result of the last flyTo
+        bool begun = false;         ///< true once resumed by the scheduler
+
+        Mission get_return_object() { return Mission(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+        static void *operator new(size_t size) { return MissionFramePool::allocate(size); }
+        static void operator delete(void *frame, size_t size) { MissionFramePool::release(frame, size); }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Mission(Mission &&other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Mission(const Mission&) = delete;
+    Mission &operator=(const Mission&) = delete;
+    ~Mission() { if (handle) handle.destroy(); }
+    /**
+     * @brief release gives the coroutine to its new owner
+     * @return the coroutine
+     */
+    inline Handle release() { Handle h = handle; handle = nullptr; return h; }
+
+private:
+    explicit Mission(Handle h) : handle(h) {}
+    Handle handle;
+};
+
+/**
+ * @brief Awaitables of the missions
+ */
+namespace Missions {
+    /**
+     * @brief Flies to a server and lands there (result: false if the drone landed elsewhere
+     * because its target was changed, or the server is unknown)
+     */
+    struct FlyTo {
+        QString server;
+        Mission::promise_type *promise = nullptr;
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(Mission::Handle h);
+        bool await_resume() const noexcept { return promise->arrived; }
+    };
+    /**
+     * @brief Waits until the battery of the landed drone reaches a level (result: false if the
+     * level is not reached, the drone took off meanwhile)
+     */
+    struct Charged {
+        double percent;
+        Drone *drone = nullptr;
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(Mission::Handle h);
+        bool await_resume() const noexcept;
+    };
+    /**
+     * @brief Waits for a duration of simulation time
+     */
+    struct Sleep {
+        double seconds;
+        bool await_ready() const noexcept { return seconds <= 0; }
+        void await_suspend(Mission::Handle h);
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief flyTo
+     * @param server: name of the server
+     * @return the awaitable
+     */
+    inline FlyTo flyTo(const QString &server) { return FlyTo{server}; }
+    /**
+     * @brief charged
+     * @param percent: battery level
+     * @return the awaitable
+     */
+    inline Charged charged(double percent) { return Charged{percent}; }
+    /**
+     * @brief sleep
+     * @param duration: simulation time
+     * @return the awaitable
+     */
+    inline Sleep sleep(std::chrono::duration<double> duration) { return Sleep{duration.count()}; }
+
+    /**
+     * @brief tour visits servers: fly to each one, charge between two legs, wait, then land at
+     * the last one. The tour ends if the drone is sent elsewhere or leaves before being charged.
+     * @param servers: names of the servers
+     * @param charge: battery level required before each new leg (percent)
+     * @param dwell: seconds spent at each intermediate server
+     * @return the mission
+     */
+    Mission tour(QStringList servers, double charge, double dwell);
+}
+
+/**
+ * @brief MissionScheduler runs the missions of the drones (one per drone) on the simulation
+ * clock: the missions are resumed between two ticks, when their drone lands (see
+ * DroneScheduler::landedDrones) or when their wake-up time is due. The drone commands issued by
+ * the missions are applied like the received ones (see Canvas::applyCommands).
+ */
+class MissionScheduler {
+public:
+    MissionScheduler() = default;
+    /**
+     * @brief MissionScheduler destructor, destroys the running missions
+     */
+    ~MissionScheduler();
+    MissionScheduler(const MissionScheduler&) = delete;
+    MissionScheduler &operator=(const MissionScheduler&) = delete;
+    /**
+     * @brief setWorld gives the servers to the missions
+     * @param w: the running world
+     */
+    inline void setWorld(const Scenario *w) { world = w; }
+    /**
+     * @brief setLanding gives the pads to the missions: a flight ends on a pad of its server
+     * @param l: the landing control of the running world
+     */
+    inline void setLanding(const LandingControl *l) { landing = l; }
+    /**
+     * @brief start gives a mission to a drone, replacing its running mission
+     * @param drone: the drone
+     * @param mission: the mission, resumed at the next run()
+     */
+    void start(Drone *drone, Mission mission);
+    /**
+     * @brief drop destroys the missions of removed drones
+     * @param removed: the drones
+     */
+    void drop(const QVector<Drone*> &removed);
+    /**
+     * @brief clear destroys all the missions (the fleet is replaced)
+     */
+    void clear();
+    /**
+     * @brief run resumes the new missions, the ones whose drone landed and the ones whose time
+     * is due (between two ticks)
+     * @param now: simulation time
+     * @param landed: drones landed since the last run
+     * @param commands: receives the commands issued by the missions
+     * @return the number of resumed missions
+     */
+    int run(double now, const QVector<Drone*> &landed, QVector<DroneCommand> &commands);
+    /**
+     * @brief count
+     * @return the number of running missions
+     */
+    inline int count() const { return running.size(); }
+
+    // used by the awaitables
+    inline double now() const { return clock; }
+    inline const Scenario *getWorld() const { return world; }
+    /**
+     * @brief issue queues a command of a mission
+     * @param command: the command
+     */
+    void issue(DroneCommand &&command);
+    /**
+     * @brief waitLanding suspends a mission until its drone lands
+     * @param promise: the mission
+     * @param name: name of the expected server
+     */
+    void waitLanding(Mission::promise_type &promise, const QString &name);
+    /**
+     * @brief wakeAt suspends a mission until a simulation time
+     * @param promise: the mission
+     * @param time: simulation time
+     */
+    void wakeAt(Mission::promise_type &promise, double time);
+
+private:
+    /**
+     * @brief A wake-up of the mission of a drone
+     */
+    struct Timer {
+        double time;
+        Drone *drone;
+        quint64 wait;  ///< the timer is ignored if the mission waits for something else
+    };
+    static bool later(const Timer &a, const Timer &b) { return a.time > b.time; }
+    /**
+     * @brief resume runs a mission until its next wait, destroys it when it ends
+     * @param drone: the drone of the mission
+     * @param handle: the mission
+     */
+    void resume(Drone *drone, Mission::Handle handle);
+
+    QHash<Drone*, Mission::Handle> running; ///< mission of each drone
+    QVector<Drone*> started;                ///< drones whose mission has not run yet
+    QVector<Timer> timers;                  ///< binary heap of wake-ups (earliest first)
+    QVector<DroneCommand> issued;           ///< commands of the missions, given by run()
+    const Scenario *world = nullptr;
+    const LandingControl *landing = nullptr;
+    double clock = 0;
+    quint64 waits = 0;                      ///< last wait ID
+};
+
+#endif // MISSIONSCHEDULER_H
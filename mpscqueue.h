@@ -0,0 +1,90 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief MpscQueue is a bounded lock-free queue between several producer threads and one
+ * consumer thread. Each cell carries a sequence number telling whether it is free for the push
+ * of a given index or holds the element of a given index: a producer claims an index with a
+ * compare-exchange on head, fills the cell and publishes it; the consumer takes the cells in
+ * order. The storage is allocated once; push and pop never block and never allocate.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    /**
+     * @brief MpscQueue constructor
+     * @param capacityLog2: log2 of the number of elements
+     */
+    explicit MpscQueue(int capacityLog2) : cells(new Cell[size_t(1) << capacityLog2]), mask((quint64(1) << capacityLog2) - 1) {
+        for (quint64 i = 0; i <= mask; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    /**
+     * @brief capacity
+     * @return the number of elements the queue can hold
+     */
+    inline int capacity() const { return int(mask + 1); }
+    /**
+     * @brief push (any producer thread) appends an element
+     * @param value: the element, moved only if it is pushed
+     * @return false if the queue is full
+     */
+    bool push(T &&value) {
+        quint64 index = head.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &cells[index & mask];
+            const qint64 lag = qint64(cell->sequence.load(std::memory_order_acquire) - index);
+            if (lag == 0) {
+                if (head.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                return false; // the cell still holds the element pushed one lap before
+            } else {
+                index = head.load(std::memory_order_relaxed); // claimed by another producer
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(index + 1, std::memory_order_release);
+        return true;
+    }
+    /**
+     * @brief pop (consumer) takes the oldest element
+     * @param value: receives the element
+     * @return false if the queue is empty (or its oldest element is still being written)
+     */
+    bool pop(T &value) {
+        Cell &cell = cells[tail & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != tail + 1) {
+            return false;
+        }
+        value = std::move(cell.value);
+        cell.sequence.store(tail + mask + 1, std::memory_order_release); // free for the next lap
+        tail++;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<quint64> sequence;
+        T value;
+    };
+    std::unique_ptr<Cell[]> cells;
+    const quint64 mask;
+    alignas(64) std::atomic<quint64> head{0}; ///< next index to claim, shared by the producers
+    alignas(64) quint64 tail = 0;             ///< next index to pop, owned by the consumer
+};
+
+#endif // MPSCQUEUE_H
@@ -0,0 +1,984 @@
+#include "scenario.h"
+#include "tilestore.h"
+#include <QObject>
+#include <QFile>
+#include <QDebug>
+#include <QStringList>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+/**
+ * @brief Scenario::load reads the file, parses the JSON data and builds the connections,
+ * the routing table and the Voronoi raster. The progress callback is called between
+ * every stage and the build stops as soon as it returns false.
+ * @param jsonFilePath The path to the JSON file to be loaded.
+ * @param rasterSize size of the Voronoi raster
+ * @param error message set on failure
+ * @param progress optional progress callback
+ * @param complete if false, stops after parsing the servers and drones
+ * @return true if the scenario is loaded
+ */
+bool Scenario::load(const QString &jsonFilePath, const QSize &rasterSize, QString &error, const Progress &progress, bool complete) {
+    auto step = [&progress](int percent) { return !progress || progress(percent); };
+
+    QFile file(jsonFilePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = QObject::tr("Couldn't open the selected JSON file.");
+        return false;
+    }
+
+    QByteArray jsonData = file.readAll();
+    file.close();
+    if (!step(10)) return false;
+
+    // Parse JSON data
+    QJsonDocument doc = QJsonDocument::fromJson(jsonData);
+    if (doc.isNull() || !doc.isObject()) {
+        error = QObject::tr("Invalid JSON file format.");
+        return false;
+    }
+    if (!step(20)) return false;
+
+    if (!parse(doc.object(), error)) return false;
+    if (!complete) return step(100);
+    if (!step(30)) return false;
+
+    buildConnections();
+    if (!step(40)) return false;
+
+    buildRoutingTable();
+    if (!step(50)) return false;
+
+    // the raster takes the remaining half of the progress
+    if (!rasterize(rasterSize, [&step](int percent) { return step(50 + percent / 2); })) {
+        return false;
+    }
+    return step(100);
+}
+
+/**
+ * @brief Scenario::parse reads the servers and the drones from the JSON data.
+ * @param rootObj root object of the JSON file
+ * @param error message set if there is no 'servers' array
+ * @return true if the servers are found
+ */
+bool Scenario::parse(const QJsonObject &rootObj, QString &error) {
+    // Parse servers
+    if (!rootObj.contains("servers") || !rootObj["servers"].isArray()) {
+        error = QObject::tr("No 'servers' array found in the JSON file.");
+        return false;
+    }
+    const QJsonArray serversArray = rootObj["servers"].toArray();
+    servers.clear();
+    serverIndex.clear();
+    servers.reserve(serversArray.size());
+
+    for (const QJsonValue &serverValue : serversArray) {
+        QJsonObject serverObj = serverValue.toObject();
+        QString name = serverObj["name"].toString();
+        QStringList positionStr = serverObj["position"].toString().split(",");
+        QColor color(serverObj["color"].toString());
+
+        if (positionStr.size() == 2) {
+            int x = positionStr[0].toInt();
+            int y = positionStr[1].toInt();
+
+            Server server;
+            server.name = name;
+            server.position = Vector2D(x, y);
+            server.color = color;
+            server.capacity = serverObj["capacity"].toInt(server.capacity);
+
+            serverIndex.insert(name, servers.size());
+            servers.append(server);
+        }
+    }
+    qDebug() << "Servers loaded:" << servers.size();
+
+    // Parse drone types, the missing characteristics are the ones of the standard type
+    types.clear();
+    if (rootObj.contains("types") && rootObj["types"].isArray()) {
+        const QJsonArray typesArray = rootObj["types"].toArray();
+        // from the profile: the type table belongs to the GUI thread
+        const DroneType standard = DroneType::fromProfile<StandardProfile>("standard");
+        for (const QJsonValue &typeValue : typesArray) {
+            QJsonObject typeObj = typeValue.toObject();
+            DroneType type = standard;
+            type.name = typeObj["name"].toString();
+            if (type.name.isEmpty()) {
+                qDebug() << "Drone type without name ignored";
+                continue;
+            }
+            type.maxSpeed = typeObj["maxSpeed"].toDouble(standard.maxSpeed);
+            type.maxPower = typeObj["maxPower"].toDouble(standard.maxPower);
+            type.takeoffSpeed = typeObj["takeoffSpeed"].toDouble(standard.takeoffSpeed);
+            type.hoveringHeight = typeObj["hoveringHeight"].toDouble(standard.hoveringHeight);
+            type.damping = typeObj["damping"].toDouble(standard.damping);
+            type.chargingSpeed = typeObj["chargingSpeed"].toDouble(standard.chargingSpeed);
+            type.powerConsumption = typeObj["powerConsumption"].toDouble(standard.powerConsumption);
+            // the phases and ranges divide by these rates
+            if (!(type.maxSpeed > 0 && type.maxPower > 0 && type.takeoffSpeed > 0 && type.hoveringHeight >= 0
+                  && type.chargingSpeed > 0 && type.powerConsumption > 0)) {
+                qDebug() << "Drone type" << type.name << "ignored: speeds, power and rates must be positive";
+                continue;
+            }
+            types.append(type);
+        }
+    }
+
+    // Parse drones
+    drones.clear();
+    if (rootObj.contains("drones") && rootObj["drones"].isArray()) {
+        const QJsonArray dronesArray = rootObj["drones"].toArray();
+        drones.reserve(dronesArray.size());
+
+        for (const QJsonValue &droneValue : dronesArray) {
+            QJsonObject droneObj = droneValue.toObject();
+            QStringList positionStr = droneObj["position"].toString().split(",");
+            if (positionStr.size() == 2) {
+                DroneSpec spec;
+                spec.name = droneObj["name"].toString();
+                spec.server = droneObj["server"].toString();
+                spec.type = droneObj["type"].toString();
+                spec.position = Vector2D(positionStr[0].toInt(), positionStr[1].toInt());
+                if (!serverIndex.contains(spec.server)) {
+                    qDebug() << "Server" << spec.server << "not found for drone" << spec.name;
+                }
+                drones.append(spec);
+            }
+        }
+    }
+    qDebug() << "Drones loaded:" << drones.size();
+    return true;
+}
+
+/**
+ * @brief Scenario::buildConnections connects every couple of servers closer than connectionDistance.
+ */
+void Scenario::buildConnections() {
+    serverConnections.clear();
+    for (int i = 0; i < servers.size(); ++i) {
+        for (int j = i + 1; j < servers.size(); ++j) {
+            if (!servers[i].online || !servers[j].online) continue;
+            // Calculate the distance between two servers
+            double distance = (servers[i].position - servers[j].position).length();
+
+            if (distance < connectionDistance) {
+                serverConnections[servers[i].name].insert(servers[j].name);
+                serverConnections[servers[j].name].insert(servers[i].name); // Bidirectional connection
+            }
+        }
+    }
+}
+
+/**
+ * @brief Scenario::buildRoutingTable converts the name based connections to an adjacency list of indices
+ * and runs a BFS from every server to fill the next hop table, with the hop count and the BFS
+ * tree used by the runtime repairs. The table is built once per loaded scenario so that routing
+ * a drone in the simulation tick is a lookup without allocation.
+ */
+void Scenario::buildRoutingTable() {
+    const int n = servers.size();
+    adjacency.fill(QVector<int>(), n);
+    for (auto it = serverConnections.cbegin(); it != serverConnections.cend(); ++it) {
+        int a = serverIndex.value(it.key(), -1);
+        if (a < 0) continue;
+        for (const QString &nameB : it.value()) {
+            int b = serverIndex.value(nameB, -1);
+            if (b >= 0 && b != a) adjacency[a].append(b);
+        }
+    }
+
+    nextHop.fill(-1, n * n);
+    hopCount.fill(-1, n * n);
+    hopParent.fill(-1, n * n);
+    QVector<int> queue(n);
+    for (int source = 0; source < n; source++) {
+        int *hop = nextHop.data() + source * n;
+        int *count = hopCount.data() + source * n;
+        int *parent = hopParent.data() + source * n;
+        int head = 0, tail = 0;
+        hop[source] = source;
+        count[source] = 0;
+        queue[tail++] = source;
+        while (head < tail) {
+            int current = queue[head++];
+            for (int neighbor : adjacency[current]) {
+                if (hop[neighbor] < 0) {
+                    // first hop is inherited from the parent, except for the direct neighbors of source
+                    hop[neighbor] = (current == source) ? neighbor : hop[current];
+                    count[neighbor] = count[current] + 1;
+                    parent[neighbor] = current;
+                    queue[tail++] = neighbor;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Scenario::rasterize fills each pixel with the color of the closest server
+ * and keeps the index of this server in regionIds.
+ * @param size size of the image
+ * @param progress optional progress callback (checked every few rows)
+ * @return false if the build was canceled
+ */
+bool Scenario::rasterize(const QSize &size, const Progress &progress) {
+    if (servers.isEmpty() || size.isEmpty()) {
+        background = QImage();
+        regionIds.clear();
+        regionBounds.clear();
+        return true;
+    }
+
+    QImage img(size, QImage::Format_RGB32);
+    QVector<int> ids(size.width() * size.height());
+    QVector<QRgb> colors(servers.size());
+    for (int i = 0; i < servers.size(); i++) {
+        colors[i] = servers[i].color.rgb();
+    }
+
+    for (int y = 0; y < size.height(); y++) {
+        if (progress && (y % 32) == 0 && !progress(100 * y / size.height())) {
+            return false;
+        }
+        QRgb *line = reinterpret_cast<QRgb*>(img.scanLine(y));
+        int *lineIds = ids.data() + y * size.width();
+        for (int x = 0; x < size.width(); x++) {
+            // Find the closest server
+            const int closest = closestOnline(x, y);
+            line[x] = colors[closest];
+            lineIds[x] = closest;
+        }
+    }
+    background = img;
+    regionIds = ids;
+    regionBounds.clear();
+    updateBounds();
+    return true;
+}
+
+/**
+ * @brief Scenario::nearestServer returns the closest online server of a position (linear search).
+ * @param position the position
+ * @return index of the server, -1 if there is no server
+ */
+int Scenario::nearestServer(const Vector2D &position) const {
+    return closestOnline(position.x, position.y);
+}
+
+/**
+ * @brief Scenario::closestOnline the offline servers are skipped, unless they are all offline:
+ * the regions then stay the ones of the servers.
+ */
+int Scenario::closestOnline(double x, double y) const {
+    double minDistance = std::numeric_limits<double>::max();
+    double minAnyDistance = minDistance;
+    int closest = -1, closestAny = -1;
+    for (int i = 0; i < servers.size(); i++) {
+        double dx = x - servers[i].position.x, dy = y - servers[i].position.y;
+        double distance = dx * dx + dy * dy;
+        if (distance < minAnyDistance) {
+            minAnyDistance = distance;
+            closestAny = i;
+        }
+        if (servers[i].online && distance < minDistance) {
+            minDistance = distance;
+            closest = i;
+        }
+    }
+    return closest >= 0 ? closest : closestAny;
+}
+
+/**
+ * @brief Scenario::regionAt reads the server of a position in the region raster,
+ * which is the Voronoi diagram drawn on the canvas. Positions outside of the raster
+ * are read in the tile store if any, then fall back to the linear search.
+ * @param position the position
+ * @return index of the server, -1 if there is no server
+ */
+int Scenario::regionAt(const Vector2D &position) const {
+    const int x = int(position.x), y = int(position.y);
+    const int w = background.width();
+    if (x >= 0 && y >= 0 && x < w && y < background.height() && !regionIds.isEmpty()) {
+        return regionIds[y * w + x];
+    }
+    if (tiles) {
+        // the tiles are built for all the servers
+        int region = tiles->regionAt(position);
+        if (region >= 0 && servers[region].online) {
+            return region;
+        }
+    }
+    return nearestServer(position);
+}
+
+/**
+ * @brief Scenario::locate finds the server region of every position in a single pass
+ * over a contiguous array: one raster read per position, O(positions) instead of
+ * O(positions x servers).
+ * @param positions the positions
+ * @param regions filled with the index of the server of each position
+ */
+void Scenario::locate(const QVector<Vector2D> &positions, QVector<int> &regions) const {
+    const int n = positions.size();
+    regions.resize(n);
+    const Vector2D *p = positions.constData();
+    int *r = regions.data();
+    const int w = background.width(), h = background.height();
+    const int *ids = regionIds.isEmpty() ? nullptr : regionIds.constData();
+    for (int i = 0; i < n; i++) {
+        const int x = int(p[i].x), y = int(p[i].y);
+        if (ids && x >= 0 && y >= 0 && x < w && y < h) {
+            r[i] = ids[y * w + x];
+        } else if (!tiles || (r[i] = tiles->regionAt(p[i])) < 0 || !servers[r[i]].online) {
+            r[i] = nearestServer(p[i]);
+        }
+    }
+}
+
+/**
+ * @brief Scenario::mergeServers diffs a new list of servers against the current one by name.
+ * The routing table is repaired like for the runtime changes: the moved servers are reconnected
+ * with addConnection and removeConnection (local repairs), the removed servers are disconnected
+ * the same way then the tables are compacted in one copy (a removed server is replaced by the
+ * last one), and the added servers are appended then connected. The raster is only recomputed
+ * in the bounding boxes of the regions that can change (see updateRaster).
+ * @param nextServers the new list of servers
+ * @return the number of added, removed, moved and recolored servers, the moved and added ones and
+ * the new index of each previous server
+ */
+Scenario::ServerDiff Scenario::mergeServers(const QVector<Server> &nextServers) {
+    ServerDiff diff;
+    const int previousCount = servers.size();
+    QVector<int> dirty, recolored, removed;
+    QVector<QRect> stale; // regions of the previous raster whose pixels must be checked
+    QHash<QString,int> nextIndex;
+    for (int j = 0; j < nextServers.size(); j++) {
+        nextIndex.insert(nextServers[j].name, j);
+    }
+    updateBounds();
+
+    // moved and recolored servers keep their index
+    for (int i = 0; i < previousCount; i++) {
+        int j = nextIndex.value(servers[i].name, -1);
+        if (j < 0) {
+            removed.append(i);
+            continue;
+        }
+        const Server &next = nextServers[j];
+        if (next.position != servers[i].position) {
+            relocate(i, next.position);
+            dirty.append(i);
+            diff.moved++;
+        }
+        servers[i].capacity = next.capacity;
+        if (next.color != servers[i].color) {
+            servers[i].color = next.color;
+            recolored.append(i);
+            diff.recolored++;
+        }
+    }
+
+    // removed servers are disconnected, then replaced by the last one (from the highest index)
+    QVector<int> origin(previousCount); // previous index of the server in each slot
+    for (int i = 0; i < previousCount; i++) {
+        origin[i] = i;
+    }
+    for (int index : removed) {
+        while (!adjacency[index].isEmpty()) {
+            removeConnection(index, adjacency[index].last());
+        }
+    }
+    for (int k = removed.size() - 1; k >= 0; k--) {
+        int index = removed[k];
+        int last = servers.size() - 1;
+        serverConnections.remove(servers[index].name);
+        serverIndex.remove(servers[index].name);
+        if (index != last) {
+            servers[index] = servers[last];
+            origin[index] = origin[last];
+            serverIndex.insert(servers[index].name, index);
+        }
+        servers.removeLast();
+        origin.removeLast();
+        diff.removed++;
+    }
+    QVector<int> newIndex(previousCount, -1);
+    for (int slot = 0; slot < origin.size(); slot++) {
+        newIndex[origin[slot]] = slot;
+    }
+    if (!removed.isEmpty()) {
+        compactTables(newIndex);
+        diff.remap = newIndex;
+    }
+
+    // the pixels of the removed and moved servers are searched again, the ones of the recolored
+    // and renumbered servers repainted
+    QVector<int> remap(previousCount);
+    for (int i = 0; i < previousCount; i++) {
+        remap[i] = newIndex[i];
+        if (newIndex[i] != i || recolored.contains(i) || dirty.contains(i)) {
+            stale.append(regionBounds.value(i));
+        }
+    }
+    for (int &d : dirty) {
+        remap[d] = -1;
+        d = newIndex[d];
+    }
+    for (int &c : recolored) {
+        c = newIndex[c];
+    }
+    QVector<QRect> bounds(servers.size());
+    for (int i = 0; i < previousCount; i++) {
+        if (remap[i] >= 0) {
+            bounds[remap[i]] = regionBounds.value(i);
+        }
+    }
+    regionBounds = bounds;
+
+    // added servers are appended
+    int added = 0;
+    for (const Server &next : nextServers) {
+        if (!serverIndex.contains(next.name)) {
+            added++;
+        }
+    }
+    if (added > 0) {
+        growTables(added);
+        for (const Server &next : nextServers) {
+            if (!serverIndex.contains(next.name)) {
+                const int index = servers.size();
+                serverIndex.insert(next.name, index);
+                servers.append(next);
+                adjacency.append(QVector<int>());
+                regionBounds.append(QRect());
+                dirty.append(index);
+                diff.added++;
+            }
+        }
+        for (int index = servers.size() - added; index < servers.size(); index++) {
+            connectInRange(index);
+        }
+    }
+
+    if (diff.added + diff.removed + diff.moved + diff.recolored == 0) {
+        return diff;
+    }
+    diff.changed = dirty;
+    tiles.reset(); // the regions of the tiles are out of date (see TileStore::matches)
+    updateRaster(remap, dirty, recolored, stale);
+    return diff;
+}
+
+/**
+ * @brief Scenario::updateBounds computes the bounding box of the region of each server from
+ * regionIds if it is not known (raster restored from a snapshot).
+ */
+void Scenario::updateBounds() {
+    if (regionBounds.size() == servers.size() || background.isNull()) {
+        return;
+    }
+    regionBounds.fill(QRect(), servers.size());
+    const int w = background.width(), h = background.height();
+    for (int y = 0; y < h; y++) {
+        const int *lineIds = regionIds.constData() + y * w;
+        for (int x = 0; x < w; x++) {
+            const int id = lineIds[x];
+            if (id >= 0 && id < servers.size()) {
+                QRect &r = regionBounds[id];
+                r = r.isNull() ? QRect(x, y, 1, 1) : r.united(QRect(x, y, 1, 1));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Scenario::cellBounds flood fill of the pixels a dirty server can take, from its own
+ * pixel: the pixels where it is closer than their owner, or whose owner is searched again. A
+ * Voronoi region is convex, so the fill covers it and stops at its border.
+ * @param index index of the server
+ * @param remap new index of each previous server, -1 if its pixels must be searched again
+ * @return the bounding box of the filled pixels, the whole raster if the server is out of it
+ */
+QRect Scenario::cellBounds(int index, const QVector<int> &remap) {
+    const int w = background.width(), h = background.height();
+    const Vector2D &p = servers[index].position;
+    const int sx = int(p.x), sy = int(p.y);
+    if (!(p.x >= 0 && p.y >= 0 && sx < w && sy < h)) {
+        return QRect(0, 0, w, h);
+    }
+    if (floodMark.size() != w * h) {
+        floodMark.fill(0, w * h);
+        floodStamp = 0;
+    }
+    if (++floodStamp == 0) {
+        std::fill(floodMark.begin(), floodMark.end(), 0);
+        floodStamp = 1;
+    }
+    auto takes = [&](int x, int y) {
+        const int previous = regionIds[y * w + x];
+        const int owner = previous >= 0 ? remap[previous] : -1;
+        if (owner < 0 || owner == index) {
+            return true;
+        }
+        double dx = x - p.x, dy = y - p.y, ox = x - servers[owner].position.x, oy = y - servers[owner].position.y;
+        return dx * dx + dy * dy < ox * ox + oy * oy;
+    };
+    QRect bounds(sx, sy, 1, 1);
+    QVector<int> stack;
+    stack.append(sy * w + sx);
+    floodMark[sy * w + sx] = floodStamp;
+    while (!stack.isEmpty()) {
+        const int pixel = stack.last();
+        stack.removeLast();
+        const int x = pixel % w, y = pixel / w;
+        bounds = bounds.united(QRect(x, y, 1, 1));
+        for (int ny = std::max(0, y - 1); ny <= std::min(h - 1, y + 1); ny++) {
+            for (int nx = std::max(0, x - 1); nx <= std::min(w - 1, x + 1); nx++) {
+                const int next = ny * w + nx;
+                if (floodMark[next] != floodStamp && takes(nx, ny)) {
+                    floodMark[next] = floodStamp;
+                    stack.append(next);
+                }
+            }
+        }
+    }
+    return bounds;
+}
+
+/**
+ * @brief Scenario::updateRaster recomputes the owner of the pixels that can change after a merge
+ * or a runtime change. Only the stale regions (previous bounding boxes of the removed, moved,
+ * recolored or renumbered servers) and the new regions of the dirty servers (found by a flood
+ * fill) are scanned, row by row over the union of their intervals.
+ * A pixel whose server was removed, moved or taken offline is searched among all the online
+ * servers; any other pixel keeps its server unless one of the dirty servers is now closer.
+ * The cost is O(changed pixels x dirty servers) instead of O(pixels x servers) for a full raster.
+ * @param remap new index of each previous server, -1 if its pixels must be recomputed
+ * @param dirty added or moved servers
+ * @param recolored servers whose color changed
+ * @param stale bounding boxes of the previous regions to scan
+ */
+void Scenario::updateRaster(const QVector<int> &remap, const QVector<int> &dirty, const QVector<int> &recolored, const QVector<QRect> &stale) {
+    if (background.isNull()) return;
+    if (servers.isEmpty()) {
+        background = QImage();
+        regionIds.clear();
+        regionBounds.clear();
+        return;
+    }
+
+    const int w = background.width(), h = background.height();
+    const QRect raster(0, 0, w, h);
+    QVector<QRgb> colors(servers.size());
+    QVector<bool> repaint(servers.size(), false);
+    for (int i = 0; i < servers.size(); i++) {
+        colors[i] = servers[i].color.rgb();
+    }
+    for (int index : recolored) {
+        repaint[index] = true;
+    }
+
+    QVector<QRect> rects;
+    for (const QRect &r : stale) {
+        if (!r.isNull()) {
+            rects.append(r.intersected(raster));
+        }
+    }
+    for (int index : dirty) {
+        if (servers[index].online) {
+            rects.append(cellBounds(index, remap));
+        }
+    }
+    regionBounds.resize(servers.size());
+
+    auto distance2 = [](int x, int y, const Vector2D &p) {
+        double dx = x - p.x, dy = y - p.y;
+        return dx * dx + dy * dy;
+    };
+
+    QVector<QPair<int,int>> intervals;
+    for (int y = 0; y < h; y++) {
+        // the intervals of the rectangles on this row, merged so that no pixel is seen twice
+        intervals.clear();
+        for (const QRect &r : rects) {
+            if (y >= r.top() && y <= r.bottom() && !r.isEmpty()) {
+                intervals.append(qMakePair(r.left(), r.right()));
+            }
+        }
+        if (intervals.isEmpty()) {
+            continue;
+        }
+        std::sort(intervals.begin(), intervals.end());
+        QRgb *line = reinterpret_cast<QRgb*>(background.scanLine(y));
+        int *lineIds = regionIds.data() + y * w;
+        int done = -1; // last pixel of the row already updated
+        for (const QPair<int,int> &interval : intervals) {
+            for (int x = std::max(interval.first, done + 1); x <= interval.second; x++) {
+                const int previous = lineIds[x];
+                int owner = previous >= 0 ? remap[previous] : -1;
+                if (owner < 0) {
+                    // the owner was removed, moved or taken offline: search among all the servers
+                    owner = closestOnline(x, y);
+                } else {
+                    double minDistance = distance2(x, y, servers[owner].position);
+                    for (int index : dirty) {
+                        if (!servers[index].online) {
+                            continue;
+                        }
+                        double d = distance2(x, y, servers[index].position);
+                        if (d < minDistance) {
+                            minDistance = d;
+                            owner = index;
+                        }
+                    }
+                }
+                if (owner != previous || previous < 0 || remap[previous] != previous || repaint[owner]) {
+                    line[x] = colors[owner];
+                }
+                lineIds[x] = owner;
+                QRect &bounds = regionBounds[owner];
+                if (!bounds.contains(x, y)) {
+                    bounds = bounds.isNull() ? QRect(x, y, 1, 1) : bounds.united(QRect(x, y, 1, 1));
+                }
+            }
+            done = std::max(done, interval.second);
+        }
+    }
+}
+
+/**
+ * @brief Scenario::addConnection adds the connection in both adjacency lists and repairs the
+ * routing table.
+ * @param a index of a server
+ * @param b index of another server
+ * @return false if the connection already exists
+ */
+bool Scenario::addConnection(int a, int b) {
+    if (a == b || adjacency[a].contains(b)) {
+        return false;
+    }
+    serverConnections[servers[a].name].insert(servers[b].name);
+    serverConnections[servers[b].name].insert(servers[a].name);
+    adjacency[a].append(b);
+    adjacency[b].append(a);
+    repairInsertion(a, b);
+    return true;
+}
+
+/**
+ * @brief Scenario::removeConnection removes the connection from both adjacency lists and
+ * repairs the routing table.
+ * @param a index of a server
+ * @param b index of another server
+ * @return false if there was no connection
+ */
+bool Scenario::removeConnection(int a, int b) {
+    if (!adjacency[a].removeOne(b)) {
+        return false;
+    }
+    adjacency[b].removeOne(a);
+    serverConnections[servers[a].name].remove(servers[b].name);
+    serverConnections[servers[b].name].remove(servers[a].name);
+    repairDeletion(a, b);
+    return true;
+}
+
+void Scenario::connectInRange(int index) {
+    if (!servers[index].online) return;
+    for (int j = 0; j < servers.size(); j++) {
+        if (j != index && servers[j].online
+            && (servers[j].position - servers[index].position).length() < connectionDistance) {
+            addConnection(index, j);
+        }
+    }
+}
+
+/**
+ * @brief Scenario::setOnline removes or restores the connections of a server one by one, each
+ * one with an incremental repair, then gives its region to its neighbors or takes it back.
+ * @param index index of the server
+ * @param online new state
+ * @return false if the state did not change
+ */
+bool Scenario::setOnline(int index, bool online) {
+    if (servers[index].online == online) {
+        return false;
+    }
+    servers[index].online = online;
+    if (online) {
+        connectInRange(index);
+    } else {
+        while (!adjacency[index].isEmpty()) {
+            removeConnection(index, adjacency[index].last());
+        }
+    }
+
+    // an offline server has no region: its pixels go to the closest online servers
+    updateBounds();
+    QVector<int> remap(servers.size());
+    for (int i = 0; i < servers.size(); i++) {
+        remap[i] = i;
+    }
+    if (online) {
+        updateRaster(remap, {index}, {}, {});
+    } else {
+        remap[index] = -1;
+        updateRaster(remap, {}, {}, {regionBounds.value(index)});
+    }
+    return true;
+}
+
+/**
+ * @brief Scenario::moveServer reconnects the server at its new position and updates the raster
+ * like a merge with one moved server.
+ * @param index index of the server
+ * @param position new position
+ * @return false if the position did not change
+ */
+bool Scenario::moveServer(int index, const Vector2D &position) {
+    if (servers[index].position == position) {
+        return false;
+    }
+    updateBounds();
+    relocate(index, position);
+    tiles.reset(); // the regions of the tiles are out of date
+
+    QVector<int> remap(servers.size());
+    for (int i = 0; i < servers.size(); i++) {
+        remap[i] = i;
+    }
+    remap[index] = -1;
+    const QRect previous = regionBounds.value(index);
+    regionBounds[index] = QRect();
+    updateRaster(remap, {index}, {}, {previous});
+    return true;
+}
+
+/**
+ * @brief Scenario::relocate moves a server; the connections that stay in range are kept, the
+ * others are removed then the new ones added, each one with a local repair.
+ * @param index index of the server
+ * @param position new position
+ */
+void Scenario::relocate(int index, const Vector2D &position) {
+    QVector<int> previous = adjacency[index];
+    for (int neighbor : previous) {
+        if ((servers[neighbor].position - position).length() >= connectionDistance) {
+            removeConnection(index, neighbor);
+        }
+    }
+    servers[index].position = position;
+    connectInRange(index);
+}
+
+/**
+ * @brief Scenario::addServer grows the routing tables by one row and one column (the new server
+ * is unreachable), then connects it with incremental repairs and updates the raster.
+ * @param server the server
+ * @return its index, -1 if the name is already used
+ */
+int Scenario::addServer(const Server &server) {
+    if (serverIndex.contains(server.name)) {
+        return -1;
+    }
+    updateBounds();
+    const int n = servers.size();
+    growTables(1);
+    servers.append(server);
+    serverIndex.insert(server.name, n);
+    adjacency.append(QVector<int>());
+    regionBounds.append(QRect());
+    connectInRange(n);
+    tiles.reset(); // the regions of the tiles are out of date
+
+    QVector<int> remap(n);
+    for (int i = 0; i < n; i++) {
+        remap[i] = i;
+    }
+    updateRaster(remap, {n}, {}, {});
+    return n;
+}
+
+/**
+ * @brief Scenario::growTables copies the routing tables in larger ones, the new servers are
+ * unreachable (and reach themselves)
+ * @param extra number of new servers
+ */
+void Scenario::growTables(int extra) {
+    const int n = servers.size();
+    const int m = n + extra;
+    QVector<int> hop(m * m, -1), count(m * m, -1), parent(m * m, -1);
+    for (int from = 0; from < n; from++) {
+        std::copy(nextHop.constData() + from * n, nextHop.constData() + (from + 1) * n, hop.data() + from * m);
+        std::copy(hopCount.constData() + from * n, hopCount.constData() + (from + 1) * n, count.data() + from * m);
+        std::copy(hopParent.constData() + from * n, hopParent.constData() + (from + 1) * n, parent.data() + from * m);
+    }
+    for (int k = n; k < m; k++) {
+        hop[k * m + k] = k;
+        count[k * m + k] = 0;
+    }
+    nextHop.swap(hop);
+    hopCount.swap(count);
+    hopParent.swap(parent);
+}
+
+/**
+ * @brief Scenario::compactTables renumbers the routing tables and the adjacency list after the
+ * removal of disconnected servers (no path goes through them)
+ * @param newIndex new index of each previous server, -1 if removed
+ */
+void Scenario::compactTables(const QVector<int> &newIndex) {
+    const int n = newIndex.size();
+    const int m = servers.size();
+    auto renumber = [&newIndex](int v) { return v < 0 ? -1 : newIndex[v]; };
+    QVector<int> hop(m * m, -1), count(m * m, -1), parent(m * m, -1);
+    QVector<QVector<int>> neighbors(m);
+    for (int from = 0; from < n; from++) {
+        const int f = newIndex[from];
+        if (f < 0) {
+            continue;
+        }
+        for (int to = 0; to < n; to++) {
+            const int t = newIndex[to];
+            if (t >= 0) {
+                hop[f * m + t] = renumber(nextHop[from * n + to]);
+                count[f * m + t] = hopCount[from * n + to];
+                parent[f * m + t] = renumber(hopParent[from * n + to]);
+            }
+        }
+        for (int v : adjacency[from]) {
+            neighbors[f].append(newIndex[v]);
+        }
+    }
+    nextHop.swap(hop);
+    hopCount.swap(count);
+    hopParent.swap(parent);
+    adjacency.swap(neighbors);
+}
+
+/**
+ * @brief Scenario::repairInsertion for each source, if the new connection shortens the path to
+ * one of its ends, a BFS from this end relaxes only the servers that get closer. A server
+ * that gets closer takes the first hop of its new parent, and so do its subtree.
+ * @param a index of a server
+ * @param b index of another server
+ */
+void Scenario::repairInsertion(int a, int b) {
+    const int n = servers.size();
+    QVector<int> queue(n);
+    for (int source = 0; source < n; source++) {
+        int *hop = nextHop.data() + source * n;
+        int *count = hopCount.data() + source * n;
+        int *parent = hopParent.data() + source * n;
+        int head = 0, tail = 0;
+        auto relax = [&](int from, int to) {
+            if (count[from] >= 0 && (count[to] < 0 || count[to] > count[from] + 1)) {
+                count[to] = count[from] + 1;
+                parent[to] = from;
+                hop[to] = (from == source) ? to : hop[from];
+                queue[tail++] = to;
+            }
+        };
+        relax(a, b);
+        relax(b, a);
+        while (head < tail) {
+            int current = queue[head++];
+            for (int neighbor : adjacency[current]) {
+                relax(current, neighbor);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Scenario::repairDeletion for each source whose BFS tree used the connection, the
+ * subtree below it is detached: it is walked from its root through the children of each server,
+ * which are its neighbors whose parent it is, so only the subtree is visited. Each of its servers
+ * is seeded from its best neighbor out of the subtree, then the paths are propagated inside the
+ * subtree in increasing hop count. The other servers keep their path, which did not use the
+ * connection. The cost for a source is O(degrees of its subtree x log), not O(servers).
+ * @param a index of a server
+ * @param b index of another server
+ */
+void Scenario::repairDeletion(int a, int b) {
+    const int n = servers.size();
+    QVector<int> mark(n, -1);   // source whose detached subtree contains the server
+    QVector<int> subtree;
+    struct Candidate {
+        int count;
+        int server;
+    };
+    auto farther = [](const Candidate &x, const Candidate &y) { return x.count > y.count; };
+    QVector<Candidate> heap;
+    for (int source = 0; source < n; source++) {
+        int *hop = nextHop.data() + source * n;
+        int *count = hopCount.data() + source * n;
+        int *parent = hopParent.data() + source * n;
+        int root;
+        if (parent[b] == a) {
+            root = b;
+        } else if (parent[a] == b) {
+            root = a;
+        } else {
+            continue; // the connection is not in the tree of this source
+        }
+
+        // the subtree hanging on root, in BFS order (the tree connections are in adjacency)
+        subtree.clear();
+        subtree.append(root);
+        mark[root] = source;
+        for (int i = 0; i < subtree.size(); i++) {
+            const int v = subtree[i];
+            for (int w : adjacency[v]) {
+                if (parent[w] == v && mark[w] != source) {
+                    mark[w] = source;
+                    subtree.append(w);
+                }
+            }
+        }
+        for (int v : subtree) {
+            count[v] = -1;
+            hop[v] = -1;
+            parent[v] = -1;
+        }
+
+        // seeds from the servers out of the subtree, then propagation in increasing count
+        heap.clear();
+        for (int v : subtree) {
+            for (int u : adjacency[v]) {
+                if (mark[u] != source && count[u] >= 0 && (count[v] < 0 || count[u] + 1 < count[v])) {
+                    count[v] = count[u] + 1;
+                    parent[v] = u;
+                    hop[v] = (u == source) ? v : hop[u];
+                }
+            }
+            if (count[v] >= 0) {
+                heap.append(Candidate{count[v], v});
+                std::push_heap(heap.begin(), heap.end(), farther);
+            }
+        }
+        while (!heap.isEmpty()) {
+            std::pop_heap(heap.begin(), heap.end(), farther);
+            Candidate c = heap.last();
+            heap.removeLast();
+            if (c.count > count[c.server]) {
+                continue;
+            }
+            for (int w : adjacency[c.server]) {
+                if (mark[w] == source && (count[w] < 0 || count[w] > c.count + 1)) {
+                    count[w] = c.count + 1;
+                    parent[w] = c.server;
+                    hop[w] = (c.server == source) ? w : hop[c.server];
+                    heap.append(Candidate{count[w], w});
+                    std::push_heap(heap.begin(), heap.end(), farther);
+                }
+            }
+        }
+    }
+}
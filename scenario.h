@@ -0,0 +1,251 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QColor>
+#include <QImage>
+#include <QPolygonF>
+#include <QRect>
+#include <functional>
+#include <memory>
+#include "vector2d.h"
+#include "dronetype.h"
+
+class QJsonObject;
+class TileStore;
+
+/**
+ * @brief Represents a server with name, position, color, and polygon.
+ */
+struct Server {
+    QString name;
+    Vector2D position;
+    QColor color;
+    QPolygonF polygon;
+    int capacity = 8;   ///< number of landing pads
+    bool online = true; ///< false when the server is down: no connection and no landing
+};
+
+/**
+ * @brief Description of a drone read in a scenario file.
+ */
+struct DroneSpec {
+    QString name;      ///< name of the drone
+    Vector2D position; ///< initial position
+    QString server;    ///< name of the target server
+    QString type;      ///< name of the type of the drone (empty for the standard type)
+};
+
+/**
+ * @brief A complete world (servers, drones, connections, routing table and Voronoi raster)
+ * built from a JSON file. It only contains plain data so that it can be built
+ * outside of the GUI thread and then adopted by the Canvas.
+ */
+class Scenario {
+public:
+    /**
+     * @brief Progress callback: receives a percentage and returns false to cancel the build
+     */
+    using Progress = std::function<bool(int)>;
+    /**
+     * @brief Servers changed by mergeServers()
+     */
+    struct ServerDiff {
+        int added=0, removed=0, moved=0, recolored=0;
+        QVector<int> remap;   ///< new index of each previous server, -1 if removed (empty if none was removed)
+        QVector<int> changed; ///< new indices of the moved and added servers
+    };
+
+    QVector<Server> servers;                      ///< list of servers
+    QHash<QString,int> serverIndex;               ///< index in servers of each server name
+    QMap<QString, QSet<QString>> serverConnections; ///< adjacency list for server connections
+    QVector<QVector<int>> adjacency;              ///< adjacency list of the servers by index
+    QVector<int> nextHop;                         ///< nextHop[from*servers.size()+to], -1 if unreachable
+    QVector<int> hopCount;                        ///< hopCount[from*servers.size()+to] connections on the path, -1 if unreachable
+    QVector<int> hopParent;                       ///< hopParent[from*servers.size()+to] server before to on the path, -1 if none
+    QVector<DroneType> types;                     ///< drone types defined in the file
+    QVector<DroneSpec> drones;                    ///< drones to create
+    QImage background;                            ///< Voronoi diagram rasterized at the canvas size
+    QVector<int> regionIds;                       ///< index of the closest server of each pixel of background
+    std::shared_ptr<TileStore> tiles;             ///< regions of the whole world on disk (see TileStore), nullptr if none
+
+    /**
+     * @brief load reads and builds a complete scenario from a JSON file
+     * @param jsonFilePath: path of the JSON file
+     * @param rasterSize: size of the Voronoi raster
+     * @param error: message set if the load fails
+     * @param progress: optional progress callback
+     * @param complete: if false only the servers and drones are parsed (for mergeServers)
+     * @return true if the scenario is loaded, false on error or cancel
+     */
+    bool load(const QString &jsonFilePath, const QSize &rasterSize, QString &error, const Progress &progress = Progress(), bool complete = true);
+    /**
+     * @brief parse reads the servers, the drone types and the drones from the root JSON object
+     * @param rootObj: the root object of the JSON file
+     * @param error: message set if there is no server
+     * @return true if the servers are found
+     */
+    bool parse(const QJsonObject &rootObj, QString &error);
+    /**
+     * @brief buildConnections connects the servers closer than connectionDistance
+     */
+    void buildConnections();
+    /**
+     * @brief buildRoutingTable converts the connections to an index adjacency list
+     * and computes the next hop between every couple of servers (BFS from each server)
+     */
+    void buildRoutingTable();
+    /**
+     * @brief rasterize draws the Voronoi regions of the servers in background and regionIds
+     * @param size: size of the image
+     * @param progress: optional progress callback
+     * @return false if canceled
+     */
+    bool rasterize(const QSize &size, const Progress &progress = Progress());
+    /**
+     * @brief regionAt finds the server region containing a position: a lookup in regionIds
+     * inside the raster, then in the tiles, the nearest server outside of them.
+     * The offline servers have no region (their area goes to the closest online servers).
+     * @param position: the position
+     * @return index of the server, -1 if there is no server
+     */
+    int regionAt(const Vector2D &position) const;
+    /**
+     * @brief locate finds the server region of a batch of positions in one pass
+     * @param positions: the positions
+     * @param regions: filled with the index of the server of each position (-1 if no server)
+     */
+    void locate(const QVector<Vector2D> &positions, QVector<int> &regions) const;
+    /**
+     * @brief nearestServer linear search of the closest online server (of any server if they are
+     * all offline)
+     * @param position: the position
+     * @return index of the server, -1 if there is no server
+     */
+    int nearestServer(const Vector2D &position) const;
+    /**
+     * @brief mergeServers updates the servers in place from a new list (matched by name).
+     * The routing table is repaired from the changed connections only and only the regions
+     * that may change of owner are scanned in the raster.
+     * @param nextServers: the new list of servers
+     * @return the changed servers, and the new index of each server when some were removed
+     */
+    ServerDiff mergeServers(const QVector<Server> &nextServers);
+
+    /**
+     * @brief addConnection connects two servers at runtime, the routing table is repaired
+     * from the servers that get closer only
+     * @param a: index of a server
+     * @param b: index of another server
+     * @return false if they were already connected
+     */
+    bool addConnection(int a, int b);
+    /**
+     * @brief removeConnection disconnects two servers at runtime, the routing table is repaired
+     * for the servers whose path used the connection only
+     * @param a: index of a server
+     * @param b: index of another server
+     * @return false if they were not connected
+     */
+    bool removeConnection(int a, int b);
+    /**
+     * @brief setOnline takes a server down (all its connections are removed and its region goes
+     * to its neighbors, its index stays valid) or back up (connected to the servers closer than
+     * connectionDistance, its region taken back)
+     * @param index: index of the server
+     * @param online: new state
+     * @return false if the state did not change
+     */
+    bool setOnline(int index, bool online);
+    /**
+     * @brief moveServer moves a server at runtime: its connections are rebuilt and only the
+     * pixels that may change of owner are recomputed
+     * @param index: index of the server
+     * @param position: new position
+     * @return false if the position did not change
+     */
+    bool moveServer(int index, const Vector2D &position);
+    /**
+     * @brief addServer appends a server at runtime, the other indices do not change
+     * @param server: the server (its name must be new)
+     * @return the index of the server, -1 if the name is used
+     */
+    int addServer(const Server &server);
+
+    static constexpr double connectionDistance = 500; ///< maximum distance between two connected servers
+
+private:
+    /**
+     * @brief closestOnline linear search of the closest online server to a point
+     * @return index of the server, of the closest server if they are all offline, -1 if there is none
+     */
+    int closestOnline(double x, double y) const;
+    /**
+     * @brief updateRaster recomputes the owner of the pixels that may change after a merge or a
+     * runtime change of the servers
+     * @param remap: new index of each previous server, -1 if its pixels must be recomputed
+     * @param dirty: servers that may take pixels from their neighbors (added, moved or back online)
+     * @param recolored: servers whose color changed
+     * @param stale: previous bounding boxes of the regions to scan (removed, moved, recolored or
+     * renumbered servers)
+     */
+    void updateRaster(const QVector<int> &remap, const QVector<int> &dirty, const QVector<int> &recolored, const QVector<QRect> &stale);
+    /**
+     * @brief updateBounds computes regionBounds from regionIds if they are not known
+     */
+    void updateBounds();
+    /**
+     * @brief cellBounds finds the pixels a dirty server takes with a flood fill from its position
+     * @param index: index of the server
+     * @param remap: see updateRaster
+     * @return their bounding box
+     */
+    QRect cellBounds(int index, const QVector<int> &remap);
+    /**
+     * @brief relocate moves a server and repairs its connections one by one
+     * @param index: index of the server
+     * @param position: new position
+     */
+    void relocate(int index, const Vector2D &position);
+    /**
+     * @brief growTables makes room in the routing tables for new unconnected servers
+     * @param extra: number of new servers
+     */
+    void growTables(int extra);
+    /**
+     * @brief compactTables removes disconnected servers from the routing tables
+     * @param newIndex: new index of each server, -1 if removed
+     */
+    void compactTables(const QVector<int> &newIndex);
+    /**
+     * @brief connectInRange connects a server to all the online servers closer than
+     * connectionDistance with addConnection
+     * @param index: index of the server
+     */
+    void connectInRange(int index);
+    /**
+     * @brief repairInsertion updates the shortest paths of every source after the connection of
+     * a and b: the servers that get closer are relaxed from the connection
+     */
+    void repairInsertion(int a, int b);
+    /**
+     * @brief repairDeletion updates the shortest paths of every source after the disconnection of
+     * a and b: only the subtree of the path tree hanging on the connection is visited and searched again
+     */
+    void repairDeletion(int a, int b);
+
+    QVector<QRect> regionBounds;  ///< bounding box of the region of each server in the raster (may be larger)
+    QVector<int> floodMark;       ///< pixels visited by cellBounds, marked with floodStamp
+    int floodStamp = 0;
+};
+
+#endif // SCENARIO_H
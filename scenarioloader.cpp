@@ -0,0 +1,115 @@
+#include "scenarioloader.h"
+#include "tilestore.h"
+#include <QMutexLocker>
+#include <QDebug>
+
+ScenarioLoader::ScenarioLoader(QObject *parent)
+    : QThread{parent} {
+    // a load asked while the previous one was ending starts now
+    connect(this, &QThread::finished, this, [this]() {
+        if (hasNext && !isRunning()) {
+            startNext();
+        }
+    });
+}
+
+ScenarioLoader::~ScenarioLoader() {
+    cancel();
+    hasNext = false;
+    wait();
+}
+
+/**
+ * @brief ScenarioLoader::load starts a new background load. A running load is canceled and the
+ * new one starts when it ends (see the constructor), without blocking the caller.
+ * @param jsonFilePath The path to the JSON file to be loaded.
+ * @param rasterSize size of the Voronoi raster
+ * @param complete false to only parse the servers and drones
+ * @return the generation of the load
+ */
+quint64 ScenarioLoader::load(const QString &jsonFilePath, const QSize &rasterSize, bool complete) {
+    next = Request{jsonFilePath, rasterSize, complete, tilePath, tileBudget, tileCellSize, ++generation};
+    hasNext = true;
+    if (isRunning()) {
+        canceled = true;
+    } else {
+        startNext();
+    }
+    return generation;
+}
+
+void ScenarioLoader::startNext() {
+    running = next;
+    hasNext = false;
+    canceled = false;
+    start(QThread::LowPriority);
+}
+
+void ScenarioLoader::setTileStore(const QString &path, qint64 budgetBytes, float cellSize) {
+    tilePath = path;
+    tileBudget = budgetBytes;
+    tileCellSize = cellSize;
+}
+
+void ScenarioLoader::cancel() {
+    canceled = true;
+    hasNext = false;
+    ++generation; // the signals already queued are ignored
+}
+
+std::unique_ptr<Scenario> ScenarioLoader::takeResult(quint64 loadGeneration, bool &complete) {
+    QMutexLocker lock(&resultLock);
+    if (loadGeneration != generation || resultGeneration != generation || !result) {
+        return nullptr;
+    }
+    complete = resultComplete;
+    return std::move(result);
+}
+
+/**
+ * @brief ScenarioLoader::run builds the scenario in the loading thread
+ * and reports the progress until it is complete or canceled.
+ */
+void ScenarioLoader::run() {
+    const Request &request = running;
+    std::unique_ptr<Scenario> scenario(new Scenario);
+    QString error;
+    bool ok = scenario->load(request.filePath, request.size, error, [this](int percent) {
+        if (canceled) return false;
+        emit progress(percent);
+        return true;
+    }, request.complete);
+
+    if (canceled) return;
+    if (ok && request.complete && !request.tilePath.isEmpty()) {
+        // the tiles are built once for a set of servers, then only opened
+        std::shared_ptr<TileStore> tiles(new TileStore);
+        QString tileError;
+        if (!tiles->open(request.tilePath, request.tileBudget, tileError) || !tiles->matches(*scenario)) {
+            tiles->close();
+            if (!TileStore::build(*scenario, request.tilePath, request.tileCellSize, tileError, [this](int percent) {
+                    if (canceled) return false;
+                    emit progress(percent);
+                    return true;
+                }) || !tiles->open(request.tilePath, request.tileBudget, tileError)) {
+                if (canceled) return;
+                // the scenario is still valid: without tiles the drones out of the raster use the linear search
+                qWarning() << "Tile store" << request.tilePath << "unavailable, running without tiles:" << tileError;
+                tiles.reset();
+            }
+        }
+        if (canceled) return;
+        scenario->tiles = tiles;
+    }
+    if (!ok) {
+        emit failed(error, request.generation);
+        return;
+    }
+    {
+        QMutexLocker lock(&resultLock);
+        result = std::move(scenario);
+        resultGeneration = request.generation;
+        resultComplete = request.complete;
+    }
+    emit loaded(request.generation);
+}
@@ -0,0 +1,106 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef SCENARIOLOADER_H
+#define SCENARIOLOADER_H
+
+#include <QThread>
+#include <QSize>
+#include <QMutex>
+#include <atomic>
+#include <memory>
+#include "scenario.h"
+
+/**
+ * @brief ScenarioLoader builds a Scenario in a background thread.
+ * The current world keeps simulating while the file is read, parsed and rasterized;
+ * the result is taken with takeResult() once loaded() is emitted.
+ * Each load has a generation: the signals carry it and a result is only given for the
+ * generation of the last load, so the signals of a replaced or canceled load are ignored.
+ * The GUI thread never waits for the loading thread (a new load starts when the canceled one ends).
+ */
+class ScenarioLoader : public QThread {
+    Q_OBJECT
+public:
+    explicit ScenarioLoader(QObject *parent = nullptr);
+    /**
+     * @brief ScenarioLoader destructor, cancels and waits for the running load
+     */
+    ~ScenarioLoader();
+    /**
+     * @brief load starts to build a scenario, a running load is canceled first
+     * @param jsonFilePath: path of the JSON file
+     * @param rasterSize: size of the Voronoi raster (the canvas size)
+     * @param complete: if false only the servers and drones are parsed (incremental reload)
+     * @return the generation of the load
+     */
+    quint64 load(const QString &jsonFilePath, const QSize &rasterSize, bool complete = true);
+    /**
+     * @brief setTileStore gives the next complete loads a tile store of the whole world (see TileStore):
+     * the file is opened, or built again if it does not match the servers; if it can be neither built
+     * nor opened the scenario is loaded without tiles (with a warning)
+     * @param path: path of the store, empty for none
+     * @param budgetBytes: memory allowed for the mapped tiles
+     * @param cellSize: world units per cell of a new store
+     */
+    void setTileStore(const QString &path, qint64 budgetBytes, float cellSize);
+    /**
+     * @brief currentGeneration
+     * @return the generation of the last load, the signals of the other ones are stale
+     */
+    inline quint64 currentGeneration() const { return generation; }
+    /**
+     * @brief cancel asks the running load to stop, its signals are ignored afterwards
+     */
+    void cancel();
+    /**
+     * @brief takeResult takes the scenario of a load, does not wait
+     * @param generation: generation given by loaded()
+     * @param complete: set to false if the scenario must be merged in the running world
+     * @return the scenario, nullptr if the generation is not the one of the last load
+     */
+    std::unique_ptr<Scenario> takeResult(quint64 generation, bool &complete);
+
+signals:
+    void progress(int percent);
+    void loaded(quint64 generation);
+    void failed(const QString &message, quint64 generation);
+
+protected:
+    void run() override;
+
+private:
+    /**
+     * @brief A load to run
+     */
+    struct Request {
+        QString filePath;           ///< file to load
+        QSize size;                 ///< size of the Voronoi raster
+        bool complete = true;       ///< false to only parse the file
+        QString tilePath;           ///< tile store of the complete loads, empty for none
+        qint64 tileBudget = 0;      ///< memory allowed for the mapped tiles
+        float tileCellSize = 0;     ///< world units per cell of a new store
+        quint64 generation = 0;
+    };
+    /**
+     * @brief startNext starts the waiting request (the thread is not running)
+     */
+    void startNext();
+
+    Request running;               ///< request of the loading thread, only changed while it is stopped
+    Request next;                  ///< request waiting for the end of the canceled load
+    bool hasNext = false;
+    quint64 generation = 0;        ///< generation of the last load (GUI thread)
+    QString tilePath;              ///< tile store given to the next loads
+    qint64 tileBudget = 0;
+    float tileCellSize = 0;
+    std::atomic<bool> canceled{false}; ///< set by cancel(), read by the loading thread
+    QMutex resultLock;             ///< protects the result
+    std::unique_ptr<Scenario> result;  ///< scenario built by the last run
+    quint64 resultGeneration = 0;
+    bool resultComplete = true;
+};
+
+#endif // SCENARIOLOADER_H
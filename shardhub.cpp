@@ -0,0 +1,433 @@
+#include "shardhub.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QCoreApplication>
+#include <QTimer>
+#include <QDebug>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+static_assert(std::is_trivially_copyable<Drone::State>::value, "the states are copied as is between the processes");
+static_assert(std::is_trivially_copyable<ShardGhost>::value && std::is_trivially_copyable<ShardSample>::value,
+              "the records are copied as is between the processes");
+
+template <typename T>
+void put(QByteArray &out, const T &value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void putName(QByteArray &out, const QString &name) {
+    QByteArray utf8 = name.toUtf8().left(0xFFFF);
+    put(out, quint16(utf8.size()));
+    out.append(utf8);
+}
+
+/**
+ * @brief Bounds checked reading of a payload, ok is false after a short read
+ */
+struct Reader {
+    const char *p, *end;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (end - p < qint64(sizeof(T))) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+    const char *skip(qint64 size) {
+        if (size < 0 || end - p < size) {
+            ok = false;
+            return end;
+        }
+        const char *start = p;
+        p += size;
+        return start;
+    }
+    QString name() {
+        quint16 length = get<quint16>();
+        const char *text = skip(ok ? length : -1);
+        return ok ? QString::fromUtf8(text, length) : QString();
+    }
+    /**
+     * @brief skipHandoff
+     * @return false if the handoff is truncated
+     */
+    bool skipHandoff() {
+        skip(get<quint16>());
+        skip(ok ? get<quint16>() : -1);
+        skip(ok ? qint64(sizeof(Drone::State)) : -1);
+        return ok;
+    }
+};
+
+/**
+ * @brief beginMessage starts a message, its size is set by endMessage
+ */
+void beginMessage(QByteArray &message, Shard::Kind kind) {
+    message.resize(sizeof(quint32));
+    put(message, quint8(kind));
+}
+
+void endMessage(QByteArray &message) {
+    quint32 size = message.size() - sizeof(quint32);
+    memcpy(message.data(), &size, sizeof(size));
+}
+
+/**
+ * @brief readFrames calls handle for each complete message of the buffer and drops them
+ * @return false if a message is invalid
+ */
+template <typename Handle>
+bool readFrames(QByteArray &buffer, Handle handle) {
+    int offset = 0;
+    bool ok = true;
+    while (ok && buffer.size() - offset >= int(sizeof(quint32))) {
+        quint32 size;
+        memcpy(&size, buffer.constData() + offset, sizeof(size));
+        if (quint32(buffer.size() - offset - sizeof(quint32)) < size) {
+            break;
+        }
+        ok = handle(buffer.constData() + offset + sizeof(quint32), size);
+        offset += sizeof(quint32) + size;
+    }
+    buffer.remove(0, offset);
+    return ok;
+}
+}
+
+ShardHub::ShardHub(QObject *parent)
+    : QObject(parent) {
+}
+
+ShardHub::~ShardHub() {
+    stop();
+}
+
+bool ShardHub::start(int count, const QString &scenarioPath, const QSize &canvasSize, const QStringList &workerArguments) {
+    stop();
+    count = qBound(1, count, Shard::maxShards);
+    if (!server) {
+        server = new QLocalServer(this);
+        connect(server, &QLocalServer::newConnection, this, &ShardHub::accept);
+    }
+    const QString name = "drones-shards-" + QString::number(QCoreApplication::applicationPid());
+    QLocalServer::removeServer(name);
+    if (!server->listen(name)) {
+        qDebug() << "Shards: cannot listen on" << name << ":" << server->errorString();
+        return false;
+    }
+    workers.resize(count);
+    inboxes.fill(Inbox(), count);
+    connected = 0;
+    simTime = 0;
+    totalDrones = 0;
+    shown.clear();
+    for (int i = 0; i < count; i++) {
+        // the same program, headless, loads the scenario and keeps the drones of its shard
+        QProcess *process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        process->start(QCoreApplication::applicationFilePath(),
+                       QStringList{"--headless", "--shm", "none", "--scenario", scenarioPath,
+                                   "--shard-worker", QString::number(i), "--shard-count", QString::number(count),
+                                   "--shard-hub", server->fullServerName(),
+                                   "--canvas", QString("%1x%2").arg(canvasSize.width()).arg(canvasSize.height())}
+                       + workerArguments);
+        workers[i].process = process;
+    }
+    qDebug() << "Shards: starting" << count << "workers on" << scenarioPath;
+    return true;
+}
+
+void ShardHub::stop() {
+    if (server) {
+        server->close();
+    }
+    for (Worker &worker : workers) {
+        if (worker.socket) {
+            worker.socket->disconnect(this);
+            worker.socket->abort();
+            worker.socket->deleteLater();
+        }
+        if (worker.process) {
+            // the workers quit when the hub closes the connection
+            if (!worker.process->waitForFinished(1000)) {
+                worker.process->kill();
+                worker.process->waitForFinished(1000);
+            }
+            delete worker.process;
+        }
+    }
+    workers.clear();
+    inboxes.clear();
+    buffers.clear();
+    connected = 0;
+    pendingReports = 0;
+}
+
+void ShardHub::accept() {
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        socket->setReadBufferSize(0);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { receive(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            for (const Worker &worker : workers) {
+                if (worker.socket == socket) {
+                    qDebug() << "Shards: a worker stopped, the simulation stops";
+                    QTimer::singleShot(0, this, &ShardHub::stop);
+                    return;
+                }
+            }
+            buffers.remove(socket);
+            socket->deleteLater(); // never said hello
+        });
+    }
+}
+
+void ShardHub::receive(QLocalSocket *socket) {
+    QByteArray &buffer = buffers[socket];
+    buffer.append(socket->readAll());
+    if (!readFrames(buffer, [this, socket](const char *data, quint32 size) { return handle(socket, data, size); })) {
+        qDebug() << "Shards: invalid message, the simulation stops";
+        QTimer::singleShot(0, this, &ShardHub::stop);
+    }
+}
+
+/**
+ * @brief ShardHub::handle reads a message of a worker: hello registers it (the first tick is sent
+ * when all the shards are ready), a report fills the inboxes of the next tick.
+ * @return false if the message is invalid
+ */
+bool ShardHub::handle(QLocalSocket *socket, const char *data, quint32 size) {
+    Reader in{data, data + size};
+    const quint8 kind = in.get<quint8>();
+    if (kind == Shard::helloMessage) {
+        const qint32 shard = in.get<qint32>();
+        if (!in.ok || shard < 0 || shard >= workers.size() || workers[shard].socket) {
+            return false;
+        }
+        workers[shard].socket = socket;
+        if (++connected == workers.size()) {
+            qDebug() << "Shards:" << connected << "workers ready";
+            wallClock.start();
+            rateTimer.start();
+            ticks = droneTicks = handoffs = 0;
+            sendTicks();
+        }
+        return true;
+    }
+    if (kind != Shard::reportMessage) {
+        return false;
+    }
+    Worker *worker = nullptr;
+    for (Worker &w : workers) {
+        if (w.socket == socket) worker = &w;
+    }
+    if (!worker || worker->reported) {
+        return false;
+    }
+    worker->drones = in.get<qint32>();
+    if (!route(in.p, in.end)) {
+        return false;
+    }
+    worker->reported = true;
+    if (--pendingReports > 0) {
+        return true;
+    }
+    // every shard ended the tick
+    simTime += tickStep;
+    ticks++;
+    totalDrones = 0;
+    for (const Worker &w : workers) {
+        totalDrones += w.drones;
+    }
+    droneTicks += totalDrones;
+    if (sampling) {
+        shown.swap(incoming);
+        sampling = false;
+    }
+    if (rateTimer.elapsed() >= 1000) {
+        const double seconds = rateTimer.restart() / 1000.0;
+        measuredTicks = ticks / seconds;
+        measuredDrones = droneTicks / seconds;
+        measuredHandoffs = handoffs / seconds;
+        ticks = droneTicks = handoffs = 0;
+        qDebug() << "Shards:" << workers.size() << "ticks/s:" << measuredTicks << "drones:" << totalDrones
+                 << "drone-ticks/s:" << measuredDrones << "handoffs/s:" << measuredHandoffs;
+    }
+    // lockstep: the next tick waits for the wall clock when the pace is limited
+    const double ahead = pace > 0 ? simTime / pace - wallClock.elapsed() / 1000.0 : 0;
+    if (ahead > 0) {
+        QTimer::singleShot(int(ahead * 1000), this, &ShardHub::sendTicks);
+    } else {
+        QTimer::singleShot(0, this, &ShardHub::sendTicks); // after the other events
+    }
+    return true;
+}
+
+/**
+ * @brief ShardHub::route appends the ghosts and the handoffs of a report to the inbox of their
+ * shard, as they are (only the sizes of the handoffs are read), and keeps its samples.
+ * @return false if the report is truncated
+ */
+bool ShardHub::route(const char *data, const char *end) {
+    Reader in{data, end};
+    for (Inbox &inbox : inboxes) {
+        const quint32 ghostCount = in.get<quint32>();
+        const char *ghosts = in.skip(in.ok ? qint64(ghostCount) * sizeof(ShardGhost) : -1);
+        const quint32 handoffCount = in.get<quint32>();
+        const char *first = in.p;
+        for (quint32 i = 0; in.ok && i < handoffCount; i++) {
+            in.skipHandoff();
+        }
+        if (!in.ok) {
+            return false;
+        }
+        inbox.ghosts.append(ghosts, ghostCount * sizeof(ShardGhost));
+        inbox.ghostCount += ghostCount;
+        inbox.handoffs.append(first, in.p - first);
+        inbox.handoffCount += handoffCount;
+        handoffs += handoffCount;
+    }
+    const quint32 sampleCount = in.get<quint32>();
+    const char *samples = in.skip(in.ok ? qint64(sampleCount) * sizeof(ShardSample) : -1);
+    if (!in.ok) {
+        return false;
+    }
+    for (quint32 i = 0; i < sampleCount; i++) {
+        ShardSample sample;
+        memcpy(&sample, samples + i * sizeof(ShardSample), sizeof(sample));
+        TraceSample shownSample;
+        shownSample.position = Vector2D(sample.x, sample.y);
+        shownSample.status = sample.status;
+        shownSample.azimut = sample.azimut;
+        incoming.append(shownSample);
+    }
+    return true;
+}
+
+/**
+ * @brief ShardHub::sendTicks sends the next tick to every worker with its inbox
+ */
+void ShardHub::sendTicks() {
+    if (connected < workers.size() || workers.isEmpty() || pendingReports > 0) {
+        return;
+    }
+    sampling = wantSamples;
+    wantSamples = false;
+    incoming.resize(0);
+    for (int i = 0; i < workers.size(); i++) {
+        Inbox &inbox = inboxes[i];
+        beginMessage(message, Shard::tickMessage);
+        put(message, tickStep);
+        put(message, quint8(sampling));
+        put(message, inbox.ghostCount);
+        message.append(inbox.ghosts);
+        put(message, inbox.handoffCount);
+        message.append(inbox.handoffs);
+        endMessage(message);
+        workers[i].socket->write(message);
+        workers[i].reported = false;
+        inbox.ghosts.resize(0);
+        inbox.handoffs.resize(0);
+        inbox.ghostCount = inbox.handoffCount = 0;
+    }
+    pendingReports = workers.size();
+}
+
+ShardWorker::ShardWorker(QObject *parent)
+    : QObject(parent) {
+}
+
+bool ShardWorker::connectTo(const QString &hubName, int shard, int count) {
+    shards = count;
+    socket = new QLocalSocket(this);
+    socket->connectToServer(hubName);
+    if (!socket->waitForConnected(5000)) {
+        qDebug() << "Shard" << shard << ": cannot reach the hub" << hubName << ":" << socket->errorString();
+        return false;
+    }
+    connect(socket, &QLocalSocket::readyRead, this, &ShardWorker::receive);
+    connect(socket, &QLocalSocket::disconnected, this, &ShardWorker::hubLost);
+    beginMessage(message, Shard::helloMessage);
+    put(message, qint32(shard));
+    endMessage(message);
+    socket->write(message);
+    return true;
+}
+
+void ShardWorker::receive() {
+    buffer.append(socket->readAll());
+    if (!readFrames(buffer, [this](const char *data, quint32 size) { return handle(data, size); })) {
+        qDebug() << "Shard: invalid message from the hub";
+        socket->abort();
+    }
+}
+
+/**
+ * @brief ShardWorker::handle reads a tick: the ghosts and the handoffs, then asks for the tick
+ * @return false if the tick is invalid
+ */
+bool ShardWorker::handle(const char *data, quint32 size) {
+    Reader in{data, data + size};
+    if (in.get<quint8>() != Shard::tickMessage) {
+        return false;
+    }
+    const double dt = in.get<double>();
+    const bool wantSamples = in.get<quint8>() != 0;
+    const quint32 ghostCount = in.get<quint32>();
+    const char *ghosts = in.skip(in.ok ? qint64(ghostCount) * sizeof(ShardGhost) : -1);
+    if (!in.ok) {
+        return false;
+    }
+    inGhosts.resize(ghostCount);
+    memcpy(static_cast<void*>(inGhosts.data()), ghosts, ghostCount * sizeof(ShardGhost));
+    const quint32 handoffCount = in.get<quint32>();
+    inHandoffs.resize(0);
+    for (quint32 i = 0; in.ok && i < handoffCount; i++) {
+        ShardHandoff handoff;
+        handoff.name = in.name();
+        handoff.target = in.name();
+        handoff.state = in.get<Drone::State>();
+        inHandoffs.append(handoff);
+    }
+    if (!in.ok) {
+        return false;
+    }
+    emit tick(dt, wantSamples);
+    return true;
+}
+
+/**
+ * @brief ShardWorker::report encodes the report in one message
+ */
+void ShardWorker::report(int drones, const QVector<QVector<ShardGhost>> &ghosts,
+                         const QVector<QVector<ShardHandoff>> &handoffs, const QVector<ShardSample> *samples) {
+    beginMessage(message, Shard::reportMessage);
+    put(message, qint32(drones));
+    for (int s = 0; s < shards; s++) {
+        const QVector<ShardGhost> &g = ghosts.at(s);
+        put(message, quint32(g.size()));
+        message.append(reinterpret_cast<const char*>(g.constData()), g.size() * sizeof(ShardGhost));
+        const QVector<ShardHandoff> &h = handoffs.at(s);
+        put(message, quint32(h.size()));
+        for (const ShardHandoff &handoff : h) {
+            putName(message, handoff.name);
+            putName(message, handoff.target);
+            put(message, handoff.state);
+        }
+    }
+    const quint32 sampleCount = samples ? samples->size() : 0;
+    put(message, sampleCount);
+    if (samples) {
+        message.append(reinterpret_cast<const char*>(samples->constData()), sampleCount * sizeof(ShardSample));
+    }
+    endMessage(message);
+    socket->write(message);
+}
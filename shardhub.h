@@ -0,0 +1,238 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef SHARDHUB_H
+#define SHARDHUB_H
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QSize>
+#include <QStringList>
+#include <QElapsedTimer>
+#include "drone.h"
+#include "tracerecorder.h"
+
+class QLocalServer;
+class QLocalSocket;
+class QProcess;
+
+/**
+ * @brief Protocol between the hub and the shard workers on local sockets (native byte order,
+ * all the processes run on the same machine). Each message is a 32-bit size, a kind and a payload:
+ * - hello (worker): the index of the shard, sent once the worker owns its drones;
+ * - tick (hub): the duration of the tick, a flag asking for the display samples, then the ghosts
+ *   and the handoffs for this shard (32-bit count, then the records);
+ * - report (worker, after the tick): the number of drones of the shard, then for each shard the
+ *   ghosts and the handoffs it must receive, then the display samples (32-bit count, 0 if not asked).
+ * A ghost is a plain ShardGhost; a handoff is its drone name and target server name (16-bit
+ * length + UTF-8) followed by the plain Drone::State.
+ */
+namespace Shard {
+    enum Kind : quint8 { helloMessage = 0, tickMessage = 1, reportMessage = 2 };
+    constexpr int maxShards = 64;
+}
+
+/**
+ * @brief A drone of another shard near the border, avoided like a drone of this shard
+ */
+struct ShardGhost {
+    float x, y;
+    float vx, vy;
+    float maxSpeed;
+};
+
+/**
+ * @brief A drone leaving its shard, simulated by the shard owning its new region from the next tick
+ */
+struct ShardHandoff {
+    QString name;
+    QString target;     ///< name of the target server
+    Drone::State state;
+};
+
+/**
+ * @brief State of a drone shown by the hub
+ */
+struct ShardSample {
+    float x, y;
+    float azimut;   ///< degrees
+    quint8 status;
+};
+
+/**
+ * @brief ShardHub runs a multi-process simulation: it starts one worker process per shard (the
+ * same program, see ShardWorker and ShardPlan), then drives them in lockstep. After each tick it
+ * forwards the handoffs and the ghosts of each report to their shard with the next tick, so every
+ * shard sees the same world at the tick boundaries. It measures the throughput of the shards.
+ */
+class ShardHub : public QObject {
+    Q_OBJECT
+public:
+    static constexpr double tickStep = 0.1; ///< simulated seconds of a tick
+
+    explicit ShardHub(QObject *parent = nullptr);
+    /**
+     * @brief ShardHub destructor, stops the workers
+     */
+    ~ShardHub();
+    /**
+     * @brief start starts the workers on a scenario (the running workers are stopped first)
+     * @param count: number of shards
+     * @param scenarioPath: the scenario file, loaded by every worker
+     * @param canvasSize: size of the world (the Voronoi raster must be the same in all the processes)
+     * @param workerArguments: more options of the worker processes
+     * @return false if the hub cannot listen
+     */
+    bool start(int count, const QString &scenarioPath, const QSize &canvasSize, const QStringList &workerArguments = QStringList());
+    /**
+     * @brief stop stops the workers
+     */
+    void stop();
+    /**
+     * @brief setPace limits the simulated seconds per wall second
+     * @param factor: 0 for as fast as the workers can
+     */
+    inline void setPace(double factor) { pace = factor; }
+    /**
+     * @brief requestSamples asks the workers for the state of their drones at the next tick
+     */
+    inline void requestSamples() { wantSamples = true; }
+    /**
+     * @brief isRunning
+     * @return true if the workers are started
+     */
+    inline bool isRunning() const { return !workers.isEmpty(); }
+    inline int shardCount() const { return workers.size(); }
+    /**
+     * @brief samples
+     * @return the drones of all the shards at the last tick that carried samples
+     */
+    inline const QVector<TraceSample> &samples() const { return shown; }
+    inline double time() const { return simTime; }
+    inline int drones() const { return totalDrones; }
+    /**
+     * @brief tickRate
+     * @return ticks per wall second, measured over about a second
+     */
+    inline double tickRate() const { return measuredTicks; }
+    /**
+     * @brief droneRate
+     * @return drone ticks per wall second (sum over the shards)
+     */
+    inline double droneRate() const { return measuredDrones; }
+    /**
+     * @brief handoffRate
+     * @return drones handed off per wall second
+     */
+    inline double handoffRate() const { return measuredHandoffs; }
+
+private:
+    /**
+     * @brief A worker process and its connection
+     */
+    struct Worker {
+        QProcess *process = nullptr;
+        QLocalSocket *socket = nullptr;
+        bool reported = false;  ///< true once the report of the current tick is read
+        int drones = 0;
+    };
+    /**
+     * @brief An outgoing tick: the records sent by the other shards
+     */
+    struct Inbox {
+        QByteArray ghosts;
+        QByteArray handoffs;
+        quint32 ghostCount = 0;
+        quint32 handoffCount = 0;
+    };
+
+    void accept();
+    void receive(QLocalSocket *socket);
+    bool handle(QLocalSocket *socket, const char *data, quint32 size);
+    bool route(const char *data, const char *end);
+    void sendTicks();
+
+    QLocalServer *server = nullptr;
+    QVector<Worker> workers;
+    QVector<Inbox> inboxes;
+    QHash<QLocalSocket*, QByteArray> buffers; ///< received bytes not yet read, by connection
+    int connected = 0;          ///< workers that sent hello
+    int pendingReports = 0;
+    bool wantSamples = false;
+    bool sampling = false;      ///< the current tick carries samples
+    QVector<TraceSample> shown;
+    QVector<TraceSample> incoming; ///< samples of the current tick
+    double pace = 1;
+    double simTime = 0;
+    int totalDrones = 0;
+    QElapsedTimer wallClock;    ///< time since the first tick
+    QElapsedTimer rateTimer;
+    qint64 ticks = 0, droneTicks = 0, handoffs = 0; ///< counted since the start of the rate measure
+    double measuredTicks = 0, measuredDrones = 0, measuredHandoffs = 0;
+    QByteArray message;         ///< message being encoded, reused
+};
+
+/**
+ * @brief ShardWorker is the link of a worker process to the hub: it receives the ticks with the
+ * ghosts and the handoffs of its shard, and sends the report of the tick.
+ */
+class ShardWorker : public QObject {
+    Q_OBJECT
+public:
+    explicit ShardWorker(QObject *parent = nullptr);
+    /**
+     * @brief connectTo connects to the hub and sends hello
+     * @param hubName: name of the local socket of the hub
+     * @param shard: index of this shard
+     * @param count: number of shards
+     * @return false if the hub cannot be reached
+     */
+    bool connectTo(const QString &hubName, int shard, int count);
+    /**
+     * @brief ghosts
+     * @return the ghosts received with the current tick
+     */
+    inline const QVector<ShardGhost> &ghosts() const { return inGhosts; }
+    /**
+     * @brief handoffs
+     * @return the drones handed to this shard with the current tick
+     */
+    inline const QVector<ShardHandoff> &handoffs() const { return inHandoffs; }
+    /**
+     * @brief report sends the result of the tick
+     * @param drones: number of drones of this shard
+     * @param ghosts: the ghosts for each shard
+     * @param handoffs: the handoffs for each shard
+     * @param samples: the state of the drones if asked by the tick, else nullptr
+     */
+    void report(int drones, const QVector<QVector<ShardGhost>> &ghosts,
+                const QVector<QVector<ShardHandoff>> &handoffs, const QVector<ShardSample> *samples);
+
+signals:
+    /**
+     * @brief tick asks for a tick, the inbox is read before the signal
+     * @param dt: duration of the tick
+     * @param wantSamples: true if the report must carry the samples
+     */
+    void tick(double dt, bool wantSamples);
+    /**
+     * @brief hubLost the hub closed the connection
+     */
+    void hubLost();
+
+private:
+    void receive();
+    bool handle(const char *data, quint32 size);
+
+    QLocalSocket *socket = nullptr;
+    QByteArray buffer;
+    QVector<ShardGhost> inGhosts;
+    QVector<ShardHandoff> inHandoffs;
+    int shards = 0;
+    QByteArray message;
+};
+
+#endif // SHARDHUB_H
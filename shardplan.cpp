@@ -0,0 +1,145 @@
+#include "shardplan.h"
+#include "scenario.h"
+#include <QPair>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief ShardPlan::build weights each server by one plus the number of drones starting in its
+ * region, then bisects the servers.
+ * @param world the world
+ * @param shardNumber number of shards
+ */
+void ShardPlan::build(const Scenario &world, int shardNumber) {
+    count = std::max(1, shardNumber);
+    const int n = world.servers.size();
+    QVector<double> weights(n, 1.0);
+    for (const DroneSpec &spec : world.drones) {
+        int region = world.regionAt(spec.position);
+        if (region >= 0) {
+            weights[region] += 1.0;
+        }
+    }
+    QVector<int> servers(n);
+    for (int i = 0; i < n; i++) {
+        servers[i] = i;
+    }
+    shards.fill(0, n);
+    loads.fill(0.0, count);
+    split(servers, 0, n, 0, count, world, weights);
+    for (int i = 0; i < n; i++) {
+        loads[shards[i]] += weights[i];
+    }
+    listForeign(world);
+}
+
+/**
+ * @brief ShardPlan::listForeign sorts the servers of the other shards by distance, keeping the
+ * nearest maxForeign of each server: O(n^2 log n) once, when the shard starts.
+ * @param world the world
+ */
+void ShardPlan::listForeign(const Scenario &world) {
+    const int n = shards.size();
+    foreignStart.fill(0, n + 1);
+    foreign.resize(0);
+    foreignDistance.resize(0);
+    foreignComplete.fill(true, n);
+    QVector<QPair<float,int>> others;
+    for (int a = 0; a < n; a++) {
+        others.resize(0);
+        for (int b = 0; b < n; b++) {
+            if (shards[b] != shards[a]) {
+                others.append(qMakePair((world.servers[b].position - world.servers[a].position).length(), b));
+            }
+        }
+        const int kept = std::min<int>(others.size(), maxForeign);
+        std::partial_sort(others.begin(), others.begin() + kept, others.end());
+        foreignComplete[a] = kept == others.size();
+        for (int k = 0; k < kept; k++) {
+            foreign.append(others[k].second);
+            foreignDistance.append(others[k].first);
+        }
+        foreignStart[a + 1] = foreign.size();
+    }
+}
+
+/**
+ * @brief ShardPlan::split sorts the servers of the range along the longest side of their
+ * bounding box (index order between equal coordinates, so that every process gets the same
+ * plan) and cuts where the weight of the first part is proportional to its number of shards.
+ */
+void ShardPlan::split(QVector<int> &servers, int begin, int end, int firstShard, int shardNumber,
+                      const Scenario &world, const QVector<double> &weights) {
+    if (shardNumber <= 1 || end - begin <= 1) {
+        for (int i = begin; i < end; i++) {
+            shards[servers[i]] = firstShard;
+        }
+        return;
+    }
+    double minX = 1e300, maxX = -1e300, minY = 1e300, maxY = -1e300, total = 0;
+    for (int i = begin; i < end; i++) {
+        const Vector2D &p = world.servers[servers[i]].position;
+        minX = std::min(minX, double(p.x));
+        maxX = std::max(maxX, double(p.x));
+        minY = std::min(minY, double(p.y));
+        maxY = std::max(maxY, double(p.y));
+        total += weights[servers[i]];
+    }
+    const bool alongX = maxX - minX >= maxY - minY;
+    std::sort(servers.begin() + begin, servers.begin() + end, [&world, alongX](int a, int b) {
+        const Vector2D &pa = world.servers[a].position, &pb = world.servers[b].position;
+        float ca = alongX ? pa.x : pa.y, cb = alongX ? pb.x : pb.y;
+        return ca < cb || (ca == cb && a < b);
+    });
+    const int firstHalf = shardNumber / 2;
+    const double goal = total * firstHalf / shardNumber;
+    // each part keeps at least one server
+    int cut = begin + 1;
+    double weight = weights[servers[begin]];
+    while (cut < end - 1 && weight + weights[servers[cut]] / 2 <= goal) {
+        weight += weights[servers[cut]];
+        cut++;
+    }
+    split(servers, begin, cut, firstShard, firstHalf, world, weights);
+    split(servers, cut, end, firstShard + firstHalf, shardNumber - firstHalf, world, weights);
+}
+
+int ShardPlan::shardAt(const Scenario &world, const Vector2D &position) const {
+    return shardOf(world.regionAt(position));
+}
+
+/**
+ * @brief ShardPlan::shardsWithin a point p of the region of a is at (|p-b|^2 - |p-a|^2) / 2|a-b|
+ * of the bisector of a and b, at least |a-b|/2 - |p-a|: the foreign servers of a are scanned
+ * closest first until that bound exceeds the distance. When the list of a is cut before, all the
+ * servers are tested.
+ */
+quint64 ShardPlan::shardsWithin(const Scenario &world, int region, const Vector2D &position, float distance) const {
+    if (region < 0 || region >= shards.size()) {
+        return 0;
+    }
+    quint64 found = quint64(1) << shards[region];
+    const Vector2D &a = world.servers[region].position;
+    const float toA2 = (position - a).lengthSquared();
+    const float limit = 2 * (std::sqrt(toA2) + distance);
+    auto test = [&](int b, float ab) {
+        const quint64 bit = quint64(1) << shards[b];
+        if (!(found & bit) && (position - world.servers[b].position).lengthSquared() - toA2 <= 2 * distance * ab) {
+            found |= bit;
+        }
+    };
+    for (int k = foreignStart[region]; k < foreignStart[region + 1]; k++) {
+        if (foreignDistance[k] > limit) {
+            return found;
+        }
+        test(foreign[k], foreignDistance[k]);
+    }
+    if (!foreignComplete[region]) {
+        for (int b = 0; b < shards.size(); b++) {
+            if (shards[b] != shards[region]) {
+                test(b, (world.servers[b].position - a).length());
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,90 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef SHARDPLAN_H
+#define SHARDPLAN_H
+
+#include <QVector>
+#include "vector2d.h"
+
+class Scenario;
+
+/**
+ * @brief ShardPlan splits the world between the shards of a multi-process simulation: each
+ * shard owns the Voronoi regions of a group of servers and simulates the drones inside them.
+ * The groups are made by recursive coordinate bisection of the server positions, each server
+ * weighted by the drones that start in its region, so that the shards are compact (few
+ * borders) and hold about the same number of drones. The plan only depends on the scenario:
+ * every process computes the same one.
+ */
+class ShardPlan {
+public:
+    /**
+     * @brief build groups the servers of a world
+     * @param world: the servers, their Voronoi raster and the initial drones
+     * @param shardNumber: number of shards
+     */
+    void build(const Scenario &world, int shardNumber);
+    /**
+     * @brief shardCount
+     * @return the number of shards
+     */
+    inline int shardCount() const { return count; }
+    /**
+     * @brief shardOf
+     * @param server: index of a server
+     * @return the shard owning its region
+     */
+    inline int shardOf(int server) const { return server >= 0 && server < shards.size() ? shards[server] : -1; }
+    /**
+     * @brief shardAt
+     * @param world: the world given to build
+     * @param position: a position
+     * @return the shard owning the region containing this position, -1 if there is no server
+     */
+    int shardAt(const Scenario &world, const Vector2D &position) const;
+    /**
+     * @brief shardLoad
+     * @param shard: a shard
+     * @return the weight of its servers (number of servers + number of initial drones)
+     */
+    inline double shardLoad(int shard) const { return loads.value(shard); }
+    /**
+     * @brief shardsWithin the shards whose territory may be closer than a distance to a position:
+     * the region of a server b is beyond the bisector between b and the server of the position,
+     * so a shard is listed when one of its servers has this bisector within the distance. The
+     * test never misses a shard; it may list one whose regions are a bit farther.
+     * @param world: the world given to build
+     * @param region: the region of the position (see Scenario::regionAt)
+     * @param position: the position
+     * @param distance: the distance
+     * @return bit s set for each shard s, including the shard of the region
+     */
+    quint64 shardsWithin(const Scenario &world, int region, const Vector2D &position, float distance) const;
+
+private:
+    /**
+     * @brief split gives a group of servers to a range of shards, halving the longest side
+     * of their bounding box at the weighted median
+     */
+    void split(QVector<int> &servers, int begin, int end, int firstShard, int shardNumber,
+               const Scenario &world, const QVector<double> &weights);
+    /**
+     * @brief listForeign lists for each server the nearest servers of the other shards
+     */
+    void listForeign(const Scenario &world);
+
+    static constexpr int maxForeign = 64; ///< servers of the other shards listed per server
+
+    int count = 0;
+    QVector<int> shards;    ///< shard of each server
+    QVector<double> loads;  ///< weight of each shard
+    QVector<int> foreignStart;        ///< first entry of each server in foreign, one more for the end
+    QVector<int> foreign;             ///< nearest servers of the other shards, closest first
+    QVector<float> foreignDistance;   ///< distance between the server and each of them
+    QVector<bool> foreignComplete;    ///< true if the list of a server holds all the other shards' servers
+};
+
+#endif // SHARDPLAN_H
@@ -0,0 +1,86 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef SHAREDSTATE_H
+#define SHAREDSTATE_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Layout of the shared memory segment written by StateExporter and mapped by the
+ * viewers: a header, then the drone and server arrays.
+ * The arrays are guarded by a sequence lock: the engine makes sequence odd, writes the arrays,
+ * then makes it even again. A viewer copies the arrays between two reads of an even and equal
+ * sequence, otherwise it copies again; it never writes in the segment, so a viewer can attach,
+ * detach or crash without the engine noticing.
+ * When the engine needs a larger segment it sets retired and creates a new segment with the
+ * same name, the viewers map it again.
+ */
+namespace SharedState {
+    constexpr char magic[8] = {'D', 'R', 'N', 'S', 'H', 'M', '1', 0};
+    constexpr quint32 version = 1;
+    constexpr int nameSize = 32;
+    constexpr const char *defaultName = "/drones-state";
+
+    /**
+     * @brief Header of the segment
+     */
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 headerSize;
+        quint32 droneCapacity;          ///< size of the drone array
+        quint32 serverCapacity;         ///< size of the server array
+        std::atomic<quint32> sequence;  ///< odd while the engine writes
+        std::atomic<quint32> retired;   ///< 1 when the segment is replaced or the engine stopped
+        quint32 droneCount;
+        quint32 serverCount;
+        quint32 ticks;                  ///< number of published ticks
+        float width, height;            ///< size of the world (canvas)
+        double time;                    ///< simulation time
+    };
+    /**
+     * @brief State of a drone
+     */
+    struct Drone {
+        float x, y;
+        float azimut;       ///< degrees
+        float power;        ///< percent
+        qint16 server;      ///< target server, -1 if none
+        quint8 status;      ///< Drone::droneStatus
+        quint8 collision;   ///< 1 if a collision is detected
+    };
+    /**
+     * @brief State of a server
+     */
+    struct Server {
+        float x, y;
+        quint32 rgb;
+        quint32 online;
+        char name[nameSize]; ///< UTF-8, null terminated
+    };
+
+    static_assert(std::atomic<quint32>::is_always_lock_free, "the sequence is shared between processes");
+
+    /**
+     * @brief dronesOffset
+     * @return the offset of the drone array
+     */
+    constexpr size_t dronesOffset() { return (sizeof(Header) + 63) / 64 * 64; }
+    /**
+     * @brief serversOffset
+     * @return the offset of the server array
+     */
+    constexpr size_t serversOffset(quint32 droneCapacity) { return (dronesOffset() + droneCapacity * sizeof(Drone) + 63) / 64 * 64; }
+    /**
+     * @brief segmentSize
+     * @return the size of a segment for these capacities
+     */
+    constexpr size_t segmentSize(quint32 droneCapacity, quint32 serverCapacity) { return serversOffset(droneCapacity) + serverCapacity * sizeof(Server); }
+}
+
+#endif // SHAREDSTATE_H
@@ -0,0 +1,157 @@
+#include "spatialgrid.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief SpatialGrid::build computes the bounding box of the points, then links each point in
+ * its cell. The number of cells is kept in O(number of points).
+ * @param p the points
+ * @param cellSize preferred size of a cell
+ */
+void SpatialGrid::build(const QVector<Vector2D> &p, float cellSize) {
+    points = &p;
+    int n = p.size();
+    if (n == 0) {
+        cols = rows = 0;
+        return;
+    }
+    float maxX = p[0].x, maxY = p[0].y;
+    minX = maxX;
+    minY = maxY;
+    for (const Vector2D &v : p) {
+        minX = std::min(minX, v.x);
+        maxX = std::max(maxX, v.x);
+        minY = std::min(minY, v.y);
+        maxY = std::max(maxY, v.y);
+    }
+    // very spread points: larger cells so that the grid stays small
+    const int maxCells = std::max(64, 4 * n);
+    cell = cellSize;
+    while ((int((maxX - minX) / cell) + 1) * (int((maxY - minY) / cell) + 1) > maxCells) {
+        cell *= 2;
+    }
+    invCell = 1.0f / cell;
+    cols = int((maxX - minX) * invCell) + 1;
+    rows = int((maxY - minY) * invCell) + 1;
+
+    cellHead.fill(-1, cols * rows);
+    cellOf.resize(n);
+    next.resize(n);
+    previous.resize(n);
+    // backward: the lists are in increasing index order
+    for (int i = n - 1; i >= 0; i--) {
+        link(i, cellIndex(p[i]));
+    }
+}
+
+void SpatialGrid::move(int index) {
+    if (cellOf[index] < 0) {
+        return;
+    }
+    const int c = cellIndex((*points)[index]);
+    if (c != cellOf[index]) {
+        unlink(index);
+        link(index, c);
+    }
+}
+
+void SpatialGrid::remove(int index) {
+    if (cellOf[index] >= 0) {
+        unlink(index);
+        cellOf[index] = -1;
+    }
+}
+
+void SpatialGrid::link(int index, int c) {
+    cellOf[index] = c;
+    previous[index] = -1;
+    next[index] = cellHead[c];
+    if (cellHead[c] >= 0) {
+        previous[cellHead[c]] = index;
+    }
+    cellHead[c] = index;
+}
+
+void SpatialGrid::unlink(int index) {
+    if (previous[index] >= 0) {
+        next[previous[index]] = next[index];
+    } else {
+        cellHead[cellOf[index]] = next[index];
+    }
+    if (next[index] >= 0) {
+        previous[next[index]] = previous[index];
+    }
+}
+
+/**
+ * @brief SpatialGrid::kNearest scans the cells ring by ring around the cell of the point.
+ * The points out of the rings already scanned are at least ring*cell away, so the scan stops
+ * as soon as the k neighbours found are closer, or when the rings go beyond radius. A point
+ * moved out of the grid is in the border cell of its projection on the grid, which is closer:
+ * the bound still holds.
+ * @param self index of the point
+ * @param radius maximum distance of the neighbours
+ * @param k maximum number of neighbours
+ * @param neighbors index of the neighbours, closest first
+ * @param distancesSquared squared distance of the neighbours
+ * @return the number of neighbours
+ */
+int SpatialGrid::kNearest(int self, float radius, int k, int *neighbors, float *distancesSquared) const {
+    if (cols == 0) {
+        return 0;
+    }
+    return search((*points)[self], self, radius, k, neighbors, distancesSquared);
+}
+
+int SpatialGrid::kNearestTo(const Vector2D &position, float radius, int k, int *neighbors, float *distancesSquared) const {
+    return search(position, -1, radius, k, neighbors, distancesSquared);
+}
+
+int SpatialGrid::search(const Vector2D &p, int self, float radius, int k, int *neighbors, float *distancesSquared) const {
+    if (cols == 0 || k <= 0) {
+        return 0;
+    }
+    const float radius2 = radius * radius;
+    // a position out of the grid starts from the closest cell
+    const int cx = std::clamp(int(std::floor((p.x - minX) * invCell)), 0, cols - 1);
+    const int cy = std::clamp(int(std::floor((p.y - minY) * invCell)), 0, rows - 1);
+    const int maxRing = int(std::min(double(std::ceil(radius * invCell)), double(std::max(cols, rows))));
+    int count = 0;
+    for (int ring = 0; ring <= maxRing; ring++) {
+        for (int y = cy - ring; y <= cy + ring; y++) {
+            if (y < 0 || y >= rows) continue;
+            // inner rows of the ring: only the two end cells
+            int step = (y == cy - ring || y == cy + ring) ? 1 : 2 * ring;
+            for (int x = cx - ring; x <= cx + ring; x += std::max(step, 1)) {
+                if (x < 0 || x >= cols) continue;
+                int c = y * cols + x;
+                for (int index = cellHead[c]; index >= 0; index = next[index]) {
+                    if (index == self) continue;
+                    float d2 = ((*points)[index] - p).lengthSquared();
+                    if (d2 <= radius2) {
+                        insert(index, d2, k, count, neighbors, distancesSquared);
+                    }
+                }
+            }
+        }
+        float reach = ring * cell;
+        if (count == k && distancesSquared[k - 1] <= reach * reach) {
+            break;
+        }
+    }
+    return count;
+}
+
+void SpatialGrid::insert(int index, float d2, int k, int &count, int *neighbors, float *distancesSquared) {
+    if (count == k && d2 >= distancesSquared[k - 1]) {
+        return;
+    }
+    int i = (count < k) ? count++ : k - 1;
+    while (i > 0 && distancesSquared[i - 1] > d2) {
+        neighbors[i] = neighbors[i - 1];
+        distancesSquared[i] = distancesSquared[i - 1];
+        i--;
+    }
+    neighbors[i] = index;
+    distancesSquared[i] = d2;
+}
@@ -0,0 +1,89 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <QVector>
+#include <algorithm>
+#include "vector2d.h"
+
+/**
+ * @brief SpatialGrid is a uniform grid over a set of points, each cell keeps a linked list of its
+ * points (no allocation once the buffers are large enough). After a build, a point can be moved
+ * or removed in O(1), the bounds of the grid stay those of the build: a point moved out of them
+ * is kept in the nearest border cell.
+ * It answers the k nearest neighbours of a point by scanning the cells ring by ring.
+ */
+class SpatialGrid {
+public:
+    /**
+     * @brief build sorts the points by cell
+     * @param points: the points, they must stay valid until the next build
+     * @param cellSize: preferred size of a cell (enlarged if the points are very spread)
+     */
+    void build(const QVector<Vector2D> &points, float cellSize);
+    /**
+     * @brief move puts a point in the cell of its new position, to call when the point given
+     * to build() changed
+     * @param index: index of the point
+     */
+    void move(int index);
+    /**
+     * @brief remove takes a point out of the grid, it is not found by the searches anymore
+     * @param index: index of the point
+     */
+    void remove(int index);
+    /**
+     * @brief kNearest finds the k nearest points of a point of the grid
+     * @param self: index of the point in the points given to build()
+     * @param radius: maximum distance of the neighbours
+     * @param k: maximum number of neighbours
+     * @param neighbors: filled with the index of the neighbours, closest first (size >= k)
+     * @param distancesSquared: filled with their squared distance (size >= k)
+     * @return the number of neighbours found
+     */
+    int kNearest(int self, float radius, int k, int *neighbors, float *distancesSquared) const;
+    /**
+     * @brief kNearestTo finds the k nearest points of any position
+     * @param position: the position
+     * @param radius: maximum distance of the neighbours
+     * @param k: maximum number of neighbours
+     * @param neighbors: filled with the index of the neighbours, closest first (size >= k)
+     * @param distancesSquared: filled with their squared distance (size >= k)
+     * @return the number of neighbours found
+     */
+    int kNearestTo(const Vector2D &position, float radius, int k, int *neighbors, float *distancesSquared) const;
+
+private:
+    /**
+     * @brief search ring search around position, the point self is skipped (-1 for none)
+     */
+    int search(const Vector2D &position, int self, float radius, int k, int *neighbors, float *distancesSquared) const;
+    /**
+     * @brief insert adds a candidate in the sorted list of the k best neighbours
+     */
+    static void insert(int index, float d2, int k, int &count, int *neighbors, float *distancesSquared);
+    /**
+     * @brief cellIndex cell of a position, clamped to the grid
+     */
+    inline int cellIndex(const Vector2D &p) const {
+        return std::clamp(int((p.y - minY) * invCell), 0, rows - 1) * cols
+             + std::clamp(int((p.x - minX) * invCell), 0, cols - 1);
+    }
+    void link(int index, int c);
+    void unlink(int index);
+
+    const QVector<Vector2D> *points = nullptr; ///< points of the last build
+    float minX = 0, minY = 0;   ///< corner of the grid
+    float cell = 1;             ///< size of a cell
+    float invCell = 1;          ///< 1/cell
+    int cols = 0, rows = 0;     ///< size of the grid in cells
+    QVector<int> cellHead;      ///< first point of each cell, -1 if empty
+    QVector<int> next, previous; ///< neighbours of each point in the list of its cell, -1 at the ends
+    QVector<int> cellOf;        ///< cell of each point, -1 if removed
+};
+
+#endif // SPATIALGRID_H
@@ -0,0 +1,72 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <QVector>
+#include <atomic>
+
+/**
+ * @brief SpscRing is a bounded lock-free queue between one producer thread and one consumer
+ * thread. The storage is allocated once; push and pop never block and never allocate.
+ * The indices grow without wrapping (a 64-bit counter never overflows in practice), the
+ * position in the storage is the index modulo the capacity (a power of 2).
+ */
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * @brief SpscRing constructor
+     * @param capacityLog2: log2 of the number of elements
+     */
+    explicit SpscRing(int capacityLog2) : buffer(1 << capacityLog2), mask((quint64(1) << capacityLog2) - 1) {}
+    /**
+     * @brief capacity
+     * @return the number of elements the ring can hold
+     */
+    inline int capacity() const { return buffer.size(); }
+    /**
+     * @brief freeSpace (producer)
+     * @return the number of elements that can be pushed
+     */
+    inline int freeSpace() const { return capacity() - int(head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire)); }
+    /**
+     * @brief available (consumer)
+     * @return the number of elements that can be popped
+     */
+    inline int available() const { return int(head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed)); }
+    /**
+     * @brief write (producer) stores an element after the pending ones, it is visible to the
+     * consumer after commit()
+     * @param offset: rank of the element after the committed ones, below freeSpace()
+     * @return the element to fill
+     */
+    inline T &write(int offset) { return buffer[(head.load(std::memory_order_relaxed) + offset) & mask]; }
+    /**
+     * @brief commit (producer) publishes the written elements
+     * @param count: number of elements written
+     */
+    inline void commit(int count) { head.store(head.load(std::memory_order_relaxed) + count, std::memory_order_release); }
+    /**
+     * @brief read (consumer)
+     * @param offset: rank of the element, below available()
+     * @return the element
+     */
+    inline const T &read(int offset) const { return buffer[(tail.load(std::memory_order_relaxed) + offset) & mask]; }
+    /**
+     * @brief release (consumer) frees the read elements for the producer
+     * @param count: number of elements read
+     */
+    inline void release(int count) { tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release); }
+
+private:
+    QVector<T> buffer;
+    const quint64 mask;
+    alignas(64) std::atomic<quint64> head{0}; ///< elements pushed, written by the producer
+    alignas(64) std::atomic<quint64> tail{0}; ///< elements popped, written by the consumer
+};
+
+#endif // SPSCRING_H
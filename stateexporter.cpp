@@ -0,0 +1,170 @@
+#include "stateexporter.h"
+#include "drone.h"
+#include "scenario.h"
+#include <QDebug>
+#include <cstring>
+#include <new>
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+StateExporter::~StateExporter() {
+    close();
+}
+
+bool StateExporter::open(const QString &name) {
+    close();
+    segmentName = name.toUtf8();
+    return allocate(1024, 64);
+}
+
+void StateExporter::close() {
+    release();
+#ifdef Q_OS_UNIX
+    if (!segmentName.isEmpty()) {
+        shm_unlink(segmentName.constData());
+    }
+#endif
+    segmentName.clear();
+}
+
+/**
+ * @brief StateExporter::allocate the previous segment is retired first, so that the viewers
+ * map the new one; the capacities are rounded up to powers of 2 to grow rarely.
+ * @param droneCount drones to hold
+ * @param serverCount servers to hold
+ * @return true if the segment is mapped
+ */
+bool StateExporter::allocate(int droneCount, int serverCount) {
+    release();
+#ifdef Q_OS_UNIX
+    quint32 droneCapacity = 1024, serverCapacity = 64;
+    while (droneCapacity < quint32(droneCount)) droneCapacity *= 2;
+    while (serverCapacity < quint32(serverCount)) serverCapacity *= 2;
+    // a new segment under the same name, the viewers still mapping the old one see it retired
+    shm_unlink(segmentName.constData());
+    int fd = shm_open(segmentName.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        qDebug() << "Shared state: cannot create" << segmentName << strerror(errno);
+        return false;
+    }
+    size = SharedState::segmentSize(droneCapacity, serverCapacity);
+    void *base = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        qDebug() << "Shared state: cannot map" << segmentName << strerror(errno);
+        shm_unlink(segmentName.constData());
+        return false;
+    }
+    header = new (base) SharedState::Header;
+    header->version = SharedState::version;
+    header->headerSize = sizeof(SharedState::Header);
+    header->droneCapacity = droneCapacity;
+    header->serverCapacity = serverCapacity;
+    header->sequence.store(0, std::memory_order_relaxed);
+    header->retired.store(0, std::memory_order_relaxed);
+    header->droneCount = header->serverCount = 0;
+    header->ticks = ticks;
+    serversWritten = false;
+    // the magic last: a viewer mapping the segment meanwhile refuses it
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, SharedState::magic, sizeof(SharedState::magic));
+    return true;
+#else
+    Q_UNUSED(droneCount);
+    Q_UNUSED(serverCount);
+    qDebug() << "Shared state export needs POSIX shared memory";
+    return false;
+#endif
+}
+
+void StateExporter::release() {
+#ifdef Q_OS_UNIX
+    if (header) {
+        header->retired.store(1, std::memory_order_release);
+        munmap(header, size);
+    }
+#endif
+    header = nullptr;
+    size = 0;
+}
+
+/**
+ * @brief StateExporter::reset the targets are looked up again and the server table is written
+ * at the next publish.
+ */
+void StateExporter::reset() {
+    targetNames.clear();
+    targets.clear();
+    serversWritten = false;
+}
+
+/**
+ * @brief StateExporter::publish the arrays are written inside the sequence lock, the readers
+ * never block the engine. The server table is only written after a reset or in a new segment.
+ * @param now simulation time
+ * @param fleet the drones
+ * @param world the servers
+ * @param area size of the world
+ */
+void StateExporter::publish(double now, const QVector<Drone*> &fleet, const Scenario &world, const QSizeF &area) {
+    if (!header) {
+        return;
+    }
+    if (quint32(fleet.size()) > header->droneCapacity || quint32(world.servers.size()) > header->serverCapacity) {
+        if (!allocate(fleet.size(), world.servers.size())) {
+            return;
+        }
+    }
+    char *base = reinterpret_cast<char*>(header);
+    SharedState::Drone *drones = reinterpret_cast<SharedState::Drone*>(base + SharedState::dronesOffset());
+    SharedState::Server *servers = reinterpret_cast<SharedState::Server*>(base + SharedState::serversOffset(header->droneCapacity));
+
+    const quint32 sequence = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < fleet.size(); i++) {
+        Drone *drone = fleet[i];
+        Vector2D position = drone->getPosition();
+        SharedState::Drone &d = drones[i];
+        d.x = position.x;
+        d.y = position.y;
+        d.azimut = drone->getAzimut();
+        d.power = drone->getPower();
+        const QString &target = drone->getTargetServerName();
+        if (target != targetNames.value(i)) { // the lookup only when the target changes
+            if (i >= targetNames.size()) {
+                targetNames.resize(i + 1);
+                targets.resize(i + 1);
+            }
+            targetNames[i] = target;
+            targets[i] = world.serverIndex.value(target, -1);
+        }
+        d.server = targets[i];
+        d.status = drone->getStatus();
+        d.collision = drone->hasCollision();
+    }
+    for (int i = 0; !serversWritten && i < world.servers.size(); i++) {
+        const Server &server = world.servers[i];
+        SharedState::Server &s = servers[i];
+        s.x = server.position.x;
+        s.y = server.position.y;
+        s.rgb = server.color.rgb();
+        s.online = server.online;
+        QByteArray name = server.name.toUtf8().left(SharedState::nameSize - 1);
+        memcpy(s.name, name.constData(), name.size() + 1);
+    }
+    serversWritten = true;
+    header->droneCount = fleet.size();
+    header->serverCount = world.servers.size();
+    header->ticks = ++ticks;
+    header->width = area.width();
+    header->height = area.height();
+    header->time = now;
+    header->sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,75 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef STATEEXPORTER_H
+#define STATEEXPORTER_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+#include <QSizeF>
+#include "sharedstate.h"
+
+class Drone;
+class Scenario;
+
+/**
+ * @brief StateExporter publishes the state of the drones and servers in a POSIX shared memory
+ * segment after each tick (see SharedState), for the viewers running in other processes.
+ * The segment grows (a new segment replaces the old one) when the fleet outgrows it.
+ */
+class StateExporter {
+public:
+    ~StateExporter();
+    /**
+     * @brief open creates the segment
+     * @param name: name of the segment (starts with '/')
+     * @return false if shared memory is not available
+     */
+    bool open(const QString &name);
+    /**
+     * @brief close retires and removes the segment
+     */
+    void close();
+    /**
+     * @brief isOpen
+     * @return true if the state is published
+     */
+    inline bool isOpen() const { return header != nullptr; }
+    /**
+     * @brief publish writes the state of the fleet and the servers (between two ticks)
+     * @param now: simulation time
+     * @param fleet: the drones
+     * @param world: the servers
+     * @param area: size of the world
+     */
+    void publish(double now, const QVector<Drone*> &fleet, const Scenario &world, const QSizeF &area);
+    /**
+     * @brief reset forgets the fleet and the servers of the last publish, to call when the fleet
+     * or the servers changed: the next publish looks up every target and writes the server table
+     */
+    void reset();
+
+private:
+    /**
+     * @brief allocate replaces the segment by a segment with room for these counts
+     * @return false if the segment cannot be created
+     */
+    bool allocate(int droneCount, int serverCount);
+    /**
+     * @brief release retires and unmaps the segment
+     */
+    void release();
+
+    QByteArray segmentName;
+    SharedState::Header *header = nullptr;
+    size_t size = 0;
+    quint32 ticks = 0;
+    QVector<QString> targetNames;      ///< target server name of each drone at the last tick
+    QVector<qint16> targets;           ///< target server index of each drone at the last tick
+    bool serversWritten = false;       ///< true if the segment holds the servers of the world
+};
+
+#endif // STATEEXPORTER_H
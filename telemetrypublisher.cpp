@@ -0,0 +1,360 @@
+#include "telemetrypublisher.h"
+#include "drone.h"
+#include "scenario.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+TelemetryPublisher::TelemetryPublisher() {
+    encoder = new TelemetryEncoder(shared);
+    encoder->moveToThread(&thread);
+    QObject::connect(&thread, &QThread::finished, encoder, &QObject::deleteLater);
+}
+
+TelemetryPublisher::~TelemetryPublisher() {
+    if (!thread.isRunning()) {
+        delete encoder;
+        return;
+    }
+    thread.quit();
+    thread.wait(); // the encoder is deleted at the end of the thread
+}
+
+void TelemetryPublisher::listen(const QString &name) {
+    if (!thread.isRunning()) {
+        thread.start(QThread::LowPriority);
+    }
+    QMetaObject::invokeMethod(encoder, "listen", Qt::QueuedConnection, Q_ARG(QString, name));
+}
+
+/**
+ * @brief TelemetryPublisher::setFleet the names are given to the encoder under the mutex,
+ * the samples of the previous fleet still in the ring are dropped by the encoder.
+ * A fleet larger than half the sample ring would drop most ticks (every tick beyond the ring):
+ * both rings are replaced while the encoder does not drain them. The simulation thread is the
+ * only writer, it does not publish meanwhile.
+ * @param drones the drones
+ * @param world the servers
+ */
+void TelemetryPublisher::setFleet(const QVector<Drone*> &drones, const Scenario &world) {
+    fleet = drones;
+    int capacityLog2 = sampleRingLog2;
+    while (qint64(1) << capacityLog2 < 2 * qint64(fleet.size())) {
+        capacityLog2++;
+    }
+    if (shared.samples->capacity() < 1 << capacityLog2) {
+        QMutexLocker lock(&shared.ringMutex);
+        shared.samples.reset(new SpscRing<TelemetrySample>(capacityLog2));
+        shared.frames.reset(new SpscRing<TelemetryFrame>(frameRingLog2));
+    }
+    targetNames.fill(QString(), fleet.size());
+    targets.fill(-1, fleet.size());
+    QStringList names;
+    names.reserve(fleet.size());
+    for (Drone *drone : fleet) {
+        names.append(drone->getName());
+    }
+    QStringList servers;
+    for (const Server &server : world.servers) {
+        servers.append(server.name);
+    }
+    QMutexLocker lock(&shared.fleetMutex);
+    shared.droneNames = names;
+    shared.serverNames = servers;
+    shared.fleetGeneration = ++generation;
+}
+
+/**
+ * @brief TelemetryPublisher::publish copies the state of the fleet in the sample ring, then
+ * the tick in the frame ring. Nothing is done without client; the tick is dropped if the
+ * encoder did not free enough room (the next one carries the same changes).
+ * @param now simulation time
+ * @param world the servers
+ */
+void TelemetryPublisher::publish(double now, const Scenario &world) {
+    if (clients() == 0 || fleet.isEmpty()) {
+        return;
+    }
+    const int n = fleet.size();
+    SpscRing<TelemetrySample> &samples = *shared.samples;
+    SpscRing<TelemetryFrame> &frames = *shared.frames;
+    if (n > samples.freeSpace() || frames.freeSpace() < 1) {
+        dropped++;
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        Drone *drone = fleet[i];
+        const QString &target = drone->getTargetServerName();
+        if (target != targetNames[i]) { // the lookup only when the target changes
+            targetNames[i] = target;
+            targets[i] = world.serverIndex.value(target, -1);
+        }
+        Vector2D position = drone->getPosition();
+        TelemetrySample &sample = samples.write(i);
+        sample.x = position.x;
+        sample.y = position.y;
+        sample.power = drone->getPower();
+        sample.azimut = drone->getAzimut();
+        sample.server = targets[i];
+        sample.region = world.regionAt(position);
+        sample.status = drone->getStatus();
+    }
+    samples.commit(n);
+    frames.write(0) = TelemetryFrame{now, n, generation};
+    frames.commit(1);
+}
+
+TelemetryEncoder::TelemetryEncoder(TelemetryPublisher::Shared &s)
+    : shared(s) {
+}
+
+void TelemetryEncoder::listen(const QString &name) {
+    clock.start();
+    if (!server) {
+        server = new QLocalServer(this);
+        connect(server, &QLocalServer::newConnection, this, &TelemetryEncoder::accept);
+        QTimer *timer = new QTimer(this);
+        connect(timer, &QTimer::timeout, this, &TelemetryEncoder::drain);
+        timer->start(drainInterval);
+    }
+    server->close();
+    QLocalServer::removeServer(name); // left by a crashed run
+    if (server->listen(name)) {
+        qDebug() << "Telemetry on" << server->fullServerName();
+    } else {
+        qDebug() << "Telemetry cannot listen on" << name << ":" << server->errorString();
+    }
+}
+
+void TelemetryEncoder::accept() {
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        Client *client = new Client;
+        client->socket = socket;
+        clients.append(client);
+        shared.clients.store(clients.size(), std::memory_order_relaxed);
+        connect(socket, &QLocalSocket::readyRead, this, [this, client]() { readCommands(*client); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, client]() {
+            clients.removeOne(client);
+            shared.clients.store(clients.size(), std::memory_order_relaxed);
+            client->socket->deleteLater();
+            delete client;
+        });
+        resolve(*client);
+        sendFleet(*client);
+    }
+}
+
+/**
+ * @brief TelemetryEncoder::readCommands applies the subscription lines of a client, the next
+ * message sends the full state of its new subscription.
+ * @param client the client
+ */
+void TelemetryEncoder::readCommands(Client &client) {
+    while (client.socket->canReadLine()) {
+        QStringList words = QString::fromUtf8(client.socket->readLine()).simplified().split(' ', Qt::SkipEmptyParts);
+        if (words.isEmpty()) {
+            continue;
+        }
+        QString command = words.takeFirst();
+        if (command == "drones") {
+            client.drones = words;
+        } else if (command == "regions") {
+            client.regions = words;
+        } else if (command == "fields") {
+            const QStringList names = {"position", "status", "power", "azimut", "server", "region"};
+            client.fields = words.isEmpty() ? Telemetry::allFields : 0;
+            for (const QString &word : words) {
+                int f = names.indexOf(word);
+                if (f >= 0) client.fields |= 1 << f;
+            }
+        } else if (command == "rate") {
+            double rate = words.value(0).toDouble();
+            client.minInterval = rate > 0 ? qint64(1000 / rate) : 0;
+        } else {
+            qDebug() << "Telemetry: unknown command" << command;
+            continue;
+        }
+        resolve(client);
+        client.known.fill(false, droneNames.size());
+    }
+}
+
+/**
+ * @brief TelemetryEncoder::resolve converts the subscribed names to masks on the current fleet
+ * @param client the client
+ */
+void TelemetryEncoder::resolve(Client &client) {
+    client.droneMask.clear();
+    if (!client.drones.isEmpty()) {
+        client.droneMask.fill(false, droneNames.size());
+        for (const QString &name : client.drones) {
+            int index = droneNames.indexOf(name);
+            if (index >= 0) client.droneMask[index] = true;
+        }
+    }
+    client.regionMask.clear();
+    if (!client.regions.isEmpty()) {
+        client.regionMask.fill(false, serverNames.size());
+        for (const QString &name : client.regions) {
+            int index = serverNames.indexOf(name);
+            if (index >= 0) client.regionMask[index] = true;
+        }
+    }
+}
+
+void TelemetryEncoder::sendFleet(Client &client) {
+    message.clear();
+    quint8 kind = Telemetry::fleetMessage;
+    message.append(reinterpret_cast<const char*>(&kind), 1);
+    for (const QStringList *names : {&droneNames, &serverNames}) {
+        quint32 count = names->size();
+        message.append(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const QString &name : *names) {
+            QByteArray utf8 = name.toUtf8().left(0xFFFF);
+            quint16 length = utf8.size();
+            message.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            message.append(utf8);
+        }
+    }
+    quint32 size = message.size();
+    client.socket->write(reinterpret_cast<const char*>(&size), sizeof(size));
+    client.socket->write(message);
+    client.sent.resize(droneNames.size());
+    client.known.fill(false, droneNames.size());
+    client.lastSent = -1;
+}
+
+/**
+ * @brief TelemetryEncoder::sendState writes the subscribed fields that changed since the last
+ * message of the client, the skipped ticks (rate cap, slow client) are merged in the deltas.
+ * A drone sent to the client and now out of its regions is sent once more, marked left.
+ * @param client the client
+ */
+void TelemetryEncoder::sendState(Client &client) {
+    const qint64 now = clock.elapsed();
+    if ((client.lastSent >= 0 && now - client.lastSent < client.minInterval)
+            || client.socket->bytesToWrite() > maxPendingBytes) {
+        return;
+    }
+    message.resize(1 + sizeof(double) + sizeof(quint32));
+    message[0] = char(Telemetry::stateMessage);
+    memcpy(message.data() + 1, &latestTime, sizeof(double));
+    quint32 count = 0;
+    char record[4 + 1 + 8 + 1 + 2 * 4];
+    for (int i = 0; i < latest.size(); i++) {
+        const Encoded &e = latest[i];
+        if (!client.droneMask.isEmpty() && !client.droneMask[i]) {
+            continue;
+        }
+        const bool outside = !client.regionMask.isEmpty() && (e.region < 0 || !client.regionMask.value(e.region));
+        if (outside && !client.known[i]) {
+            continue;
+        }
+        Encoded &s = client.sent[i];
+        quint8 mask = 0;
+        if (outside) {
+            mask = Telemetry::left | Telemetry::region; // the last record until it comes back
+        } else if (!client.known[i]) {
+            mask = client.fields;
+        } else {
+            if (e.x != s.x || e.y != s.y) mask |= Telemetry::position;
+            if (e.status != s.status) mask |= Telemetry::status;
+            if (e.power != s.power) mask |= Telemetry::power;
+            if (e.azimut != s.azimut) mask |= Telemetry::azimut;
+            if (e.server != s.server) mask |= Telemetry::server;
+            if (e.region != s.region) mask |= Telemetry::region;
+            mask &= client.fields;
+        }
+        if (!mask) {
+            continue;
+        }
+        char *out = record;
+        quint32 index = i;
+        memcpy(out, &index, 4); out += 4;
+        *out++ = char(mask);
+        if (mask & Telemetry::position) { memcpy(out, &e.x, 4); memcpy(out + 4, &e.y, 4); out += 8; }
+        if (mask & Telemetry::status) { *out++ = char(e.status); }
+        if (mask & Telemetry::power) { memcpy(out, &e.power, 2); out += 2; }
+        if (mask & Telemetry::azimut) { memcpy(out, &e.azimut, 2); out += 2; }
+        if (mask & Telemetry::server) { memcpy(out, &e.server, 2); out += 2; }
+        if (mask & Telemetry::region) { memcpy(out, &e.region, 2); out += 2; }
+        message.append(record, out - record);
+        s = e;
+        client.known[i] = !outside;
+        count++;
+    }
+    memcpy(message.data() + 1 + sizeof(double), &count, sizeof(count));
+    if (count == 0 && client.lastSent >= 0) {
+        return; // nothing changed
+    }
+    quint32 size = message.size();
+    client.socket->write(reinterpret_cast<const char*>(&size), sizeof(size));
+    client.socket->write(message);
+    client.lastSent = now;
+}
+
+/**
+ * @brief TelemetryEncoder::adoptFleet takes the names of the latest fleet, resolves the
+ * subscriptions again and sends the new fleet to the clients.
+ */
+void TelemetryEncoder::adoptFleet() {
+    {
+        QMutexLocker lock(&shared.fleetMutex);
+        droneNames = shared.droneNames;
+        serverNames = shared.serverNames;
+        generation = shared.fleetGeneration;
+    }
+    latest.fill(Encoded{0, 0, 0, 0, -1, -1, 0}, droneNames.size());
+    for (Client *client : clients) {
+        resolve(*client);
+        sendFleet(*client);
+    }
+}
+
+/**
+ * @brief TelemetryEncoder::drain quantizes the ticks of the rings in the latest state, then
+ * sends the changes to each client once.
+ * The rings are drained under ringMutex, the publisher replaces them under it (see
+ * TelemetryPublisher::setFleet).
+ */
+void TelemetryEncoder::drain() {
+    bool changed = false;
+    QMutexLocker lock(&shared.ringMutex);
+    SpscRing<TelemetrySample> &samples = *shared.samples;
+    SpscRing<TelemetryFrame> &frames = *shared.frames;
+    while (frames.available() > 0) {
+        const TelemetryFrame frame = frames.read(0);
+        if (frame.generation != generation) {
+            adoptFleet();
+        }
+        if (frame.generation == generation && frame.count == latest.size()) {
+            for (int i = 0; i < frame.count; i++) {
+                const TelemetrySample &sample = samples.read(i);
+                Encoded &e = latest[i];
+                e.x = sample.x;
+                e.y = sample.y;
+                e.power = quint16(std::lround(std::clamp(sample.power, 0.0f, 100.0f) * 100));
+                e.azimut = qint16(std::lround(sample.azimut * 10));
+                e.server = sample.server;
+                e.region = sample.region;
+                e.status = sample.status;
+            }
+            latestTime = frame.time;
+            changed = true;
+        }
+        // the samples of a previous fleet are dropped
+        samples.release(frame.count);
+        frames.release(1);
+    }
+    lock.unlock();
+    if (!changed) {
+        return;
+    }
+    for (Client *client : clients) {
+        sendState(*client);
+    }
+}
@@ -0,0 +1,208 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef TELEMETRYPUBLISHER_H
+#define TELEMETRYPUBLISHER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QVector>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <atomic>
+#include <memory>
+#include "spscring.h"
+
+class Drone;
+class Scenario;
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * @brief Telemetry protocol on the local socket (native byte order).
+ * The clients send text lines to choose what they receive (none = everything):
+ * - "drones name...": only these drones
+ * - "regions server...": only the drones in the Voronoi regions of these servers
+ * - "fields position status power azimut server region": only these fields
+ * - "rate hz": at most hz messages per second (0: each tick)
+ * The publisher sends messages made of a 32-bit size, a kind and a payload:
+ * - fleet: the drone names then the server names (32-bit count, then 16-bit length + UTF-8),
+ *   sent on connection and when the scenario changes; the drones and servers are then given
+ *   by their index in these lists;
+ * - state: the simulation time, the number of drones, then for each drone whose subscribed
+ *   fields changed since the last message: its index, a mask of the fields, and the fields
+ *   (position 2 float, status 8 bits, power 16 bits in 1/100 %, azimut 16 bits in 1/10 degree,
+ *   target server and region 16 bits). A drone that leaves the subscribed regions is sent
+ *   once with the mask left | region and its new region, then no more until it comes back
+ *   (with all its subscribed fields).
+ */
+namespace Telemetry {
+    enum Kind : quint8 { fleetMessage = 0, stateMessage = 1 };
+    enum Field : quint8 { position = 1, status = 2, power = 4, azimut = 8, server = 16, region = 32, allFields = 63, left = 64 };
+}
+
+/**
+ * @brief State of a drone at a tick, pushed by the simulation thread
+ */
+struct TelemetrySample {
+    float x, y;
+    float power;    ///< percent
+    float azimut;   ///< degrees
+    qint16 server;  ///< target server, -1 if none
+    qint16 region;  ///< server region containing the drone
+    quint8 status;
+};
+
+/**
+ * @brief A tick pushed by the simulation thread: count samples follow in the sample ring
+ */
+struct TelemetryFrame {
+    double time;
+    qint32 count;
+    quint32 generation; ///< fleet of the samples (see TelemetryPublisher::setFleet)
+};
+
+class TelemetryEncoder;
+
+/**
+ * @brief TelemetryPublisher streams the state of the drones to the clients of a QLocalServer.
+ * After each tick the simulation thread copies the state of the fleet in a lock-free ring
+ * (nothing is copied without client, and a full ring drops the tick instead of waiting); an
+ * encoder thread owns the socket server, filters the samples for each subscription and writes
+ * the changed fields. The sample ring holds at least two ticks of the fleet: it is replaced by
+ * a larger one when a larger fleet is set.
+ */
+class TelemetryPublisher {
+public:
+    static constexpr int sampleRingLog2 = 20; ///< room for at least 2^20 drone states
+    static constexpr int frameRingLog2 = 8;   ///< room for 2^8 ticks
+
+    TelemetryPublisher();
+    /**
+     * @brief TelemetryPublisher destructor, stops the encoder thread
+     */
+    ~TelemetryPublisher();
+    /**
+     * @brief listen starts the encoder thread and the socket server
+     * @param name: name of the local socket
+     */
+    void listen(const QString &name);
+    /**
+     * @brief setFleet changes the published drones (after a scenario change), the rings are
+     * replaced if the sample ring cannot hold two ticks of the fleet
+     * @param fleet: the drones, their index is their rank in this list
+     * @param world: the servers
+     */
+    void setFleet(const QVector<Drone*> &fleet, const Scenario &world);
+    /**
+     * @brief publish pushes the state of the fleet (simulation thread, after a tick)
+     * @param now: simulation time
+     * @param world: the servers, to find the target and region of the drones
+     */
+    void publish(double now, const Scenario &world);
+    /**
+     * @brief clients
+     * @return the number of connected clients
+     */
+    inline int clients() const { return shared.clients.load(std::memory_order_relaxed); }
+    /**
+     * @brief droppedTicks
+     * @return the number of ticks not published because the encoder was late
+     */
+    inline int droppedTicks() const { return dropped; }
+
+    /**
+     * @brief State shared by the simulation and the encoder threads
+     */
+    struct Shared {
+        Shared() : samples(new SpscRing<TelemetrySample>(sampleRingLog2)), frames(new SpscRing<TelemetryFrame>(frameRingLog2)) {}
+        std::unique_ptr<SpscRing<TelemetrySample>> samples;
+        std::unique_ptr<SpscRing<TelemetryFrame>> frames;
+        QMutex ringMutex;          ///< held by the encoder while it drains the rings, and to replace them
+        std::atomic<int> clients{0};
+        QMutex fleetMutex;         ///< protects the names and fleetGeneration
+        QStringList droneNames;
+        QStringList serverNames;
+        quint32 fleetGeneration = 0;
+    };
+
+private:
+    Shared shared;
+    QThread thread;
+    TelemetryEncoder *encoder = nullptr;
+    QVector<Drone*> fleet;             ///< published drones
+    QVector<QString> targetNames;      ///< target server name of each drone at the last tick
+    QVector<qint16> targets;           ///< target server index of each drone at the last tick
+    quint32 generation = 0;
+    int dropped = 0;
+};
+
+/**
+ * @brief TelemetryEncoder lives in the encoder thread: it accepts the clients, reads their
+ * subscriptions and drains the rings on a timer.
+ */
+class TelemetryEncoder : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int drainInterval = 20;             ///< ms between two drains of the rings
+    static constexpr qint64 maxPendingBytes = 16 << 20;  ///< a slower client skips messages (its deltas accumulate)
+
+    explicit TelemetryEncoder(TelemetryPublisher::Shared &shared);
+
+public slots:
+    /**
+     * @brief listen creates the server and the drain timer in the encoder thread
+     * @param name: name of the local socket
+     */
+    void listen(const QString &name);
+
+private:
+    /**
+     * @brief Quantized state of a drone, as sent
+     */
+    struct Encoded {
+        float x, y;
+        quint16 power;
+        qint16 azimut, server, region;
+        quint8 status;
+    };
+    /**
+     * @brief A connected client and its subscription
+     */
+    struct Client {
+        QLocalSocket *socket;
+        QStringList drones;         ///< subscribed drone names, empty for all
+        QStringList regions;        ///< subscribed region server names, empty for all
+        QVector<bool> droneMask;    ///< subscribed drones by index (empty for all)
+        QVector<bool> regionMask;   ///< subscribed regions by index (empty for all)
+        quint8 fields = Telemetry::allFields;
+        qint64 minInterval = 0;     ///< ms between two messages
+        qint64 lastSent = -1;       ///< time of the last message (ms)
+        QVector<Encoded> sent;      ///< last state sent of each drone
+        QVector<bool> known;        ///< true if the drone was sent since the fleet message
+    };
+
+    void accept();
+    void readCommands(Client &client);
+    void resolve(Client &client);
+    void sendFleet(Client &client);
+    void sendState(Client &client);
+    void drain();
+    void adoptFleet();
+
+    TelemetryPublisher::Shared &shared;
+    QLocalServer *server = nullptr;
+    QVector<Client*> clients;
+    QStringList droneNames;         ///< fleet of the latest samples
+    QStringList serverNames;
+    quint32 generation = 0;
+    QVector<Encoded> latest;        ///< state of each drone at the last drained tick
+    double latestTime = 0;
+    QByteArray message;             ///< message being encoded, reused
+    QElapsedTimer clock;
+};
+
+#endif // TELEMETRYPUBLISHER_H
@@ -0,0 +1,313 @@
+#include "tilestore.h"
+#include "scenario.h"
+#include "spatialgrid.h"
+#include <QFile>
+#include <QObject>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr char magic[8] = {'D', 'R', 'N', 'T', 'I', 'L', 'E', 0};
+constexpr qint64 tileBytes = qint64(TileStore::tileSize) * TileStore::tileSize * sizeof(qint32);
+constexpr quint64 pageSize = 4096;
+}
+
+TileStore::~TileStore() {
+    close();
+}
+
+quint64 TileStore::fingerprint(const Scenario &world, float cellSize) {
+    // FNV-1a over the cell size and the server positions (the regions only depend on them)
+    quint64 hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void *data, size_t size) {
+        const uchar *bytes = static_cast<const uchar*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    const quint32 tile = tileSize;
+    mix(&tile, sizeof(tile));
+    mix(&cellSize, sizeof(cellSize));
+    for (const Server &server : world.servers) {
+        mix(&server.position.x, sizeof(float));
+        mix(&server.position.y, sizeof(float));
+    }
+    return hash;
+}
+
+/**
+ * @brief TileStore::build covers the servers and the initial drones with a margin of
+ * connectionDistance, then fills each tile with a nearest search in a grid of the servers
+ * (O(cells), not O(cells x servers)) and appends it to a temporary file renamed at the end.
+ */
+bool TileStore::build(const Scenario &world, const QString &path, float cellSize, QString &error,
+                      const std::function<bool(int)> &progress) {
+    if (world.servers.isEmpty() || !(cellSize > 0)) {
+        error = QObject::tr("No server to tile.");
+        return false;
+    }
+    QVector<Vector2D> positions;
+    positions.reserve(world.servers.size());
+    float minX = world.servers[0].position.x, maxX = minX;
+    float minY = world.servers[0].position.y, maxY = minY;
+    for (const Server &server : world.servers) {
+        positions.append(server.position);
+        minX = std::min(minX, server.position.x);
+        maxX = std::max(maxX, server.position.x);
+        minY = std::min(minY, server.position.y);
+        maxY = std::max(maxY, server.position.y);
+    }
+    for (const DroneSpec &spec : world.drones) {
+        minX = std::min(minX, spec.position.x);
+        maxX = std::max(maxX, spec.position.x);
+        minY = std::min(minY, spec.position.y);
+        maxY = std::max(maxY, spec.position.y);
+    }
+    const float margin = float(Scenario::connectionDistance);
+    const float tileExtent = cellSize * tileSize;
+
+    Header h{};
+    memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.headerSize = sizeof(Header);
+    h.tileSize = tileSize;
+    h.originX = minX - margin;
+    h.originY = minY - margin;
+    h.tilesX = quint32(std::ceil((maxX + margin - h.originX) / tileExtent));
+    h.tilesY = quint32(std::ceil((maxY + margin - h.originY) / tileExtent));
+    h.serverCount = world.servers.size();
+    h.cellSize = cellSize;
+    h.fingerprint = fingerprint(world, cellSize);
+    h.dataOffset = pageSize;
+    if (quint64(h.tilesX) * h.tilesY > quint64(std::numeric_limits<int>::max())) {
+        error = QObject::tr("The world needs too many tiles, use larger cells.");
+        return false;
+    }
+
+    // about one server per cell of the search grid
+    SpatialGrid grid;
+    const float spread = std::max(maxX - minX, maxY - minY) + 1;
+    grid.build(positions, std::max(cellSize, spread / std::sqrt(float(positions.size()))));
+    const float radius = 2 * (std::max(h.tilesX, h.tilesY) * tileExtent + spread);
+
+    const QString partPath = path + ".part";
+    QFile file(partPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = QObject::tr("Cannot write %1: %2").arg(partPath, file.errorString());
+        return false;
+    }
+    QByteArray page(int(pageSize), 0);
+    memcpy(page.data(), &h, sizeof(h));
+    file.write(page);
+    QVector<qint32> cells(tileSize * tileSize);
+    int neighbor;
+    float distanceSquared;
+    for (quint32 ty = 0; ty < h.tilesY; ty++) {
+        if (progress && !progress(int(100 * ty / h.tilesY))) {
+            file.remove();
+            return false;
+        }
+        for (quint32 tx = 0; tx < h.tilesX; tx++) {
+            for (int cy = 0; cy < tileSize; cy++) {
+                const float y = h.originY + ((ty * tileSize + cy) + 0.5f) * cellSize;
+                for (int cx = 0; cx < tileSize; cx++) {
+                    const float x = h.originX + ((tx * tileSize + cx) + 0.5f) * cellSize;
+                    cells[cy * tileSize + cx] = grid.kNearestTo(Vector2D(x, y), radius, 1, &neighbor, &distanceSquared) > 0 ? neighbor : -1;
+                }
+            }
+            if (file.write(reinterpret_cast<const char*>(cells.constData()), tileBytes) != tileBytes) {
+                error = QObject::tr("Cannot write %1: %2").arg(partPath, file.errorString());
+                file.remove();
+                return false;
+            }
+        }
+    }
+    file.close();
+    QFile::remove(path);
+    if (!QFile::rename(partPath, path)) {
+        error = QObject::tr("Cannot replace %1").arg(path);
+        return false;
+    }
+    qDebug() << "Tile store" << path << ":" << h.tilesX << "x" << h.tilesY << "tiles of"
+             << tileSize << "cells of" << cellSize << "units";
+    return true;
+}
+
+bool TileStore::open(const QString &path, qint64 budgetBytes, QString &error) {
+    close();
+    fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+    if (fd < 0) {
+        error = QObject::tr("Cannot open %1: %2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    struct stat info;
+    const bool read = ::pread(fd, &header, sizeof(header), 0) == ssize_t(sizeof(header)) && fstat(fd, &info) == 0;
+    if (!read || memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version
+            || header.headerSize != sizeof(Header) || header.tileSize != quint32(tileSize)
+            || !(header.cellSize > 0) || header.dataOffset % pageSize != 0
+            || quint64(info.st_size) < header.dataOffset + quint64(header.tilesX) * header.tilesY * tileBytes) {
+        error = QObject::tr("%1 is not a tile store of version %2.").arg(path).arg(version);
+        close();
+        return false;
+    }
+    invCell = 1.0f / header.cellSize;
+    columns = int(header.tilesX) * tileSize;
+    rows = int(header.tilesY) * tileSize;
+    // the slots are allocated once: looking up a tile never allocates
+    const int slots = int(std::min(std::max<qint64>(budgetBytes / tileBytes, 4), qint64(header.tilesX) * header.tilesY));
+    slotOfTile.fill(-1, int(header.tilesX * header.tilesY));
+    prefetched.fill(0, int(header.tilesX * header.tilesY));
+    prefetchCall = 0;
+    tileOfSlot.fill(-1, slots);
+    slotCells.fill(nullptr, slots);
+    prev.fill(-1, slots);
+    next.fill(-1, slots);
+    head = tail = -1;
+    used = 0;
+    counters = Stats();
+    counters.capacity = slots;
+    return true;
+}
+
+void TileStore::close() {
+    for (int slot = 0; slot < used; slot++) {
+        munmap(const_cast<qint32*>(slotCells[slot]), tileBytes);
+    }
+    used = 0;
+    head = tail = -1;
+    lastTile = -1;
+    lastCells = nullptr;
+    slotOfTile.clear();
+    prefetched.clear();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool TileStore::matches(const Scenario &world) const {
+    return fd >= 0 && header.serverCount == quint32(world.servers.size())
+            && header.fingerprint == fingerprint(world, header.cellSize);
+}
+
+int TileStore::regionAt(const Vector2D &position) const {
+    const float fx = (position.x - header.originX) * invCell;
+    const float fy = (position.y - header.originY) * invCell;
+    if (fd < 0 || !(fx >= 0 && fy >= 0 && fx < columns && fy < rows)) {
+        return -1;
+    }
+    const int x = int(fx), y = int(fy);
+    const int index = (y / tileSize) * int(header.tilesX) + x / tileSize;
+    const qint32 *cells = index == lastTile ? lastCells : tile(index);
+    return cells ? cells[(y % tileSize) * tileSize + x % tileSize] : -1;
+}
+
+/**
+ * @brief TileStore::prefetch the drones close to each other share their tiles: a tile already
+ * touched by this call is skipped, so the cost is O(distinct tiles), and the call stops at the
+ * capacity so that the tiles of a tick never evict each other.
+ */
+void TileStore::prefetch(const QVector<Vector2D> &positions, const QSize &raster) const {
+    if (fd < 0) {
+        return;
+    }
+    if (++prefetchCall == 0) { // wrapped around, the old marks could match again
+        prefetched.fill(0);
+        prefetchCall = 1;
+    }
+    int touched = 0;
+    const float reach = prefetchMargin * invCell;
+    const int tilesX = int(header.tilesX), tilesY = int(header.tilesY);
+    for (const Vector2D &position : positions) {
+        if (position.x >= 0 && position.y >= 0 && position.x < raster.width() && position.y < raster.height()) {
+            continue;
+        }
+        const float fx = (position.x - header.originX) * invCell;
+        const float fy = (position.y - header.originY) * invCell;
+        const int x0 = std::max(0, int(std::floor((fx - reach) / tileSize)));
+        const int x1 = std::min(tilesX - 1, int(std::floor((fx + reach) / tileSize)));
+        const int y0 = std::max(0, int(std::floor((fy - reach) / tileSize)));
+        const int y1 = std::min(tilesY - 1, int(std::floor((fy + reach) / tileSize)));
+        for (int ty = y0; ty <= y1; ty++) {
+            for (int tx = x0; tx <= x1; tx++) {
+                const int index = ty * tilesX + tx;
+                if (prefetched[index] == prefetchCall) {
+                    continue;
+                }
+                if (touched == counters.capacity) {
+                    return;
+                }
+                prefetched[index] = prefetchCall;
+                touched++;
+                tile(index);
+            }
+        }
+    }
+}
+
+/**
+ * @brief TileStore::tile a mapped tile moves to the front of the LRU list; a missing one takes a
+ * free slot, or the slot of the least recently used tile which is unmapped first
+ * @param index index of the tile
+ * @return its cells
+ */
+const qint32 *TileStore::tile(int index) const {
+    int slot = slotOfTile[index];
+    if (slot >= 0) {
+        if (slot != head) {
+            unlink(slot);
+            pushFront(slot);
+        }
+    } else {
+        void *cells = mmap(nullptr, tileBytes, PROT_READ, MAP_SHARED, fd, off_t(header.dataOffset + quint64(index) * tileBytes));
+        if (cells == MAP_FAILED) {
+            return nullptr;
+        }
+        madvise(cells, tileBytes, MADV_WILLNEED); // read ahead, the cells are used soon
+        if (used < tileOfSlot.size()) {
+            slot = used++;
+        } else {
+            slot = tail;
+            unlink(slot);
+            const int old = tileOfSlot[slot];
+            munmap(const_cast<qint32*>(slotCells[slot]), tileBytes);
+            slotOfTile[old] = -1;
+            if (old == lastTile) {
+                lastTile = -1;
+                lastCells = nullptr;
+            }
+            counters.evicted++;
+        }
+        slotOfTile[index] = slot;
+        tileOfSlot[slot] = index;
+        slotCells[slot] = static_cast<const qint32*>(cells);
+        pushFront(slot);
+        counters.mapped++;
+        counters.resident = used;
+    }
+    lastTile = index;
+    lastCells = slotCells[slot];
+    return lastCells;
+}
+
+void TileStore::unlink(int slot) const {
+    if (prev[slot] >= 0) next[prev[slot]] = next[slot]; else head = next[slot];
+    if (next[slot] >= 0) prev[next[slot]] = prev[slot]; else tail = prev[slot];
+    prev[slot] = next[slot] = -1;
+}
+
+void TileStore::pushFront(int slot) const {
+    prev[slot] = -1;
+    next[slot] = head;
+    if (head >= 0) prev[head] = slot;
+    head = slot;
+    if (tail < 0) tail = slot;
+}
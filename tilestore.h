@@ -0,0 +1,155 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef TILESTORE_H
+#define TILESTORE_H
+
+#include <QString>
+#include <QVector>
+#include <QSize>
+#include <functional>
+#include "vector2d.h"
+
+class Scenario;
+
+/**
+ * @brief TileStore keeps the Voronoi regions of a whole world on disk, for worlds much larger than
+ * the canvas. The world (bounding box of the servers and the drones, plus a margin) is cut in square
+ * tiles of tileSize x tileSize cells; each cell holds the index of its closest server.
+ * The file is a header followed by the tiles, each one aligned on a page. A tile is mapped when a
+ * position inside it is looked up (or prefetched around the drones) and unmapped when it is the least
+ * recently used one and the memory budget is full, so the mapped tiles stay under the budget whatever
+ * the size of the world.
+ * Only the regions are out of core: the servers, the connections, the routing table and the canvas
+ * background stay in memory, and nothing is paged around the viewport (the canvas raster covers it).
+ * Only the simulation thread reads the tiles (the cache is not thread safe).
+ */
+class TileStore {
+public:
+    static constexpr quint32 version = 1;
+    static constexpr int tileSize = 256;        ///< cells per side of a tile
+    static constexpr float defaultCellSize = 4; ///< world units per cell
+    static constexpr float prefetchMargin = 256; ///< distance around a drone whose tiles are kept mapped
+
+    /**
+     * @brief Header of the file
+     */
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 headerSize;
+        quint32 tileSize;
+        quint32 tilesX, tilesY;     ///< number of tiles along x and y
+        quint32 serverCount;
+        float originX, originY;     ///< world position of the first cell
+        float cellSize;             ///< world units per cell
+        quint64 fingerprint;        ///< servers the regions were computed for (see fingerprint())
+        quint64 dataOffset;         ///< offset of the first tile
+    };
+    /**
+     * @brief Activity of the tile cache
+     */
+    struct Stats {
+        int resident = 0;       ///< mapped tiles
+        int capacity = 0;       ///< tiles allowed by the budget
+        qint64 mapped = 0;      ///< tiles mapped since open
+        qint64 evicted = 0;     ///< tiles unmapped to stay in the budget
+    };
+
+    TileStore() = default;
+    TileStore(const TileStore&) = delete;
+    TileStore &operator=(const TileStore&) = delete;
+    /**
+     * @brief TileStore destructor, unmaps the tiles
+     */
+    ~TileStore();
+
+    /**
+     * @brief build computes the regions of a world tile by tile and writes the file (only one tile
+     * is in memory at a time); the file is replaced only when it is complete
+     * @param world: the servers and the drones
+     * @param path: path of the file
+     * @param cellSize: world units per cell
+     * @param error: message set on failure
+     * @param progress: optional progress callback, returns false to cancel
+     * @return true if written
+     */
+    static bool build(const Scenario &world, const QString &path, float cellSize, QString &error,
+                      const std::function<bool(int)> &progress = std::function<bool(int)>());
+    /**
+     * @brief fingerprint
+     * @param world: the servers
+     * @param cellSize: world units per cell
+     * @return a hash of the server positions and the cell size, the regions are valid while it is unchanged
+     */
+    static quint64 fingerprint(const Scenario &world, float cellSize);
+    /**
+     * @brief open reads the header of a store, no tile is mapped yet
+     * @param path: path of the file
+     * @param budgetBytes: memory allowed for the mapped tiles
+     * @param error: message set on failure
+     * @return true if the file is a valid store of this version
+     */
+    bool open(const QString &path, qint64 budgetBytes, QString &error);
+    /**
+     * @brief close unmaps the tiles and closes the file
+     */
+    void close();
+    /**
+     * @brief matches
+     * @param world: the servers
+     * @return true if the regions of the store were computed for these servers
+     */
+    bool matches(const Scenario &world) const;
+    /**
+     * @brief regionAt reads the server of a position, mapping its tile if needed
+     * @param position: the position
+     * @return index of the server, -1 outside of the store
+     */
+    int regionAt(const Vector2D &position) const;
+    /**
+     * @brief prefetch maps the tiles within prefetchMargin of positions (the ones already mapped
+     * become the most recently used) and asks the kernel to read the new ones ahead; each tile is
+     * touched once per call, and the call stops when it has touched as many tiles as the budget
+     * allows (more would evict the tiles it just mapped)
+     * @param positions: positions of the active drones
+     * @param raster: size of the region raster of the canvas, the positions inside it are skipped
+     * (they are read in Scenario::regionIds)
+     */
+    void prefetch(const QVector<Vector2D> &positions, const QSize &raster) const;
+    /**
+     * @brief stats
+     * @return the activity of the cache
+     */
+    inline const Stats &stats() const { return counters; }
+
+private:
+    /**
+     * @brief tile maps a tile if needed and makes it the most recently used
+     * @param index: index of the tile
+     * @return its cells, nullptr if it cannot be mapped
+     */
+    const qint32 *tile(int index) const;
+    void unlink(int slot) const;
+    void pushFront(int slot) const;
+
+    int fd = -1;
+    Header header{};
+    float invCell = 0;
+    int columns = 0, rows = 0;              ///< number of cells along x and y
+    mutable QVector<int> slotOfTile;        ///< slot of each tile, -1 if not mapped
+    mutable QVector<int> tileOfSlot;        ///< tile of each slot, -1 if free
+    mutable QVector<const qint32*> slotCells; ///< mapped cells of each slot
+    mutable QVector<int> prev, next;        ///< LRU list of the used slots
+    mutable int head = -1, tail = -1;       ///< most and least recently used slots
+    mutable int used = 0;                   ///< number of used slots
+    mutable QVector<quint32> prefetched;    ///< call of prefetch which last touched each tile
+    mutable quint32 prefetchCall = 0;       ///< number of calls of prefetch
+    mutable int lastTile = -1;              ///< tile of the last lookup
+    mutable const qint32 *lastCells = nullptr;
+    mutable Stats counters;
+};
+
+#endif // TILESTORE_H
@@ -0,0 +1,242 @@
+#include "tracereader.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/**
+ * @brief readRaw copies a value in native byte order
+ */
+template <typename T>
+static T readRaw(const uchar *in) {
+    T value;
+    memcpy(&value, in, sizeof(T));
+    return value;
+}
+
+/**
+ * @brief readVarint reads a value written by appendVarint (see TraceRecorder)
+ * @param in: position of the value, moved after it
+ * @param end: end of the payload
+ */
+static qint32 readVarint(const uchar *&in, const uchar *end) {
+    quint32 v = 0;
+    for (int shift = 0; in < end && shift < 35; shift += 7) {
+        uchar byte = *in++;
+        v |= quint32(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return qint32(v >> 1) ^ -qint32(v & 1);
+}
+
+TraceReader::~TraceReader() {
+    close();
+}
+
+/**
+ * @brief TraceReader::open maps the whole file and checks its header, then reads the seek
+ * index from the footer or rebuilds it.
+ * @param path path of the trace
+ * @return true if the trace can be replayed
+ */
+bool TraceReader::open(const QString &path) {
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "cannot read" << path;
+        return false;
+    }
+    size = file.size();
+    data = size > 0 ? file.map(0, size) : nullptr;
+    const qint64 headerSize = 4 + 3 * sizeof(quint32) + 2 * sizeof(double);
+    if (!data || size < headerSize || memcmp(data, TraceFormat::headerMagic, 4) != 0
+            || readRaw<quint32>(data + 4) != TraceFormat::version) {
+        qDebug() << path << "is not a trace";
+        close();
+        return false;
+    }
+    const quint32 droneCount = readRaw<quint32>(data + 8);
+    const quint32 serverCount = readRaw<quint32>(data + 12);
+    start = readRaw<double>(data + 16);
+    interval = readRaw<double>(data + 24);
+    // the slots of the index are computed from the interval
+    if (!std::isfinite(start) || !std::isfinite(interval) || interval <= 0) {
+        qDebug() << path << "has an invalid keyframe interval";
+        close();
+        return false;
+    }
+    qint64 offset = headerSize;
+    for (quint32 i = 0; i < droneCount + serverCount; i++) {
+        if (offset + 2 > size || offset + 2 + readRaw<quint16>(data + offset) > size) {
+            qDebug() << path << "is truncated";
+            close();
+            return false;
+        }
+        quint16 length = readRaw<quint16>(data + offset);
+        QString name = QString::fromUtf8(reinterpret_cast<const char*>(data + offset + 2), length);
+        (i < droneCount ? drones : servers).append(name);
+        offset += 2 + length;
+    }
+    firstFrame = offset;
+    if (!readFooter()) {
+        scanFrames();
+    }
+    fields.fill(0, drones.size() * TraceFormat::fieldCount);
+    current.resize(drones.size());
+    if (keyframes.isEmpty()) {
+        qDebug() << path << "has no frame";
+        close();
+        return false;
+    }
+    seek(start);
+    return true;
+}
+
+/**
+ * @brief TraceReader::close unmaps and closes the file.
+ */
+void TraceReader::close() {
+    if (data) {
+        file.unmap(const_cast<uchar*>(data));
+        data = nullptr;
+    }
+    file.close();
+    size = 0;
+    drones.clear();
+    servers.clear();
+    keyframes.clear();
+    current.clear();
+}
+
+/**
+ * @brief TraceReader::readFooter checks the trailer (offset of the footer and magic) and
+ * the size of the footer before reading the index.
+ */
+bool TraceReader::readFooter() {
+    const qint64 trailer = size - qint64(sizeof(qint64)) - 4;
+    if (trailer < firstFrame || memcmp(data + trailer + sizeof(qint64), TraceFormat::footerMagic, 4) != 0) {
+        return false;
+    }
+    const qint64 footer = readRaw<qint64>(data + trailer);
+    if (footer < firstFrame || footer + qint64(sizeof(quint32)) > trailer) {
+        return false;
+    }
+    const quint32 slotCount = readRaw<quint32>(data + footer);
+    const qint64 index = footer + sizeof(quint32);
+    if (index + qint64(slotCount) * qint64(sizeof(qint64)) + qint64(sizeof(double) + sizeof(quint32)) != trailer) {
+        return false;
+    }
+    keyframes.resize(slotCount);
+    memcpy(keyframes.data(), data + index, slotCount * sizeof(qint64));
+    for (qint64 offset : keyframes) {
+        if (offset < firstFrame || offset + TraceFormat::frameHeaderSize > footer) {
+            keyframes.clear();
+            return false;
+        }
+    }
+    end = readRaw<double>(data + index + slotCount * sizeof(qint64));
+    framesEnd = footer;
+    return true;
+}
+
+/**
+ * @brief TraceReader::scanFrames walks the frame headers up to the last complete frame and
+ * indexes the keyframes like TraceRecorder::record. The index is bounded by the size of the
+ * file (like a footer): a keyframe whose slot is beyond ends the scan.
+ */
+void TraceReader::scanFrames() {
+    keyframes.clear();
+    const double maxSlots = double(size / qint64(sizeof(qint64)));
+    end = start;
+    qint64 offset = firstFrame;
+    while (offset + TraceFormat::frameHeaderSize <= size) {
+        qint64 next = offset + TraceFormat::frameHeaderSize + readRaw<quint32>(data + offset + 9);
+        if (next > size) {
+            break;
+        }
+        double time = frameTime(offset);
+        if (time < end) {
+            break; // not a frame: the times never decrease
+        }
+        if (data[offset] == TraceFormat::keyFrame) {
+            const double slotIndex = std::floor((time - start) / interval);
+            if (!(slotIndex < maxSlots)) {
+                break; // not a frame: its index would outgrow the file
+            }
+            int slot = std::max(0, int(slotIndex));
+            while (keyframes.size() < slot) {
+                keyframes.append(keyframes.isEmpty() ? offset : keyframes.last());
+            }
+            keyframes.append(offset);
+        }
+        end = time;
+        offset = next;
+    }
+    framesEnd = offset;
+    qDebug() << "trace without index," << keyframes.size() << "keyframes found";
+}
+
+double TraceReader::frameTime(qint64 offset) const {
+    return readRaw<double>(data + offset + 1);
+}
+
+/**
+ * @brief TraceReader::decode adds the changes of a frame to the fields, a keyframe restarts
+ * from zero.
+ * @param offset frame to decode
+ * @return the next frame
+ */
+qint64 TraceReader::decode(qint64 offset) {
+    const uchar *in = data + offset + TraceFormat::frameHeaderSize;
+    const uchar *payloadEnd = std::min(in + readRaw<quint32>(data + offset + 9), data + framesEnd);
+    if (data[offset] == TraceFormat::keyFrame) {
+        std::fill(fields.begin(), fields.end(), 0);
+    }
+    qint32 *f = fields.data();
+    for (int i = 0; i < drones.size() && in < payloadEnd; i++, f += TraceFormat::fieldCount) {
+        uchar mask = *in++;
+        for (int k = 0; k < TraceFormat::fieldCount; k++) {
+            if (mask & (1 << k)) {
+                f[k] += readVarint(in, payloadEnd);
+            }
+        }
+    }
+    return payloadEnd - data;
+}
+
+/**
+ * @brief TraceReader::seek starts from the keyframe of the slot of t (the previous one if the
+ * keyframe of the slot is after t) and decodes forward, at most the frames of a slot.
+ * @param t time to show
+ * @return the time of the decoded frame
+ */
+double TraceReader::seek(double t) {
+    if (!isOpen() || keyframes.isEmpty()) {
+        return start;
+    }
+    t = std::clamp(t, start, end);
+    int slot = std::clamp(int(std::floor((t - start) / interval)), 0, int(keyframes.size()) - 1);
+    qint64 offset = keyframes[slot];
+    if (slot > 0 && frameTime(offset) > t) {
+        offset = keyframes[slot - 1];
+    }
+    double time = frameTime(offset);
+    offset = decode(offset);
+    while (offset + TraceFormat::frameHeaderSize <= framesEnd && frameTime(offset) <= t) {
+        time = frameTime(offset);
+        offset = decode(offset);
+    }
+
+    const qint32 *f = fields.constData();
+    for (TraceSample &sample : current) {
+        sample.position.set(f[0] / TraceFormat::positionScale, f[1] / TraceFormat::positionScale);
+        sample.status = f[2];
+        sample.power = f[3] / TraceFormat::powerScale;
+        sample.azimut = f[4] / TraceFormat::azimutScale;
+        sample.server = f[5];
+        f += TraceFormat::fieldCount;
+    }
+    return time;
+}
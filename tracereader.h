@@ -0,0 +1,108 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef TRACEREADER_H
+#define TRACEREADER_H
+
+#include <QFile>
+#include <QVector>
+#include <QStringList>
+#include "tracerecorder.h"
+
+/**
+ * @brief TraceReader maps a trace written by TraceRecorder and rebuilds the state of the fleet
+ * at any time: the seek index gives the keyframe of the time slot, then the few delta frames
+ * of the slot are decoded, so a seek costs the same anywhere in the trace.
+ * A trace without footer (recording interrupted) is indexed by scanning its frames once.
+ */
+class TraceReader {
+public:
+    ~TraceReader();
+    /**
+     * @brief open maps the file and reads its header and seek index
+     * @param path: path of the trace
+     * @return false if the file is not a valid trace
+     */
+    bool open(const QString &path);
+    /**
+     * @brief close unmaps the file
+     */
+    void close();
+    /**
+     * @brief isOpen
+     * @return true if a trace is mapped
+     */
+    inline bool isOpen() const { return data != nullptr; }
+    /**
+     * @brief seek decodes the last frame at or before a time
+     * @param t: simulation time, clamped to the trace
+     * @return the time of the decoded frame
+     */
+    double seek(double t);
+    /**
+     * @brief startTime
+     * @return the time of the first frame
+     */
+    inline double startTime() const { return start; }
+    /**
+     * @brief endTime
+     * @return the time of the last frame
+     */
+    inline double endTime() const { return end; }
+    /**
+     * @brief droneNames
+     * @return the names of the recorded drones, in the order of the samples
+     */
+    inline const QStringList &droneNames() const { return drones; }
+    /**
+     * @brief serverNames
+     * @return the names of the servers, TraceSample::server indexes this list
+     */
+    inline const QStringList &serverNames() const { return servers; }
+    /**
+     * @brief samples
+     * @return the state of each drone at the last seek
+     */
+    inline const QVector<TraceSample> &samples() const { return current; }
+
+private:
+    /**
+     * @brief readFooter reads the seek index written by TraceRecorder::stop
+     * @return false if the trace has no valid footer
+     */
+    bool readFooter();
+    /**
+     * @brief scanFrames rebuilds the seek index from the frames
+     */
+    void scanFrames();
+    /**
+     * @brief frameTime
+     * @param offset: offset of a frame
+     * @return its simulation time
+     */
+    double frameTime(qint64 offset) const;
+    /**
+     * @brief decode applies a frame to the quantized fields
+     * @param offset: offset of the frame
+     * @return the offset of the next frame
+     */
+    qint64 decode(qint64 offset);
+
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 size = 0;
+    qint64 firstFrame = 0;      ///< offset of the first frame
+    qint64 framesEnd = 0;       ///< end of the last frame (footer)
+    double start = 0;
+    double end = 0;
+    double interval = 1;
+    QStringList drones;
+    QStringList servers;
+    QVector<qint64> keyframes;  ///< keyframe of each slot
+    QVector<qint32> fields;     ///< quantized fields of the decoded frame
+    QVector<TraceSample> current;
+};
+
+#endif // TRACEREADER_H
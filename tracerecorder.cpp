@@ -0,0 +1,166 @@
+#include "tracerecorder.h"
+#include "drone.h"
+#include <QDebug>
+#include <cmath>
+#include <cstring>
+
+/**
+ * @brief appendRaw copies a value in native byte order
+ */
+template <typename T>
+static char *appendRaw(char *out, T value) {
+    memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
+
+/**
+ * @brief appendVarint writes a signed value zigzag encoded (small magnitudes on few bytes),
+ * then 7 bits per byte with the high bit set when more bytes follow.
+ */
+static char *appendVarint(char *out, qint32 value) {
+    quint32 v = (quint32(value) << 1) ^ quint32(value >> 31);
+    while (v >= 0x80) {
+        *out++ = char(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = char(v);
+    return out;
+}
+
+/**
+ * @brief writeName writes a string as its 16-bit length and UTF-8 bytes
+ */
+static void writeName(QFile &file, const QString &name) {
+    QByteArray utf8 = name.toUtf8().left(0xFFFF);
+    quint16 length = utf8.size();
+    file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    file.write(utf8);
+}
+
+/**
+ * @brief TraceRecorder::start writes the header and sizes the buffers for the fleet and the seek
+ * index for indexReserve slots: a frame only allocates when the index grows beyond (once every
+ * indexReserve keyframe intervals at most).
+ * @param path path of the trace
+ * @param drones drones to record
+ * @param names names of the servers
+ * @param now simulation time
+ * @return true if the file is open
+ */
+bool TraceRecorder::start(const QString &path, const QVector<Drone*> &drones, const QStringList &names, double now) {
+    stop();
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "cannot write" << path;
+        return false;
+    }
+    fleet = drones;
+    startTime = lastTime = now;
+    frames = 0;
+    keyframes.clear();
+    keyframes.reserve(indexReserve);
+    previous.fill(0, fleet.size() * TraceFormat::fieldCount);
+    serverNames.fill(QString(), fleet.size());
+    servers.fill(-1, fleet.size());
+    // mask + a 5-byte varint per field at most
+    buffer.resize(fleet.size() * (1 + 5 * TraceFormat::fieldCount));
+
+    quint32 header[3] = {TraceFormat::version, quint32(fleet.size()), quint32(names.size())};
+    double times[2] = {startTime, keyframeInterval};
+    file.write(TraceFormat::headerMagic, sizeof(TraceFormat::headerMagic));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(times), sizeof(times));
+    for (Drone *drone : fleet) {
+        writeName(file, drone->getName());
+    }
+    for (const QString &name : names) {
+        writeName(file, name);
+    }
+    return true;
+}
+
+/**
+ * @brief TraceRecorder::record quantizes the state of each drone and writes the fields that
+ * changed since the previous frame. The first frame of each keyframeInterval slot is a keyframe
+ * (all the fields against zero) and is added to the seek index; the slots without frame point
+ * to the previous keyframe.
+ * @param now simulation time
+ * @param serverIndex index of the server names of the trace
+ */
+void TraceRecorder::record(double now, const QHash<QString,int> &serverIndex) {
+    if (!file.isOpen()) {
+        return;
+    }
+    const int slot = std::max(0, int(std::floor((now - startTime) / keyframeInterval)));
+    const bool key = slot >= keyframes.size();
+    if (key) {
+        qint64 offset = file.pos();
+        if (keyframes.capacity() <= slot) {
+            keyframes.reserve(slot + indexReserve);
+        }
+        while (keyframes.size() < slot) {
+            keyframes.append(keyframes.isEmpty() ? offset : keyframes.last());
+        }
+        keyframes.append(offset);
+    }
+
+    char *out = buffer.data();
+    qint32 *last = previous.data();
+    for (int i = 0; i < fleet.size(); i++, last += TraceFormat::fieldCount) {
+        Drone *drone = fleet[i];
+        const QString &target = drone->getTargetServerName();
+        if (target != serverNames[i]) { // the lookup only when the target changes
+            serverNames[i] = target;
+            servers[i] = serverIndex.value(target, -1);
+        }
+        Vector2D position = drone->getPosition();
+        qint32 fields[TraceFormat::fieldCount] = {
+            qint32(std::lround(position.x * TraceFormat::positionScale)),
+            qint32(std::lround(position.y * TraceFormat::positionScale)),
+            qint32(drone->getStatus()),
+            qint32(std::lround(drone->getPower() * TraceFormat::powerScale)),
+            qint32(std::lround(drone->getAzimut() * TraceFormat::azimutScale)),
+            qint32(servers[i])
+        };
+        char *mask = out++;
+        *mask = 0;
+        for (int f = 0; f < TraceFormat::fieldCount; f++) {
+            qint32 delta = key ? fields[f] : fields[f] - last[f];
+            if (delta != 0) {
+                *mask |= char(1 << f);
+                out = appendVarint(out, delta);
+            }
+            last[f] = fields[f];
+        }
+    }
+
+    char frameHeader[TraceFormat::frameHeaderSize];
+    char *h = appendRaw(frameHeader, key ? TraceFormat::keyFrame : TraceFormat::deltaFrame);
+    h = appendRaw(h, now);
+    appendRaw(h, quint32(out - buffer.constData()));
+    file.write(frameHeader, sizeof(frameHeader));
+    file.write(buffer.constData(), out - buffer.constData());
+    lastTime = now;
+    frames++;
+}
+
+/**
+ * @brief TraceRecorder::stop appends the seek index and the trailer pointing to it.
+ */
+void TraceRecorder::stop() {
+    if (!file.isOpen()) {
+        return;
+    }
+    qint64 footer = file.pos();
+    quint32 slotCount = keyframes.size();
+    file.write(reinterpret_cast<const char*>(&slotCount), sizeof(slotCount));
+    file.write(reinterpret_cast<const char*>(keyframes.constData()), slotCount * sizeof(qint64));
+    file.write(reinterpret_cast<const char*>(&lastTime), sizeof(lastTime));
+    quint32 count = frames;
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    file.write(TraceFormat::footerMagic, sizeof(TraceFormat::footerMagic));
+    qDebug() << "trace" << file.fileName() << frames << "frames," << file.size() << "bytes";
+    file.close();
+    fleet.clear();
+}
@@ -0,0 +1,111 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QFile>
+#include <QVector>
+#include <QByteArray>
+#include <QStringList>
+#include <QHash>
+#include "vector2d.h"
+
+class Drone;
+
+/**
+ * @brief State of a drone in a frame of a trace
+ */
+struct TraceSample {
+    Vector2D position;
+    int status = 0;     ///< Drone::droneStatus
+    float power = 0;    ///< power in percent
+    float azimut = 0;   ///< heading in degrees
+    int server = -1;    ///< index of the target server in the server names of the trace, -1 if none
+};
+
+/**
+ * @brief Binary format of the traces (native little endian):
+ * - header: magic, version, drone and server counts, start time, keyframe interval, then the
+ *   names of the drones and of the servers (16-bit length + UTF-8);
+ * - frames: kind (key or delta), simulation time, payload size, payload. For each drone the
+ *   payload has a mask of the changed fields then the zigzag varint of the change of each one
+ *   (quantized, against the previous frame, or against zero for a keyframe);
+ * - footer, written by stop(): for each keyframeInterval slot since the start, the offset of
+ *   the last keyframe before the end of the slot; then the offset of the footer and a magic.
+ */
+namespace TraceFormat {
+    constexpr char headerMagic[4] = {'D', 'T', 'R', 'C'};
+    constexpr char footerMagic[4] = {'D', 'T', 'R', 'I'};
+    constexpr quint32 version = 1;
+    constexpr int fieldCount = 6;           ///< x, y, status, power, azimut, server
+    constexpr float positionScale = 8;      ///< 1/8 pixel
+    constexpr float powerScale = 100;       ///< 1/100 percent
+    constexpr float azimutScale = 10;       ///< 1/10 degree
+    constexpr quint8 deltaFrame = 0;
+    constexpr quint8 keyFrame = 1;
+    constexpr int frameHeaderSize = 1 + 8 + 4;
+}
+
+/**
+ * @brief TraceRecorder appends the state of the fleet at each tick to a trace file, delta and
+ * varint encoded against the previous tick with a keyframe every keyframeInterval seconds of
+ * simulation, so that the replay can seek in O(1) (see TraceReader).
+ * The fleet is fixed at the start of the recording, which stops when the scenario changes.
+ */
+class TraceRecorder {
+public:
+    static constexpr double keyframeInterval = 1.0; ///< seconds of simulation between two keyframes
+    static constexpr int indexReserve = 3600;       ///< slots of the seek index reserved at once (an hour)
+
+    /**
+     * @brief start creates the trace file and writes its header
+     * @param path: path of the file
+     * @param fleet: the drones to record
+     * @param serverNames: names of the servers (indexed like the servers of the world)
+     * @param now: simulation time
+     * @return false if the file cannot be created
+     */
+    bool start(const QString &path, const QVector<Drone*> &fleet, const QStringList &serverNames, double now);
+    /**
+     * @brief record appends the current state of the fleet
+     * @param now: simulation time
+     * @param serverIndex: index of each server name
+     */
+    void record(double now, const QHash<QString,int> &serverIndex);
+    /**
+     * @brief stop writes the seek index and closes the file
+     */
+    void stop();
+    /**
+     * @brief isRecording
+     * @return true between start and stop
+     */
+    inline bool isRecording() const { return file.isOpen(); }
+    /**
+     * @brief size
+     * @return the number of bytes written
+     */
+    inline qint64 size() const { return file.isOpen() ? file.pos() : 0; }
+    /**
+     * @brief frameCount
+     * @return the number of recorded frames
+     */
+    inline int frameCount() const { return frames; }
+
+private:
+    QFile file;
+    QVector<Drone*> fleet;          ///< recorded drones
+    QVector<QString> serverNames;   ///< target server name of each drone at the last frame
+    QVector<int> servers;           ///< target server index of each drone at the last frame
+    QVector<qint32> previous;       ///< quantized fields of the last frame, fieldCount per drone
+    QByteArray buffer;              ///< encoded frame, reused
+    QVector<qint64> keyframes;      ///< seek index: keyframe of each slot
+    double startTime = 0;
+    double lastTime = 0;
+    int frames = 0;
+};
+
+#endif // TRACERECORDER_H
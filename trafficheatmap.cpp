@@ -0,0 +1,116 @@
+#include "trafficheatmap.h"
+#include "drone.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+/// weights rescaled above this factor, far from the float limit
+const double maxScale = 1e15;
+
+/**
+ * @brief heatColor transparent blue, then yellow, then opaque red
+ * @param t density in [0, 1]
+ * @return a premultiplied color
+ */
+QRgb heatColor(float t) {
+    if (t <= 0.01f) {
+        return 0;
+    }
+    float r, g, b;
+    if (t < 0.5f) {
+        const float u = t * 2;
+        r = u; g = u; b = 1 - u;
+    } else {
+        const float u = (t - 0.5f) * 2;
+        r = 1; g = 1 - u; b = 0;
+    }
+    const float a = 0.25f + 0.5f * t;
+    return qRgba(int(r * a * 255), int(g * a * 255), int(b * a * 255), int(a * 255));
+}
+}
+
+void TrafficHeatmap::reset(const QSize &size, double now) {
+    canvas = size;
+    columns = std::max(1, (size.width() + cellSize - 1) / cellSize);
+    rows = std::max(1, (size.height() + cellSize - 1) / cellSize);
+    weights.fill(0.0f, columns * rows);
+    density.resize(columns * rows);
+    smoothed.resize(columns * rows);
+    cached = QImage(columns, rows, QImage::Format_ARGB32_Premultiplied);
+    cached.fill(0);
+    epoch = now;
+    dirty = true;
+}
+
+/**
+ * @brief TrafficHeatmap::record adds dt to the cell of each drone, scaled by the growth of the
+ * weights since the epoch: O(drones), whatever the size of the grid.
+ */
+void TrafficHeatmap::record(const QVector<Drone*> &drones, double now, double dt) {
+    double scale = std::exp((now - epoch) / timeConstant);
+    if (scale > maxScale) {
+        // back to unit weights, the only pass over the grid
+        const float factor = float(1 / scale);
+        for (float &weight : weights) {
+            weight *= factor;
+        }
+        epoch = now;
+        scale = 1;
+    }
+    const float sample = float(dt * scale);
+    const float invCell = 1.0f / cellSize;
+    for (Drone *drone : drones) {
+        const Vector2D &position = drone->getPosition();
+        const int x = int(position.x * invCell), y = int(position.y * invCell);
+        if (x >= 0 && y >= 0 && x < columns && y < rows) {
+            weights[y * columns + x] += sample;
+        }
+    }
+    dirty = dirty || !drones.isEmpty();
+}
+
+/**
+ * @brief TrafficHeatmap::image converts the weights to the mean number of drones per cell over
+ * about timeConstant, blurs them and maps them to colors. Without new record the cached image is
+ * kept for a second: the decay in a second is not visible.
+ */
+const QImage &TrafficHeatmap::image(double now) {
+    if (weights.isEmpty() || (!dirty && std::abs(now - cachedTime) < 1)) {
+        return cached;
+    }
+    // the integral of the decay over all the past is timeConstant: the result is a number of drones
+    const float toDensity = float(std::exp(-(now - epoch) / timeConstant) / timeConstant);
+    for (int i = 0; i < weights.size(); i++) {
+        density[i] = weights[i] * toDensity;
+    }
+    blur(density, smoothed, true);
+    blur(smoothed, density, false);
+    const float invSaturation = 1.0f / saturation;
+    for (int y = 0; y < rows; y++) {
+        QRgb *line = reinterpret_cast<QRgb*>(cached.scanLine(y));
+        const float *values = density.constData() + y * columns;
+        for (int x = 0; x < columns; x++) {
+            line[x] = heatColor(std::min(1.0f, values[x] * invSaturation));
+        }
+    }
+    dirty = false;
+    cachedTime = now;
+    return cached;
+}
+
+void TrafficHeatmap::blur(const QVector<float> &from, QVector<float> &to, bool horizontal) const {
+    const int step = horizontal ? 1 : columns;
+    const int length = horizontal ? columns : rows;
+    const int lines = horizontal ? rows : columns;
+    const int lineStep = horizontal ? columns : 1;
+    for (int l = 0; l < lines; l++) {
+        const float *in = from.constData() + l * lineStep;
+        float *out = to.data() + l * lineStep;
+        for (int i = 0; i < length; i++) {
+            // the border cells are repeated
+            const float before = in[std::max(i - 1, 0) * step];
+            const float after = in[std::min(i + 1, length - 1) * step];
+            out[i * step] = 0.25f * before + 0.5f * in[i * step] + 0.25f * after;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef TRAFFICHEATMAP_H
+#define TRAFFICHEATMAP_H
+
+#include <QVector>
+#include <QImage>
+#include <QSize>
+
+class Drone;
+
+/**
+ * @brief TrafficHeatmap accumulates where the drones fly in a coarse occupancy grid with an
+ * exponential decay, shown as an overlay of the canvas.
+ * The decay is not applied to the cells at each tick: a sample added at time t weighs
+ * exp((t - epoch) / timeConstant), and the grid is read multiplied by exp(-(now - epoch) / timeConstant).
+ * A tick only touches the cells of the moving drones; the weights are brought back near 1 (one
+ * pass over the grid) when they become large, about every 20 minutes of simulation.
+ * The image (blur and color map) is computed again only when it is drawn, and only if the grid
+ * changed or the density decayed since the last one.
+ */
+class TrafficHeatmap {
+public:
+    static constexpr int cellSize = 16;             ///< pixels per cell
+    static constexpr double timeConstant = 30;      ///< seconds for the density to decay by e
+    static constexpr float saturation = 1.0f;       ///< drones per cell shown with the hottest color
+
+    /**
+     * @brief reset sizes an empty grid for the canvas
+     * @param size: size of the canvas
+     * @param now: simulation time
+     */
+    void reset(const QSize &size, double now);
+    /**
+     * @brief canvasSize
+     * @return the size of the canvas given to reset
+     */
+    inline const QSize &canvasSize() const { return canvas; }
+    /**
+     * @brief record adds the time spent by the moving drones in their cell during a tick
+     * @param drones: the hovering and flying drones
+     * @param now: simulation time at the end of the tick
+     * @param dt: duration of the tick
+     */
+    void record(const QVector<Drone*> &drones, double now, double dt);
+    /**
+     * @brief image the blurred and color mapped density at a time, cached until the next record
+     * (or a second of decay)
+     * @param now: simulation time
+     * @return an image of one pixel per cell with alpha, to scale on the canvas
+     */
+    const QImage &image(double now);
+
+private:
+    /**
+     * @brief blur smooths one direction of the density with a [1 2 1]/4 kernel
+     * @param from: the density
+     * @param to: the smoothed density
+     * @param horizontal: direction of the kernel
+     */
+    void blur(const QVector<float> &from, QVector<float> &to, bool horizontal) const;
+
+    QSize canvas;                   ///< size of the canvas
+    int columns = 0, rows = 0;
+    QVector<float> weights;         ///< time spent in each cell, scaled by exp((t - epoch) / timeConstant)
+    QVector<float> density, smoothed; ///< blur buffers (reused)
+    double epoch = 0;               ///< time of the unit weight
+    QImage cached;
+    bool dirty = true;              ///< the grid changed since the image was computed
+    double cachedTime = -1;         ///< time of the cached image
+};
+
+#endif // TRAFFICHEATMAP_H
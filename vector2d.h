@@ -1,95 +1,167 @@
-/**
- * @brief Drone_demo project
- * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
- * @date dec. 2024
- **/
-#ifndef VECTOR2D_H
-#define VECTOR2D_H
-
-#include <cmath>
-
-class Vector2D {
-public:
-    float x,y; ///< coordinates of the vector
-    Vector2D(float p_x,float p_y):x(p_x),y(p_y) {};
-    Vector2D() { x=y=0.0; }
-    Vector2D(Vector2D *p):x(p->x),y(p->y) {};
-
-    /**
-     * @brief set new coordinates to the vector
-     * @param p_x: x component
-     * @param p_y: y component
-     */
-    void set(float p_x,float p_y) { x=p_x; y=p_y; }
-    /**
-     * @brief length: return the length (or the norm) of the vector
-     * @return the length
-     */
-    double length() const {
-        return sqrt(x*x+y*y);
-    }
-    /**
-     * @brief normalize: change the current vector to a vector with the same direction but a norme equal to 1
-     */
-    void normalize() {
-        float l=float(length());
-        x/=l;
-        y/=l;
-    }
-    /**
-     * @brief orthoNormed: return a new vector, orthogonal and normed
-     * @return the orthonormed vector
-     */
-    Vector2D orthoNormed() const {
-        float l=float(length());
-        return Vector2D(y/l,-x/l);
-    }
-    /**
-     * @brief operator []: a way to get the component of the vector
-     * @param i: equal to 0 or 1
-     * @return x if i is equal to 0 and y else
-     */
-    float operator[](const int i) const {
-        return (i==0)?x:y;
-    };
-    /**
-     * @brief operator +=: multiply the components of the current vector with the components of the vector v
-     * @param v: the multiplier
-     */
-    void operator+=(const Vector2D& v) {
-        x+=v.x;
-        y+=v.y;
-    }
-
-    Vector2D operator*(double scalar) const {
-        return Vector2D(x * scalar, y * scalar);
-    }
-
-
-    Vector2D operator/(double scalar) const {
-        return Vector2D(x / scalar, y / scalar);
-    }
-
-
-
-    friend double operator *(const Vector2D&,const Vector2D&);
-    friend const Vector2D operator *(double,const Vector2D&);
-    friend const Vector2D operator +(const Vector2D&,const Vector2D&);
-    friend const Vector2D operator -(const Vector2D&,const Vector2D&);
-    friend const Vector2D operator -(const Vector2D&);
-    friend double operator ^(const Vector2D&,const Vector2D&);
-    friend bool operator ==(const Vector2D&,const Vector2D&);
-    friend bool operator !=(const Vector2D&,const Vector2D&);
-};
-
-const Vector2D operator *(double,const Vector2D&);
-double operator *(const Vector2D&,const Vector2D&);
-const Vector2D operator +(const Vector2D&,const Vector2D&);
-const Vector2D operator -(const Vector2D&,const Vector2D&);
-const Vector2D operator -(const Vector2D&);
-double operator ^(const Vector2D&,const Vector2D&);
-bool operator==(const Vector2D&,const Vector2D&);
-bool operator !=(const Vector2D&,const Vector2D&);
-
-
-#endif // VECTOR2D_H
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef VECTOR2D_H
+#define VECTOR2D_H
+
+#include <cmath>
+
+/**
+ * @brief 2D vector with components of type T.
+ * All the operators are inline, constexpr when possible, and compute in the precision T
+ * (no float/double round trip in the drone hot path).
+ */
+template <typename T>
+class Vector2 {
+public:
+    T x,y; ///< coordinates of the vector
+    constexpr Vector2(T p_x,T p_y) noexcept:x(p_x),y(p_y) {}
+    constexpr Vector2() noexcept:x(0),y(0) {}
+    explicit constexpr Vector2(const Vector2 *p) noexcept:x(p->x),y(p->y) {}
+
+    /**
+     * @brief set new coordinates to the vector
+     * @param p_x: x component
+     * @param p_y: y component
+     */
+    constexpr void set(T p_x,T p_y) noexcept { x=p_x; y=p_y; }
+    /**
+     * @brief lengthSquared: return the square of the length (no square root)
+     * @return the squared length
+     */
+    constexpr T lengthSquared() const noexcept {
+        return x*x+y*y;
+    }
+    /**
+     * @brief length: return the length (or the norm) of the vector
+     * @return the length
+     */
+    T length() const noexcept {
+        return std::sqrt(lengthSquared());
+    }
+    /**
+     * @brief normalize: change the current vector to a vector with the same direction but a norme equal to 1
+     */
+    void normalize() noexcept {
+        T l=length();
+        x/=l;
+        y/=l;
+    }
+    /**
+     * @brief normalizeLength: normalize the vector and return its previous length,
+     * with a single square root. A null vector is left unchanged.
+     * @return the length before normalization
+     */
+    T normalizeLength() noexcept {
+        T l=length();
+        if (l>T(0)) {
+            T inv=T(1)/l;
+            x*=inv;
+            y*=inv;
+        }
+        return l;
+    }
+    /**
+     * @brief orthoNormed: return a new vector, orthogonal and normed
+     * @return the orthonormed vector
+     */
+    Vector2 orthoNormed() const noexcept {
+        T l=length();
+        return Vector2(y/l,-x/l);
+    }
+    /**
+     * @brief operator []: a way to get the component of the vector
+     * @param i: equal to 0 or 1
+     * @return x if i is equal to 0 and y else
+     */
+    constexpr T operator[](const int i) const noexcept {
+        return (i==0)?x:y;
+    }
+    /**
+     * @brief operator +=: add the components of the vector v to the current vector
+     * @param v: the vector to add
+     */
+    constexpr void operator+=(const Vector2& v) noexcept {
+        x+=v.x;
+        y+=v.y;
+    }
+
+    constexpr Vector2 operator*(T scalar) const noexcept {
+        return Vector2(x * scalar, y * scalar);
+    }
+
+    constexpr Vector2 operator/(T scalar) const noexcept {
+        return Vector2(x / scalar, y / scalar);
+    }
+
+    /// dot product
+    friend constexpr T operator *(const Vector2 &u,const Vector2 &v) noexcept {
+        return u.x*v.x+u.y*v.y;
+    }
+    friend constexpr Vector2 operator *(T a,const Vector2 &v) noexcept {
+        return Vector2(a*v.x,a*v.y);
+    }
+    friend constexpr Vector2 operator +(const Vector2 &u,const Vector2 &v) noexcept {
+        return Vector2(u.x+v.x,u.y+v.y);
+    }
+    friend constexpr Vector2 operator -(const Vector2 &u,const Vector2 &v) noexcept {
+        return Vector2(u.x-v.x,u.y-v.y);
+    }
+    friend constexpr Vector2 operator -(const Vector2 &v) noexcept {
+        return Vector2(-v.x,-v.y);
+    }
+    /// cross product (z component)
+    friend constexpr T operator ^(const Vector2 &u,const Vector2 &v) noexcept {
+        return u.x*v.y-u.y*v.x;
+    }
+    friend constexpr bool operator ==(const Vector2 &u,const Vector2 &v) noexcept {
+        return (u.x==v.x && u.y==v.y);
+    }
+    friend constexpr bool operator !=(const Vector2 &u,const Vector2 &v) noexcept {
+        return !(u==v);
+    }
+};
+
+/**
+ * @brief Vector2D: the vector type used by the drones and the servers
+ */
+using Vector2D = Vector2<float>;
+
+/**
+ * @brief batch helpers on contiguous arrays of vectors (the loops are easy to vectorize)
+ */
+namespace Vector2Batch {
+    /**
+     * @brief axpy: p[i] += s*v[i] for i in [0,n[
+     */
+    template <typename T>
+    inline void axpy(Vector2<T> *p,const Vector2<T> *v,T s,int n) noexcept {
+        for (int i=0; i<n; i++) {
+            p[i].x+=s*v[i].x;
+            p[i].y+=s*v[i].y;
+        }
+    }
+    /**
+     * @brief distanceSquared: d[i] = |p[i]-q|^2 for i in [0,n[
+     */
+    template <typename T>
+    inline void distanceSquared(const Vector2<T> *p,const Vector2<T> &q,T *d,int n) noexcept {
+        for (int i=0; i<n; i++) {
+            T dx=p[i].x-q.x, dy=p[i].y-q.y;
+            d[i]=dx*dx+dy*dy;
+        }
+    }
+    /**
+     * @brief normalizeLength: normalize every vector and store its previous length in l[i]
+     */
+    template <typename T>
+    inline void normalizeLength(Vector2<T> *v,T *l,int n) noexcept {
+        for (int i=0; i<n; i++) {
+            l[i]=v[i].normalizeLength();
+        }
+    }
+}
+
+#endif // VECTOR2D_H
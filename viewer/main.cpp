@@ -0,0 +1,15 @@
+#include "viewerwidget.h"
+#include "sharedstate.h"
+
+#include <QApplication>
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+    // the segment exported by drones --shm <name>
+    QString name = argc > 1 ? QString(argv[1]) : QString(SharedState::defaultName);
+    ViewerWidget w(name);
+    w.resize(800, 800);
+    w.show();
+    return a.exec();
+}
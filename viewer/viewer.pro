@@ -0,0 +1,19 @@
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++17
+
+TARGET = drones_viewer
+
+# shared memory layout of the simulation (see sharedstate.h)
+INCLUDEPATH += ..
+
+unix:!macx: LIBS += -lrt
+
+SOURCES += \
+    main.cpp \
+    viewerwidget.cpp
+HEADERS += \
+    ../sharedstate.h \
+    viewerwidget.h
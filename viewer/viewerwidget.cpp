@@ -0,0 +1,157 @@
+#include "viewerwidget.h"
+#include <QPainter>
+#include <QTimer>
+#include <QDebug>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ViewerWidget::ViewerWidget(const QString &name, QWidget *parent)
+    : QWidget(parent), segmentName(name.toUtf8()) {
+    setWindowTitle(tr("Drones viewer - %1").arg(name));
+    QTimer *timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &ViewerWidget::refresh);
+    timer->start(refreshInterval);
+}
+
+ViewerWidget::~ViewerWidget() {
+    detach();
+}
+
+bool ViewerWidget::attach() {
+#ifdef Q_OS_UNIX
+    int fd = shm_open(segmentName.constData(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    void *base = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(SharedState::Header)) {
+        size = info.st_size;
+        base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    header = static_cast<const SharedState::Header*>(base);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // the magic is written last by the simulation, the capacities must fit the mapped size
+    if (memcmp(header->magic, SharedState::magic, sizeof(SharedState::magic)) != 0
+            || header->version != SharedState::version
+            || header->headerSize != sizeof(SharedState::Header)
+            || SharedState::segmentSize(header->droneCapacity, header->serverCapacity) > size) {
+        detach();
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ViewerWidget::detach() {
+#ifdef Q_OS_UNIX
+    if (header) {
+        munmap(const_cast<SharedState::Header*>(header), size);
+    }
+#endif
+    header = nullptr;
+    size = 0;
+    lastTicks = 0;
+}
+
+/**
+ * @brief ViewerWidget::refresh copies the arrays between two reads of the same even sequence
+ * into scratch buffers, swapped with the drawn state only when the copy is consistent; a copy
+ * torn by a write of the simulation is made again, after maxRetries the previous state is kept
+ * until the next refresh.
+ */
+void ViewerWidget::refresh() {
+    if (header && header->retired.load(std::memory_order_acquire)) {
+        detach();
+    }
+    if (!header && !attach()) {
+        if (!drones.isEmpty() || !servers.isEmpty()) {
+            drones.clear();
+            servers.clear();
+            QWidget::update();
+        }
+        return;
+    }
+    const char *base = reinterpret_cast<const char*>(header);
+    const SharedState::Drone *sharedDrones = reinterpret_cast<const SharedState::Drone*>(base + SharedState::dronesOffset());
+    const SharedState::Server *sharedServers = reinterpret_cast<const SharedState::Server*>(base + SharedState::serversOffset(header->droneCapacity));
+    for (int retry = 0; retry < maxRetries; retry++) {
+        const quint32 before = header->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue; // being written
+        }
+        if (header->ticks == lastTicks && !drones.isEmpty()) {
+            return; // nothing new
+        }
+        quint32 droneCount = qMin(header->droneCount, header->droneCapacity);
+        quint32 serverCount = qMin(header->serverCount, header->serverCapacity);
+        readDrones.resize(droneCount);
+        readServers.resize(serverCount);
+        memcpy(readDrones.data(), sharedDrones, droneCount * sizeof(SharedState::Drone));
+        memcpy(readServers.data(), sharedServers, serverCount * sizeof(SharedState::Server));
+        const quint32 ticks = header->ticks;
+        const float readWidth = header->width, readHeight = header->height;
+        const double readTime = header->time;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->sequence.load(std::memory_order_relaxed) == before) {
+            drones.swap(readDrones);
+            servers.swap(readServers);
+            width = readWidth;
+            height = readHeight;
+            time = readTime;
+            lastTicks = ticks;
+            QWidget::update();
+            return;
+        }
+    }
+}
+
+/**
+ * @brief ViewerWidget::paintEvent draws the servers and the drones of the last copy, the world
+ * scaled to the widget.
+ */
+void ViewerWidget::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::white);
+    if (!header) {
+        painter.drawText(rect(), Qt::AlignCenter, tr("Waiting for the simulation (%1)...").arg(QString::fromUtf8(segmentName)));
+        return;
+    }
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.drawText(8, 16, tr("t=%1s  drones:%2  servers:%3").arg(time, 0, 'f', 1).arg(drones.size()).arg(servers.size()));
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    const double scale = qMin(this->width() / width, this->height() / height);
+    painter.scale(scale, scale);
+
+    // servers: a disc of their color, grey when down
+    painter.setPen(Qt::black);
+    for (const SharedState::Server &server : servers) {
+        painter.setBrush(server.online ? QColor::fromRgb(server.rgb) : QColor(Qt::lightGray));
+        painter.drawEllipse(QPointF(server.x, server.y), 10, 10);
+        painter.drawText(QPointF(server.x + 12, server.y + 4), QString::fromUtf8(server.name));
+    }
+    // drones: a triangle oriented by their azimut, red in collision, hollow when landed
+    const QPointF arrow[3] = {{0, -8}, {5, 6}, {-5, 6}};
+    for (const SharedState::Drone &drone : drones) {
+        painter.save();
+        painter.translate(drone.x, drone.y);
+        painter.rotate(drone.azimut);
+        painter.setPen(drone.collision ? Qt::red : Qt::darkBlue);
+        painter.setBrush(drone.status == 0 ? QBrush(Qt::NoBrush) : QBrush(drone.collision ? Qt::red : Qt::blue));
+        painter.drawPolygon(arrow, 3);
+        painter.restore();
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef VIEWERWIDGET_H
+#define VIEWERWIDGET_H
+
+#include <QWidget>
+#include <QVector>
+#include <QByteArray>
+#include "sharedstate.h"
+
+/**
+ * @brief ViewerWidget draws the state exported by a simulation running in another process.
+ * The segment is mapped read only; a timer copies the arrays under the sequence lock and
+ * repaints, so the simulation never waits for the viewer. The segment is mapped again when it
+ * is retired (larger fleet, simulation restarted).
+ */
+class ViewerWidget : public QWidget {
+    Q_OBJECT
+public:
+    static constexpr int refreshInterval = 33; ///< ms between two copies
+    static constexpr int maxRetries = 64;      ///< copies tried while the simulation writes
+
+    explicit ViewerWidget(const QString &name, QWidget *parent = nullptr);
+    ~ViewerWidget();
+
+protected:
+    void paintEvent(QPaintEvent *) override;
+
+private:
+    /**
+     * @brief attach maps the segment
+     * @return true if a valid segment is mapped
+     */
+    bool attach();
+    /**
+     * @brief detach unmaps the segment
+     */
+    void detach();
+    /**
+     * @brief refresh copies a consistent state and repaints
+     */
+    void refresh();
+
+    QByteArray segmentName;
+    const SharedState::Header *header = nullptr;
+    size_t size = 0;
+    quint32 lastTicks = 0;
+    QVector<SharedState::Drone> drones;   ///< copy of the last consistent state
+    QVector<SharedState::Server> servers;
+    QVector<SharedState::Drone> readDrones;   ///< copy in progress, swapped with drones once consistent
+    QVector<SharedState::Server> readServers;
+    float width = 0, height = 0;
+    double time = 0;
+};
+
+#endif // VIEWERWIDGET_H
@@ -0,0 +1,309 @@
+#include "worldsnapshot.h"
+#include <QFile>
+#include <QSaveFile>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+/**
+ * @brief Sections of a snapshot file, in the order of the file
+ */
+enum Section { Servers, Types, Drones, EdgeStart, EdgeTo, NextHop, HopCount, HopParent, Pads, Queues,
+               Charging, RegionIds, Background, NameOffsets, NameData, SectionCount };
+
+/**
+ * @brief Position of a section: offset in the file and number of elements
+ */
+struct SectionEntry {
+    quint64 offset;
+    quint64 count;
+};
+
+/**
+ * @brief Header at the start of a snapshot file
+ */
+struct Header {
+    char magic[8];
+    quint32 version;
+    quint32 headerSize;
+    quint32 recordSizes[5];         ///< server, type, drone, pad and queue records
+    qint32 width, height;           ///< size of the raster
+    qint32 reserved;
+    double time;
+    LandingControl::Counters counters;
+    SectionEntry sections[SectionCount];
+};
+
+constexpr char snapshotMagic[8] = {'D', 'R', 'N', 'S', 'N', 'A', 'P', 0};
+
+static_assert(std::is_trivially_copyable<WorldSnapshot::DroneRecord>::value, "drone records are copied as is");
+static_assert(std::is_trivially_copyable<LandingControl::PadState>::value, "pad records are copied as is");
+
+/**
+ * @brief elementSize
+ * @return the size of an element of each section
+ */
+quint64 elementSize(int section) {
+    switch (section) {
+        case Servers: return sizeof(WorldSnapshot::ServerRecord);
+        case Types: return sizeof(WorldSnapshot::TypeRecord);
+        case Drones: return sizeof(WorldSnapshot::DroneRecord);
+        case Pads: return sizeof(LandingControl::PadState);
+        case Queues: return sizeof(LandingControl::QueueState);
+        case Background:
+        case NameData: return 1;
+        default: return sizeof(qint32);
+    }
+}
+
+void recordSizes(quint32 sizes[5]) {
+    const int sections[5] = {Servers, Types, Drones, Pads, Queues};
+    for (int i = 0; i < 5; i++) {
+        sizes[i] = elementSize(sections[i]);
+    }
+}
+
+/**
+ * @brief copySection copies a mapped section to a vector
+ */
+template <typename T>
+void copySection(const uchar *data, const SectionEntry &entry, QVector<T> &out) {
+    out.resize(entry.count);
+    memcpy(out.data(), data + entry.offset, entry.count * sizeof(T));
+}
+
+/**
+ * @brief inRange
+ * @return true if all the values are in [low, limit[
+ */
+bool inRange(const QVector<qint32> &values, qint64 low, qint64 limit) {
+    for (qint32 v : values) {
+        if (v < low || v >= limit) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief validRoute
+ * @return true if the servers of the route are in [-1, servers[ and its connection in [-1, edges[
+ */
+bool validRoute(const Drone::Route &route, qint64 servers, qint64 edges) {
+    for (int server : {route.from, route.target, route.stop, route.stopFrom, route.destination}) {
+        if (server < -1 || server >= servers) return false;
+    }
+    return route.edge >= -1 && route.edge < edges;
+}
+
+/**
+ * @brief validType like the types of a scenario file (see Scenario), the phases and ranges divide
+ * by these rates
+ * @return true if the speeds, power and rates are positive
+ */
+bool validType(const WorldSnapshot::TypeRecord &type) {
+    return type.maxSpeed > 0 && type.maxPower > 0 && type.takeoffSpeed > 0 && type.hoveringHeight >= 0
+            && type.chargingSpeed > 0 && type.powerConsumption > 0;
+}
+
+}
+
+/**
+ * @brief WorldSnapshot::write encodes the names, places the sections after the header and
+ * writes them with QSaveFile (the previous file stays until the commit).
+ * @param path path of the file
+ * @param error message on failure
+ * @return true if written
+ */
+bool WorldSnapshot::write(const QString &path, QString &error) const {
+    QVector<qint32> nameOffsets;
+    QByteArray nameData;
+    nameOffsets.reserve(names.size() + 1);
+    for (const QString &name : names) {
+        nameOffsets.append(nameData.size());
+        nameData.append(name.toUtf8());
+    }
+    nameOffsets.append(nameData.size());
+    QImage raster = background.format() == QImage::Format_RGB32 ? background : background.convertToFormat(QImage::Format_RGB32);
+
+    const void *data[SectionCount] = {
+        servers.constData(), types.constData(), drones.constData(), edgeStart.constData(), edgeTo.constData(),
+        nextHop.constData(), hopCount.constData(), hopParent.constData(), pads.constData(), queues.constData(),
+        charging.constData(), regionIds.constData(), raster.constBits(), nameOffsets.constData(), nameData.constData()
+    };
+    const quint64 counts[SectionCount] = {
+        quint64(servers.size()), quint64(types.size()), quint64(drones.size()), quint64(edgeStart.size()), quint64(edgeTo.size()),
+        quint64(nextHop.size()), quint64(hopCount.size()), quint64(hopParent.size()), quint64(pads.size()), quint64(queues.size()),
+        quint64(charging.size()), quint64(regionIds.size()), quint64(raster.isNull() ? 0 : raster.sizeInBytes()),
+        quint64(nameOffsets.size()), quint64(nameData.size())
+    };
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = version;
+    header.headerSize = sizeof(Header);
+    recordSizes(header.recordSizes);
+    header.width = raster.width();
+    header.height = raster.height();
+    header.time = time;
+    header.counters = landingCounters;
+    quint64 offset = sizeof(Header);
+    for (int s = 0; s < SectionCount; s++) {
+        offset = (offset + 7) & ~quint64(7);
+        header.sections[s] = SectionEntry{offset, counts[s]};
+        offset += counts[s] * elementSize(s);
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const char padding[8] = {};
+    for (int s = 0; s < SectionCount; s++) {
+        file.write(padding, header.sections[s].offset - file.pos());
+        file.write(static_cast<const char*>(data[s]), counts[s] * elementSize(s));
+    }
+    if (!file.commit()) {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief WorldSnapshot::read checks the header and the bounds of every section before copying
+ * them out of the mapped file, then checks that the indices (including the routes of the drones)
+ * are consistent and the rates of the types positive, so that a bad file is refused instead of
+ * crashing the restore.
+ * @param path path of the file
+ * @param error message on failure
+ * @return true if the snapshot is read
+ */
+bool WorldSnapshot::read(const QString &path, QString &error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    const quint64 size = file.size();
+    const uchar *data = size >= sizeof(Header) ? file.map(0, size) : nullptr;
+    if (!data) {
+        error = QObject::tr("%1 is not a snapshot.").arg(path);
+        return false;
+    }
+    Header header;
+    memcpy(&header, data, sizeof(header));
+    quint32 sizes[5];
+    recordSizes(sizes);
+    if (memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0) {
+        error = QObject::tr("%1 is not a snapshot.").arg(path);
+        return false;
+    }
+    if (header.version != version || header.headerSize != sizeof(Header) || memcmp(header.recordSizes, sizes, sizeof(sizes)) != 0) {
+        error = QObject::tr("%1 was saved by another version (%2).").arg(path).arg(header.version);
+        return false;
+    }
+    for (int s = 0; s < SectionCount; s++) {
+        const SectionEntry &entry = header.sections[s];
+        if (entry.offset > size || entry.count > (size - entry.offset) / elementSize(s)) {
+            error = QObject::tr("%1 is truncated.").arg(path);
+            return false;
+        }
+    }
+
+    time = header.time;
+    landingCounters = header.counters;
+    copySection(data, header.sections[Servers], servers);
+    copySection(data, header.sections[Types], types);
+    copySection(data, header.sections[Drones], drones);
+    copySection(data, header.sections[EdgeStart], edgeStart);
+    copySection(data, header.sections[EdgeTo], edgeTo);
+    copySection(data, header.sections[NextHop], nextHop);
+    copySection(data, header.sections[HopCount], hopCount);
+    copySection(data, header.sections[HopParent], hopParent);
+    copySection(data, header.sections[Pads], pads);
+    copySection(data, header.sections[Queues], queues);
+    copySection(data, header.sections[Charging], charging);
+    copySection(data, header.sections[RegionIds], regionIds);
+    QVector<qint32> nameOffsets;
+    copySection(data, header.sections[NameOffsets], nameOffsets);
+
+    const SectionEntry &raster = header.sections[Background];
+    background = QImage();
+    if (header.width > 0 && header.height > 0 && raster.count == quint64(header.width) * header.height * 4) {
+        background = QImage(header.width, header.height, QImage::Format_RGB32);
+        memcpy(background.bits(), data + raster.offset, raster.count);
+    }
+
+    const SectionEntry &nameData = header.sections[NameData];
+    const char *text = reinterpret_cast<const char*>(data + nameData.offset);
+    names.clear();
+    names.reserve(nameOffsets.size());
+    for (int i = 0; i + 1 < nameOffsets.size(); i++) {
+        qint32 begin = nameOffsets[i], end = nameOffsets[i + 1];
+        if (begin < 0 || end < begin || quint64(end) > nameData.count) {
+            error = QObject::tr("%1 is corrupted.").arg(path);
+            return false;
+        }
+        names.append(QString::fromUtf8(text + begin, end - begin));
+    }
+    file.unmap(const_cast<uchar*>(data));
+
+    const qint64 n = servers.size();
+    bool valid = edgeStart.size() == n + 1 && nextHop.size() == n * n && hopCount.size() == n * n && hopParent.size() == n * n
+            && inRange(edgeTo, 0, n) && inRange(nextHop, -1, n) && inRange(hopParent, -1, n) && inRange(regionIds, -1, n)
+            && inRange(charging, 0, drones.size()) && (background.isNull() || regionIds.size() == qint64(header.width) * header.height);
+    for (int s = 0; valid && s < n; s++) {
+        valid = servers[s].name < quint32(names.size()) && edgeStart[s] >= 0 && edgeStart[s] <= edgeStart[s + 1] && edgeStart[s + 1] <= edgeTo.size();
+    }
+    for (int t = 0; valid && t < types.size(); t++) {
+        valid = types[t].name < quint32(names.size()) && validType(types[t]);
+    }
+    for (int d = 0; valid && d < drones.size(); d++) {
+        valid = drones[d].name < quint32(names.size()) && drones[d].target >= -1 && drones[d].target < n
+                && drones[d].state.typeId >= 0 && drones[d].state.typeId < types.size()
+                && validRoute(drones[d].state.route, n, edgeTo.size());
+    }
+    if (!valid) {
+        error = QObject::tr("%1 is corrupted.").arg(path);
+        return false;
+    }
+    return true;
+}
+
+SnapshotWriter::SnapshotWriter(QObject *parent)
+    : QThread{parent} {
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    wait();
+}
+
+/**
+ * @brief SnapshotWriter::save waits for the previous save, so that two saves never write the
+ * same file at the same time.
+ * @param s the snapshot
+ * @param path path of the file
+ */
+void SnapshotWriter::save(std::unique_ptr<WorldSnapshot> s, const QString &path) {
+    wait();
+    snapshot = std::move(s);
+    filePath = path;
+    start(QThread::LowPriority);
+}
+
+/**
+ * @brief SnapshotWriter::run writes the snapshot in the background thread.
+ */
+void SnapshotWriter::run() {
+    QString error;
+    bool ok = snapshot->write(filePath, error);
+    snapshot.reset();
+    if (ok) {
+        emit saved(filePath);
+    } else {
+        emit failed(error);
+    }
+}
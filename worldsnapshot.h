@@ -0,0 +1,119 @@
+/**
+ * @brief Drone_demo project
+ * @author B.Piranda ---STUDENTS-ZAHRAHMAN Bilal & ABIONA Boluwatife
+ * @date dec. 2024
+ **/
+#ifndef WORLDSNAPSHOT_H
+#define WORLDSNAPSHOT_H
+
+#include <QThread>
+#include <QVector>
+#include <QStringList>
+#include <QImage>
+#include <memory>
+#include "drone.h"
+#include "landingcontrol.h"
+
+/**
+ * @brief WorldSnapshot is a copy of the running world at a tick boundary (servers, connections,
+ * routing table, Voronoi raster, drone types, drones, landing pads and queues), filled by
+ * Canvas::captureSnapshot and applied by Canvas::restoreSnapshot.
+ * The file is a fixed layout: a versioned header with the size of the records and the offset
+ * of each section, then the sections, arrays of plain records aligned on 8 bytes, so that a
+ * mapped file is read with a few copies.
+ */
+class WorldSnapshot {
+public:
+    static constexpr quint32 version = 1;
+
+    /**
+     * @brief A server, its name is an index in names
+     */
+    struct ServerRecord {
+        Vector2D position;
+        quint32 rgb;
+        qint32 capacity;
+        qint32 online;
+        quint32 name;
+    };
+    /**
+     * @brief A drone type, indexed by its ID in DroneTypes
+     */
+    struct TypeRecord {
+        quint32 name;
+        qint32 reserved;
+        double maxSpeed, maxPower, takeoffSpeed, hoveringHeight, damping, chargingSpeed, powerConsumption;
+    };
+    /**
+     * @brief A drone
+     */
+    struct DroneRecord {
+        Drone::State state;
+        qint32 target; ///< index of the target server, -1 if none
+        quint32 name;
+    };
+
+    double time = 0;                          ///< simulation time
+    QVector<ServerRecord> servers;
+    QVector<TypeRecord> types;                ///< all the types of DroneTypes
+    QVector<DroneRecord> drones;
+    QVector<qint32> edgeStart;                ///< first connection of each server (one more entry at the end)
+    QVector<qint32> edgeTo;                   ///< connected server of each connection
+    QVector<int> nextHop, hopCount, hopParent; ///< routing table (see Scenario)
+    QVector<LandingControl::PadState> pads;
+    QVector<LandingControl::QueueState> queues;
+    LandingControl::Counters landingCounters{};
+    QVector<qint32> charging;                 ///< drones landed at a charging stop
+    QImage background;                        ///< Voronoi raster
+    QVector<int> regionIds;                   ///< server of each pixel of background
+    QStringList names;                        ///< names of the servers, types and drones
+
+    /**
+     * @brief write saves the snapshot (can be called from any thread), the file is replaced
+     * only when it is complete
+     * @param path: path of the file
+     * @param error: message set on failure
+     * @return true if saved
+     */
+    bool write(const QString &path, QString &error) const;
+    /**
+     * @brief read maps a snapshot file and copies its sections
+     * @param path: path of the file
+     * @param error: message set on failure
+     * @return true if the file is a valid snapshot of this version
+     */
+    bool read(const QString &path, QString &error);
+};
+
+/**
+ * @brief SnapshotWriter writes a WorldSnapshot in a background thread, the simulation goes on
+ * while the file is written.
+ */
+class SnapshotWriter : public QThread {
+    Q_OBJECT
+public:
+    explicit SnapshotWriter(QObject *parent = nullptr);
+    /**
+     * @brief SnapshotWriter destructor, waits for the running save
+     */
+    ~SnapshotWriter();
+    /**
+     * @brief save starts to write a snapshot, after the running save if any
+     * @param snapshot: the copy of the world
+     * @param path: path of the file
+     */
+    void save(std::unique_ptr<WorldSnapshot> snapshot, const QString &path);
+
+signals:
+    void saved(const QString &path);
+    void failed(const QString &message);
+
+protected:
+    void run() override;
+
+private:
+    std::unique_ptr<WorldSnapshot> snapshot; ///< snapshot being written
+    QString filePath;                        ///< file to write
+};
+
+#endif // WORLDSNAPSHOT_H